@@ -34,6 +34,12 @@ if "%~2"=="editor" (
 	..\..\vendor\bin\ispc.exe ..\..\src\ispc\simple.ispc -o simple.ispc.obj -h ..\..\src\ispc\simple.ispc.h --target=sse4-i32x4
 )
 
+if "%~2"=="test" (
+	echo compiling ispc kernels...
+	rem one object per target plus kernels.ispc.obj, which dispatches to the best target at runtime
+	..\..\vendor\bin\ispc.exe ..\..\src\ispc\kernels.ispc -O2 -o kernels.ispc.obj -h ..\..\src\ispc\kernels.ispc.h --target=sse4-i32x4,avx2-i32x8,avx512skx-i32x16
+)
+
 popd
 popd
 
@@ -30,15 +30,22 @@
 #include <cfloat>
 
 #include <array>
+#include <algorithm>
+#include <type_traits>
+#include <utility>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <mutex>
+#include <condition_variable>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#include <emmintrin.h>
+
 
-typedef int8_t int8;
-typedef int16_t int16;
-typedef int32_t int32;
-typedef int64_t int64;
-typedef uint8_t uint8;
-typedef uint16_t uint16;
-typedef uint32_t uint32;
-typedef uint64_t uint64;
+#include "types.cpp"
 
 #define m_countof(x) (sizeof(x) / sizeof(x[0]))
 
@@ -147,6 +154,28 @@ uint64 next_pow2(uint64 n) {
 	return n;
 }
 
+uint32 count_trailing_zeros(uint32 n) {
+	m_debug_assert(n != 0);
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanForward(&index, n);
+	return index;
+#else
+	return __builtin_ctz(n);
+#endif
+}
+
+uint32 count_trailing_zeros(uint64 n) {
+	m_debug_assert(n != 0);
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanForward64(&index, n);
+	return index;
+#else
+	return __builtin_ctzll(n);
+#endif
+}
+
 template <typename F>
 struct scope_exit_func {
 	F func;
@@ -176,11 +205,159 @@ range<T> make_range(T* first, T* last) { return range<T>{first, last}; }
 template <typename T>
 range<T> make_range(T* first, uint64 size) { return range<T>{first, size}; }
 
+uint64 virtual_memory_page_size(bool large_pages) {
+	if (large_pages) {
+		return GetLargePageMinimum();
+	}
+	SYSTEM_INFO system_info;
+	GetSystemInfo(&system_info);
+	return system_info.dwAllocationGranularity;
+}
+
+void* virtual_memory_reserve(uint64 size, bool large_pages) {
+	if (large_pages) {
+		return VirtualAlloc(nullptr, size, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+	}
+	return VirtualAlloc(nullptr, size, MEM_RESERVE, PAGE_NOACCESS);
+}
+
+bool virtual_memory_commit(void* ptr, uint64 size) {
+	return VirtualAlloc(ptr, size, MEM_COMMIT, PAGE_READWRITE) != nullptr;
+}
+
+void virtual_memory_decommit(void* ptr, uint64 size) {
+	VirtualFree(ptr, size, MEM_DECOMMIT);
+}
+
+void virtual_memory_release(void* ptr, uint64 size) {
+	VirtualFree(ptr, 0, MEM_RELEASE);
+}
+
+// Reserves capacity bytes of address space up front and commits it in commit_granularity steps as the arena grows.
+// Freshly committed pages come from the OS already zeroed, so only memory below dirty_size is cleared on allocation.
+struct memory_arena {
+	uint8* memory;
+	uint64 size;
+	uint64 capacity;
+	uint64 committed;
+	uint64 commit_granularity;
+	uint64 dirty_size;
+	uint64 peak_size;
+	bool large_pages;
+};
+
+struct memory_arena_marker {
+	uint64 size;
+};
+
+bool memory_arena_init(uint64 capacity, memory_arena* arena, bool large_pages = false) {
+	*arena = {};
+	arena->large_pages = large_pages;
+	arena->commit_granularity = max(virtual_memory_page_size(large_pages), (uint64)m_kilobytes(64));
+	round_up(&capacity, arena->commit_granularity);
+	arena->memory = (uint8*)virtual_memory_reserve(capacity, large_pages);
+	if (!arena->memory && large_pages) {
+		arena->large_pages = false;
+		arena->commit_granularity = max(virtual_memory_page_size(false), (uint64)m_kilobytes(64));
+		arena->memory = (uint8*)virtual_memory_reserve(capacity, false);
+	}
+	if (!arena->memory) {
+		return false;
+	}
+	arena->capacity = capacity;
+	if (arena->large_pages) {
+		arena->committed = capacity;
+	}
+	return true;
+}
+
+void memory_arena_destroy(memory_arena* arena) {
+	if (arena->memory) {
+		virtual_memory_release(arena->memory, arena->capacity);
+	}
+	*arena = {};
+}
+
+bool memory_arena_commit(memory_arena* arena, uint64 size) {
+	if (size <= arena->committed) {
+		return true;
+	}
+	if (size > arena->capacity) {
+		return false;
+	}
+	uint64 new_committed = size;
+	round_up(&new_committed, arena->commit_granularity);
+	new_committed = min(new_committed, arena->capacity);
+	if (!virtual_memory_commit(arena->memory + arena->committed, new_committed - arena->committed)) {
+		return false;
+	}
+	arena->committed = new_committed;
+	return true;
+}
+
+// Returns committed pages above max(size, keep_size) to the OS.
+void memory_arena_trim(memory_arena* arena, uint64 keep_size = 0) {
+	if (arena->large_pages) {
+		return;
+	}
+	uint64 new_committed = max(arena->size, keep_size);
+	round_up(&new_committed, arena->commit_granularity);
+	if (new_committed < arena->committed) {
+		virtual_memory_decommit(arena->memory + new_committed, arena->committed - new_committed);
+		arena->committed = new_committed;
+		arena->dirty_size = min(arena->dirty_size, new_committed);
+	}
+}
+
+template <typename T>
+T* memory_arena_alloc(memory_arena* memory_arena, uint64 count, uint64 alignment = alignof(T)) {
+	m_debug_assert(is_pow2(alignment));
+	if (count == 0) {
+		return nullptr;
+	}
+	uint8* memory = (uint8*)memory_arena->memory + memory_arena->size;
+	uint64 remainder = (uintptr_t)memory % alignment;
+	uint64 offset = (remainder == 0) ? 0 : (alignment - remainder);
+	uint64 new_arena_size = memory_arena->size + offset + count * sizeof(T);
+	m_assert(memory_arena_commit(memory_arena, new_arena_size));
+	uint64 alloc_begin = memory_arena->size + offset;
+	if (alloc_begin < memory_arena->dirty_size) {
+		memset(memory + offset, 0, min(new_arena_size, memory_arena->dirty_size) - alloc_begin);
+	}
+	memory_arena->size = new_arena_size;
+	memory_arena->dirty_size = max(memory_arena->dirty_size, new_arena_size);
+	memory_arena->peak_size = max(memory_arena->peak_size, new_arena_size);
+	return (T*)(memory + offset);
+}
+
+memory_arena_marker memory_arena_get_marker(memory_arena* arena) {
+	return memory_arena_marker{ arena->size };
+}
+
+void memory_arena_rewind(memory_arena* arena, memory_arena_marker marker) {
+	m_debug_assert(marker.size <= arena->size);
+	arena->size = marker.size;
+}
+
+void memory_arena_reset(memory_arena* arena) {
+	arena->size = 0;
+}
+
+struct memory_arena_undo_alloc_scope_exit {
+	memory_arena* arena;
+	memory_arena_marker marker;
+	memory_arena_undo_alloc_scope_exit(memory_arena* a) : arena(a), marker(memory_arena_get_marker(a)) {};
+	~memory_arena_undo_alloc_scope_exit() { memory_arena_rewind(arena, marker); }
+};
+
+// Growable array of trivially copyable elements. Storage comes from the heap, or from arena when it is set,
+// in which case growing leaves the old storage behind in the arena and release only forgets the elements.
 template <typename T>
 struct array {
 	T* elems;
 	uint64 size;
 	uint64 capacity;
+	memory_arena* arena;
 
 	T* begin() const { return elems; }
 	T* end() const { return elems + size; }
@@ -190,22 +367,54 @@ struct array {
 		return elems[index];
 	}
 
-	T* append(const T& value) {
-		if (size < capacity) {
-			elems[size] = value;
-			size += 1;
-			return &elems[size - 1];
+	T& back() {
+		m_debug_assert(size > 0);
+		return elems[size - 1];
+	}
+
+	void reserve(uint64 new_capacity) {
+		if (new_capacity <= capacity) {
+			return;
 		}
-		else {
-			capacity = max(capacity * 2, 64ull);
-			T* new_elems = new T[capacity];
-			memcpy(new_elems, elems, size * sizeof(T));
-			new_elems[size] = value;
+		T* new_elems = arena ? memory_arena_alloc<T>(arena, new_capacity) : new T[new_capacity];
+		memcpy(new_elems, elems, size * sizeof(T));
+		if (!arena) {
 			delete[] elems;
-			elems = new_elems;
-			size += 1;
-			return &new_elems[size - 1];
 		}
+		elems = new_elems;
+		capacity = new_capacity;
+	}
+
+	void resize(uint64 new_size) {
+		reserve(new_size);
+		for (uint64 i = size; i < new_size; i += 1) {
+			elems[i] = {};
+		}
+		size = new_size;
+	}
+
+	T* append(const T& value) {
+		if (size == capacity) {
+			reserve(max(capacity * 2, 64ull));
+		}
+		elems[size] = value;
+		size += 1;
+		return &elems[size - 1];
+	}
+
+	template <typename... ARGS>
+	T* emplace_back(ARGS&&... args) {
+		if (size == capacity) {
+			reserve(max(capacity * 2, 64ull));
+		}
+		elems[size] = T{ std::forward<ARGS>(args)... };
+		size += 1;
+		return &elems[size - 1];
+	}
+
+	void pop_back() {
+		m_debug_assert(size > 0);
+		size -= 1;
 	}
 
 	void clear() {
@@ -217,6 +426,94 @@ struct array {
 		memmove(elems + index, elems + index + 1, (size - index - 1) * sizeof(T));
 		size -= 1;
 	}
+
+	void release() {
+		if (!arena) {
+			delete[] elems;
+		}
+		elems = nullptr;
+		size = 0;
+		capacity = 0;
+	}
+};
+
+// array with room for N elements inline, spills to the heap or to arena past that.
+template <typename T, uint32 N>
+struct small_array {
+	T inline_elems[N];
+	T* heap_elems;
+	uint64 size;
+	uint64 capacity;
+	memory_arena* arena;
+
+	T* data() { return heap_elems ? heap_elems : inline_elems; }
+	T* begin() { return data(); }
+	T* end() { return data() + size; }
+
+	T& operator[](uint64 index) {
+		m_debug_assert(index < size);
+		return data()[index];
+	}
+
+	T& back() {
+		m_debug_assert(size > 0);
+		return data()[size - 1];
+	}
+
+	void reserve(uint64 new_capacity) {
+		if (new_capacity <= max(capacity, (uint64)N)) {
+			return;
+		}
+		T* new_elems = arena ? memory_arena_alloc<T>(arena, new_capacity) : new T[new_capacity];
+		memcpy(new_elems, data(), size * sizeof(T));
+		if (heap_elems && !arena) {
+			delete[] heap_elems;
+		}
+		heap_elems = new_elems;
+		capacity = new_capacity;
+	}
+
+	void resize(uint64 new_size) {
+		reserve(new_size);
+		T* elems = data();
+		for (uint64 i = size; i < new_size; i += 1) {
+			elems[i] = {};
+		}
+		size = new_size;
+	}
+
+	T* append(const T& value) {
+		if (size == max(capacity, (uint64)N)) {
+			reserve(size * 2);
+		}
+		T* elem = &data()[size];
+		*elem = value;
+		size += 1;
+		return elem;
+	}
+
+	template <typename... ARGS>
+	T* emplace_back(ARGS&&... args) {
+		return append(T{ std::forward<ARGS>(args)... });
+	}
+
+	void pop_back() {
+		m_debug_assert(size > 0);
+		size -= 1;
+	}
+
+	void clear() {
+		size = 0;
+	}
+
+	void release() {
+		if (heap_elems && !arena) {
+			delete[] heap_elems;
+		}
+		heap_elems = nullptr;
+		size = 0;
+		capacity = 0;
+	}
 };
 
 struct string {
@@ -358,280 +655,716 @@ struct ring_buffer {
 template <typename T>
 void ring_buffer_write(ring_buffer<T>* rb, T elem) {
 	rb->buffer[rb->write_index] = elem;
+	rb->write_index = (rb->write_index + 1) % rb->capacity;
 	if (rb->size == (rb->capacity - 1)) {
 		rb->read_index = (rb->read_index + 1) % rb->capacity;
 	}
-	rb->write_index = (rb->write_index + 1) % rb->capacity;
-
-	if (rb->write_index > rb->read_index) {
-		rb->size = rb->write_index - rb->read_index;
-	}
-	else if (rb->write_index < rb->read_index) {
-		rb->size = rb->write_index + rb->capacity - rb->read_index;
-	}
 	else {
-		rb->size = 0;
+		rb->size += 1;
 	}
 }
 
-uint32 murmur3_32(const void* key, uint32 len) {
-	uint32 seed = 0xdeadbeef;
-
-	const uint8* data = (const uint8*)key;
-	const int nblocks = len / 4;
-
-	uint32 h1 = seed;
-
-	const uint32 c1 = 0xcc9e2d51;
-	const uint32 c2 = 0x1b873593;
-
-	const uint32* blocks = (const uint32*)(data + nblocks * 4ll);
-
-	for (int i = -nblocks; i; i += 1) {
-		uint32 k1 = blocks[i];
-		k1 *= c1;
-		k1 = _rotl(k1, 15);
-		k1 *= c2;
-		h1 ^= k1;
-		h1 = _rotl(h1, 13);
-		h1 = h1 * 5 + 0xe6546b64;
+// Spins for a while then starts yielding the time slice, for the blocking queue operations.
+void queue_backoff(uint32* spin_count) {
+	if (*spin_count < 64) {
+		_mm_pause();
+		*spin_count += 1;
+	}
+	else {
+		std::this_thread::yield();
 	}
-
-	const uint8* tail = (const uint8*)(data + nblocks * 4ll);
-	uint32 k1 = 0;
-
-	switch (len & 3) {
-	case 3: k1 ^= tail[2] << 16;
-	case 2: k1 ^= tail[1] << 8;
-	case 1: k1 ^= tail[0];
-		k1 *= c1;
-		k1 = _rotl(k1, 15);
-		k1 *= c2;
-		h1 ^= k1;
-	};
-
-	h1 ^= len;
-	h1 ^= h1 >> 16;
-	h1 *= 0x85ebca6b;
-	h1 ^= h1 >> 13;
-	h1 *= 0xc2b2ae35;
-	h1 ^= h1 >> 16;
-	return h1;
 }
 
-template <typename KEY, typename VALUE>
-struct hash_map_elem {
-	KEY key;
-	VALUE value;
-};
-
-template <typename KEY, typename VALUE>
-struct hash_map {
-	hash_map_elem<KEY, VALUE>* elems;
-	VALUE zero_elem_value;
-	bool zero_elem_used;
+// Bounded single producer single consumer queue. Indices run freely and are masked into the power of 2 sized storage.
+// Each side keeps a cached copy of the other side's index and only reloads it when the queue looks full or empty,
+// so the shared cache lines move between cores once per batch of operations instead of once per element.
+template <typename T>
+struct spsc_queue {
+	alignas(64) std::atomic<uint32> head;
+	uint32 cached_tail;
+	alignas(64) std::atomic<uint32> tail;
+	uint32 cached_head;
+	alignas(64) T* elems;
 	uint32 capacity;
-	uint32 size;
 };
 
-bool hash_map_key_is_zero(string s) {
-	return s.len == 0;
+template <typename T>
+void spsc_queue_init(spsc_queue<T>* queue, uint32 capacity) {
+	static_assert(std::is_trivially_copyable<T>::value, "");
+	m_assert(capacity > 0 && capacity <= (1u << 31));
+	capacity = next_pow2(capacity);
+	queue->head.store(0, std::memory_order_relaxed);
+	queue->cached_tail = 0;
+	queue->tail.store(0, std::memory_order_relaxed);
+	queue->cached_head = 0;
+	queue->elems = new T[capacity];
+	queue->capacity = capacity;
 }
 
-bool hash_map_key_is_zero(uint64 i) {
-	return i == 0;
+template <typename T>
+void spsc_queue_destroy(spsc_queue<T>* queue) {
+	delete[] queue->elems;
+	queue->elems = nullptr;
+	queue->capacity = 0;
 }
 
-template <typename VALUE>
-bool hash_map_elem_is_empty(const hash_map_elem<string, VALUE>* elem) {
-	return elem->key.ptr == nullptr && elem->key.len == 0;
+// Producer only. Pushes as many of elems as fit and returns how many that was.
+template <typename T>
+uint32 spsc_queue_try_push_batch(spsc_queue<T>* queue, const T* elems, uint32 count) {
+	uint32 tail = queue->tail.load(std::memory_order_relaxed);
+	uint32 free_count = queue->capacity - (tail - queue->cached_head);
+	if (free_count < count) {
+		queue->cached_head = queue->head.load(std::memory_order_acquire);
+		free_count = queue->capacity - (tail - queue->cached_head);
+	}
+	count = min(count, free_count);
+	uint32 mask = queue->capacity - 1;
+	for (uint32 i = 0; i < count; i += 1) {
+		queue->elems[(tail + i) & mask] = elems[i];
+	}
+	queue->tail.store(tail + count, std::memory_order_release);
+	return count;
 }
 
-template <typename VALUE>
-bool hash_map_elem_is_empty(const hash_map_elem<uint32, VALUE>* elem) {
-	return elem->key == 0;
+// Consumer only. Pops up to max_count elements into elems and returns how many that was.
+template <typename T>
+uint32 spsc_queue_try_pop_batch(spsc_queue<T>* queue, T* elems, uint32 max_count) {
+	uint32 head = queue->head.load(std::memory_order_relaxed);
+	uint32 count = queue->cached_tail - head;
+	if (count < max_count) {
+		queue->cached_tail = queue->tail.load(std::memory_order_acquire);
+		count = queue->cached_tail - head;
+	}
+	count = min(count, max_count);
+	uint32 mask = queue->capacity - 1;
+	for (uint32 i = 0; i < count; i += 1) {
+		elems[i] = queue->elems[(head + i) & mask];
+	}
+	queue->head.store(head + count, std::memory_order_release);
+	return count;
 }
 
-template <typename VALUE>
-hash_map_elem<string, VALUE>* hash_map_get_first(const hash_map<string, VALUE>* map, string key) {
-	uint32 hash = murmur3_32(key.ptr, key.len);
-	uint32 index = hash & (map->capacity - 1);
-	return map->elems + index;
+template <typename T>
+bool spsc_queue_try_push(spsc_queue<T>* queue, const T& elem) {
+	return spsc_queue_try_push_batch(queue, &elem, 1) == 1;
 }
 
-template <typename VALUE>
-hash_map_elem<uint32, VALUE>* hash_map_get_first(const hash_map<uint32, VALUE>* map, uint32 key) {
-	uint32 hash = murmur3_32(&key, sizeof(key));
-	uint32 index = hash & (map->capacity - 1);
-	return map->elems + index;
+template <typename T>
+bool spsc_queue_try_pop(spsc_queue<T>* queue, T* elem) {
+	return spsc_queue_try_pop_batch(queue, elem, 1) == 1;
 }
 
-template <typename KEY, typename VALUE>
-hash_map_elem<KEY, VALUE>* hash_map_get_next(const hash_map<KEY, VALUE>* map, hash_map_elem<KEY, VALUE>* elem) {
-	if (elem + 1 != map->elems + map->capacity) {
-		return elem + 1;
-	}
-	else {
-		return map->elems;
+// Blocks until every element is pushed.
+template <typename T>
+void spsc_queue_push_batch(spsc_queue<T>* queue, const T* elems, uint32 count) {
+	uint32 spin_count = 0;
+	while (count > 0) {
+		uint32 push_count = spsc_queue_try_push_batch(queue, elems, count);
+		if (push_count == 0) {
+			queue_backoff(&spin_count);
+		}
+		else {
+			spin_count = 0;
+		}
+		elems += push_count;
+		count -= push_count;
 	}
 }
 
-template <typename KEY, typename VALUE>
-uint32 hash_map_get_offset(const hash_map<KEY, VALUE>* map, hash_map_elem<KEY, VALUE>* elem1, hash_map_elem<KEY, VALUE>* elem2) {
-	ptrdiff_t diff = elem2 - elem1;
-	if (diff >= 0) {
-		return (uint32)diff;
-	}
-	else {
-		return (uint32)((ptrdiff_t)map->capacity + diff);
+// Blocks until at least one element is popped.
+template <typename T>
+uint32 spsc_queue_pop_batch(spsc_queue<T>* queue, T* elems, uint32 max_count) {
+	uint32 spin_count = 0;
+	uint32 count = 0;
+	while ((count = spsc_queue_try_pop_batch(queue, elems, max_count)) == 0) {
+		queue_backoff(&spin_count);
 	}
+	return count;
 }
 
-template <typename KEY, typename VALUE>
-void hash_map_initialize(hash_map<KEY, VALUE>* map, uint32 capacity) {
-	m_assert(capacity >= 256 && is_pow2(capacity));
-	*map = {};
-	map->capacity = capacity;
-	map->elems = new hash_map_elem<KEY, VALUE>[capacity]();
+template <typename T>
+void spsc_queue_push(spsc_queue<T>* queue, const T& elem) {
+	spsc_queue_push_batch(queue, &elem, 1);
 }
 
-template <typename KEY, typename VALUE>
-void hash_map_delete(hash_map<KEY, VALUE>* map) {
-	delete[] map->elems;
-	*map = {};
+template <typename T>
+T spsc_queue_pop(spsc_queue<T>* queue) {
+	T elem;
+	spsc_queue_pop_batch(queue, &elem, 1);
+	return elem;
 }
 
-template <typename KEY, typename VALUE>
-void hash_map_resize(hash_map<KEY, VALUE>* map, uint32 new_capacity) {
-	m_assert(is_pow2(new_capacity));
-	m_assert(map->size * 4 <= new_capacity * 3);
-
-	hash_map_elem<KEY, VALUE>* old_elem_begin = map->elems;
-	hash_map_elem<KEY, VALUE>* old_elem_end = map->elems + map->capacity;
-
-	map->capacity = new_capacity;
-	map->elems = new hash_map_elem<KEY, VALUE>[new_capacity]();
-
-	for (hash_map_elem<KEY, VALUE>* old_elem = old_elem_begin; old_elem != old_elem_end; old_elem += 1) {
-		if (!hash_map_elem_is_empty(old_elem)) {
-			for (hash_map_elem<KEY, VALUE>* elem = hash_map_get_first(map, old_elem->key); ; elem = hash_map_get_next(map, elem)) {
-				if (hash_map_elem_is_empty(elem)) {
-					*elem = *old_elem;
-					break;
-				}
-			}
-		}
+// Bounded multi producer multi consumer queue after Dmitry Vyukov's design. Every cell carries a sequence number
+// telling whether it is ready to be written (sequence == position) or read (sequence == position + 1) in the current lap,
+// so producers and consumers only contend on their own index and claim a run of cells with a single CAS.
+template <typename T>
+struct mpmc_queue_cell {
+	std::atomic<uint32> sequence;
+	T elem;
+};
+
+template <typename T>
+struct mpmc_queue {
+	alignas(64) std::atomic<uint32> enqueue_index;
+	alignas(64) std::atomic<uint32> dequeue_index;
+	alignas(64) mpmc_queue_cell<T>* cells;
+	uint32 capacity;
+};
+
+template <typename T>
+void mpmc_queue_init(mpmc_queue<T>* queue, uint32 capacity) {
+	static_assert(std::is_trivially_copyable<T>::value, "");
+	m_assert(capacity > 0 && capacity <= (1u << 30));
+	capacity = max(next_pow2(capacity), 2u);
+	queue->enqueue_index.store(0, std::memory_order_relaxed);
+	queue->dequeue_index.store(0, std::memory_order_relaxed);
+	queue->cells = new mpmc_queue_cell<T>[capacity];
+	for (uint32 i = 0; i < capacity; i += 1) {
+		queue->cells[i].sequence.store(i, std::memory_order_relaxed);
 	}
+	queue->capacity = capacity;
+}
 
-	delete[] old_elem_begin;
+template <typename T>
+void mpmc_queue_destroy(mpmc_queue<T>* queue) {
+	delete[] queue->cells;
+	queue->cells = nullptr;
+	queue->capacity = 0;
 }
 
-template <typename KEY, typename VALUE>
-bool hash_map_get(const hash_map<KEY, VALUE>* map, KEY key, VALUE* value) {
-	if (hash_map_key_is_zero(key)) {
-		if (!map->zero_elem_used) {
-			return false;
-		}
-		else {
-			*value = map->zero_elem_value;
-			return true;
+// Pushes as many of elems as there are free cells in a row and returns how many that was.
+template <typename T>
+uint32 mpmc_queue_try_push_batch(mpmc_queue<T>* queue, const T* elems, uint32 count) {
+	uint32 mask = queue->capacity - 1;
+	uint32 position = queue->enqueue_index.load(std::memory_order_relaxed);
+	while (true) {
+		uint32 free_count = 0;
+		while (free_count < count) {
+			uint32 sequence = queue->cells[(position + free_count) & mask].sequence.load(std::memory_order_acquire);
+			if (sequence != position + free_count) {
+				break;
+			}
+			free_count += 1;
 		}
-	}
-	else {
-		for (hash_map_elem<KEY, VALUE>* elem = hash_map_get_first(map, key); ; elem = hash_map_get_next(map, elem)) {
-			if (hash_map_elem_is_empty(elem)) {
-				return false;
+		if (free_count == 0) {
+			uint32 current_position = queue->enqueue_index.load(std::memory_order_relaxed);
+			if (current_position == position) {
+				return 0;
 			}
-			else if (elem->key == key) {
-				*value = elem->value;
-				return true;
+			position = current_position;
+		}
+		else if (queue->enqueue_index.compare_exchange_weak(position, position + free_count, std::memory_order_relaxed)) {
+			for (uint32 i = 0; i < free_count; i += 1) {
+				mpmc_queue_cell<T>* cell = &queue->cells[(position + i) & mask];
+				cell->elem = elems[i];
+				cell->sequence.store(position + i + 1, std::memory_order_release);
 			}
+			return free_count;
 		}
 	}
 }
 
-template <typename KEY, typename VALUE>
-bool hash_map_insert(hash_map<KEY, VALUE>* map, KEY key, VALUE value) {
-	if (hash_map_key_is_zero(key)) {
-		if (map->zero_elem_used) {
-			return false;
+// Pops up to max_count elements that are ready in a row and returns how many that was.
+template <typename T>
+uint32 mpmc_queue_try_pop_batch(mpmc_queue<T>* queue, T* elems, uint32 max_count) {
+	uint32 mask = queue->capacity - 1;
+	uint32 position = queue->dequeue_index.load(std::memory_order_relaxed);
+	while (true) {
+		uint32 ready_count = 0;
+		while (ready_count < max_count) {
+			uint32 sequence = queue->cells[(position + ready_count) & mask].sequence.load(std::memory_order_acquire);
+			if (sequence != position + ready_count + 1) {
+				break;
+			}
+			ready_count += 1;
 		}
-		else {
-			map->zero_elem_value = value;
-			map->zero_elem_used = true;
-			map->size += 1;
-			return true;
+		if (ready_count == 0) {
+			uint32 current_position = queue->dequeue_index.load(std::memory_order_relaxed);
+			if (current_position == position) {
+				return 0;
+			}
+			position = current_position;
 		}
-	}
-	else {
-		for (;;) {
-			for (hash_map_elem<KEY, VALUE>* elem = hash_map_get_first(map, key); ; elem = hash_map_get_next(map, elem)) {
-				if (hash_map_elem_is_empty(elem)) {
-					if ((map->size + 1) * 4 >= map->capacity * 3) {
-						hash_map_resize(map, map->capacity * 2);
-						break;
-					}
-					else {
-						elem->key = key;
-						elem->value = value;
-						map->size += 1;
-						return true;
-					}
-				}
-				else if (elem->key == key) {
-					return false;
-				}
+		else if (queue->dequeue_index.compare_exchange_weak(position, position + ready_count, std::memory_order_relaxed)) {
+			for (uint32 i = 0; i < ready_count; i += 1) {
+				mpmc_queue_cell<T>* cell = &queue->cells[(position + i) & mask];
+				elems[i] = cell->elem;
+				cell->sequence.store(position + i + queue->capacity, std::memory_order_release);
 			}
+			return ready_count;
 		}
 	}
 }
 
-template <typename KEY, typename VALUE>
-bool hash_map_remove(hash_map<KEY, VALUE>* map, KEY key) {
-	if (hash_map_key_is_zero(key)) {
-		if (map->zero_elem_used) {
-			map->zero_elem_used = false;
-			map->zero_elem_value = {};
-			map->size -= 1;
-			return true;
+template <typename T>
+bool mpmc_queue_try_push(mpmc_queue<T>* queue, const T& elem) {
+	return mpmc_queue_try_push_batch(queue, &elem, 1) == 1;
+}
+
+template <typename T>
+bool mpmc_queue_try_pop(mpmc_queue<T>* queue, T* elem) {
+	return mpmc_queue_try_pop_batch(queue, elem, 1) == 1;
+}
+
+// Blocks until every element is pushed.
+template <typename T>
+void mpmc_queue_push_batch(mpmc_queue<T>* queue, const T* elems, uint32 count) {
+	uint32 spin_count = 0;
+	while (count > 0) {
+		uint32 push_count = mpmc_queue_try_push_batch(queue, elems, count);
+		if (push_count == 0) {
+			queue_backoff(&spin_count);
 		}
 		else {
-			return false;
-		}
-	}
-	else {
-		for (hash_map_elem<KEY, VALUE>* elem = hash_map_get_first(map, key); ; elem = hash_map_get_next(map, elem)) {
-			if (hash_map_elem_is_empty(elem)) {
-				return false;
-			}
-			else if (elem->key == key) {
-				for (hash_map_elem<KEY, VALUE>* next_elem = hash_map_get_next(map, elem); ; next_elem = hash_map_get_next(map, next_elem)) {
-					if (hash_map_elem_is_empty(next_elem)) {
-						memset(elem, 0, sizeof(*elem));
-						map->size -= 1;
-						return true;
-					}
-					else {
-						hash_map_elem<KEY, VALUE>* ideal_elem = hash_map_get_first(map, next_elem->key);
-						if (hash_map_get_offset(map, ideal_elem, elem) < hash_map_get_offset(map, ideal_elem, next_elem)) {
-							*elem = *next_elem;
-							elem = next_elem;
-						}
-					}
-				}
-			}
+			spin_count = 0;
 		}
+		elems += push_count;
+		count -= push_count;
 	}
 }
 
-const char* get_file_name(const char* path) {
-	const char* ptr_0 = strrchr(path, '/');
-	const char* ptr_1 = strrchr(path, '\\');
-	if (ptr_0 && ptr_1) {
-		return ptr_0 > ptr_1 ? ptr_0 : ptr_1;
+// Blocks until at least one element is popped.
+template <typename T>
+uint32 mpmc_queue_pop_batch(mpmc_queue<T>* queue, T* elems, uint32 max_count) {
+	uint32 spin_count = 0;
+	uint32 count = 0;
+	while ((count = mpmc_queue_try_pop_batch(queue, elems, max_count)) == 0) {
+		queue_backoff(&spin_count);
 	}
-	else if (ptr_0) {
-		return ptr_0 + 1;
+	return count;
+}
+
+template <typename T>
+void mpmc_queue_push(mpmc_queue<T>* queue, const T& elem) {
+	mpmc_queue_push_batch(queue, &elem, 1);
+}
+
+template <typename T>
+T mpmc_queue_pop(mpmc_queue<T>* queue) {
+	T elem;
+	mpmc_queue_pop_batch(queue, &elem, 1);
+	return elem;
+}
+
+// 64 bit hash in the style of wyhash for short inputs and xxh3 for long inputs.
+// Inputs up to one stripe are folded with 64x64->128 bit multiplies,
+// longer inputs are accumulated 64 bytes at a time into eight 64 bit lanes with SSE2.
+// hash64_state hashes data that arrives in pieces and gives the same result as hashing it in one go.
+const uint64 hash64_stripe_size = 64;
+const uint64 hash64_block_stripe_count = 16;
+
+const uint64 hash64_secret[24] = {
+	0xa0761d6478bd642full, 0xe7037ed1a0b428dbull, 0x8ebc6af09c88c6e3ull, 0x589965cc75374cc3ull,
+	0x1c948e1575796814ull, 0xae9ef1ab67004bdbull, 0x7a2988d31f16e86eull, 0x7a5daea24eba3ba7ull,
+	0xbb83c0c2207ad3e6ull, 0xe2da71d9f0e79e32ull, 0xf037b46f16a54449ull, 0xafd7e49c4512ee8cull,
+	0x25ade43f8dcffc85ull, 0x0028cf578ec6bd94ull, 0x9f26b835468010bbull, 0xb9792de59de179e6ull,
+	0xca030ef931c393c6ull, 0x34c690fbf80367a9ull, 0x5bddd920e3712b45ull, 0x7587183f9ed6c5bfull,
+	0xac39bb1f2aa2a8fcull, 0xee1f1c282cdf78ccull, 0xee912e80c0b0b0d3ull, 0x0149fc107d224ebbull,
+};
+
+struct hash64_state {
+	__m128i accs[4];
+	uint8 buffer[hash64_stripe_size];
+	uint32 buffer_size;
+	uint32 stripe_index;
+	uint64 len;
+	uint64 seed;
+};
+
+void hash64_mum(uint64* a, uint64* b) {
+#ifdef _MSC_VER
+	*a = _umul128(*a, *b, b);
+#else
+	unsigned __int128 r = (unsigned __int128)*a * *b;
+	*a = (uint64)r;
+	*b = (uint64)(r >> 64);
+#endif
+}
+
+uint64 hash64_mix(uint64 a, uint64 b) {
+	hash64_mum(&a, &b);
+	return a ^ b;
+}
+
+uint64 hash64_read64(const uint8* p) {
+	uint64 v;
+	memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+uint64 hash64_read32(const uint8* p) {
+	uint32 v;
+	memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+uint64 hash64_short(const uint8* p, uint64 len, uint64 seed) {
+	seed ^= hash64_mix(seed ^ hash64_secret[0], hash64_secret[1]);
+	uint64 a = 0;
+	uint64 b = 0;
+	if (len <= 16) {
+		if (len >= 4) {
+			a = (hash64_read32(p) << 32) | hash64_read32(p + ((len >> 3) << 2));
+			b = (hash64_read32(p + len - 4) << 32) | hash64_read32(p + len - 4 - ((len >> 3) << 2));
+		}
+		else if (len > 0) {
+			a = ((uint64)p[0] << 16) | ((uint64)p[len >> 1] << 8) | p[len - 1];
+		}
+	}
+	else {
+		for (uint64 i = 0; len - i > 16; i += 16) {
+			seed = hash64_mix(hash64_read64(p + i) ^ hash64_secret[1], hash64_read64(p + i + 8) ^ seed);
+		}
+		a = hash64_read64(p + len - 16);
+		b = hash64_read64(p + len - 8);
+	}
+	a ^= hash64_secret[1];
+	b ^= seed;
+	hash64_mum(&a, &b);
+	return hash64_mix(a ^ hash64_secret[0] ^ len, b ^ hash64_secret[1]);
+}
+
+void hash64_init_accs(__m128i* accs, uint64 seed) {
+	accs[0] = _mm_set_epi64x((long long)(0xc2b2ae3d27d4eb4full - seed), (long long)(0x00000000c2b2ae3dull + seed));
+	accs[1] = _mm_set_epi64x((long long)(0x27d4eb2f165667c5ull - seed), (long long)(0x9e3779b185ebca87ull + seed));
+	accs[2] = _mm_set_epi64x((long long)(0x0000000085ebca77ull - seed), (long long)(0x165667b19e3779f9ull + seed));
+	accs[3] = _mm_set_epi64x((long long)(0x000000009e3779b1ull - seed), (long long)(0x85ebca77c2b2ae63ull + seed));
+}
+
+void hash64_accumulate(__m128i* accs, const uint8* p, uint64 stripe_count, uint32* stripe_index) {
+	const __m128i prime = _mm_set1_epi32((int)0x9e3779b1);
+	__m128i acc[4] = { accs[0], accs[1], accs[2], accs[3] };
+	uint32 index = *stripe_index;
+	for (uint64 i = 0; i < stripe_count; i += 1) {
+		const __m128i* secret = (const __m128i*)(hash64_secret + index);
+		for (uint32 j = 0; j < 4; j += 1) {
+			__m128i data = _mm_loadu_si128((const __m128i*)(p + j * 16));
+			__m128i key = _mm_xor_si128(data, _mm_loadu_si128(secret + j));
+			__m128i product = _mm_mul_epu32(key, _mm_shuffle_epi32(key, _MM_SHUFFLE(0, 3, 0, 1)));
+			__m128i swapped = _mm_shuffle_epi32(data, _MM_SHUFFLE(1, 0, 3, 2));
+			acc[j] = _mm_add_epi64(acc[j], _mm_add_epi64(product, swapped));
+		}
+		p += hash64_stripe_size;
+		index += 1;
+		if (index == hash64_block_stripe_count) {
+			index = 0;
+			const __m128i* scramble_secret = (const __m128i*)(hash64_secret + 16);
+			for (uint32 j = 0; j < 4; j += 1) {
+				__m128i a = _mm_xor_si128(acc[j], _mm_srli_epi64(acc[j], 47));
+				a = _mm_xor_si128(a, _mm_loadu_si128(scramble_secret + j));
+				__m128i lo = _mm_mul_epu32(a, prime);
+				__m128i hi = _mm_mul_epu32(_mm_srli_epi64(a, 32), prime);
+				acc[j] = _mm_add_epi64(lo, _mm_slli_epi64(hi, 32));
+			}
+		}
+	}
+	for (uint32 j = 0; j < 4; j += 1) {
+		accs[j] = acc[j];
+	}
+	*stripe_index = index;
+}
+
+uint64 hash64_merge(const __m128i* accs, uint64 len, uint64 seed) {
+	alignas(16) uint64 lanes[8];
+	for (uint32 i = 0; i < 4; i += 1) {
+		_mm_store_si128((__m128i*)lanes + i, accs[i]);
+	}
+	uint64 h = len * hash64_secret[0] ^ seed;
+	for (uint32 i = 0; i < 4; i += 1) {
+		h = hash64_mix(lanes[i * 2] ^ hash64_secret[i * 2 + 4], lanes[i * 2 + 1] ^ h);
+	}
+	h ^= h >> 37;
+	h *= 0x165667919e3779f9ull;
+	h ^= h >> 32;
+	return h;
+}
+
+uint64 hash64_last_stripe(__m128i* accs, const uint8* p, uint64 size, uint32 stripe_index, uint64 len, uint64 seed) {
+	uint8 last_stripe[hash64_stripe_size] = {};
+	memcpy(last_stripe, p, size);
+	hash64_accumulate(accs, last_stripe, 1, &stripe_index);
+	return hash64_merge(accs, len, seed);
+}
+
+uint64 hash64(const void* data, uint64 len, uint64 seed = 0) {
+	const uint8* p = (const uint8*)data;
+	if (len <= hash64_stripe_size) {
+		return hash64_short(p, len, seed);
+	}
+	__m128i accs[4];
+	hash64_init_accs(accs, seed);
+	uint32 stripe_index = 0;
+	uint64 stripe_count = (len - 1) / hash64_stripe_size;
+	hash64_accumulate(accs, p, stripe_count, &stripe_index);
+	uint64 offset = stripe_count * hash64_stripe_size;
+	return hash64_last_stripe(accs, p + offset, len - offset, stripe_index, len, seed);
+}
+
+void hash64_init(hash64_state* state, uint64 seed = 0) {
+	*state = {};
+	hash64_init_accs(state->accs, seed);
+	state->seed = seed;
+}
+
+void hash64_update(hash64_state* state, const void* data, uint64 len) {
+	const uint8* p = (const uint8*)data;
+	state->len += len;
+	while (len > 0) {
+		if (state->buffer_size == hash64_stripe_size) {
+			hash64_accumulate(state->accs, state->buffer, 1, &state->stripe_index);
+			state->buffer_size = 0;
+		}
+		if (state->buffer_size == 0 && len > hash64_stripe_size) {
+			uint64 stripe_count = (len - 1) / hash64_stripe_size;
+			hash64_accumulate(state->accs, p, stripe_count, &state->stripe_index);
+			p += stripe_count * hash64_stripe_size;
+			len -= stripe_count * hash64_stripe_size;
+		}
+		uint64 size = min(hash64_stripe_size - state->buffer_size, len);
+		memcpy(state->buffer + state->buffer_size, p, size);
+		state->buffer_size += (uint32)size;
+		p += size;
+		len -= size;
+	}
+}
+
+uint64 hash64_final(const hash64_state* state) {
+	if (state->len <= hash64_stripe_size) {
+		return hash64_short(state->buffer, state->len, state->seed);
+	}
+	__m128i accs[4] = { state->accs[0], state->accs[1], state->accs[2], state->accs[3] };
+	return hash64_last_stripe(accs, state->buffer, state->buffer_size, state->stripe_index, state->len, state->seed);
+}
+
+// Open addressing hash map in the style of Swiss tables. Every slot has a control byte that is either
+// hash_map_ctrl_empty or the top 7 bits of the key hash, and lookups compare 16 control bytes at once with SSE2.
+// Probing is linear from the slot the hash picks, so removal shifts later elements back instead of leaving tombstones.
+// The first 15 control bytes are mirrored past the end so a group load never has to wrap around.
+// Keys work as long as hash_map_hash and hash_map_key_equal are overloaded for them, the byte hash fallback only takes
+// types without padding or floats, where equal values always have equal bytes.
+// Lookups accept other key types, such as const char* for string keys, other lookup keys are converted to the key type
+// before hashing so that a uint32 lookup into a uint64 map still hashes 8 bytes.
+const int8 hash_map_ctrl_empty = -128;
+const uint32 hash_map_group_size = 16;
+
+template <typename KEY, typename VALUE>
+struct hash_map {
+	int8* ctrls;
+	KEY* keys;
+	VALUE* values;
+	uint32 capacity;
+	uint32 size;
+};
+
+uint64 hash_map_hash_bytes(const void* data, uint64 len) {
+	return hash64(data, len);
+}
+
+uint64 hash_map_hash(const string& key) {
+	return hash_map_hash_bytes(key.ptr, key.len);
+}
+
+uint64 hash_map_hash(const char* key) {
+	return hash_map_hash_bytes(key, strlen(key));
+}
+
+uint64 hash_map_hash(char* key) {
+	return hash_map_hash_bytes(key, strlen(key));
+}
+
+template <typename T>
+uint64 hash_map_hash(const T& key) {
+	static_assert(__has_unique_object_representations(T), "overload hash_map_hash for this key type");
+	return hash_map_hash_bytes(&key, sizeof(key));
+}
+
+template <typename KEY, typename LOOKUP_KEY>
+uint64 hash_map_lookup_hash(const LOOKUP_KEY& key, std::true_type) {
+	return hash_map_hash(key);
+}
+
+template <typename KEY, typename LOOKUP_KEY>
+uint64 hash_map_lookup_hash(const LOOKUP_KEY& key, std::false_type) {
+	return hash_map_hash(static_cast<KEY>(key));
+}
+
+// C strings hash like string keys, everything else hashes as KEY.
+template <typename KEY, typename LOOKUP_KEY>
+uint64 hash_map_lookup_hash(const LOOKUP_KEY& key) {
+	return hash_map_lookup_hash<KEY>(key, std::integral_constant<bool, std::is_same<KEY, LOOKUP_KEY>::value || std::is_same<KEY, string>::value>());
+}
+
+bool hash_map_key_equal(const string& a, const string& b) {
+	return a.len == b.len && !memcmp(a.ptr, b.ptr, a.len);
+}
+
+bool hash_map_key_equal(const string& a, const char* b) {
+	uint64 b_len = strlen(b);
+	return a.len == b_len && !memcmp(a.ptr, b, b_len);
+}
+
+template <typename T, typename T2>
+bool hash_map_key_equal(const T& a, const T2& b) {
+	return a == b;
+}
+
+uint32 hash_map_ideal_index(uint64 hash, uint32 capacity) {
+	return (uint32)hash & (capacity - 1);
+}
+
+int8 hash_map_ctrl_from_hash(uint64 hash) {
+	return (int8)(hash >> 57);
+}
+
+template <typename KEY, typename VALUE>
+void hash_map_set_ctrl(hash_map<KEY, VALUE>* map, uint32 index, int8 ctrl) {
+	map->ctrls[index] = ctrl;
+	if (index < hash_map_group_size - 1) {
+		map->ctrls[map->capacity + index] = ctrl;
+	}
+}
+
+template <typename KEY, typename VALUE>
+void hash_map_initialize(hash_map<KEY, VALUE>* map, uint32 capacity) {
+	m_assert(capacity >= hash_map_group_size && is_pow2(capacity));
+	*map = {};
+	map->capacity = capacity;
+	map->ctrls = new int8[capacity + hash_map_group_size - 1];
+	memset(map->ctrls, hash_map_ctrl_empty, capacity + hash_map_group_size - 1);
+	map->keys = new KEY[capacity];
+	map->values = new VALUE[capacity];
+}
+
+template <typename KEY, typename VALUE>
+void hash_map_delete(hash_map<KEY, VALUE>* map) {
+	delete[] map->ctrls;
+	delete[] map->keys;
+	delete[] map->values;
+	*map = {};
+}
+
+template <typename KEY, typename VALUE>
+void hash_map_insert_new(hash_map<KEY, VALUE>* map, uint64 hash, const KEY& key, const VALUE& value) {
+	uint32 index = hash_map_ideal_index(hash, map->capacity);
+	for (;;) {
+		__m128i group = _mm_loadu_si128((const __m128i*)(map->ctrls + index));
+		uint32 empty_mask = (uint32)_mm_movemask_epi8(group);
+		if (empty_mask) {
+			index = (index + count_trailing_zeros(empty_mask)) & (map->capacity - 1);
+			hash_map_set_ctrl(map, index, hash_map_ctrl_from_hash(hash));
+			map->keys[index] = key;
+			map->values[index] = value;
+			map->size += 1;
+			return;
+		}
+		index = (index + hash_map_group_size) & (map->capacity - 1);
+	}
+}
+
+template <typename KEY, typename VALUE>
+void hash_map_resize(hash_map<KEY, VALUE>* map, uint32 new_capacity) {
+	m_assert(is_pow2(new_capacity) && new_capacity >= hash_map_group_size);
+	m_assert((uint64)map->size * 8 <= (uint64)new_capacity * 7);
+	hash_map<KEY, VALUE> old_map = *map;
+	hash_map_initialize(map, new_capacity);
+	for (uint32 i = 0; i < old_map.capacity; i += 1) {
+		if (old_map.ctrls[i] != hash_map_ctrl_empty) {
+			hash_map_insert_new(map, hash_map_hash(old_map.keys[i]), old_map.keys[i], old_map.values[i]);
+		}
+	}
+	hash_map_delete(&old_map);
+}
+
+// Grows the map so that count elements fit without another resize.
+template <typename KEY, typename VALUE>
+void hash_map_reserve(hash_map<KEY, VALUE>* map, uint32 count) {
+	uint64 capacity = max(next_pow2((uint64)count * 8 / 7 + 1), (uint64)hash_map_group_size);
+	if (capacity > map->capacity) {
+		hash_map_resize(map, (uint32)capacity);
+	}
+}
+
+template <typename KEY, typename VALUE, typename LOOKUP_KEY>
+uint32 hash_map_find_index(const hash_map<KEY, VALUE>* map, uint64 hash, const LOOKUP_KEY& key) {
+	__m128i ctrl = _mm_set1_epi8(hash_map_ctrl_from_hash(hash));
+	uint32 index = hash_map_ideal_index(hash, map->capacity);
+	for (;;) {
+		__m128i group = _mm_loadu_si128((const __m128i*)(map->ctrls + index));
+		uint32 match_mask = (uint32)_mm_movemask_epi8(_mm_cmpeq_epi8(group, ctrl));
+		while (match_mask) {
+			uint32 match_index = (index + count_trailing_zeros(match_mask)) & (map->capacity - 1);
+			if (hash_map_key_equal(map->keys[match_index], key)) {
+				return match_index;
+			}
+			match_mask &= match_mask - 1;
+		}
+		if (_mm_movemask_epi8(group)) {
+			return UINT32_MAX;
+		}
+		index = (index + hash_map_group_size) & (map->capacity - 1);
+	}
+}
+
+template <typename KEY, typename VALUE, typename LOOKUP_KEY>
+VALUE* hash_map_find(const hash_map<KEY, VALUE>* map, const LOOKUP_KEY& key) {
+	uint32 index = hash_map_find_index(map, hash_map_lookup_hash<KEY>(key), key);
+	return index == UINT32_MAX ? nullptr : &map->values[index];
+}
+
+template <typename KEY, typename VALUE, typename LOOKUP_KEY>
+bool hash_map_get(const hash_map<KEY, VALUE>* map, const LOOKUP_KEY& key, VALUE* value) {
+	VALUE* v = hash_map_find(map, key);
+	if (v) {
+		*value = *v;
+		return true;
+	}
+	return false;
+}
+
+template <typename KEY, typename VALUE>
+bool hash_map_insert(hash_map<KEY, VALUE>* map, const KEY& key, const VALUE& value) {
+	uint64 hash = hash_map_hash(key);
+	if (hash_map_find_index(map, hash, key) != UINT32_MAX) {
+		return false;
+	}
+	if ((uint64)(map->size + 1) * 8 > (uint64)map->capacity * 7) {
+		hash_map_resize(map, map->capacity * 2);
+	}
+	hash_map_insert_new(map, hash, key, value);
+	return true;
+}
+
+template <typename KEY, typename VALUE, typename LOOKUP_KEY>
+bool hash_map_remove(hash_map<KEY, VALUE>* map, const LOOKUP_KEY& key) {
+	uint32 index = hash_map_find_index(map, hash_map_lookup_hash<KEY>(key), key);
+	if (index == UINT32_MAX) {
+		return false;
+	}
+	uint32 mask = map->capacity - 1;
+	for (uint32 next_index = (index + 1) & mask; map->ctrls[next_index] != hash_map_ctrl_empty; next_index = (next_index + 1) & mask) {
+		uint32 ideal_index = hash_map_ideal_index(hash_map_hash(map->keys[next_index]), map->capacity);
+		if (((index - ideal_index) & mask) < ((next_index - ideal_index) & mask)) {
+			hash_map_set_ctrl(map, index, map->ctrls[next_index]);
+			map->keys[index] = map->keys[next_index];
+			map->values[index] = map->values[next_index];
+			index = next_index;
+		}
+	}
+	hash_map_set_ctrl(map, index, hash_map_ctrl_empty);
+	map->keys[index] = {};
+	map->values[index] = {};
+	map->size -= 1;
+	return true;
+}
+
+const char* get_file_name(const char* path) {
+	const char* ptr_0 = strrchr(path, '/');
+	const char* ptr_1 = strrchr(path, '\\');
+	if (ptr_0 && ptr_1) {
+		return ptr_0 > ptr_1 ? ptr_0 : ptr_1;
+	}
+	else if (ptr_0) {
+		return ptr_0 + 1;
 	}
 	else if (ptr_1) {
 		return ptr_1 + 1;
@@ -641,170 +1374,993 @@ const char* get_file_name(const char* path) {
 	}
 }
 
-struct memory_arena {
+// Interned strings. Every distinct string is copied once into arena memory and named by an atom,
+// so comparing names is an integer compare and the characters never move. Atom 0 is the empty string.
+struct atom {
+	uint32 index;
+
+	bool operator==(atom a) const { return index == a.index; }
+	bool operator!=(atom a) const { return index != a.index; }
+};
+
+struct atom_table {
+	memory_arena chars;
+	memory_arena strings;
+	uint32 count;
+	hash_map<string, uint32> indices;
+	std::mutex mutex;
+};
+
+atom_table* atom_table_get() {
+	static atom_table* table = [] {
+		atom_table* table = new atom_table();
+		m_assert(memory_arena_init(m_gigabytes(1), &table->chars));
+		m_assert(memory_arena_init(m_megabytes(256), &table->strings));
+		hash_map_initialize(&table->indices, 1024);
+		string* empty_string = memory_arena_alloc<string>(&table->strings, 1);
+		empty_string->ptr = memory_arena_alloc<char>(&table->chars, 1);
+		table->count = 1;
+		return table;
+	}();
+	return table;
+}
+
+atom atom_intern(const char* str, uint32 len) {
+	if (len == 0) {
+		return atom{ 0 };
+	}
+	atom_table* table = atom_table_get();
+	std::lock_guard<std::mutex> lock(table->mutex);
+	string key = { (char*)str, len, len };
+	uint32* index = hash_map_find(&table->indices, key);
+	if (index) {
+		return atom{ *index };
+	}
+	char* chars = memory_arena_alloc<char>(&table->chars, len + 1);
+	memcpy(chars, str, len);
+	string* interned_string = memory_arena_alloc<string>(&table->strings, 1);
+	*interned_string = { chars, len, len };
+	hash_map_insert(&table->indices, *interned_string, table->count);
+	table->count += 1;
+	return atom{ table->count - 1 };
+}
+
+atom atom_intern(const char* str) {
+	return atom_intern(str, (uint32)strlen(str));
+}
+
+bool atom_find(const char* str, atom* atom) {
+	if (str[0] == '\0') {
+		*atom = { 0 };
+		return true;
+	}
+	atom_table* table = atom_table_get();
+	std::lock_guard<std::mutex> lock(table->mutex);
+	uint32* index = hash_map_find(&table->indices, str);
+	if (index) {
+		*atom = { *index };
+		return true;
+	}
+	return false;
+}
+
+const char* atom_str(atom atom) {
+	return ((string*)atom_table_get()->strings.memory)[atom.index].ptr;
+}
+
+uint32 atom_len(atom atom) {
+	return ((string*)atom_table_get()->strings.memory)[atom.index].len;
+}
+
+// Index of the calling thread inside the job system, -1 for threads outside of it. The index is not tied to a
+// particular job_system, so there is only ever one per process, subsystems share it instead of starting their own.
+thread_local int32 job_worker_index = -1;
+
+// Fixed-size block pool usable from any number of threads. Free blocks travel between threads in chains of up to
+// memory_pool_batch_size blocks, kept on a Treiber stack whose head carries a 32 bit tag against ABA.
+// Job workers keep a private cache of one chain to allocate from plus the blocks they freed,
+// and only touch the shared stack once per batch. Other threads go to the shared stack directly.
+// A free block stores the next block of its chain at offset 0 and the next chain at offset 4.
+const uint32 memory_pool_null_index = UINT32_MAX;
+const uint32 memory_pool_batch_size = 32;
+
+struct alignas(64) memory_pool_cache {
+	uint32 alloc_head;
+	uint32 free_head;
+	uint32 free_count;
+};
+
+struct memory_pool {
+	alignas(64) std::atomic<uint64> free_chains;
+	memory_pool_cache* caches;
+	uint32 cache_count;
+	uint64 block_count;
+	uint64 block_size;
+	uint64 block_alignment;
 	uint8* memory;
-	uint64 size;
-	uint64 capacity;
 };
 
-bool memory_arena_init(uint64 capacity, memory_arena* arena) {
-	arena->memory = new uint8[capacity]();
-	arena->size = 0;
-	arena->capacity = capacity;
-	return arena->memory != nullptr;
+uint32* memory_pool_block_next(memory_pool* pool, uint32 index) {
+	return (uint32*)(pool->memory + index * pool->block_size);
+}
+
+std::atomic<uint32>* memory_pool_block_next_chain(memory_pool* pool, uint32 index) {
+	return (std::atomic<uint32>*)(pool->memory + index * pool->block_size + sizeof(uint32));
+}
+
+void memory_pool_push_chain(memory_pool* pool, uint32 chain_head) {
+	uint64 old_top = pool->free_chains.load(std::memory_order_relaxed);
+	uint64 new_top;
+	do {
+		memory_pool_block_next_chain(pool, chain_head)->store((uint32)old_top, std::memory_order_relaxed);
+		new_top = (((old_top >> 32) + 1) << 32) | chain_head;
+	} while (!pool->free_chains.compare_exchange_weak(old_top, new_top, std::memory_order_release, std::memory_order_relaxed));
+}
+
+uint32 memory_pool_pop_chain(memory_pool* pool) {
+	uint64 old_top = pool->free_chains.load(std::memory_order_acquire);
+	uint64 new_top;
+	do {
+		uint32 chain_head = (uint32)old_top;
+		if (chain_head == memory_pool_null_index) {
+			return memory_pool_null_index;
+		}
+		uint32 next_chain = memory_pool_block_next_chain(pool, chain_head)->load(std::memory_order_relaxed);
+		new_top = (((old_top >> 32) + 1) << 32) | next_chain;
+	} while (!pool->free_chains.compare_exchange_weak(old_top, new_top, std::memory_order_acquire, std::memory_order_acquire));
+	return (uint32)old_top;
+}
+
+// Not thread safe, every block returns to the pool.
+void memory_pool_clear(memory_pool* pool) {
+	pool->free_chains.store(memory_pool_null_index);
+	uint32 chain_count = (uint32)((pool->block_count + memory_pool_batch_size - 1) / memory_pool_batch_size);
+	for (uint32 chain = chain_count; chain > 0; chain -= 1) {
+		uint32 first = (chain - 1) * memory_pool_batch_size;
+		uint32 last = (uint32)min((uint64)(first + memory_pool_batch_size), pool->block_count) - 1;
+		for (uint32 i = first; i < last; i += 1) {
+			*memory_pool_block_next(pool, i) = i + 1;
+		}
+		*memory_pool_block_next(pool, last) = memory_pool_null_index;
+		memory_pool_push_chain(pool, first);
+	}
+	for (uint32 i = 0; i < pool->cache_count; i += 1) {
+		pool->caches[i] = { memory_pool_null_index, memory_pool_null_index, 0 };
+	}
+}
+
+// Not thread safe, hands the blocks held in every worker cache back to the shared stack.
+void memory_pool_flush_caches(memory_pool* pool) {
+	for (uint32 i = 0; i < pool->cache_count; i += 1) {
+		memory_pool_cache* cache = &pool->caches[i];
+		if (cache->alloc_head != memory_pool_null_index) {
+			memory_pool_push_chain(pool, cache->alloc_head);
+		}
+		if (cache->free_head != memory_pool_null_index) {
+			memory_pool_push_chain(pool, cache->free_head);
+		}
+		*cache = { memory_pool_null_index, memory_pool_null_index, 0 };
+	}
+}
+
+bool memory_arena_init(memory_pool* pool, uint64 block_count, uint64 block_size, uint64 block_alignment, uint32 cache_count = 0) {
+	m_debug_assert(block_count > 0 && block_count < memory_pool_null_index);
+	block_alignment = max(block_alignment, sizeof(void*));
+	m_debug_assert(is_pow2(block_alignment));
+	round_up(&block_size, block_alignment);
+	uint64 memory_size = block_size * block_count;
+	pool->block_size = block_size;
+	pool->block_count = block_count;
+	pool->block_alignment = block_alignment;
+	pool->memory = new uint8[memory_size];
+	if (!pool->memory) {
+		return false;
+	}
+	pool->cache_count = cache_count ? cache_count : max(std::thread::hardware_concurrency(), 1u);
+	pool->caches = new memory_pool_cache[pool->cache_count];
+	memory_pool_clear(pool);
+	return true;
+}
+
+void memory_pool_destroy(memory_pool* pool) {
+	delete[] pool->memory;
+	delete[] pool->caches;
+	pool->memory = nullptr;
+	pool->caches = nullptr;
+	pool->cache_count = 0;
+	pool->block_count = 0;
+}
+
+template <typename T>
+T* memory_pool_alloc(memory_pool* memory_pool) {
+	m_debug_assert(sizeof(T) <= memory_pool->block_size);
+	uint32 index = memory_pool_null_index;
+	if (job_worker_index >= 0 && (uint32)job_worker_index < memory_pool->cache_count) {
+		memory_pool_cache* cache = &memory_pool->caches[job_worker_index];
+		if (cache->free_head != memory_pool_null_index) {
+			index = cache->free_head;
+			cache->free_head = *memory_pool_block_next(memory_pool, index);
+			cache->free_count -= 1;
+		}
+		else {
+			if (cache->alloc_head == memory_pool_null_index) {
+				cache->alloc_head = memory_pool_pop_chain(memory_pool);
+			}
+			index = cache->alloc_head;
+			if (index != memory_pool_null_index) {
+				cache->alloc_head = *memory_pool_block_next(memory_pool, index);
+			}
+		}
+	}
+	else {
+		index = memory_pool_pop_chain(memory_pool);
+		if (index != memory_pool_null_index) {
+			uint32 rest = *memory_pool_block_next(memory_pool, index);
+			if (rest != memory_pool_null_index) {
+				memory_pool_push_chain(memory_pool, rest);
+			}
+		}
+	}
+	if (index == memory_pool_null_index) {
+		return nullptr;
+	}
+	T* block = (T*)(memory_pool->memory + index * memory_pool->block_size);
+	m_debug_assert((uintptr_t)block % alignof(T) == 0);
+	return block;
+}
+
+void memory_pool_free(memory_pool* memory_pool, void* block) {
+	m_debug_assert((uintptr_t)block >= (uintptr_t)memory_pool->memory);
+	m_debug_assert((uintptr_t)block < (uintptr_t)memory_pool->memory + memory_pool->block_count * memory_pool->block_size);
+	uint32 index = (uint32)(((uint8*)block - memory_pool->memory) / memory_pool->block_size);
+	if (job_worker_index >= 0 && (uint32)job_worker_index < memory_pool->cache_count) {
+		memory_pool_cache* cache = &memory_pool->caches[job_worker_index];
+		*memory_pool_block_next(memory_pool, index) = cache->free_head;
+		cache->free_head = index;
+		cache->free_count += 1;
+		if (cache->free_count == memory_pool_batch_size) {
+			memory_pool_push_chain(memory_pool, cache->free_head);
+			cache->free_head = memory_pool_null_index;
+			cache->free_count = 0;
+		}
+	}
+	else {
+		*memory_pool_block_next(memory_pool, index) = memory_pool_null_index;
+		memory_pool_push_chain(memory_pool, index);
+	}
+}
+
+std::array<char, 16> pretty_print_bytes(uint64 bytes) {
+	const char* suffixes[7];
+	suffixes[0] = "B";
+	suffixes[1] = "KB";
+	suffixes[2] = "MB";
+	suffixes[3] = "GB";
+	suffixes[4] = "TB";
+	suffixes[5] = "PB";
+	suffixes[6] = "EB";
+
+	uint32 s = 0;
+	double count = (double)bytes;
+	while (count >= 1024 && s < 7) {
+		s += 1;
+		count /= 1024;
+	}
+	std::array<char, 16> str;
+	if (count - floor(count) == 0.0) {
+		snprintf(str.data(), 16, "%d %s", (int32)count, suffixes[s]);
+	}
+	else {
+		snprintf(str.data(), 16, "%.1f %s", count, suffixes[s]);
+	}
+	return str;
+}
+
+std::array<char, 256> get_winapi_err_str() {
+	std::array<char, 256> str_buf;
+	FormatMessageA(FORMAT_MESSAGE_FROM_SYSTEM, nullptr, GetLastError(), MAKELANGID(LANG_NEUTRAL, SUBLANG_DEFAULT), &str_buf[0], (DWORD)str_buf.max_size(), nullptr);
+	return str_buf;
+}
+
+void show_console() {
+	if (!GetConsoleWindow()) {
+		AllocConsole();
+		m_assert(freopen("CONIN$", "r", stdin));
+		m_assert(freopen("CONOUT$", "w", stdout));
+		m_assert(freopen("CONOUT$", "w", stderr));
+	}
+}
+
+struct timer {
+	LARGE_INTEGER performance_frequency;
+	LARGE_INTEGER performance_counters[2];
+};
+
+void timer_init(timer* timer) {
+	QueryPerformanceFrequency(&timer->performance_frequency);
+}
+
+void timer_start(timer* timer) {
+	QueryPerformanceCounter(&timer->performance_counters[0]);
+}
+
+void timer_stop(timer* timer) {
+	QueryPerformanceCounter(&timer->performance_counters[1]);
+}
+
+double timer_get_duration(timer timer) {
+	LONGLONG ticks = timer.performance_counters[1].QuadPart - timer.performance_counters[0].QuadPart;
+	return (double)ticks / (double)timer.performance_frequency.QuadPart;
+}
+
+// Instrumentation for hot paths. m_profile_zone records the time spent until the end of the enclosing scope,
+// m_profile_counter_add accumulates into a per-call-site counter that profiler_frame samples and resets,
+// m_profile_gauge records a value as is. Events go into a buffer owned by the recording thread,
+// so recording is a timestamp read and a store, and nothing is recorded unless a capture is running.
+// Outside of a capture every macro costs a single relaxed load.
+// Build with NO_PROFILE to compile every macro away.
+const uint32 profiler_event_zone = 0;
+const uint32 profiler_event_value = 1;
+const uint32 profiler_thread_event_capacity = 1 << 18;
+
+struct profiler_event {
+	const char* name;
+	uint64 timestamp;
+	union {
+		uint64 duration;
+		double value;
+	};
+	uint32 type;
+};
+
+struct profiler_thread {
+	profiler_event* events;
+	std::atomic<uint32> event_count;
+	std::atomic<uint32> dropped_event_count;
+	std::atomic<uint32> capture_index;
+	uint32 thread_index;
+	char name[32];
+	profiler_thread* next;
+};
+
+struct profiler_counter {
+	const char* name;
+	std::atomic<int64> value;
+	profiler_counter* next;
+	profiler_counter(const char* name);
+};
+
+struct profiler {
+	std::atomic<bool> capturing;
+	std::atomic<uint32> capture_index;
+	std::atomic<uint32> thread_count;
+	std::atomic<profiler_thread*> threads;
+	std::atomic<profiler_counter*> counters;
+	uint64 capture_begin_timestamp;
+};
+
+profiler* profiler_get() {
+	static profiler profiler = {};
+	return &profiler;
+}
+
+uint64 profiler_timestamp() {
+	return (uint64)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+profiler_counter::profiler_counter(const char* name) : name(name), value(0), next(nullptr) {
+	profiler* profiler = profiler_get();
+	next = profiler->counters.load(std::memory_order_relaxed);
+	while (!profiler->counters.compare_exchange_weak(next, this, std::memory_order_release, std::memory_order_relaxed));
+}
+
+// The buffer of the calling thread, created and linked into the profiler on first use and never freed.
+// Event storage is only allocated once the thread records something.
+// The buffer empties itself when it notices a new capture, so no other thread ever writes to it.
+profiler_thread* profiler_get_thread() {
+	thread_local profiler_thread* thread = nullptr;
+	profiler* profiler = profiler_get();
+	if (!thread) {
+		thread = new profiler_thread();
+		thread->thread_index = profiler->thread_count.fetch_add(1);
+		snprintf(thread->name, sizeof(thread->name), "thread %u", thread->thread_index);
+		thread->next = profiler->threads.load(std::memory_order_relaxed);
+		while (!profiler->threads.compare_exchange_weak(thread->next, thread, std::memory_order_release, std::memory_order_relaxed));
+	}
+	uint32 capture_index = profiler->capture_index.load(std::memory_order_acquire);
+	if (thread->capture_index.load(std::memory_order_relaxed) != capture_index) {
+		thread->capture_index.store(capture_index, std::memory_order_relaxed);
+		thread->event_count.store(0, std::memory_order_relaxed);
+		thread->dropped_event_count.store(0, std::memory_order_relaxed);
+	}
+	return thread;
+}
+
+void profiler_set_thread_name(const char* name) {
+	profiler_thread* thread = profiler_get_thread();
+	snprintf(thread->name, sizeof(thread->name), "%s", name);
+}
+
+void profiler_record(const profiler_event& event) {
+	profiler_thread* thread = profiler_get_thread();
+	if (!thread->events) {
+		thread->events = new profiler_event[profiler_thread_event_capacity];
+	}
+	uint32 event_count = thread->event_count.load(std::memory_order_relaxed);
+	if (event_count == profiler_thread_event_capacity) {
+		thread->dropped_event_count.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+	thread->events[event_count] = event;
+	thread->event_count.store(event_count + 1, std::memory_order_release);
+}
+
+bool profiler_capturing() {
+	return profiler_get()->capturing.load(std::memory_order_relaxed);
+}
+
+void profiler_begin_capture() {
+	profiler* profiler = profiler_get();
+	profiler->capture_begin_timestamp = profiler_timestamp();
+	profiler->capture_index.fetch_add(1, std::memory_order_release);
+	profiler->capturing.store(true, std::memory_order_release);
+}
+
+void profiler_end_capture() {
+	profiler_get()->capturing.store(false, std::memory_order_release);
+}
+
+struct profiler_zone {
+	const char* name;
+	uint64 begin_timestamp;
+	profiler_zone(const char* name) : name(name), begin_timestamp(0) {
+		if (profiler_capturing()) {
+			begin_timestamp = profiler_timestamp();
+		}
+	}
+	~profiler_zone() {
+		if (begin_timestamp) {
+			profiler_event event;
+			event.name = name;
+			event.timestamp = begin_timestamp;
+			event.duration = profiler_timestamp() - begin_timestamp;
+			event.type = profiler_event_zone;
+			profiler_record(event);
+		}
+	}
+};
+
+void profiler_gauge(const char* name, double value) {
+	if (profiler_capturing()) {
+		profiler_event event;
+		event.name = name;
+		event.timestamp = profiler_timestamp();
+		event.value = value;
+		event.type = profiler_event_value;
+		profiler_record(event);
+	}
+}
+
+// Records every counter and sets it back to zero. Call once per frame.
+void profiler_frame() {
+	for (profiler_counter* counter = profiler_get()->counters.load(std::memory_order_acquire); counter; counter = counter->next) {
+		int64 value = counter->value.exchange(0, std::memory_order_relaxed);
+		profiler_gauge(counter->name, (double)value);
+	}
+}
+
+#ifndef NO_PROFILE
+#define m_profile_zone(name) profiler_zone m_concat_macros_2(profiler_zone_, __LINE__)(name)
+#define m_profile_gauge(name, value) profiler_gauge(name, (double)(value))
+#define m_profile_counter_add(name, delta) \
+do { \
+	if (profiler_capturing()) { \
+		static profiler_counter profiler_counter_(name); \
+		profiler_counter_.value.fetch_add((int64)(delta), std::memory_order_relaxed); \
+	} \
+} while (0)
+#else
+#define m_profile_zone(name) (void(0))
+#define m_profile_gauge(name, value) (void(0))
+#define m_profile_counter_add(name, delta) (void(0))
+#endif
+
+void profiler_write_json_string(FILE* file, const char* str) {
+	fputc('"', file);
+	for (; *str; str += 1) {
+		if (*str == '"' || *str == '\\') {
+			fputc('\\', file);
+		}
+		fputc(*str, file);
+	}
+	fputc('"', file);
+}
+
+// Writes the events of the last capture in the Chrome trace event format, viewable in chrome://tracing or Perfetto.
+// Threads that are still recording contribute the events they published so far.
+bool profiler_export_chrome_trace(const char* file_name) {
+	FILE* file = fopen(file_name, "w");
+	if (!file) {
+		return false;
+	}
+	auto close_file = scope_exit([&] { fclose(file); });
+
+	profiler* profiler = profiler_get();
+	uint32 capture_index = profiler->capture_index.load(std::memory_order_acquire);
+	uint64 begin_timestamp = profiler->capture_begin_timestamp;
+	fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+	bool first_event = true;
+	for (profiler_thread* thread = profiler->threads.load(std::memory_order_acquire); thread; thread = thread->next) {
+		uint32 event_count = thread->event_count.load(std::memory_order_acquire);
+		if (thread->capture_index.load(std::memory_order_relaxed) != capture_index || event_count == 0) {
+			continue;
+		}
+		fprintf(file, "%s{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":0,\"tid\":%u,\"args\":{\"name\":", first_event ? "" : ",\n", thread->thread_index);
+		profiler_write_json_string(file, thread->name);
+		fprintf(file, "}}");
+		first_event = false;
+		for (uint32 i = 0; i < event_count; i += 1) {
+			profiler_event& event = thread->events[i];
+			double timestamp = (double)(int64)(event.timestamp - begin_timestamp) / 1000.0;
+			fprintf(file, ",\n{\"name\":");
+			profiler_write_json_string(file, event.name);
+			if (event.type == profiler_event_zone) {
+				fprintf(file, ",\"ph\":\"X\",\"pid\":0,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}", thread->thread_index, timestamp, event.duration / 1000.0);
+			}
+			else {
+				fprintf(file, ",\"ph\":\"C\",\"pid\":0,\"tid\":%u,\"ts\":%.3f,\"args\":{\"value\":%g}}", thread->thread_index, timestamp, event.value);
+			}
+		}
+		uint32 dropped_event_count = thread->dropped_event_count.load(std::memory_order_relaxed);
+		if (dropped_event_count > 0) {
+			fprintf(file, ",\n{\"name\":\"dropped events\",\"ph\":\"C\",\"pid\":0,\"tid\":%u,\"ts\":0,\"args\":{\"value\":%u}}", thread->thread_index, dropped_event_count);
+		}
+	}
+	fprintf(file, "\n]}\n");
+	return !ferror(file);
+}
+
+// Allocation tracking by tag. Tags are registered once, typically into a global constant, and every tracked
+// allocation or free adjusts the byte and allocation count of its tag in a block owned by the calling thread,
+// so tracking is two uncontended stores. memory_tracker_snapshot sums the blocks of every thread that ever tracked
+// anything; frees on a different thread than the allocation simply cancel out in the sum.
+// Peaks are the highest totals seen by snapshots; take one per frame to keep them meaningful.
+const uint32 memory_tag_capacity = 64;
+
+struct memory_tracker_thread {
+	std::atomic<int64> bytes[memory_tag_capacity];
+	std::atomic<int64> counts[memory_tag_capacity];
+	memory_tracker_thread* next;
+};
+
+struct memory_tracker {
+	const char* tag_names[memory_tag_capacity];
+	std::atomic<uint32> tag_count;
+	int64 peak_bytes[memory_tag_capacity];
+	std::atomic<memory_tracker_thread*> threads;
+	std::mutex mutex;
+};
+
+struct memory_tag_stats {
+	const char* name;
+	int64 bytes;
+	int64 count;
+	int64 peak_bytes;
+};
+
+memory_tracker* memory_tracker_get() {
+	static memory_tracker tracker = {};
+	return &tracker;
+}
+
+uint32 memory_tag_register(const char* name) {
+	memory_tracker* tracker = memory_tracker_get();
+	std::lock_guard<std::mutex> lock(tracker->mutex);
+	uint32 tag_count = tracker->tag_count.load(std::memory_order_relaxed);
+	for (uint32 i = 0; i < tag_count; i += 1) {
+		if (!strcmp(tracker->tag_names[i], name)) {
+			return i;
+		}
+	}
+	m_assert(tag_count < memory_tag_capacity);
+	tracker->tag_names[tag_count] = name;
+	tracker->tag_count.store(tag_count + 1, std::memory_order_release);
+	return tag_count;
+}
+
+memory_tracker_thread* memory_tracker_get_thread() {
+	thread_local memory_tracker_thread* thread = nullptr;
+	if (!thread) {
+		memory_tracker* tracker = memory_tracker_get();
+		thread = new memory_tracker_thread();
+		thread->next = tracker->threads.load(std::memory_order_relaxed);
+		while (!tracker->threads.compare_exchange_weak(thread->next, thread, std::memory_order_release, std::memory_order_relaxed));
+	}
+	return thread;
+}
+
+void memory_track(uint32 tag, int64 bytes, int64 count) {
+	m_debug_assert(tag < memory_tag_capacity);
+	memory_tracker_thread* thread = memory_tracker_get_thread();
+	thread->bytes[tag].store(thread->bytes[tag].load(std::memory_order_relaxed) + bytes, std::memory_order_relaxed);
+	thread->counts[tag].store(thread->counts[tag].load(std::memory_order_relaxed) + count, std::memory_order_relaxed);
+}
+
+void memory_track_alloc(uint32 tag, uint64 size) {
+	memory_track(tag, (int64)size, 1);
+}
+
+void memory_track_free(uint32 tag, uint64 size) {
+	memory_track(tag, -(int64)size, -1);
+}
+
+// new T[count]() that is tracked under tag.
+template <typename T>
+T* memory_tracked_new(uint32 tag, uint64 count) {
+	memory_track_alloc(tag, count * sizeof(T));
+	return new T[count]();
+}
+
+template <typename T>
+void memory_tracked_delete(uint32 tag, T* ptr, uint64 count) {
+	if (ptr) {
+		memory_track_free(tag, count * sizeof(T));
+		delete[] ptr;
+	}
+}
+
+// Fills stats with one entry per registered tag and returns the tag count.
+uint32 memory_tracker_snapshot(memory_tag_stats* stats) {
+	memory_tracker* tracker = memory_tracker_get();
+	uint32 tag_count = tracker->tag_count.load(std::memory_order_acquire);
+	for (uint32 i = 0; i < tag_count; i += 1) {
+		stats[i] = { tracker->tag_names[i], 0, 0, 0 };
+	}
+	for (memory_tracker_thread* thread = tracker->threads.load(std::memory_order_acquire); thread; thread = thread->next) {
+		for (uint32 i = 0; i < tag_count; i += 1) {
+			stats[i].bytes += thread->bytes[i].load(std::memory_order_relaxed);
+			stats[i].count += thread->counts[i].load(std::memory_order_relaxed);
+		}
+	}
+	std::lock_guard<std::mutex> lock(tracker->mutex);
+	for (uint32 i = 0; i < tag_count; i += 1) {
+		tracker->peak_bytes[i] = max(tracker->peak_bytes[i], stats[i].bytes);
+		stats[i].peak_bytes = tracker->peak_bytes[i];
+	}
+	return tag_count;
+}
+
+// Samples the peaks, call once per frame.
+void memory_tracker_frame() {
+	memory_tag_stats stats[memory_tag_capacity];
+	memory_tracker_snapshot(stats);
+}
+
+// Writes every tag as a line of text, or as the members of a JSON object when json is set,
+// so callers can append their own members after it.
+void memory_tracker_write_report(FILE* file, bool json) {
+	memory_tag_stats stats[memory_tag_capacity];
+	uint32 tag_count = memory_tracker_snapshot(stats);
+	int64 total_bytes = 0;
+	int64 total_count = 0;
+	for (uint32 i = 0; i < tag_count; i += 1) {
+		total_bytes += stats[i].bytes;
+		total_count += stats[i].count;
+	}
+	if (json) {
+		fprintf(file, "\"total_bytes\":%lld,\"total_count\":%lld,\"tags\":[", (long long)total_bytes, (long long)total_count);
+		for (uint32 i = 0; i < tag_count; i += 1) {
+			fprintf(file, "%s\n{\"name\":", i == 0 ? "" : ",");
+			profiler_write_json_string(file, stats[i].name);
+			fprintf(file, ",\"bytes\":%lld,\"count\":%lld,\"peak_bytes\":%lld}", (long long)stats[i].bytes, (long long)stats[i].count, (long long)stats[i].peak_bytes);
+		}
+		fprintf(file, "]");
+	}
+	else {
+		fprintf(file, "%-32s %16s %12s %16s\n", "tag", "bytes", "count", "peak bytes");
+		for (uint32 i = 0; i < tag_count; i += 1) {
+			fprintf(file, "%-32s %16lld %12lld %16lld\n", stats[i].name, (long long)stats[i].bytes, (long long)stats[i].count, (long long)stats[i].peak_bytes);
+		}
+		fprintf(file, "%-32s %16lld %12lld\n", "total", (long long)total_bytes, (long long)total_count);
+	}
+}
+
+// Work-stealing job system. Every worker owns a Chase-Lev deque: the owner pushes and pops at the bottom,
+// idle workers steal from the top. Jobs are fire-and-forget and report completion through a job_counter,
+// job_system_wait keeps the waiting thread busy running other jobs until the counter drops to zero.
+// Jobs may only be submitted from the thread that called job_system_init or from inside other jobs.
+// Only one job system may exist at a time, see job_worker_index.
+
+struct job_counter {
+	std::atomic<uint64> count;
+};
+
+struct job {
+	void(*func)(void* data, uint64 begin, uint64 end);
+	void* data;
+	uint64 begin;
+	uint64 end;
+	job_counter* counter;
+};
+
+struct job_deque_slot {
+	std::atomic<void(*)(void*, uint64, uint64)> func;
+	std::atomic<void*> data;
+	std::atomic<uint64> begin;
+	std::atomic<uint64> end;
+	std::atomic<job_counter*> counter;
+};
+
+const int64 job_deque_capacity = 4096;
+
+struct alignas(64) job_deque {
+	std::atomic<int64> top;
+	alignas(64) std::atomic<int64> bottom;
+	job_deque_slot* slots;
+};
+
+struct job_system {
+	job_deque* deques;
+	std::thread* threads;
+	uint32 worker_count;
+	std::atomic<bool> quit;
+	std::atomic<uint64> queued_job_count;
+	std::atomic<uint32> sleeping_worker_count;
+	std::mutex sleep_mutex;
+	std::condition_variable sleep_condition;
+};
+
+void job_deque_write(job_deque_slot* slot, const job& job) {
+	slot->func.store(job.func, std::memory_order_relaxed);
+	slot->data.store(job.data, std::memory_order_relaxed);
+	slot->begin.store(job.begin, std::memory_order_relaxed);
+	slot->end.store(job.end, std::memory_order_relaxed);
+	slot->counter.store(job.counter, std::memory_order_relaxed);
 }
 
-void memory_arena_destroy(memory_arena* arena) {
-	delete[] arena->memory;
-	*arena = {};
+job job_deque_read(job_deque_slot* slot) {
+	job job;
+	job.func = slot->func.load(std::memory_order_relaxed);
+	job.data = slot->data.load(std::memory_order_relaxed);
+	job.begin = slot->begin.load(std::memory_order_relaxed);
+	job.end = slot->end.load(std::memory_order_relaxed);
+	job.counter = slot->counter.load(std::memory_order_relaxed);
+	return job;
 }
 
-template <typename T>
-T* memory_arena_alloc(memory_arena* memory_arena, uint64 count, uint64 alignment = alignof(T)) {
-	m_debug_assert(is_pow2(alignment));
-	if (count == 0) {
-		return nullptr;
+bool job_deque_push(job_deque* deque, const job& job) {
+	int64 bottom = deque->bottom.load(std::memory_order_relaxed);
+	int64 top = deque->top.load(std::memory_order_acquire);
+	if (bottom - top >= job_deque_capacity) {
+		return false;
 	}
-	uint8* memory = (uint8*)memory_arena->memory + memory_arena->size;
-	uint64 remainder = (uintptr_t)memory % alignment;
-	uint64 offset = (remainder == 0) ? 0 : (alignment - remainder);
-	uint64 new_arena_size = memory_arena->size + offset + count * sizeof(T);
-	m_assert(new_arena_size <= memory_arena->capacity);
-	memory_arena->size = new_arena_size;
-	memset(memory + offset, 0, count * sizeof(T));
-	return (T*)(memory + offset);
+	job_deque_write(&deque->slots[bottom & (job_deque_capacity - 1)], job);
+	deque->bottom.store(bottom + 1, std::memory_order_release);
+	return true;
 }
 
-struct memory_arena_undo_alloc_scope_exit {
-	memory_arena* arena;
-	uint64 restore_size;
-	memory_arena_undo_alloc_scope_exit(memory_arena* a) : arena(a), restore_size(a->size) {};
-	~memory_arena_undo_alloc_scope_exit() { arena->size = restore_size; }
-};
-
-struct memory_pool {
-	void* free_block;
-	uint64 free_block_count;
-	uint64 block_count;
-	uint64 block_size;
-	uint64 block_alignment;
-	uint8* memory;
-};
-
-void memory_pool_clear(memory_pool* pool) {
-	uint8* free_block = (uint8*)pool->memory;
-	for (uint64 i = 0; i < (pool->block_count - 1); i += 1) {
-		*(void**)free_block = free_block + pool->block_size;
-		free_block += pool->block_size;
+bool job_deque_pop(job_deque* deque, job* job) {
+	int64 bottom = deque->bottom.load(std::memory_order_relaxed) - 1;
+	deque->bottom.store(bottom, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	int64 top = deque->top.load(std::memory_order_relaxed);
+	if (top > bottom) {
+		deque->bottom.store(bottom + 1, std::memory_order_relaxed);
+		return false;
+	}
+	*job = job_deque_read(&deque->slots[bottom & (job_deque_capacity - 1)]);
+	if (top == bottom) {
+		bool won = deque->top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+		deque->bottom.store(bottom + 1, std::memory_order_relaxed);
+		return won;
 	}
-	*(void**)free_block = nullptr;
-	pool->free_block = pool->memory;
-	pool->free_block_count = pool->block_count;
+	return true;
 }
 
-bool memory_arena_init(memory_pool* pool, uint64 block_count, uint64 block_size, uint64 block_alignment) {
-	m_debug_assert(block_count > 0);
-	block_alignment = max(block_alignment, sizeof(void*));
-	m_debug_assert(is_pow2(block_alignment));
-	round_up(&block_size, block_alignment);
-	uint64 memory_size = block_size * block_count;
-	pool->block_size = block_size;
-	pool->block_count = block_count;
-	pool->memory = new uint8[memory_size]();
-	if (!pool->memory) {
+bool job_deque_steal(job_deque* deque, job* job) {
+	int64 top = deque->top.load(std::memory_order_acquire);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	int64 bottom = deque->bottom.load(std::memory_order_acquire);
+	if (top >= bottom) {
 		return false;
 	}
-	memory_pool_clear(pool);
-	return true;
+	*job = job_deque_read(&deque->slots[top & (job_deque_capacity - 1)]);
+	return deque->top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
 }
 
-void memory_pool_destroy(memory_pool* pool) {
-	delete[] pool->memory;
-	*pool = {};
+void job_run(const job& job) {
+	job.func(job.data, job.begin, job.end);
+	if (job.counter) {
+		job.counter->count.fetch_sub(1, std::memory_order_acq_rel);
+	}
 }
 
-template <typename T>
-T* memory_pool_alloc(memory_pool* memory_pool) {
-	m_debug_assert(sizeof(T) <= memory_pool->block_size);
-	T* block = (T*)memory_pool->free_block;
-	if (!block) {
-		return block;
+bool job_system_try_run_one(job_system* js) {
+	uint32 worker_index = (uint32)job_worker_index;
+	job job;
+	if (job_deque_pop(&js->deques[worker_index], &job)) {
+		js->queued_job_count.fetch_sub(1);
+		job_run(job);
+		return true;
 	}
-	memory_pool->free_block = *(T**)block;
-	memory_pool->free_block_count -= 1;
-	m_debug_assert((uintptr_t)block % alignof(T) == 0);
-	return block;
+	for (uint32 i = 1; i < js->worker_count; i += 1) {
+		uint32 victim_index = (worker_index + i) % js->worker_count;
+		if (job_deque_steal(&js->deques[victim_index], &job)) {
+			js->queued_job_count.fetch_sub(1);
+			job_run(job);
+			return true;
+		}
+	}
+	return false;
 }
 
-void memory_pool_free(memory_pool* memory_pool, void* block) {
-	m_debug_assert((uintptr_t)block >= (uintptr_t)memory_pool->memory);
-	m_debug_assert((uintptr_t)block < (uintptr_t)memory_pool->memory + memory_pool->block_count * memory_pool->block_size);
-	*(void**)block = memory_pool->free_block;
-	memory_pool->free_block = block;
-	memory_pool->free_block_count += 1;
+void job_system_worker_thread(job_system* js, uint32 worker_index) {
+	job_worker_index = (int32)worker_index;
+	char thread_name[32];
+	snprintf(thread_name, sizeof(thread_name), "job worker %u", worker_index);
+	profiler_set_thread_name(thread_name);
+	while (!js->quit.load(std::memory_order_acquire)) {
+		if (!job_system_try_run_one(js)) {
+			std::unique_lock<std::mutex> lock(js->sleep_mutex);
+			js->sleeping_worker_count.fetch_add(1);
+			if (js->queued_job_count.load() == 0 && !js->quit.load()) {
+				js->sleep_condition.wait(lock);
+			}
+			js->sleeping_worker_count.fetch_sub(1);
+		}
+	}
 }
 
-std::array<char, 16> pretty_print_bytes(uint64 bytes) {
-	const char* suffixes[7];
-	suffixes[0] = "B";
-	suffixes[1] = "KB";
-	suffixes[2] = "MB";
-	suffixes[3] = "GB";
-	suffixes[4] = "TB";
-	suffixes[5] = "PB";
-	suffixes[6] = "EB";
+std::atomic<job_system*> job_system_instance(nullptr);
 
-	uint32 s = 0;
-	double count = (double)bytes;
-	while (count >= 1024 && s < 7) {
-		s += 1;
-		count /= 1024;
+void job_system_init(job_system* js, uint32 worker_count = 0) {
+	m_assert(job_worker_index == -1);
+	job_system* no_instance = nullptr;
+	m_assert(job_system_instance.compare_exchange_strong(no_instance, js));
+	if (worker_count == 0) {
+		worker_count = max(std::thread::hardware_concurrency(), 1u);
 	}
-	std::array<char, 16> str;
-	if (count - floor(count) == 0.0) {
-		snprintf(str.data(), 16, "%d %s", (int32)count, suffixes[s]);
+	js->worker_count = worker_count;
+	js->quit = false;
+	js->queued_job_count = 0;
+	js->sleeping_worker_count = 0;
+	js->deques = new job_deque[worker_count];
+	for (uint32 i = 0; i < worker_count; i += 1) {
+		js->deques[i].top = 0;
+		js->deques[i].bottom = 0;
+		js->deques[i].slots = new job_deque_slot[job_deque_capacity];
 	}
-	else {
-		snprintf(str.data(), 16, "%.1f %s", count, suffixes[s]);
+	job_worker_index = 0;
+	js->threads = new std::thread[worker_count];
+	for (uint32 i = 1; i < worker_count; i += 1) {
+		js->threads[i] = std::thread(job_system_worker_thread, js, i);
 	}
-	return str;
 }
 
-std::array<char, 256> get_winapi_err_str() {
-	std::array<char, 256> str_buf;
-	FormatMessageA(FORMAT_MESSAGE_FROM_SYSTEM, nullptr, GetLastError(), MAKELANGID(LANG_NEUTRAL, SUBLANG_DEFAULT), &str_buf[0], (DWORD)str_buf.max_size(), nullptr);
-	return str_buf;
+void job_system_destroy(job_system* js) {
+	m_assert(job_worker_index == 0);
+	m_assert(job_system_instance.load() == js);
+	{
+		std::lock_guard<std::mutex> lock(js->sleep_mutex);
+		js->quit.store(true);
+	}
+	js->sleep_condition.notify_all();
+	for (uint32 i = 1; i < js->worker_count; i += 1) {
+		js->threads[i].join();
+	}
+	for (uint32 i = 0; i < js->worker_count; i += 1) {
+		delete[] js->deques[i].slots;
+	}
+	delete[] js->deques;
+	delete[] js->threads;
+	job_worker_index = -1;
+	job_system_instance.store(nullptr);
 }
 
-void show_console() {
-	if (!GetConsoleWindow()) {
-		AllocConsole();
-		m_assert(freopen("CONIN$", "r", stdin));
-		m_assert(freopen("CONOUT$", "w", stdout));
-		m_assert(freopen("CONOUT$", "w", stderr));
+void job_system_submit(job_system* js, const job& job) {
+	m_assert(job_worker_index >= 0 && (uint32)job_worker_index < js->worker_count);
+	if (job.counter) {
+		job.counter->count.fetch_add(1, std::memory_order_relaxed);
+	}
+	if (!job_deque_push(&js->deques[job_worker_index], job)) {
+		job_run(job);
+		return;
+	}
+	js->queued_job_count.fetch_add(1);
+	if (js->sleeping_worker_count.load() > 0) {
+		std::lock_guard<std::mutex> lock(js->sleep_mutex);
+		js->sleep_condition.notify_one();
 	}
 }
 
-struct timer {
-	LARGE_INTEGER performance_frequency;
-	LARGE_INTEGER performance_counters[2];
+void job_system_wait(job_system* js, job_counter* counter) {
+	while (counter->count.load(std::memory_order_acquire) > 0) {
+		if (!job_system_try_run_one(js)) {
+			std::this_thread::yield();
+		}
+	}
+}
+
+template <typename F>
+struct parallel_for_context {
+	job_system* js;
+	job_counter* counter;
+	uint64 grain_size;
+	F* func;
 };
 
-void timer_init(timer* timer) {
-	QueryPerformanceFrequency(&timer->performance_frequency);
+template <typename F>
+void parallel_for_job(void* data, uint64 begin, uint64 end) {
+	parallel_for_context<F>* context = (parallel_for_context<F>*)data;
+	while (end - begin > context->grain_size) {
+		uint64 mid = begin + (end - begin) / 2;
+		job_system_submit(context->js, job{ parallel_for_job<F>, data, mid, end, context->counter });
+		end = mid;
+	}
+	(*context->func)(begin, end);
 }
 
-void timer_start(timer* timer) {
-	QueryPerformanceCounter(&timer->performance_counters[0]);
+// Calls func(begin, end) over [0, count) in chunks of at most grain_size, returns when every chunk is done.
+template <typename F>
+void parallel_for(job_system* js, uint64 count, uint64 grain_size, F func) {
+	if (count == 0) {
+		return;
+	}
+	job_counter counter = {};
+	parallel_for_context<F> context = { js, &counter, max(grain_size, 1ull), &func };
+	parallel_for_job<F>(&context, 0, count);
+	job_system_wait(js, &counter);
 }
 
-void timer_stop(timer* timer) {
-	QueryPerformanceCounter(&timer->performance_counters[1]);
+// Per-thread linear allocators for transient frame data, one memory_arena per job worker per in-flight frame.
+// Allocations made during frame N stay valid through frame N + 1 and are released wholesale when frame N + 2 begins.
+// Only job workers may allocate, a thread outside the job system has no arena of its own.
+const uint32 frame_allocator_frame_count = 2;
+
+struct frame_allocator {
+	memory_arena* arenas;
+	uint32 worker_count;
+	uint32 frame_index;
+};
+
+bool frame_allocator_init(frame_allocator* fa, uint32 worker_count, uint64 arena_capacity) {
+	fa->worker_count = max(worker_count, 1u);
+	fa->frame_index = 0;
+	fa->arenas = new memory_arena[fa->worker_count * frame_allocator_frame_count]();
+	for (uint32 i = 0; i < fa->worker_count * frame_allocator_frame_count; i += 1) {
+		if (!memory_arena_init(arena_capacity, &fa->arenas[i])) {
+			return false;
+		}
+	}
+	return true;
 }
 
-double timer_get_duration(timer timer) {
-	LONGLONG ticks = timer.performance_counters[1].QuadPart - timer.performance_counters[0].QuadPart;
-	return (double)ticks / (double)timer.performance_frequency.QuadPart;
+void frame_allocator_destroy(frame_allocator* fa) {
+	for (uint32 i = 0; i < fa->worker_count * frame_allocator_frame_count; i += 1) {
+		memory_arena_destroy(&fa->arenas[i]);
+	}
+	delete[] fa->arenas;
+	*fa = {};
+}
+
+// Must not race with allocations, call it between frames.
+void frame_allocator_next_frame(frame_allocator* fa) {
+	fa->frame_index = (fa->frame_index + 1) % frame_allocator_frame_count;
+	for (uint32 i = 0; i < fa->worker_count; i += 1) {
+		memory_arena_reset(&fa->arenas[fa->frame_index * fa->worker_count + i]);
+	}
+}
+
+memory_arena* frame_allocator_arena(frame_allocator* fa) {
+	m_assert(job_worker_index >= 0);
+	uint32 worker_index = (uint32)job_worker_index;
+	m_debug_assert(worker_index < fa->worker_count);
+	return &fa->arenas[fa->frame_index * fa->worker_count + worker_index];
+}
+
+template <typename T>
+T* frame_allocator_alloc(frame_allocator* fa, uint64 count, uint64 alignment = alignof(T)) {
+	return memory_arena_alloc<T>(frame_allocator_arena(fa), count, alignment);
 }
 
 bool get_current_dir(char* dir, uint32 dir_buf_size) {
@@ -838,26 +2394,150 @@ bool file_exists(const char* path) {
 	return (dwAttrib != INVALID_FILE_ATTRIBUTES && !(dwAttrib & FILE_ATTRIBUTE_DIRECTORY));
 }
 
+// Bit i is set when data[i] is one of the isspace characters, for the 32 bytes at data.
+uint32 whitespace_mask32(const char* data) {
+	__m128i tab = _mm_set1_epi8('\t' - 1);
+	__m128i carriage_return = _mm_set1_epi8('\r' + 1);
+	__m128i space = _mm_set1_epi8(' ');
+	__m128i a = _mm_loadu_si128((const __m128i*)data);
+	__m128i b = _mm_loadu_si128((const __m128i*)(data + 16));
+	__m128i a_mask = _mm_or_si128(_mm_cmpeq_epi8(a, space), _mm_and_si128(_mm_cmpgt_epi8(a, tab), _mm_cmplt_epi8(a, carriage_return)));
+	__m128i b_mask = _mm_or_si128(_mm_cmpeq_epi8(b, space), _mm_and_si128(_mm_cmpgt_epi8(b, tab), _mm_cmplt_epi8(b, carriage_return)));
+	return (uint32)_mm_movemask_epi8(a_mask) | ((uint32)_mm_movemask_epi8(b_mask) << 16);
+}
+
+bool is_whitespace(char c) {
+	return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+// A view into the tokenizer's buffer, the buffer is never written to so tokens are not NUL terminated.
 struct token {
-	char* ptr;
+	const char* ptr;
 	int len;
 
+	bool equals(const char* str) {
+		return strlen(str) == (size_t)len && !memcmp(ptr, str, len);
+	}
+
+	// Parses the whole token. Plain decimals with at most 19 significant digits and a small exponent are
+	// computed exactly in double and then rounded once to float, which is correct unless the double lands exactly
+	// halfway between two floats. Those, and everything else strtof accepts, go through strtof on a copy.
 	bool to_float(float* fp) {
-		char c = ptr[len];
-		ptr[len] = '\0';
-		auto restore_char = scope_exit([&] { ptr[len] = c; });
+		const char* p = ptr;
+		const char* end = ptr + len;
+		bool negative = false;
+		if (p < end && (*p == '-' || *p == '+')) {
+			negative = *p == '-';
+			p += 1;
+		}
+		uint64 mantissa = 0;
+		int digit_count = 0;
+		int significant_digit_count = 0;
+		int exponent = 0;
+		for (; p < end && *p >= '0' && *p <= '9'; p += 1) {
+			mantissa = mantissa * 10 + (*p - '0');
+			significant_digit_count += (mantissa != 0);
+			digit_count += 1;
+		}
+		if (p < end && *p == '.') {
+			p += 1;
+			for (; p < end && *p >= '0' && *p <= '9'; p += 1) {
+				mantissa = mantissa * 10 + (*p - '0');
+				significant_digit_count += (mantissa != 0);
+				digit_count += 1;
+				exponent -= 1;
+			}
+		}
+		if (digit_count > 0 && p < end && (*p == 'e' || *p == 'E')) {
+			p += 1;
+			bool negative_exponent = false;
+			if (p < end && (*p == '-' || *p == '+')) {
+				negative_exponent = *p == '-';
+				p += 1;
+			}
+			int e = 0;
+			const char* exponent_begin = p;
+			for (; p < end && *p >= '0' && *p <= '9'; p += 1) {
+				e = min(e * 10 + (*p - '0'), 100000);
+			}
+			if (p == exponent_begin) {
+				return to_float_slow(fp);
+			}
+			exponent += negative_exponent ? -e : e;
+		}
+		if (p != end || digit_count == 0 || significant_digit_count > 19) {
+			return to_float_slow(fp);
+		}
+		if (mantissa == 0) {
+			*fp = negative ? -0.0f : 0.0f;
+			return true;
+		}
+		static const double powers_of_ten[] = {
+			1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+			1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+		};
+		if (mantissa > (1ull << 53) || exponent < -22 || exponent > 22) {
+			return to_float_slow(fp);
+		}
+		double d = exponent < 0 ? (double)mantissa / powers_of_ten[-exponent] : (double)mantissa * powers_of_ten[exponent];
+		uint64 bits;
+		memcpy(&bits, &d, sizeof(bits));
+		if ((bits & ((1ull << 29) - 1)) == (1ull << 28)) {
+			return to_float_slow(fp);
+		}
+		*fp = negative ? -(float)d : (float)d;
+		return true;
+	}
+
+	bool to_float_slow(float* fp) {
+		char buffer[128];
+		char* str = len < (int)sizeof(buffer) ? buffer : new char[len + 1];
+		auto delete_str = scope_exit([&] { if (str != buffer) delete[] str; });
+		memcpy(str, ptr, len);
+		str[len] = '\0';
 		char* endptr = nullptr;
-		*fp = strtof(ptr, &endptr);
-		if (errno == ERANGE) {
+		errno = 0;
+		*fp = strtof(str, &endptr);
+		return len > 0 && endptr == str + len && errno != ERANGE;
+	}
+
+	bool to_int(int64* ip) {
+		const char* p = ptr;
+		const char* end = ptr + len;
+		bool negative = false;
+		if (p < end && (*p == '-' || *p == '+')) {
+			negative = *p == '-';
+			p += 1;
+		}
+		if (p == end) {
+			return false;
+		}
+		uint64 n = 0;
+		for (; p < end; p += 1) {
+			uint32 digit = (uint32)(*p - '0');
+			if (digit > 9 || n > (UINT64_MAX - digit) / 10) {
+				return false;
+			}
+			n = n * 10 + digit;
+		}
+		if (n > (negative ? (uint64)INT64_MAX + 1 : (uint64)INT64_MAX)) {
 			return false;
 		}
-		if (*fp == 0.0f && endptr == ptr) {
+		*ip = negative ? (int64)(0 - n) : (int64)n;
+		return true;
+	}
+
+	bool to_int(int32* ip) {
+		int64 i;
+		if (!to_int(&i) || i < INT32_MIN || i > INT32_MAX) {
 			return false;
 		}
+		*ip = (int32)i;
 		return true;
 	}
 };
 
+// Splits file_data into whitespace separated tokens, 32 bytes at a time while there are that many left.
 struct file_tokenizer {
 	FILE* file;
 	size_t file_len;
@@ -865,20 +2545,34 @@ struct file_tokenizer {
 	size_t file_pos;
 
 	bool get_token(token* tk) {
-		while (file_pos < file_len && isspace(file_data[file_pos])) {
+		while (file_pos + 32 <= file_len) {
+			uint32 mask = ~whitespace_mask32(file_data + file_pos);
+			if (mask) {
+				file_pos += count_trailing_zeros(mask);
+				break;
+			}
+			file_pos += 32;
+		}
+		while (file_pos < file_len && is_whitespace(file_data[file_pos])) {
 			file_pos += 1;
 		}
 		if (file_pos >= file_len) {
 			return false;
 		}
 		size_t tk_pos = file_pos;
-		int len = 0;
-		while (file_pos < file_len && !isspace(file_data[file_pos])) {
-			len += 1;
+		while (file_pos + 32 <= file_len) {
+			uint32 mask = whitespace_mask32(file_data + file_pos);
+			if (mask) {
+				file_pos += count_trailing_zeros(mask);
+				break;
+			}
+			file_pos += 32;
+		}
+		while (file_pos < file_len && !is_whitespace(file_data[file_pos])) {
 			file_pos += 1;
 		}
 		tk->ptr = file_data + tk_pos;
-		tk->len = len;
+		tk->len = (int)(file_pos - tk_pos);
 		return true;
 	}
 };
@@ -913,15 +2607,52 @@ void file_tokenizer_delete(file_tokenizer ft) {
 	fclose(ft.file);
 }
 
+// Hints about how a mapping is going to be touched, combine them with |.
+// sequential and random tune read-ahead, will_need and populate start reading the whole file in before open returns.
+// A freshly created file has nothing to read in, so create only takes sequential and random.
+const uint32 file_mapping_hint_sequential = 1 << 0;
+const uint32 file_mapping_hint_random = 1 << 1;
+const uint32 file_mapping_hint_will_need = 1 << 2;
+const uint32 file_mapping_hint_populate = 1 << 3;
+
 struct file_mapping {
 	uint8* ptr;
 	uint64 size;
+	bool writable;
 	HANDLE mapping_handle;
 	HANDLE file_handle;
 };
 
-bool file_mapping_create(const char* file_name, uint64 file_size, file_mapping* file_mapping) {
-	HANDLE file_handle = CreateFileA(file_name, GENERIC_READ | GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+DWORD file_mapping_file_flags(uint32 hints) {
+	DWORD flags = FILE_ATTRIBUTE_NORMAL;
+	if (hints & file_mapping_hint_sequential) {
+		flags |= FILE_FLAG_SEQUENTIAL_SCAN;
+	}
+	else if (hints & file_mapping_hint_random) {
+		flags |= FILE_FLAG_RANDOM_ACCESS;
+	}
+	return flags;
+}
+
+// Reads [offset, offset + size) of the file into memory in the background so later accesses do not fault.
+void file_mapping_prefetch(file_mapping* file_mapping, uint64 offset, uint64 size) {
+	if (offset >= file_mapping->size) {
+		return;
+	}
+	WIN32_MEMORY_RANGE_ENTRY range = { file_mapping->ptr + offset, (SIZE_T)min(size, file_mapping->size - offset) };
+	PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+}
+
+// Applies hints to an existing mapping. Read-ahead hints only take effect when passed to open or create.
+void file_mapping_advise(file_mapping* file_mapping, uint32 hints) {
+	if (hints & (file_mapping_hint_will_need | file_mapping_hint_populate)) {
+		file_mapping_prefetch(file_mapping, 0, file_mapping->size);
+	}
+}
+
+bool file_mapping_create(const char* file_name, uint64 file_size, file_mapping* file_mapping, uint32 hints = 0) {
+	m_debug_assert(!(hints & (file_mapping_hint_will_need | file_mapping_hint_populate)));
+	HANDLE file_handle = CreateFileA(file_name, GENERIC_READ | GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, file_mapping_file_flags(hints), nullptr);
 	if (file_handle == INVALID_HANDLE_VALUE) {
 		return false;
 	}
@@ -954,18 +2685,19 @@ bool file_mapping_create(const char* file_name, uint64 file_size, file_mapping*
 	file_mapping->mapping_handle = mapping_handle;
 	file_mapping->ptr = mapping_ptr;
 	file_mapping->size = file_size;
+	file_mapping->writable = true;
 	return true;
 }
 
-bool file_mapping_open(const char* file_name, file_mapping* file_mapping, bool read_only) {
+bool file_mapping_open(const char* file_name, file_mapping* file_mapping, bool read_only, uint32 hints = 0) {
 	DWORD access_flags = read_only ? GENERIC_READ : (GENERIC_READ | GENERIC_WRITE);
 	DWORD share_flags = read_only ? FILE_SHARE_READ : 0;
-	HANDLE file_handle = CreateFileA(file_name, access_flags, share_flags, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	HANDLE file_handle = CreateFileA(file_name, access_flags, share_flags, nullptr, OPEN_EXISTING, file_mapping_file_flags(hints), nullptr);
 	if (file_handle == INVALID_HANDLE_VALUE) {
 		return false;
 	}
-	uint64 file_size = GetFileSize(file_handle, nullptr);
-	if (file_size == INVALID_FILE_SIZE) {
+	LARGE_INTEGER file_size;
+	if (!GetFileSizeEx(file_handle, &file_size)) {
 		CloseHandle(file_handle);
 		return false;
 	}
@@ -983,7 +2715,9 @@ bool file_mapping_open(const char* file_name, file_mapping* file_mapping, bool r
 	file_mapping->file_handle = file_handle;
 	file_mapping->mapping_handle = mapping_handle;
 	file_mapping->ptr = mapping_ptr;
-	file_mapping->size = file_size;
+	file_mapping->size = file_size.QuadPart;
+	file_mapping->writable = !read_only;
+	file_mapping_advise(file_mapping, hints);
 	return true;
 }
 
@@ -1016,6 +2750,225 @@ void file_mapping_close(file_mapping file_mapping) {
 	m_assert(CloseHandle(file_mapping.file_handle));
 }
 
+// Asynchronous file reads. Requests are queued by priority class and served highest class first, FIFO within a class.
+// A pool of threads issues positional blocking reads. Completion calls the request callback on an io thread and then
+// decrements the request counter, async_io_wait blocks until a counter reaches zero.
+// Files opened with direct = true bypass the OS cache, their reads need offsets and buffers aligned to async_io_alignment,
+// and buffers from async_io_buffer_alloc satisfy that.
+const uint32 async_io_priority_high = 0;
+const uint32 async_io_priority_normal = 1;
+const uint32 async_io_priority_low = 2;
+const uint32 async_io_priority_count = 3;
+const uint64 async_io_alignment = 4096;
+
+struct async_file {
+	HANDLE handle;
+	uint64 size;
+	bool direct;
+};
+
+struct async_io_request {
+	async_file* file;
+	uint64 offset;
+	uint64 size;
+	uint8* buffer;
+	uint32 priority;
+	void(*callback)(async_io_request* request);
+	void* callback_data;
+	job_counter* counter;
+	uint64 bytes_read;
+	bool success;
+	async_io_request* next;
+};
+
+struct async_io {
+	async_io_request* queue_heads[async_io_priority_count];
+	async_io_request* queue_tails[async_io_priority_count];
+	std::mutex mutex;
+	std::condition_variable queue_condition;
+	std::condition_variable completion_condition;
+	std::thread* threads;
+	uint32 thread_count;
+	bool quit;
+};
+
+bool async_file_open(const char* file_name, async_file* file, bool direct = false) {
+	DWORD flags = FILE_ATTRIBUTE_NORMAL | (direct ? FILE_FLAG_NO_BUFFERING : FILE_FLAG_SEQUENTIAL_SCAN);
+	HANDLE handle = CreateFileA(file_name, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, flags, nullptr);
+	if (handle == INVALID_HANDLE_VALUE) {
+		return false;
+	}
+	LARGE_INTEGER file_size;
+	if (!GetFileSizeEx(handle, &file_size)) {
+		CloseHandle(handle);
+		return false;
+	}
+	file->handle = handle;
+	file->size = file_size.QuadPart;
+	file->direct = direct;
+	return true;
+}
+
+void async_file_close(async_file* file) {
+	CloseHandle(file->handle);
+}
+
+uint8* async_io_buffer_alloc(uint64 size) {
+	size = round_up(max(size, (uint64)1), virtual_memory_page_size(false));
+	uint8* buffer = (uint8*)virtual_memory_reserve(size, false);
+	if (buffer && !virtual_memory_commit(buffer, size)) {
+		virtual_memory_release(buffer, size);
+		return nullptr;
+	}
+	return buffer;
+}
+
+void async_io_buffer_free(uint8* buffer, uint64 size) {
+	virtual_memory_release(buffer, round_up(max(size, (uint64)1), virtual_memory_page_size(false)));
+}
+
+// Returns the byte count a read of request->size bytes at request->offset moves, direct reads go in whole alignment units.
+uint64 async_io_read_size(const async_io_request* request) {
+	return request->file->direct ? round_up(request->size, async_io_alignment) : request->size;
+}
+
+void async_io_complete(async_io* io, async_io_request* request, bool success) {
+	request->success = success;
+	request->bytes_read = min(request->bytes_read, request->size);
+	if (request->callback) {
+		request->callback(request);
+	}
+	if (request->counter) {
+		std::lock_guard<std::mutex> lock(io->mutex);
+		request->counter->count.fetch_sub(1, std::memory_order_acq_rel);
+		io->completion_condition.notify_all();
+	}
+}
+
+// Pops the first request of the highest priority class, the caller holds io->mutex.
+async_io_request* async_io_pop_request(async_io* io) {
+	for (uint32 i = 0; i < async_io_priority_count; i += 1) {
+		async_io_request* request = io->queue_heads[i];
+		if (request) {
+			io->queue_heads[i] = request->next;
+			if (!request->next) {
+				io->queue_tails[i] = nullptr;
+			}
+			return request;
+		}
+	}
+	return nullptr;
+}
+
+void async_io_push_request(async_io* io, async_io_request* request, bool front) {
+	uint32 priority = request->priority;
+	if (front) {
+		request->next = io->queue_heads[priority];
+		io->queue_heads[priority] = request;
+		if (!io->queue_tails[priority]) {
+			io->queue_tails[priority] = request;
+		}
+	}
+	else {
+		request->next = nullptr;
+		if (io->queue_tails[priority]) {
+			io->queue_tails[priority]->next = request;
+		}
+		else {
+			io->queue_heads[priority] = request;
+		}
+		io->queue_tails[priority] = request;
+	}
+}
+
+void async_io_thread_pool_read(async_io* io, async_io_request* request) {
+	uint64 read_size = async_io_read_size(request);
+	while (request->bytes_read < read_size) {
+		uint64 offset = request->offset + request->bytes_read;
+		uint32 size = (uint32)min(read_size - request->bytes_read, (uint64)m_gigabytes(1));
+		OVERLAPPED overlapped = {};
+		overlapped.Offset = (DWORD)offset;
+		overlapped.OffsetHigh = (DWORD)(offset >> 32);
+		DWORD bytes_read = 0;
+		if (!ReadFile(request->file->handle, request->buffer + request->bytes_read, size, &bytes_read, &overlapped)) {
+			if (GetLastError() != ERROR_HANDLE_EOF) {
+				async_io_complete(io, request, false);
+				return;
+			}
+		}
+		if (bytes_read == 0) {
+			break;
+		}
+		request->bytes_read += bytes_read;
+	}
+	async_io_complete(io, request, true);
+}
+
+void async_io_thread_pool_thread(async_io* io) {
+	profiler_set_thread_name("async io");
+	while (true) {
+		async_io_request* request = nullptr;
+		{
+			std::unique_lock<std::mutex> lock(io->mutex);
+			io->queue_condition.wait(lock, [&] { return (request = async_io_pop_request(io)) != nullptr || io->quit; });
+			if (!request) {
+				return;
+			}
+		}
+		m_profile_zone("async io read");
+		async_io_thread_pool_read(io, request);
+	}
+}
+
+// thread_count is the number of reads in flight at once.
+void async_io_init(async_io* io, uint32 thread_count = 4) {
+	for (uint32 i = 0; i < async_io_priority_count; i += 1) {
+		io->queue_heads[i] = nullptr;
+		io->queue_tails[i] = nullptr;
+	}
+	io->quit = false;
+	io->thread_count = max(thread_count, 1u);
+	io->threads = new std::thread[io->thread_count];
+	for (uint32 i = 0; i < io->thread_count; i += 1) {
+		io->threads[i] = std::thread(async_io_thread_pool_thread, io);
+	}
+}
+
+// Finishes every queued read before returning.
+void async_io_destroy(async_io* io) {
+	{
+		std::lock_guard<std::mutex> lock(io->mutex);
+		io->quit = true;
+	}
+	io->queue_condition.notify_all();
+	for (uint32 i = 0; i < io->thread_count; i += 1) {
+		io->threads[i].join();
+	}
+	delete[] io->threads;
+}
+
+// Queues a read of request->size bytes at request->offset into request->buffer.
+// The request must stay alive and untouched until it completes, bytes_read and success are valid from the callback on.
+void async_io_read(async_io* io, async_io_request* request) {
+	m_debug_assert(request->priority < async_io_priority_count);
+	m_debug_assert(!request->file->direct || (request->offset % async_io_alignment == 0 && (uint64)request->buffer % async_io_alignment == 0));
+	request->bytes_read = 0;
+	request->success = false;
+	if (request->counter) {
+		request->counter->count.fetch_add(1, std::memory_order_relaxed);
+	}
+	{
+		std::lock_guard<std::mutex> lock(io->mutex);
+		async_io_push_request(io, request, false);
+	}
+	io->queue_condition.notify_one();
+}
+
+void async_io_wait(async_io* io, job_counter* counter) {
+	std::unique_lock<std::mutex> lock(io->mutex);
+	io->completion_condition.wait(lock, [&] { return counter->count.load(std::memory_order_acquire) == 0; });
+}
+
 template <typename T>
 bool iterate_files_in_dir(const char* dir, T func) {
 	char dir_buf[256];
@@ -1263,90 +3216,4 @@ bool rgba_image_to_bmp_file(void* image, uint32 image_width, uint32 image_height
 	}
 }
 
-// struct profiler_code_frame {
-//   const char *name;
-//   uint32 level;
-//   uint64 per_frame_num_calls[2];
-//   uint64 per_frame_call_time_microsec[2];
-//   profiler_code_frame *parent;
-//   profiler_code_frame *next;
-//   profiler_code_frame *children;
-// };
-
-// struct profiler {
-//   uint32 current_frame_index;
-//   profiler_code_frame *current_code_frame;
-//   profiler_code_frame *root_code_frame;
-//   LARGE_INTEGER performance_frequency;
-// };
-
-// template <typename F>
-// void profiler_traverse_code_frames(profiler_code_frame *code_frame, F f) {
-//   f(code_frame);
-//   profiler_code_frame *child_code_frame = code_frame->children;
-//   while (child_code_frame) {
-//     profiler_traverse_code_frames(child_code_frame, f);
-//     child_code_frame = child_code_frame->next;
-//   }
-// };
-
-// void profiler_swap_frame(profiler *profiler) {
-//   uint32 last_frame_index = profiler->current_frame_index == 0 ? 1 : 0;
-//   profiler->current_frame_index = last_frame_index;
-//   profiler_traverse_code_frames(profiler->current_code_frame, [last_frame_index] (profiler_code_frame *code_frame) {
-//     code_frame->per_frame_num_calls[last_frame_index] = 0;
-//     code_frame->per_frame_call_time_microsec[last_frame_index] = 0;
-//   });
-// }
-
-// uint64 profiler_get_last_frame_call_time(profiler *profiler) {
-//   return profiler->current_code_frame->per_frame_call_time_microsec[profiler->current_frame_index == 0 ? 1 :0];
-// }
-
-// #define m_profiler_begin_code_frame(profiler__, frame_name__)           \
-//   {                                                                     \
-//     static profiler_code_frame code_frame = {};                         \
-//     static int32 code_frame_init = [] (struct profiler *profiler, struct profiler_code_frame *code_frame) { \
-//       code_frame->name = frame_name__;                                  \
-//       code_frame->level = profiler->current_code_frame->level + 1;      \
-//       code_frame->parent = profiler->current_code_frame;                \
-//       profiler_code_frame *child_frame = profiler->current_code_frame->children; \
-//       if (!child_frame) {                                               \
-//         profiler->current_code_frame->children = code_frame;            \
-//       }                                                                 \
-//       else {                                                            \
-//         while (child_frame->next) {                                     \
-//           child_frame = child_frame->next;                              \
-//         }                                                               \
-//         child_frame->next = code_frame;                                 \
-//       }                                                                 \
-//       return 0;                                                         \
-//     }(profiler__, &code_frame);                                         \
-//     (profiler__)->current_code_frame = &code_frame;                     \
-//   }                                                                     \
-
-// #define m_profiler_end_code_frame(profiler__, frame_time__)                      \
-//   {                                                                              \
-//     uint32 frame_index = (profiler__)->current_frame_index;                      \
-//     (profiler__)->current_code_frame->per_frame_num_calls[frame_index] += 1;     \
-//     (profiler__)->current_code_frame->per_frame_call_time_microsec[frame_index] += frame_time__; \
-//     (profiler__)->current_code_frame = (profiler__)->current_code_frame->parent; \
-//   }
-
-// struct profiler_scope_exit {
-//   profiler *profiler;
-//   LARGE_INTEGER performance_counters[2];
-//   ~profiler_scope_exit() {
-//     QueryPerformanceCounter(&performance_counters[1]);
-//     uint64 frame_time = (performance_counters[1].QuadPart - performance_counters[0].QuadPart) * 1000000 / profiler->performance_frequency.QuadPart;
-//     m_profiler_end_code_frame(profiler, frame_time);
-//   }
-// };
-
-// #define m_profile_scope(profiler__, frame_name__)                           \
-//   m_profiler_begin_code_frame(profiler__, frame_name__)                     \
-//   struct profiler_scope_exit profiler_scope_exit = {};                      \
-//   profiler_scope_exit.profiler = profiler__;                                \
-//   QueryPerformanceCounter(&profiler_scope_exit.performance_counters[0]);
-
 #endif // __COMMON_CPP__
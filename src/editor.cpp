@@ -79,7 +79,7 @@ enum transformable_type {
 
 struct transform_operation {
 	transformable_type transformable_type;
-	char id[64];
+	atom id;
 	transform original_transform;
 };
 
@@ -210,7 +210,6 @@ struct editor {
 	float terrain_brush_tool_radius;
 	float terrain_brush_tool_speed;
 
-	uint64 world_frame_memory_arena_size;
 	char world_save_file[256];
 
 	edit_operation undoes[256];
@@ -362,7 +361,7 @@ bool editor::load_settings() {
 
 	token tk;
 	while (ft.get_token(&tk)) {
-		if (!strncmp(tk.ptr, "camera_position:", tk.len)) {
+		if (tk.equals("camera_position:")) {
 			token tx, ty, tz;
 			float fx, fy, fz;
 			if (!ft.get_token(&tx) || !tx.to_float(&fx) ||
@@ -372,7 +371,7 @@ bool editor::load_settings() {
 			}
 			camera_position = XMVectorSet(fx, fy, fz, 0);
 		}
-		else if (!strncmp(tk.ptr, "camera_view:", tk.len)) {
+		else if (tk.equals("camera_view:")) {
 			token tx, ty, tz;
 			float fx, fy, fz;
 			if (!ft.get_token(&tx) || !tx.to_float(&fx) ||
@@ -382,7 +381,7 @@ bool editor::load_settings() {
 			}
 			camera_view = XMVectorSet(fx, fy, fz, 0);
 		}
-		else if (!strncmp(tk.ptr, "camera_move_speed:", tk.len)) {
+		else if (tk.equals("camera_move_speed:")) {
 			token ts;
 			float fs;
 			if (!ft.get_token(&ts) || !ts.to_float(&fs)) {
@@ -390,7 +389,7 @@ bool editor::load_settings() {
 			}
 			camera_move_speed = (uint32)fs;
 		}
-		else if (!strncmp(tk.ptr, "camera_rotate_speed:", tk.len)) {
+		else if (tk.equals("camera_rotate_speed:")) {
 			token ts;
 			float fs;
 			if (!ft.get_token(&ts) || !ts.to_float(&fs)) {
@@ -848,7 +847,7 @@ void editor::pop_undo(world* world) {
 			} break;
 			case transformable_type_model: {
 				for (auto& model : world->models) {
-					if (!strcmp(model.file_name, op->id)) {
+					if (model.file == op->id) {
 						model.transform = op->original_transform;
 						break;
 					}
@@ -957,10 +956,13 @@ void editor::check_popups(world* world, d3d12* d3d12) {
 		if (ImGui::Button("Ok")) {
 			bool empty_id = id[0] == 0;
 			bool duplicate = false;
-			for (auto& object : world->static_objects) {
-				if (object.id == id) {
-					duplicate = true;
-					break;
+			atom id_atom;
+			if (atom_find(id, &id_atom)) {
+				for (auto& object : world->static_objects) {
+					if (object.id == id_atom) {
+						duplicate = true;
+						break;
+					}
 				}
 			}
 			if (empty_id) {
@@ -978,9 +980,7 @@ void editor::check_popups(world* world, d3d12* d3d12) {
 				static_object->transform = transform_identity();
 				static_object->animation_index = UINT32_MAX;
 				static_object->animation_time = 0;
-				char* id_cstr = new char[strlen(id) + 1]();
-				strcpy(id_cstr, id);
-				static_object->id = { id_cstr, (uint32)strlen(id) };
+				static_object->id = atom_intern(id);
 				close_popup();
 			}
 		}
@@ -1012,10 +1012,13 @@ void editor::check_popups(world* world, d3d12* d3d12) {
 		if (ImGui::Button("Ok")) {
 			bool empty_id = id[0] == 0;
 			bool duplicate = false;
-			for (uint32 i = 0; i < world->static_objects.size; i += 1) {
-				if (world->static_objects[i].id == id && i != static_object_index) {
-					duplicate = true;
-					break;
+			atom id_atom;
+			if (atom_find(id, &id_atom)) {
+				for (uint32 i = 0; i < world->static_objects.size; i += 1) {
+					if (world->static_objects[i].id == id_atom && i != static_object_index) {
+						duplicate = true;
+						break;
+					}
 				}
 			}
 			if (empty_id) {
@@ -1028,9 +1031,7 @@ void editor::check_popups(world* world, d3d12* d3d12) {
 			}
 			else {
 				static_object* static_object = &world->static_objects[static_object_index];
-				char* id_cstr = new char[strlen(id) + 1]();
-				strcpy(id_cstr, id);
-				static_object->id = { id_cstr, (uint32)strlen(id) };
+				static_object->id = atom_intern(id);
 				close_popup();
 			}
 		}
@@ -1062,10 +1063,13 @@ void editor::check_popups(world* world, d3d12* d3d12) {
 		if (ImGui::Button("Ok")) {
 			bool empty_id = id[0] == 0;
 			bool duplicate = false;
-			for (auto& object : world->dynamic_objects) {
-				if (object.id == id) {
-					duplicate = true;
-					break;
+			atom id_atom;
+			if (atom_find(id, &id_atom)) {
+				for (auto& object : world->dynamic_objects) {
+					if (object.id == id_atom) {
+						duplicate = true;
+						break;
+					}
 				}
 			}
 			if (empty_id) {
@@ -1083,9 +1087,7 @@ void editor::check_popups(world* world, d3d12* d3d12) {
 				dynamic_object->transform = transform_identity();
 				dynamic_object->animation_index = UINT32_MAX;
 				dynamic_object->animation_time = 0;
-				char* id_cstr = new char[strlen(id) + 1]();
-				strcpy(id_cstr, id);
-				dynamic_object->id = { id_cstr, (uint32)strlen(id_cstr) };
+				dynamic_object->id = atom_intern(id);
 				close_popup();
 			}
 		}
@@ -1117,10 +1119,13 @@ void editor::check_popups(world* world, d3d12* d3d12) {
 		if (ImGui::Button("Ok")) {
 			bool empty_id = id[0] == 0;
 			bool duplicate = false;
-			for (uint32 i = 0; i < world->dynamic_objects.size; i += 1) {
-				if (world->dynamic_objects[i].id == id && i != dynamic_object_index) {
-					duplicate = true;
-					break;
+			atom id_atom;
+			if (atom_find(id, &id_atom)) {
+				for (uint32 i = 0; i < world->dynamic_objects.size; i += 1) {
+					if (world->dynamic_objects[i].id == id_atom && i != dynamic_object_index) {
+						duplicate = true;
+						break;
+					}
 				}
 			}
 			if (empty_id) {
@@ -1133,9 +1138,7 @@ void editor::check_popups(world* world, d3d12* d3d12) {
 			}
 			else {
 				dynamic_object* dynamic_object = &world->dynamic_objects[dynamic_object_index];
-				char* id_cstr = new char[strlen(id) + 1]();
-				strcpy(id_cstr, id);
-				dynamic_object->id = { id_cstr, (uint32)strlen(id_cstr) };
+				dynamic_object->id = atom_intern(id);
 				close_popup();
 			}
 		}
@@ -1289,6 +1292,27 @@ void editor::top_menu(world* world, d3d12* d3d12) {
 				}
 			}
 			ImGui::Separator();
+			if (!profiler_capturing()) {
+				if (ImGui::MenuItem("Begin Profile Capture")) {
+					profiler_begin_capture();
+				}
+			}
+			else {
+				if (ImGui::MenuItem("End Profile Capture")) {
+					profiler_end_capture();
+					if (!profiler_export_chrome_trace("profile_trace.json")) {
+						snprintf(error_msg, sizeof(error_msg), "failed to write profile trace to file: \"profile_trace.json\"");
+						error_popup = true;
+					}
+				}
+			}
+			if (ImGui::MenuItem("Write Memory Report")) {
+				if (!world_write_memory_report(world, "memory_report.txt", false) || !world_write_memory_report(world, "memory_report.json", true)) {
+					snprintf(error_msg, sizeof(error_msg), "failed to write memory report to file: \"memory_report.txt\"");
+					error_popup = true;
+				}
+			}
+			ImGui::Separator();
 			if (ImGui::MenuItem("Quit")) {
 				quit_popup = true;
 			}
@@ -1389,10 +1413,10 @@ void editor::bottom_menu() {
 }
 
 void editor::edit_window_model_transform(world* world, uint32* model_index, transform* transform) {
-	const char* model_file = *model_index < world->models.size ? world->models[*model_index].file_name : nullptr;
+	const char* model_file = *model_index < world->models.size ? atom_str(world->models[*model_index].file) : nullptr;
 	if (ImGui::BeginCombo("model", model_file)) {
 		for (uint32 i = 0; i < world->models.size; i += 1) {
-			if (ImGui::Selectable(world->models[i].file_name, *model_index == i)) {
+			if (ImGui::Selectable(atom_str(world->models[i].file), *model_index == i)) {
 				*model_index = i;
 			}
 		}
@@ -1421,10 +1445,10 @@ void editor::edit_window_static_object_tab(world* world) {
 		add_static_object_popup = true;
 	}
 	static_object* static_object = static_object_index < world->static_objects.size ? &world->static_objects[static_object_index] : nullptr;
-	const char* id = static_object ? static_object->id.ptr : nullptr;
+	const char* id = static_object ? atom_str(static_object->id) : nullptr;
 	if (ImGui::BeginCombo("static objects", id)) {
 		for (uint32 i = 0; i < world->static_objects.size; i += 1) {
-			if (ImGui::Selectable(world->static_objects[i].id.ptr, static_object_index == i)) {
+			if (ImGui::Selectable(atom_str(world->static_objects[i].id), static_object_index == i)) {
 				static_object_index = i;
 				static_object = &world->static_objects[i];
 			}
@@ -1448,10 +1472,10 @@ void editor::edit_window_dynamic_object_tab(world* world) {
 		add_dynamic_object_popup = true;
 	}
 	dynamic_object* dynamic_object = dynamic_object_index < world->dynamic_objects.size ? &world->dynamic_objects[dynamic_object_index] : nullptr;
-	const char* id = dynamic_object ? dynamic_object->id.ptr : nullptr;
+	const char* id = dynamic_object ? atom_str(dynamic_object->id) : nullptr;
 	if (ImGui::BeginCombo("dynamic objects", id)) {
 		for (uint32 i = 0; i < world->dynamic_objects.size; i += 1) {
-			if (ImGui::Selectable(world->dynamic_objects[i].id.ptr, dynamic_object_index == i)) {
+			if (ImGui::Selectable(atom_str(world->dynamic_objects[i].id), dynamic_object_index == i)) {
 				dynamic_object_index = i;
 				dynamic_object = &world->dynamic_objects[i];
 			}
@@ -1487,10 +1511,10 @@ void editor::edit_window_model_tab(world* world, d3d12* d3d12) {
 	ImGui::Checkbox("Adjust", &adjust_model);
 	ImGui::Separator();
 	model* model = model_index < world->models.size ? &world->models[model_index] : nullptr;
-	const char* file = model ? model->file_name : nullptr;
+	const char* file = model ? atom_str(model->file) : nullptr;
 	if (ImGui::BeginCombo("models", file)) {
 		for (uint32 i = 0; i < world->models.size; i += 1) {
-			if (ImGui::Selectable(world->models[i].file_name, model_index == i)) {
+			if (ImGui::Selectable(atom_str(world->models[i].file), model_index == i)) {
 				model_index = i;
 				model = &world->models[i];
 			}
@@ -1595,10 +1619,10 @@ void editor::edit_window_terrain_tab(world* world) {
 		}
 	}
 	terrain* terrain = world->terrain_index < world->terrains.size ? &world->terrains[world->terrain_index] : nullptr;
-	const char* file = terrain ? terrain->file : nullptr;
+	const char* file = terrain ? atom_str(terrain->file) : nullptr;
 	if (ImGui::BeginCombo("terrains", file)) {
 		for (uint32 i = 0; i < world->terrains.size; i += 1) {
-			if (ImGui::Selectable(world->terrains[i].file, world->terrain_index == i)) {
+			if (ImGui::Selectable(atom_str(world->terrains[i].file), world->terrain_index == i)) {
 				world->terrain_index = i;
 				terrain = &world->terrains[i];
 			}
@@ -1620,10 +1644,10 @@ void editor::edit_window_skybox_tab(world* world) {
 		}
 	}
 	skybox* skybox = world->skybox_index < world->skyboxes.size ? &world->skyboxes[world->skybox_index] : nullptr;
-	const char* file = skybox ? skybox->file : nullptr;
+	const char* file = skybox ? atom_str(skybox->file) : nullptr;
 	if (ImGui::BeginCombo("skyboxes", file)) {
 		for (uint32 i = 0; i < world->skyboxes.size; i += 1) {
-			if (ImGui::Selectable(world->skyboxes[i].file, world->skybox_index == i)) {
+			if (ImGui::Selectable(atom_str(world->skyboxes[i].file), world->skybox_index == i)) {
 				world->skybox_index = i;
 				skybox = &world->skyboxes[i];
 			}
@@ -1716,7 +1740,7 @@ void editor::objects_window(world* world, d3d12* d3d12) {
 				}
 				for (uint32 i = 0; i < world->models.size; i += 1) {
 					bool selected = selected_object_type == selectable_object_model && selected_object_index == i;
-					if (ImGui::Selectable(world->models[i].file_name, selected)) {
+					if (ImGui::Selectable(atom_str(world->models[i].file), selected)) {
 						selected_object_type = selectable_object_model;
 						selected_object_index = i;
 					}
@@ -1759,9 +1783,49 @@ void editor::memories_window(world* world, d3d12* d3d12) {
 			ImGui::Text("%s", memory_name);
 		};
 		ImGui::Text("System Memory");
-		imgui_render_memory(world_frame_memory_arena_size, world->frame_memory_arena.capacity, "world frame arena");
+		uint64 frame_allocator_size = 0;
+		uint64 frame_allocator_committed = 0;
+		uint64 frame_allocator_peak_size = 0;
+		for (uint32 i = 0; i < world->frame_allocator.worker_count * frame_allocator_frame_count; i += 1) {
+			frame_allocator_size += world->frame_allocator.arenas[i].size;
+			frame_allocator_committed += world->frame_allocator.arenas[i].committed;
+			frame_allocator_peak_size += world->frame_allocator.arenas[i].peak_size;
+		}
+		imgui_render_memory(frame_allocator_size, frame_allocator_committed, "world frame arenas");
+		ImGui::Text("world frame arenas peak: %s", pretty_print_bytes(frame_allocator_peak_size).data());
 		ImGui::Text("GPU Memory");
 		imgui_render_memory(d3d12->frame_constants_buffer_size, d3d12->frame_constants_buffer_capacity, "world frame constants");
+		if (ImGui::CollapsingHeader("Allocations")) {
+			memory_tag_stats stats[memory_tag_capacity];
+			uint32 tag_count = memory_tracker_snapshot(stats);
+			ImGui::Columns(4);
+			ImGui::Text("tag"); ImGui::NextColumn();
+			ImGui::Text("size"); ImGui::NextColumn();
+			ImGui::Text("count"); ImGui::NextColumn();
+			ImGui::Text("peak"); ImGui::NextColumn();
+			for (uint32 i = 0; i < tag_count; i += 1) {
+				ImGui::Text("%s", stats[i].name); ImGui::NextColumn();
+				ImGui::Text("%s", pretty_print_bytes(stats[i].bytes).data()); ImGui::NextColumn();
+				ImGui::Text("%lld", (long long)stats[i].count); ImGui::NextColumn();
+				ImGui::Text("%s", pretty_print_bytes(stats[i].peak_bytes).data()); ImGui::NextColumn();
+			}
+			ImGui::Columns(1);
+		}
+		if (ImGui::CollapsingHeader("Models")) {
+			uint32* model_indices = frame_allocator_alloc<uint32>(&world->frame_allocator, world->models.size + 1);
+			world_sort_models_by_memory_size(world, model_indices);
+			ImGui::Columns(3);
+			ImGui::Text("model"); ImGui::NextColumn();
+			ImGui::Text("size"); ImGui::NextColumn();
+			ImGui::Text("gpu size"); ImGui::NextColumn();
+			for (uint32 i = 0; i < world->models.size; i += 1) {
+				model* model = &world->models[model_indices[i]];
+				ImGui::Text("%s", atom_str(model->file)); ImGui::NextColumn();
+				ImGui::Text("%s", pretty_print_bytes(model->memory_size).data()); ImGui::NextColumn();
+				ImGui::Text("%s", pretty_print_bytes(model->gpu_memory_size).data()); ImGui::NextColumn();
+			}
+			ImGui::Columns(1);
+		}
 	}
 	ImGui::End();
 	ImGui::PopID();
@@ -1953,15 +2017,15 @@ void editor::tool_gizmo(world* world, window* window) {
 	//					} break;
 	//					case transformable_type_static_object: {
 	//						operation.transform_operation.transformable_type = transformable_type_static_object;
-	//						strcpy(operation.transform_operation.id, world->static_objects[editor->static_object_index].id.ptr);
+	//						operation.transform_operation.id = world->static_objects[editor->static_object_index].id;
 	//					} break;
 	//					case transformable_type_dynamic_object: {
 	//						operation.transform_operation.transformable_type = transformable_type_dynamic_object;
-	//						strcpy(operation.transform_operation.id, world->dynamic_objects[editor->dynamic_object_index].id.ptr);
+	//						operation.transform_operation.id = world->dynamic_objects[editor->dynamic_object_index].id;
 	//					} break;
 	//					case transformable_type_model: {
 	//						operation.transform_operation.transformable_type = transformable_type_model;
-	//						strcpy(operation.transform_operation.id, world->models[editor->model_index].file);
+	//						operation.transform_operation.id = world->models[editor->model_index].file;
 	//					} break;
 	//					}
 	//					editor_add_undo(editor, operation);
@@ -2153,6 +2217,9 @@ int main(int argc, char** argv) {
 	window_show(window);
 
 	while (!editor->quit) {
+		profiler_frame();
+		memory_tracker_frame();
+		m_profile_zone("frame");
 		timer_start(&editor->timer);
 		auto record_frame_timing = scope_exit(
 			[&] {
@@ -2175,19 +2242,22 @@ int main(int argc, char** argv) {
 		window_handle_messages(window);
 
 		ImGui::GetIO().DeltaTime = (float)editor->last_frame_time;
-		ImGui::NewFrame();
-		editor->check_quit();
-		editor->check_toggle_fullscreen(window);
-		editor->check_popups(world, d3d12);
-		editor->top_menu(world, d3d12);
-		editor->bottom_menu();
-		editor->objects_window(world, d3d12);
-		editor->memories_window(world, d3d12);
-		editor->frame_statistic_window(window);
-		editor->update_camera(window);
-		editor->tool_gizmo(world, window);
-		editor->check_undo(world);
-		ImGui::Render();
+		{
+			m_profile_zone("editor ui");
+			ImGui::NewFrame();
+			editor->check_quit();
+			editor->check_toggle_fullscreen(window);
+			editor->check_popups(world, d3d12);
+			editor->top_menu(world, d3d12);
+			editor->bottom_menu();
+			editor->objects_window(world, d3d12);
+			editor->memories_window(world, d3d12);
+			editor->frame_statistic_window(window);
+			editor->update_camera(window);
+			editor->tool_gizmo(world, window);
+			editor->check_undo(world);
+			ImGui::Render();
+		}
 
 		d3d12->swap_chain_buffer_index = d3d12->swap_chain->GetCurrentBackBufferIndex();
 		m_d3d_assert(d3d12->command_allocator->Reset());
@@ -2205,12 +2275,18 @@ int main(int argc, char** argv) {
 
 		m_d3d_assert(d3d12->command_list->Close());
 		d3d12->command_queue->ExecuteCommandLists(1, (ID3D12CommandList**)&d3d12->command_list);
-		d3d12->wait_command_list_completion();
-
-		m_d3d_assert(d3d12->swap_chain->Present(1, 0));
+		{
+			m_profile_zone("wait gpu");
+			d3d12->wait_command_list_completion();
+		}
+		{
+			m_profile_zone("present");
+			m_d3d_assert(d3d12->swap_chain->Present(1, 0));
+		}
 	}
 	editor->save_settings();
 	ImGui::DestroyContext(editor->imgui_context);
+	world_destroy(world);
 
 	// d3d12->dxgi_debug->ReportLiveObjects(DXGI_DEBUG_ALL, DXGI_DEBUG_RLO_IGNORE_INTERNAL);
 	d3d12->dxgi_info_queue->SetMuteDebugOutput(DXGI_DEBUG_ALL, true);
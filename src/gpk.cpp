@@ -5,7 +5,7 @@
 #ifndef __GPK_CPP__
 #define __GPK_CPP__
 
-#define m_gpk_model_format_str "GPK_MODEL_FORMAT"
+#define m_gpk_model_format_str "GPK_MODEL_FORMAT_2"
 #define m_gpk_skybox_format_str "GPK_SKYBOX_FORMAT"
 #define m_gpk_terrain_format_str "GPK_TERRAIN_FORMAT"
 
@@ -50,12 +50,17 @@ struct gpk_model_mesh {
 	uint32 primitive_count;
 };
 
+const uint32 gpk_model_vertex_format_full = 0;
+const uint32 gpk_model_vertex_format_packed = 1;
+
 struct gpk_model_mesh_primitive {
 	uint32 material_index;
 	uint32 indices_offset;
 	uint32 index_count;
 	uint32 vertices_offset;
 	uint32 vertex_count;
+	uint32 vertex_format;
+	aabb bound;
 };
 
 struct gpk_model_vertex {
@@ -69,6 +74,142 @@ struct gpk_model_vertex {
 };
 static_assert(sizeof(gpk_model_vertex) == 12 + 4 + 8 + 8 + 8 + 4 + 8, "");
 
+// Compact form of gpk_model_vertex. position is unorm16 across the primitive bound, its w is 1 where the bitangent sign
+// (tangent.w of gpk_model_vertex) is negative. normal_tangent holds the octahedral normal in xy and the octahedral tangent
+// in zw as snorm16, uv is half precision.
+struct gpk_model_vertex_packed {
+	u16vec4 position;
+	u8vec4 color;
+	uint16 uv[2];
+	i16vec4 normal_tangent;
+	u8vec4 joints;
+	u16vec4 weights;
+};
+static_assert(sizeof(gpk_model_vertex_packed) == 8 + 4 + 4 + 8 + 4 + 8, "");
+
+uint32 gpk_model_vertex_size(uint32 vertex_format) {
+	return vertex_format == gpk_model_vertex_format_packed ? (uint32)sizeof(gpk_model_vertex_packed) : (uint32)sizeof(gpk_model_vertex);
+}
+
+// Both directions run 4 vertices at a time, a partial last group goes through a padded copy so every vertex gets the
+// same rounding. bound must contain every position, a flat axis packs to 0.
+void gpk_model_vertices_pack(const gpk_model_vertex* vertices, uint32 vertex_count, aabb bound, gpk_model_vertex_packed* packed) {
+	vec3 extent = bound.max - bound.min;
+	vec3x4 scale = vec3x4_set1({extent.x > 0 ? 65535 / extent.x : 0, extent.y > 0 ? 65535 / extent.y : 0, extent.z > 0 ? 65535 / extent.z : 0});
+	vec3x4 origin = vec3x4_set1(bound.min);
+	auto pack4 = [&](const gpk_model_vertex* v, gpk_model_vertex_packed* p, uint32 count) {
+		auto gather = [v](auto&& get) { return floatx4{_mm_setr_ps(get(v[0]), get(v[1]), get(v[2]), get(v[3]))}; };
+		auto quantize = [](floatx4 f, floatx4 lo, floatx4 hi) { return _mm_cvtps_epi32(min(max(f, lo), hi).v); };
+		vec3x4 position = {
+			gather([](const gpk_model_vertex& v) { return v.position.x; }),
+			gather([](const gpk_model_vertex& v) { return v.position.y; }),
+			gather([](const gpk_model_vertex& v) { return v.position.z; })};
+		position = (position - origin) * scale;
+		floatx4 normal_u, normal_v, tangent_u, tangent_v;
+		octahedral_encode(
+			gather([](const gpk_model_vertex& v) { return (float)v.normal.x; }),
+			gather([](const gpk_model_vertex& v) { return (float)v.normal.y; }),
+			gather([](const gpk_model_vertex& v) { return (float)v.normal.z; }), &normal_u, &normal_v);
+		octahedral_encode(
+			gather([](const gpk_model_vertex& v) { return (float)v.tangent.x; }),
+			gather([](const gpk_model_vertex& v) { return (float)v.tangent.y; }),
+			gather([](const gpk_model_vertex& v) { return (float)v.tangent.z; }), &tangent_u, &tangent_v);
+		floatx4 zero = floatx4_set1(0);
+		floatx4 unorm_max = floatx4_set1(65535);
+		floatx4 snorm_min = floatx4_set1(-32767);
+		floatx4 snorm_max = floatx4_set1(32767);
+		alignas(16) int32 lanes[9][4];
+		_mm_store_si128((__m128i*)lanes[0], quantize(position.x, zero, unorm_max));
+		_mm_store_si128((__m128i*)lanes[1], quantize(position.y, zero, unorm_max));
+		_mm_store_si128((__m128i*)lanes[2], quantize(position.z, zero, unorm_max));
+		_mm_store_si128((__m128i*)lanes[3], half_from_float(gather([](const gpk_model_vertex& v) { return v.uv.x; })));
+		_mm_store_si128((__m128i*)lanes[4], half_from_float(gather([](const gpk_model_vertex& v) { return v.uv.y; })));
+		_mm_store_si128((__m128i*)lanes[5], quantize(normal_u * 32767.0f, snorm_min, snorm_max));
+		_mm_store_si128((__m128i*)lanes[6], quantize(normal_v * 32767.0f, snorm_min, snorm_max));
+		_mm_store_si128((__m128i*)lanes[7], quantize(tangent_u * 32767.0f, snorm_min, snorm_max));
+		_mm_store_si128((__m128i*)lanes[8], quantize(tangent_v * 32767.0f, snorm_min, snorm_max));
+		for (uint32 i = 0; i < count; i += 1) {
+			p[i].position = {(uint16)lanes[0][i], (uint16)lanes[1][i], (uint16)lanes[2][i], (uint16)(v[i].tangent.w < 0)};
+			p[i].color = v[i].color;
+			p[i].uv[0] = (uint16)lanes[3][i];
+			p[i].uv[1] = (uint16)lanes[4][i];
+			p[i].normal_tangent = {(int16)lanes[5][i], (int16)lanes[6][i], (int16)lanes[7][i], (int16)lanes[8][i]};
+			p[i].joints = v[i].joints;
+			p[i].weights = v[i].weights;
+		}
+	};
+	uint32 i = 0;
+	for (; i + 4 <= vertex_count; i += 4) {
+		pack4(vertices + i, packed + i, 4);
+	}
+	if (i < vertex_count) {
+		gpk_model_vertex tail[4];
+		for (uint32 j = 0; j < 4; j += 1) {
+			tail[j] = vertices[min(i + j, vertex_count - 1)];
+		}
+		pack4(tail, packed + i, vertex_count - i);
+	}
+}
+
+// Normals and tangents come back unit length before the snorm16 rounding, tangent.w is +-32767 and normal.w is 0.
+void gpk_model_vertices_unpack(const gpk_model_vertex_packed* packed, uint32 vertex_count, aabb bound, gpk_model_vertex* vertices) {
+	vec3x4 scale = vec3x4_set1((bound.max - bound.min) / 65535.0f);
+	vec3x4 origin = vec3x4_set1(bound.min);
+	auto unpack4 = [&](const gpk_model_vertex_packed* p, gpk_model_vertex* v, uint32 count) {
+		auto gather = [p](auto&& get) { return _mm_setr_epi32(get(p[0]), get(p[1]), get(p[2]), get(p[3])); };
+		auto snorm = [](__m128i i) { return max(floatx4{_mm_cvtepi32_ps(i)} * (1.0f / 32767), floatx4_set1(-1)); };
+		vec3x4 position = {
+			floatx4{_mm_cvtepi32_ps(gather([](const gpk_model_vertex_packed& p) { return (int32)p.position.x; }))},
+			floatx4{_mm_cvtepi32_ps(gather([](const gpk_model_vertex_packed& p) { return (int32)p.position.y; }))},
+			floatx4{_mm_cvtepi32_ps(gather([](const gpk_model_vertex_packed& p) { return (int32)p.position.z; }))}};
+		position = origin + position * scale;
+		floatx4 uv_x = float_from_half(gather([](const gpk_model_vertex_packed& p) { return (int32)p.uv[0]; }));
+		floatx4 uv_y = float_from_half(gather([](const gpk_model_vertex_packed& p) { return (int32)p.uv[1]; }));
+		vec3x4 normal, tangent;
+		octahedral_decode(
+			snorm(gather([](const gpk_model_vertex_packed& p) { return (int32)p.normal_tangent.x; })),
+			snorm(gather([](const gpk_model_vertex_packed& p) { return (int32)p.normal_tangent.y; })), &normal.x, &normal.y, &normal.z);
+		octahedral_decode(
+			snorm(gather([](const gpk_model_vertex_packed& p) { return (int32)p.normal_tangent.z; })),
+			snorm(gather([](const gpk_model_vertex_packed& p) { return (int32)p.normal_tangent.w; })), &tangent.x, &tangent.y, &tangent.z);
+		normal *= floatx4_set1(32767);
+		tangent *= floatx4_set1(32767);
+		alignas(16) float floats[5][4];
+		alignas(16) int32 lanes[6][4];
+		floatx4_store(position.x, floats[0]);
+		floatx4_store(position.y, floats[1]);
+		floatx4_store(position.z, floats[2]);
+		floatx4_store(uv_x, floats[3]);
+		floatx4_store(uv_y, floats[4]);
+		_mm_store_si128((__m128i*)lanes[0], _mm_cvtps_epi32(normal.x.v));
+		_mm_store_si128((__m128i*)lanes[1], _mm_cvtps_epi32(normal.y.v));
+		_mm_store_si128((__m128i*)lanes[2], _mm_cvtps_epi32(normal.z.v));
+		_mm_store_si128((__m128i*)lanes[3], _mm_cvtps_epi32(tangent.x.v));
+		_mm_store_si128((__m128i*)lanes[4], _mm_cvtps_epi32(tangent.y.v));
+		_mm_store_si128((__m128i*)lanes[5], _mm_cvtps_epi32(tangent.z.v));
+		for (uint32 i = 0; i < count; i += 1) {
+			v[i].position = {floats[0][i], floats[1][i], floats[2][i]};
+			v[i].color = p[i].color;
+			v[i].uv = {floats[3][i], floats[4][i]};
+			v[i].normal = {(int16)lanes[0][i], (int16)lanes[1][i], (int16)lanes[2][i], 0};
+			v[i].tangent = {(int16)lanes[3][i], (int16)lanes[4][i], (int16)lanes[5][i], (int16)(p[i].position.w ? -32767 : 32767)};
+			v[i].joints = p[i].joints;
+			v[i].weights = p[i].weights;
+		}
+	};
+	uint32 i = 0;
+	for (; i + 4 <= vertex_count; i += 4) {
+		unpack4(packed + i, vertices + i, 4);
+	}
+	if (i < vertex_count) {
+		gpk_model_vertex_packed tail[4];
+		for (uint32 j = 0; j < 4; j += 1) {
+			tail[j] = packed[min(i + j, vertex_count - 1)];
+		}
+		unpack4(tail, vertices + i, vertex_count - i);
+	}
+}
+
 struct gpk_model_skin {
 	char name[64];
 	uint32 joint_count;
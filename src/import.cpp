@@ -37,8 +37,96 @@ void rgba_to_bgra(uint8 *image_data, uint32 image_width, uint32 image_height) {
 	}
 }
 
-void gen_mips_and_compress_image(uint8 *data, uint32 width, uint32 height, nvtt::Format compress_format, uint8 **compressed_data, uint32 *compressed_data_mipmap_count, uint32 *compressed_data_size) {
+// Checks on the input in the importers that -import-json runs, a failed check prints the expression and makes the
+// importer return false, so one bad asset does not stop the other imports running in the same process.
+#define m_import_check(expr) \
+if (!(expr)) { \
+	printf("import error: %s, %s:%d\n", #expr, __FILE__, __LINE__); \
+	return false; \
+}
+
+struct compressed_image {
+	uint8 *data;
+	uint32 mipmap_count;
+	uint32 size;
+	bool done;
+	bool success;
+};
+
+// Compressed images are cached on disk under build\image_cache, keyed by a hash of the source pixels, size and format,
+// so reimports skip nvtt for textures that did not change and models sharing a texture compress it once.
+// Bump m_image_cache_format_str when the compression settings change. Inside one run the first thread to miss an image
+// compresses it and other threads asking for the same image wait for that result.
+#define m_image_cache_format_str "IMAGE_CACHE_FORMAT_1"
+
+const char *image_cache_dir = "..\\image_cache";
+
+struct image_cache_file_header {
+	char format_str[32];
+	uint32 mipmap_count;
+	uint32 size;
+};
+
+struct compressed_image_cache {
+	hash_map<uint64, compressed_image *> images;
+	std::mutex mutex;
+	std::condition_variable done_condition;
+};
+
+compressed_image_cache *compressed_image_cache_get() {
+	static compressed_image_cache *cache = [] {
+		compressed_image_cache *cache = new compressed_image_cache();
+		hash_map_initialize(&cache->images, 256);
+		return cache;
+	}();
+	return cache;
+}
+
+bool image_cache_read(const char *file_name, compressed_image *image) {
+	file_mapping file_mapping;
+	if (!file_mapping_open(file_name, &file_mapping, true)) {
+		return false;
+	}
+	auto close_file = scope_exit([&] { file_mapping_close(file_mapping); });
+	if (file_mapping.size < sizeof(image_cache_file_header)) {
+		return false;
+	}
+	image_cache_file_header *header = (image_cache_file_header *)file_mapping.ptr;
+	if (strcmp(header->format_str, m_image_cache_format_str) || file_mapping.size != sizeof(image_cache_file_header) + header->size) {
+		return false;
+	}
+	image->data = (uint8 *)malloc(header->size);
+	memcpy(image->data, file_mapping.ptr + sizeof(image_cache_file_header), header->size);
+	image->mipmap_count = header->mipmap_count;
+	image->size = header->size;
+	return true;
+}
+
+// A failed write only costs the next run a recompression. The entry is written under a temporary name and renamed,
+// so an import that dies halfway never leaves a truncated entry behind.
+void image_cache_write(const char *file_name, const compressed_image &image) {
+	CreateDirectoryA(image_cache_dir, nullptr);
+	char temp_file_name[256];
+	snprintf(temp_file_name, sizeof(temp_file_name), "%s.%u.tmp", file_name, GetCurrentThreadId());
+	file_mapping file_mapping;
+	if (!file_mapping_create(temp_file_name, sizeof(image_cache_file_header) + image.size, &file_mapping, file_mapping_hint_sequential)) {
+		return;
+	}
+	image_cache_file_header *header = (image_cache_file_header *)file_mapping.ptr;
+	*header = { m_image_cache_format_str };
+	header->mipmap_count = image.mipmap_count;
+	header->size = image.size;
+	memcpy(file_mapping.ptr + sizeof(image_cache_file_header), image.data, image.size);
+	file_mapping_flush(file_mapping);
+	file_mapping_close(file_mapping);
+	if (!MoveFileExA(temp_file_name, file_name, MOVEFILE_REPLACE_EXISTING)) {
+		DeleteFileA(temp_file_name);
+	}
+}
+
+bool compress_image(uint8 *data, uint32 width, uint32 height, nvtt::Format compress_format, compressed_image *image) {
 	using namespace nvtt;
+	m_profile_zone("compress_image");
 
 	InputOptions input_options = {};
 	CompressionOptions compression_options = {};
@@ -50,7 +138,7 @@ void gen_mips_and_compress_image(uint8 *data, uint32 width, uint32 height, nvtt:
 	input_options.setAlphaMode(AlphaMode_None);
 	input_options.setMipmapFilter(MipmapFilter_Kaiser);
 	input_options.setMipmapGeneration(true);
-	m_assert(input_options.setMipmapData(data, width, height));
+	m_import_check(input_options.setMipmapData(data, width, height));
 	compression_options.setFormat(compress_format);	// Format_RGBA, Format_BC1, Format_BC4, Format_BC5
 	if (compress_format == Format_BC4) {
 		input_options.setGamma(1.0f, 1.0f);
@@ -71,9 +159,11 @@ void gen_mips_and_compress_image(uint8 *data, uint32 width, uint32 height, nvtt:
 			compressed_data_mipmap_count += 1;
 		}
 		bool writeData(const void * data, int size) {
+			if (compressed_data_size + size > estimate_compressed_data_size) {
+				return false;
+			}
 			memcpy(compressed_data + compressed_data_size, data, size);
 			compressed_data_size += size;
-			m_assert(compressed_data_size <= estimate_compressed_data_size);
 			return true;
 		}
 		void endImage() {}
@@ -86,14 +176,78 @@ void gen_mips_and_compress_image(uint8 *data, uint32 width, uint32 height, nvtt:
 	output_options.setOutputHandler(&output_handler);
 	output_options.setOutputHeader(false);
 
-	m_assert(compressor.process(input_options, compression_options, output_options));
+	if (!compressor.process(input_options, compression_options, output_options)) {
+		free(output_handler.compressed_data);
+		printf("import error: nvtt failed to compress a %ux%u image\n", width, height);
+		return false;
+	}
 
-	*compressed_data = output_handler.compressed_data;
-	*compressed_data_mipmap_count = output_handler.compressed_data_mipmap_count;
-	*compressed_data_size = output_handler.compressed_data_size;
+	image->data = output_handler.compressed_data;
+	image->mipmap_count = output_handler.compressed_data_mipmap_count;
+	image->size = output_handler.compressed_data_size;
+	return true;
 }
 
-void skybox_to_gpk(std::string skybox_dir, std::string gpk_file) {
+bool gen_mips_and_compress_image(uint8 *data, uint32 width, uint32 height, nvtt::Format compress_format, uint8 **compressed_data, uint32 *compressed_data_mipmap_count, uint32 *compressed_data_size) {
+	m_profile_zone("gen_mips_and_compress_image");
+
+	hash64_state hash_state;
+	hash64_init(&hash_state);
+	hash64_update(&hash_state, &width, sizeof(width));
+	hash64_update(&hash_state, &height, sizeof(height));
+	hash64_update(&hash_state, &compress_format, sizeof(compress_format));
+	hash64_update(&hash_state, data, (uint64)width * height * 4);
+	uint64 hash = hash64_final(&hash_state);
+
+	compressed_image_cache *cache = compressed_image_cache_get();
+	compressed_image *image = nullptr;
+	bool owner = false;
+	bool success = false;
+	{
+		std::unique_lock<std::mutex> lock(cache->mutex);
+		compressed_image **cached_image = hash_map_find(&cache->images, hash);
+		if (cached_image) {
+			image = *cached_image;
+			cache->done_condition.wait(lock, [&] { return image->done; });
+			m_profile_counter_add("compressed image cache hits", 1);
+			success = image->success;
+		}
+		else {
+			image = new compressed_image();
+			hash_map_insert(&cache->images, hash, image);
+			owner = true;
+		}
+	}
+	if (owner) {
+		char file_name[256];
+		snprintf(file_name, sizeof(file_name), "%s\\%016llx", image_cache_dir, hash);
+		success = image_cache_read(file_name, image);
+		if (success) {
+			m_profile_counter_add("compressed image disk cache hits", 1);
+		}
+		else {
+			success = compress_image(data, width, height, compress_format, image);
+			if (success) {
+				image_cache_write(file_name, *image);
+			}
+		}
+		{
+			std::lock_guard<std::mutex> lock(cache->mutex);
+			image->success = success;
+			image->done = true;
+		}
+		cache->done_condition.notify_all();
+	}
+	if (success) {
+		*compressed_data = image->data;
+		*compressed_data_mipmap_count = image->mipmap_count;
+		*compressed_data_size = image->size;
+	}
+	return success;
+}
+
+bool skybox_to_gpk(std::string skybox_dir, std::string gpk_file) {
+	m_profile_zone("skybox_to_gpk");
 	printf("begin importing skybox: \"%s\"\n", skybox_dir.c_str());
 
 	const char *cubemap_files[6] = { "left.png", "right.png", "up.png", "down.png", "front.png", "back.png" };
@@ -103,12 +257,12 @@ void skybox_to_gpk(std::string skybox_dir, std::string gpk_file) {
 		std::string png_file = skybox_dir + "\\" + cubemap_files[i];
 		int32 channel = 0;
 		cubemap_data[i] = stbi_load(png_file.c_str(), &cubemap_sizes[i].first, &cubemap_sizes[i].second, &channel, 4);
-		m_assert(cubemap_data[i]);
+		m_import_check(cubemap_data[i]);
 	}
 	for (uint32 i = 0; i < 6; i += 1) {
-		m_assert(cubemap_sizes[i] == cubemap_sizes[0]);
-		m_assert(cubemap_sizes[i].first % 4 == 0);
-		m_assert(cubemap_sizes[i].second % 4 == 0);
+		m_import_check(cubemap_sizes[i] == cubemap_sizes[0]);
+		m_import_check(cubemap_sizes[i].first % 4 == 0);
+		m_import_check(cubemap_sizes[i].second % 4 == 0);
 	}
 	uint8* cubemap_compressed_data[6];
 	uint32 cubemap_compressed_size = cubemap_sizes[0].first * cubemap_sizes[0].second;
@@ -125,7 +279,7 @@ void skybox_to_gpk(std::string skybox_dir, std::string gpk_file) {
 	uint32 cubemap_offset = round_up((uint32)sizeof(struct gpk_skybox), 16u);
 	uint32 gpk_file_size = cubemap_offset + cubemap_compressed_size * 6;
 	file_mapping gpk_file_mapping;
-	m_assert(file_mapping_create(gpk_file.c_str(), gpk_file_size, &gpk_file_mapping));
+	m_import_check(file_mapping_create(gpk_file.c_str(), gpk_file_size, &gpk_file_mapping, file_mapping_hint_sequential));
 	gpk_skybox *gpk_skybox = (struct gpk_skybox *)gpk_file_mapping.ptr;
 	*gpk_skybox = { m_gpk_skybox_format_str };
 	gpk_skybox->cubemap_offset = cubemap_offset;
@@ -146,6 +300,7 @@ void skybox_to_gpk(std::string skybox_dir, std::string gpk_file) {
 	file_mapping_close(gpk_file_mapping);
 
 	printf("done importing skybox: \"%s\"\n", gpk_file.c_str());
+	return true;
 }
 
 bool gltf_model_nodes_contain_cycle(const tinygltf::Model &gltf_model) {
@@ -197,11 +352,13 @@ void initialize_model_scene_nodes_global_transform(std::vector<gpk_model_scene>
 	}
 }
 
-void gltf_to_gpk(std::string gltf_file, std::string gpk_file) {
+bool gltf_to_gpk(std::string gltf_file, std::string gpk_file) {
+	m_profile_zone("gltf_to_gpk");
 	printf("begin importing gltf: \"%s\" \n", gltf_file.c_str());
 
 	tinygltf::Model gltf_model;
 	{
+		m_profile_zone("load gltf");
 		tinygltf::TinyGLTF gltf_loader;
 		std::string gltf_loader_err;
 		std::string gltf_loader_warning;
@@ -213,7 +370,7 @@ void gltf_to_gpk(std::string gltf_file, std::string gpk_file) {
 			if (!gltf_loader_warning.empty()) {
 				printf("%s load warning:\n%s\n", gltf_file.c_str(), gltf_loader_warning.c_str());
 			}
-			m_assert(gltf_load_success);
+			m_import_check(gltf_load_success);
 		}
 		else if (gltf_file.substr(gltf_file.find_last_of(".") + 1) == "glb") {
 			bool gltf_load_success = gltf_loader.LoadBinaryFromFile(&gltf_model, &gltf_loader_err, &gltf_loader_warning, gltf_file);
@@ -223,10 +380,10 @@ void gltf_to_gpk(std::string gltf_file, std::string gpk_file) {
 			if (!gltf_loader_warning.empty()) {
 				printf("%s load warning:\n%s\n", gltf_file.c_str(), gltf_loader_warning.c_str());
 			}
-			m_assert(gltf_load_success);
+			m_import_check(gltf_load_success);
 		}
 		else {
-			m_assert(false);
+			m_import_check(false);
 		}
 	}
 	gpk_model gpk_model = { m_gpk_model_format_str };
@@ -235,15 +392,15 @@ void gltf_to_gpk(std::string gltf_file, std::string gpk_file) {
 	{
 		gpk_model.scene_offset = current_offset;
 		gpk_model.scene_count = (uint32)gltf_model.scenes.size();
-		m_assert(gpk_model.scene_count > 0);
+		m_import_check(gpk_model.scene_count > 0);
 		gpk_model_scenes.resize(gpk_model.scene_count);
 		for (uint32 i = 0; i < gpk_model.scene_count; i += 1) {
 			auto &scene = gltf_model.scenes[i];
 			auto &gpk_scene = gpk_model_scenes[i];
-			m_assert(scene.name.length() < sizeof(gpk_scene.name));
+			m_import_check(scene.name.length() < sizeof(gpk_scene.name));
 			strcpy(gpk_scene.name, scene.name.c_str());
 			gpk_scene.node_index_count = (uint32)scene.nodes.size();
-			m_assert(gpk_scene.node_index_count <= m_countof(gpk_scene.node_indices));
+			m_import_check(gpk_scene.node_index_count <= m_countof(gpk_scene.node_indices));
 			for (uint32 i = 0; i < gpk_scene.node_index_count; i += 1) {
 				gpk_scene.node_indices[i] = (uint32)scene.nodes[i];
 			}
@@ -252,10 +409,10 @@ void gltf_to_gpk(std::string gltf_file, std::string gpk_file) {
 	}
 	std::vector<gpk_model_node> gpk_model_nodes;
 	{
-		m_assert(!gltf_model_nodes_contain_cycle(gltf_model));
+		m_import_check(!gltf_model_nodes_contain_cycle(gltf_model));
 		gpk_model.node_offset = current_offset;
 		gpk_model.node_count = (uint32)gltf_model.nodes.size();
-		m_assert(gpk_model.node_count > 0);
+		m_import_check(gpk_model.node_count > 0);
 		gpk_model_nodes.resize(gpk_model.node_count);
 		for (uint32 i = 0; i < gpk_model.node_count; i += 1) {
 			auto &node = gltf_model.nodes[i];
@@ -263,10 +420,10 @@ void gltf_to_gpk(std::string gltf_file, std::string gpk_file) {
 			gpk_node.mesh_index = (node.mesh >= 0 && node.mesh < gltf_model.meshes.size()) ? node.mesh : UINT32_MAX;
 			gpk_node.skin_index = (node.skin >= 0 && node.skin < gltf_model.skins.size()) ? node.skin : UINT32_MAX;
 			array_fill(gpk_node.children, UINT32_MAX);
-			m_assert(node.children.size() <= m_countof(gpk_node.children));
+			m_import_check(node.children.size() <= m_countof(gpk_node.children));
 			gpk_node.child_count = (uint32)node.children.size();
 			for (uint32 i = 0; i < gpk_node.child_count; i += 1) {
-				m_assert(node.children[i] >= 0 && node.children[i] < gltf_model.nodes.size());
+				m_import_check(node.children[i] >= 0 && node.children[i] < gltf_model.nodes.size());
 				gpk_node.children[i] = node.children[i];
 			}
 			if (node.matrix.size() > 0) {
@@ -296,28 +453,28 @@ void gltf_to_gpk(std::string gltf_file, std::string gpk_file) {
 	{
 		gpk_model.mesh_offset = current_offset;
 		gpk_model.mesh_count = (uint32)gltf_model.meshes.size();
-		m_assert(gpk_model.mesh_count > 0);
+		m_import_check(gpk_model.mesh_count > 0);
 		gpk_model_meshes.resize(gpk_model.mesh_count);
 		for (uint32 i = 0; i < gpk_model.mesh_count; i += 1) {
 			auto &mesh = gltf_model.meshes[i];
 			auto &gpk_mesh = gpk_model_meshes[i];
-			m_assert(mesh.name.length() < sizeof(gpk_mesh.name));
+			m_import_check(mesh.name.length() < sizeof(gpk_mesh.name));
 			strcpy(gpk_mesh.name, mesh.name.c_str());
 			gpk_mesh.skin_index = UINT32_MAX;
-			m_assert(mesh.primitives.size() > 0);
+			m_import_check(mesh.primitives.size() > 0);
 			gpk_mesh.primitive_count = (uint32)mesh.primitives.size();
 			for (auto &p : mesh.primitives) {
-				m_assert(p.mode == TINYGLTF_MODE_TRIANGLES);
-				m_assert(p.indices >= 0);
-				m_assert(p.attributes.find("POSITION") != p.attributes.end());
-				m_assert(p.attributes.find("NORMAL") != p.attributes.end());
+				m_import_check(p.mode == TINYGLTF_MODE_TRIANGLES);
+				m_import_check(p.indices >= 0);
+				m_import_check(p.attributes.find("POSITION") != p.attributes.end());
+				m_import_check(p.attributes.find("NORMAL") != p.attributes.end());
 			}
 		}
 		for (uint32 i = 0; i < gpk_model.node_count; i += 1) {
 			auto &node = gltf_model.nodes[i];
 			if (node.skin >= 0 && node.skin < gltf_model.skins.size()) {
-				m_assert(node.mesh >= 0 && node.mesh < gltf_model.meshes.size());
-				m_assert(gpk_model_meshes[node.mesh].skin_index == UINT32_MAX);
+				m_import_check(node.mesh >= 0 && node.mesh < gltf_model.meshes.size());
+				m_import_check(gpk_model_meshes[node.mesh].skin_index == UINT32_MAX);
 				gpk_model_meshes[node.mesh].skin_index = node.skin;
 			}
 		}
@@ -331,11 +488,11 @@ void gltf_to_gpk(std::string gltf_file, std::string gpk_file) {
 		for (uint32 i = 0; i < gpk_model.skin_count; i += 1) {
 			auto &skin = gltf_model.skins[i];
 			auto &gpk_skin = gpk_model_skins[i];
-			m_assert(skin.name.length() < sizeof(gpk_skin.name));
+			m_import_check(skin.name.length() < sizeof(gpk_skin.name));
 			strcpy(gpk_skin.name, skin.name.c_str());
-			m_assert(skin.skeleton >= 0 && skin.skeleton < gltf_model.nodes.size());
-			m_assert(skin.joints.size() > 0 && skin.joints.size() < gltf_model.nodes.size());
-			m_assert(skin.joints.size() < 256);
+			m_import_check(skin.skeleton >= 0 && skin.skeleton < gltf_model.nodes.size());
+			m_import_check(skin.joints.size() > 0 && skin.joints.size() < gltf_model.nodes.size());
+			m_import_check(skin.joints.size() < 256);
 			gpk_skin.joint_count = (uint32)skin.joints.size();
 		}
 		current_offset = round_up(current_offset + gpk_model.skin_count * (uint32)sizeof(struct gpk_model_skin), 16u);
@@ -348,7 +505,7 @@ void gltf_to_gpk(std::string gltf_file, std::string gpk_file) {
 		for (uint32 i = 0; i < gpk_model.animation_count; i += 1) {
 			auto &animation = gltf_model.animations[i];
 			auto &gpk_animation = gpk_model_animations[i];
-			m_assert(animation.name.length() < sizeof(gpk_animation.name));
+			m_import_check(animation.name.length() < sizeof(gpk_animation.name));
 			strcpy(gpk_animation.name, animation.name.c_str());
 			gpk_animation.channel_count = (uint32)animation.channels.size();
 			gpk_animation.sampler_count = (uint32)animation.samplers.size();
@@ -371,33 +528,33 @@ void gltf_to_gpk(std::string gltf_file, std::string gpk_file) {
 			auto base_color_texture = m.values.find("baseColorTexture");
 			if (base_color_texture != m.values.end()) {
 				int32 texture_index = base_color_texture->second.TextureIndex();
-				m_assert(texture_index >= 0 && texture_index < gltf_model.textures.size());
+				m_import_check(texture_index >= 0 && texture_index < gltf_model.textures.size());
 				int32 image_index = gltf_model.textures[texture_index].source;
-				m_assert(image_index >= 0 && image_index < gltf_model.images.size());
+				m_import_check(image_index >= 0 && image_index < gltf_model.images.size());
 				image_remaps[image_index].is_base_color = true;
 			}
 
 			auto metallic_roughness_texture = m.values.find("metallicRoughnessTexture");
 			if (metallic_roughness_texture != m.values.end()) {
 				int32 texture_index = metallic_roughness_texture->second.TextureIndex();
-				m_assert(texture_index >= 0 && texture_index < gltf_model.textures.size());
+				m_import_check(texture_index >= 0 && texture_index < gltf_model.textures.size());
 				int32 image_index = gltf_model.textures[texture_index].source;
-				m_assert(image_index >= 0 && image_index < gltf_model.images.size());
+				m_import_check(image_index >= 0 && image_index < gltf_model.images.size());
 				image_remaps[image_index].is_metallic_roughness = true;
 			}
 
 			auto normal_texture = m.additionalValues.find("normalTexture");
 			if (normal_texture != m.additionalValues.end()) {
 				int32 texture_index = normal_texture->second.TextureIndex();
-				m_assert(texture_index >= 0 && texture_index < gltf_model.textures.size());
+				m_import_check(texture_index >= 0 && texture_index < gltf_model.textures.size());
 				int32 image_index = gltf_model.textures[texture_index].source;
-				m_assert(image_index >= 0 && image_index < gltf_model.images.size());
+				m_import_check(image_index >= 0 && image_index < gltf_model.images.size());
 				image_remaps[image_index].is_normal = true;
 			}
 		}
 		for (auto &remap : image_remaps) {
 			int32 is = (int32)remap.is_base_color + (int32)remap.is_metallic_roughness + (int32)remap.is_normal;
-			m_assert(is == 0 || is == 1);
+			m_import_check(is == 0 || is == 1);
 			if (is == 0) {
 				remap.index = UINT32_MAX;
 			}
@@ -424,7 +581,7 @@ void gltf_to_gpk(std::string gltf_file, std::string gpk_file) {
 		for (uint32 i = 0; i < gpk_model.material_count; i += 1) {
 			auto &material = gltf_model.materials[i];
 			auto &gpk_material = gpk_model_materials[i];
-			m_assert(material.name.length() < sizeof(gpk_material.name));
+			m_import_check(material.name.length() < sizeof(gpk_material.name));
 			strcpy(gpk_material.name, material.name.c_str());
 			auto base_color_texture = material.values.find("baseColorTexture");
 			auto base_color_factor = material.values.find("baseColorFactor");
@@ -434,23 +591,23 @@ void gltf_to_gpk(std::string gltf_file, std::string gpk_file) {
 			auto normal_texture = material.additionalValues.find("normalTexture");
 			if (base_color_texture != material.values.end()) {
 				int32 index = base_color_texture->second.TextureIndex();
-				m_assert(index >= 0 && index < gltf_model.textures.size());
+				m_import_check(index >= 0 && index < gltf_model.textures.size());
 				auto &texture = gltf_model.textures[index];
-				m_assert(texture.source >= 0 && texture.source < gltf_model.images.size());
-				m_assert(image_remaps[texture.source].is_base_color);
+				m_import_check(texture.source >= 0 && texture.source < gltf_model.images.size());
+				m_import_check(image_remaps[texture.source].is_base_color);
 				gpk_material.diffuse_image_index = image_remaps[texture.source].index;
 			}
 			else if (base_color_factor != material.values.end()) {
 				auto &color = base_color_factor->second.number_array;
-				m_assert(color.size() == 4);
+				m_import_check(color.size() == 4);
 				gpk_material.diffuse_factor = { (float)color[0], (float)color[1], (float)color[2], (float)color[3] };
 			}
 			if (metallic_roughness_texture != material.values.end()) {
 				int32 index = metallic_roughness_texture->second.TextureIndex();
-				m_assert(index >= 0 && index < gltf_model.textures.size());
+				m_import_check(index >= 0 && index < gltf_model.textures.size());
 				auto &texture = gltf_model.textures[index];
-				m_assert(texture.source >= 0 && texture.source < gltf_model.images.size());
-				m_assert(image_remaps[texture.source].is_metallic_roughness);
+				m_import_check(texture.source >= 0 && texture.source < gltf_model.images.size());
+				m_import_check(image_remaps[texture.source].is_metallic_roughness);
 				gpk_material.metallic_image_index = image_remaps[texture.source].index;
 				gpk_material.roughness_image_index = image_remaps[texture.source].index + 1;
 			}
@@ -470,10 +627,10 @@ void gltf_to_gpk(std::string gltf_file, std::string gpk_file) {
 			}
 			if (normal_texture != material.additionalValues.end()) {
 				int32 index = normal_texture->second.TextureIndex();
-				m_assert(index >= 0 && index < gltf_model.textures.size());
+				m_import_check(index >= 0 && index < gltf_model.textures.size());
 				auto &texture = gltf_model.textures[index];
-				m_assert(texture.source >= 0 && texture.source < gltf_model.images.size());
-				m_assert(image_remaps[texture.source].is_normal);
+				m_import_check(texture.source >= 0 && texture.source < gltf_model.images.size());
+				m_import_check(image_remaps[texture.source].is_normal);
 				gpk_material.normal_image_index = image_remaps[texture.source].index;
 			}
 		}
@@ -491,10 +648,10 @@ void gltf_to_gpk(std::string gltf_file, std::string gpk_file) {
 			if (remap.index == UINT32_MAX) {
 				continue;
 			}
-			m_assert(image.width >= 4);
-			m_assert(image.height >= 4);
+			m_import_check(image.width >= 4);
+			m_import_check(image.height >= 4);
 			if (remap.is_base_color) {
-				m_assert(image.component == 3 || image.component == 4);
+				m_import_check(image.component == 3 || image.component == 4);
 				std::vector<uint8> color_image;
 				color_image.resize(image.width * image.height * 4);
 				if (image.component == 3) {
@@ -521,7 +678,9 @@ void gltf_to_gpk(std::string gltf_file, std::string gpk_file) {
 				}
 				uint32 mipmap_count = 0;
 				uint32 size = 0;
-				gen_mips_and_compress_image(&color_image[0], image.width, image.height, compress_format, &remap.compressed_data, &mipmap_count, &size);
+				if (!gen_mips_and_compress_image(&color_image[0], image.width, image.height, compress_format, &remap.compressed_data, &mipmap_count, &size)) {
+					return false;
+				}
 
 				auto &gpk_image = gpk_model_images[image_index++];
 				gpk_image.width = image.width;
@@ -532,8 +691,8 @@ void gltf_to_gpk(std::string gltf_file, std::string gpk_file) {
 				gpk_image.format = dxgi_format;
 			}
 			else if (remap.is_metallic_roughness) {
-				m_assert(image.width % 4 == 0 && image.height % 4 == 0);
-				m_assert(image.component >= 2);
+				m_import_check(image.width % 4 == 0 && image.height % 4 == 0);
+				m_import_check(image.component >= 2);
 				{
 					std::vector<uint8> metallic_image;
 					metallic_image.resize(image.width * image.height * 4);
@@ -550,7 +709,9 @@ void gltf_to_gpk(std::string gltf_file, std::string gpk_file) {
 					}
 					uint32 mipmap_count = 0;
 					uint32 size = 0;
-					gen_mips_and_compress_image(&metallic_image[0], image.width, image.height, nvtt::Format_BC4, &remap.compressed_data, &mipmap_count, &size);
+					if (!gen_mips_and_compress_image(&metallic_image[0], image.width, image.height, nvtt::Format_BC4, &remap.compressed_data, &mipmap_count, &size)) {
+						return false;
+					}
 
 					auto &gpk_metallic_image = gpk_model_images[image_index++];
 					gpk_metallic_image.width = image.width;
@@ -573,7 +734,9 @@ void gltf_to_gpk(std::string gltf_file, std::string gpk_file) {
 					}
 					uint32 mipmap_count = 0;
 					uint32 size = 0;
-					gen_mips_and_compress_image(&roughness_image[0], image.width, image.height, nvtt::Format_BC4, &remap.compressed_data_2, &mipmap_count, &size);
+					if (!gen_mips_and_compress_image(&roughness_image[0], image.width, image.height, nvtt::Format_BC4, &remap.compressed_data_2, &mipmap_count, &size)) {
+						return false;
+					}
 
 					auto &gpk_roughness_image = gpk_model_images[image_index++];
 					gpk_roughness_image.width = image.width;
@@ -585,8 +748,8 @@ void gltf_to_gpk(std::string gltf_file, std::string gpk_file) {
 				}
 			}
 			else if (remap.is_normal) {
-				m_assert(image.width % 4 == 0 && image.height % 4 == 0);
-				m_assert(image.component == 3 || image.component == 4);
+				m_import_check(image.width % 4 == 0 && image.height % 4 == 0);
+				m_import_check(image.component == 3 || image.component == 4);
 				std::vector<uint8> normal_image;
 				normal_image.resize(image.width * image.height * 4);
 				if (image.component == 3) {
@@ -607,7 +770,9 @@ void gltf_to_gpk(std::string gltf_file, std::string gpk_file) {
 				}
 				uint32 mipmap_count = 0;
 				uint32 size = 0;
-				gen_mips_and_compress_image(&normal_image[0], image.width, image.height, nvtt::Format_BC5, &remap.compressed_data, &mipmap_count, &size);
+				if (!gen_mips_and_compress_image(&normal_image[0], image.width, image.height, nvtt::Format_BC5, &remap.compressed_data, &mipmap_count, &size)) {
+					return false;
+				}
 
 				auto &gpk_image = gpk_model_images[image_index++];
 				gpk_image.width = image.width;
@@ -618,7 +783,7 @@ void gltf_to_gpk(std::string gltf_file, std::string gpk_file) {
 				gpk_image.format = DXGI_FORMAT_BC5_UNORM;
 			}
 			else {
-				m_assert(false);
+				m_import_check(false);
 			}
 		}
 		current_offset = round_up(current_offset + gpk_model.image_count * (uint32)sizeof(struct gpk_model_image), 16u);
@@ -633,60 +798,60 @@ void gltf_to_gpk(std::string gltf_file, std::string gpk_file) {
 			auto &primitive = mesh.primitives[i];
 
 			auto &index_accessor = gltf_model.accessors[primitive.indices];
-			m_assert(index_accessor.count > 0);
-			m_assert(
+			m_import_check(index_accessor.count > 0);
+			m_import_check(
 				index_accessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE ||
 				index_accessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT ||
 				index_accessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT);
-			m_assert(index_accessor.type == TINYGLTF_TYPE_SCALAR);
+			m_import_check(index_accessor.type == TINYGLTF_TYPE_SCALAR);
 
 			auto &position_accessor = gltf_model.accessors[primitive.attributes["POSITION"]];
-			m_assert(position_accessor.count > 0 && position_accessor.count <= UINT16_MAX);
-			m_assert(position_accessor.componentType == TINYGLTF_COMPONENT_TYPE_FLOAT);
-			m_assert(position_accessor.type == TINYGLTF_TYPE_VEC3);
+			m_import_check(position_accessor.count > 0 && position_accessor.count <= UINT16_MAX);
+			m_import_check(position_accessor.componentType == TINYGLTF_COMPONENT_TYPE_FLOAT);
+			m_import_check(position_accessor.type == TINYGLTF_TYPE_VEC3);
 
 			auto &normal_accessor = gltf_model.accessors[primitive.attributes["NORMAL"]];
-			m_assert(normal_accessor.componentType == TINYGLTF_COMPONENT_TYPE_FLOAT);
-			m_assert(normal_accessor.type == TINYGLTF_TYPE_VEC3);
-			m_assert(normal_accessor.count == position_accessor.count);
+			m_import_check(normal_accessor.componentType == TINYGLTF_COMPONENT_TYPE_FLOAT);
+			m_import_check(normal_accessor.type == TINYGLTF_TYPE_VEC3);
+			m_import_check(normal_accessor.count == position_accessor.count);
 
 			if (primitive.attributes.find("TEXCOORD_0") != primitive.attributes.end()) {
 				auto &uv_accessor = gltf_model.accessors[primitive.attributes["TEXCOORD_0"]];
-				m_assert(uv_accessor.componentType == TINYGLTF_COMPONENT_TYPE_FLOAT);
-				m_assert(uv_accessor.type == TINYGLTF_TYPE_VEC2);
-				m_assert(uv_accessor.count == position_accessor.count);
+				m_import_check(uv_accessor.componentType == TINYGLTF_COMPONENT_TYPE_FLOAT);
+				m_import_check(uv_accessor.type == TINYGLTF_TYPE_VEC2);
+				m_import_check(uv_accessor.count == position_accessor.count);
 			}
 
 			if (primitive.attributes.find("TANGENT") != primitive.attributes.end()) {
 				auto &tangent_accessor = gltf_model.accessors[primitive.attributes["TANGENT"]];
-				m_assert(tangent_accessor.componentType == TINYGLTF_COMPONENT_TYPE_FLOAT);
-				m_assert(tangent_accessor.type == TINYGLTF_TYPE_VEC4);
-				m_assert(tangent_accessor.count == position_accessor.count);
+				m_import_check(tangent_accessor.componentType == TINYGLTF_COMPONENT_TYPE_FLOAT);
+				m_import_check(tangent_accessor.type == TINYGLTF_TYPE_VEC4);
+				m_import_check(tangent_accessor.count == position_accessor.count);
 			}
 
 			if (primitive.attributes.find("COLOR_0") != primitive.attributes.end()) {
 				auto &color_accessor = gltf_model.accessors[primitive.attributes["COLOR_0"]];
-				m_assert(color_accessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE);
-				m_assert(color_accessor.type == TINYGLTF_TYPE_VEC3);
-				m_assert(color_accessor.count == position_accessor.count);
+				m_import_check(color_accessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE);
+				m_import_check(color_accessor.type == TINYGLTF_TYPE_VEC3);
+				m_import_check(color_accessor.count == position_accessor.count);
 			}
 
 			if (primitive.attributes.find("JOINTS_0") != primitive.attributes.end()) {
 				auto weights = primitive.attributes.find("WEIGHTS_0");
-				m_assert(weights != primitive.attributes.end());
+				m_import_check(weights != primitive.attributes.end());
 				auto &joint_accessor = gltf_model.accessors[primitive.attributes["JOINTS_0"]];
-				m_assert(joint_accessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT);
-				m_assert(joint_accessor.type == TINYGLTF_TYPE_VEC4);
-				m_assert(joint_accessor.count == position_accessor.count);
+				m_import_check(joint_accessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT);
+				m_import_check(joint_accessor.type == TINYGLTF_TYPE_VEC4);
+				m_import_check(joint_accessor.count == position_accessor.count);
 
 				auto &weight_accessor = gltf_model.accessors[primitive.attributes["WEIGHTS_0"]];
-				m_assert(weight_accessor.componentType == TINYGLTF_COMPONENT_TYPE_FLOAT);
-				m_assert(weight_accessor.type == TINYGLTF_TYPE_VEC4);
-				m_assert(weight_accessor.count == position_accessor.count);
+				m_import_check(weight_accessor.componentType == TINYGLTF_COMPONENT_TYPE_FLOAT);
+				m_import_check(weight_accessor.type == TINYGLTF_TYPE_VEC4);
+				m_import_check(weight_accessor.count == position_accessor.count);
 			}
 
 			current_offset = round_up(current_offset + (uint32)index_accessor.count * (uint32)sizeof(uint16), 16u);
-			current_offset = round_up(current_offset + (uint32)position_accessor.count * (uint32)sizeof(struct gpk_model_vertex), 16u);
+			current_offset = round_up(current_offset + (uint32)position_accessor.count * (uint32)sizeof(struct gpk_model_vertex_packed), 16u);
 		}
 	}
 	for (uint32 i = 0; i < gpk_model.skin_count; i += 1) {
@@ -702,15 +867,15 @@ void gltf_to_gpk(std::string gltf_file, std::string gpk_file) {
 		gpk_animation.sampler_offset = current_offset;
 		current_offset = round_up(current_offset + gpk_animation.sampler_count * (uint32)sizeof(struct gpk_model_animation_sampler), 16u);
 		for (auto &sampler : animation.samplers) {
-			m_assert(sampler.input >= 0 && sampler.input < gltf_model.accessors.size());
-			m_assert(sampler.output >= 0 && sampler.output < gltf_model.accessors.size());
+			m_import_check(sampler.input >= 0 && sampler.input < gltf_model.accessors.size());
+			m_import_check(sampler.output >= 0 && sampler.output < gltf_model.accessors.size());
 			auto &input_accessor = gltf_model.accessors[sampler.input];
 			auto &output_accessor = gltf_model.accessors[sampler.output];
-			m_assert(input_accessor.count > 0 && input_accessor.count <= output_accessor.count);
-			m_assert(input_accessor.componentType == TINYGLTF_COMPONENT_TYPE_FLOAT);
-			m_assert(input_accessor.type == TINYGLTF_TYPE_SCALAR);
-			m_assert(output_accessor.componentType == TINYGLTF_COMPONENT_TYPE_FLOAT);
-			m_assert(
+			m_import_check(input_accessor.count > 0 && input_accessor.count <= output_accessor.count);
+			m_import_check(input_accessor.componentType == TINYGLTF_COMPONENT_TYPE_FLOAT);
+			m_import_check(input_accessor.type == TINYGLTF_TYPE_SCALAR);
+			m_import_check(output_accessor.componentType == TINYGLTF_COMPONENT_TYPE_FLOAT);
+			m_import_check(
 				output_accessor.type == TINYGLTF_TYPE_SCALAR ||
 				output_accessor.type == TINYGLTF_TYPE_VEC2 ||
 				output_accessor.type == TINYGLTF_TYPE_VEC3 ||
@@ -725,7 +890,15 @@ void gltf_to_gpk(std::string gltf_file, std::string gpk_file) {
 	}
 
 	file_mapping gpk_file_mapping = {};
-	m_assert(file_mapping_create(gpk_file.c_str(), current_offset, &gpk_file_mapping));
+	m_import_check(file_mapping_create(gpk_file.c_str(), current_offset, &gpk_file_mapping, file_mapping_hint_sequential));
+	// the checks below can still fail, a half written gpk file must not be left behind for world_load to pick up
+	bool gpk_file_complete = false;
+	auto close_gpk_file = scope_exit([&] {
+		file_mapping_close(gpk_file_mapping);
+		if (!gpk_file_complete) {
+			DeleteFileA(gpk_file.c_str());
+		}
+	});
 	*(struct gpk_model *)gpk_file_mapping.ptr = gpk_model;
 	memcpy(gpk_file_mapping.ptr + gpk_model.scene_offset, &gpk_model_scenes[0], gpk_model_scenes.size() * sizeof(struct gpk_model_scene));
 	memcpy(gpk_file_mapping.ptr + gpk_model.node_offset, &gpk_model_nodes[0], gpk_model_nodes.size() * sizeof(struct gpk_model_node));
@@ -798,9 +971,9 @@ void gltf_to_gpk(std::string gltf_file, std::string gpk_file) {
 			uint32 weight_stride = 0;
 			uint32 skin_joint_count = 0;
 			if (primitive.attributes.find("JOINTS_0") != primitive.attributes.end()) {
-				m_assert(gpk_mesh.skin_index < (uint32)gltf_model.skins.size());
+				m_import_check(gpk_mesh.skin_index < (uint32)gltf_model.skins.size());
 				skin_joint_count = (uint32)gltf_model.skins[gpk_mesh.skin_index].joints.size();
-				m_assert(skin_joint_count < 256);
+				m_import_check(skin_joint_count < 256);
 
 				auto &joint_accessor = gltf_model.accessors[primitive.attributes["JOINTS_0"]];
 				auto &joint_buffer_view = gltf_model.bufferViews[joint_accessor.bufferView];
@@ -821,7 +994,8 @@ void gltf_to_gpk(std::string gltf_file, std::string gpk_file) {
 			indices_vertices_offset = round_up(indices_vertices_offset + gpk_primitive.index_count * (uint32)sizeof(uint16), 16u);
 			gpk_primitive.vertices_offset = indices_vertices_offset;
 			gpk_primitive.vertex_count = (uint32)position_accessor.count;
-			indices_vertices_offset = round_up(indices_vertices_offset + gpk_primitive.vertex_count * (uint32)sizeof(struct gpk_model_vertex), 16u);
+			gpk_primitive.vertex_format = gpk_model_vertex_format_packed;
+			indices_vertices_offset = round_up(indices_vertices_offset + gpk_primitive.vertex_count * (uint32)sizeof(struct gpk_model_vertex_packed), 16u);
 
 			if (index_accessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE) {
 				for (uint32 i = 0; i < gpk_primitive.index_count; i += 1) {
@@ -839,11 +1013,12 @@ void gltf_to_gpk(std::string gltf_file, std::string gpk_file) {
 				}
 			}
 			else {
-				m_assert(false);
+				m_import_check(false);
 			}
 
+			std::vector<gpk_model_vertex> vertices(gpk_primitive.vertex_count);
 			for (uint32 i = 0; i < gpk_primitive.vertex_count; i += 1) {
-				gpk_model_vertex *vertex = ((gpk_model_vertex *)(gpk_file_mapping.ptr + gpk_primitive.vertices_offset)) + i;
+				gpk_model_vertex *vertex = &vertices[i];
 
 				vertex->position = *(vec3 *)(position_data + position_stride * i);
 
@@ -860,24 +1035,26 @@ void gltf_to_gpk(std::string gltf_file, std::string gpk_file) {
 				vertex->normal = { (int16)roundf(normal[0] * 32767.0f), (int16)roundf(normal[1] * 32767.0f), (int16)roundf(normal[2] * 32767.0f), 0 };
 
 				vec3 tangent = {};
+				float bitangent_sign = 1;
 				if (tangent_data) {
 					tangent = *(vec3 *)(tangent_data + tangent_stride * i);
+					bitangent_sign = ((float *)(tangent_data + tangent_stride * i))[3];
 				}
 				else {
 					vec3 tangent1 = vec3_cross(normal, vec3{ 0, 0, 1 });
 					vec3 tangent2 = vec3_cross(normal, vec3{ 0, 1, 0 });
 					tangent = vec3_normalize(vec3_len(tangent1) > vec3_len(tangent2) ? tangent1 : tangent2);
 				}
-				vertex->tangent = { (int16)roundf(tangent[0] * 32767.0f), (int16)roundf(tangent[1] * 32767.0f), (int16)roundf(tangent[2] * 32767.0f), 0 };
+				vertex->tangent = { (int16)roundf(tangent[0] * 32767.0f), (int16)roundf(tangent[1] * 32767.0f), (int16)roundf(tangent[2] * 32767.0f), (int16)(bitangent_sign < 0 ? -32767 : 32767) };
 
 				if (joint_data) {
 					u16vec4 js = *(u16vec4 *)(joint_data + joint_stride * i);
-					m_assert(js[0] < skin_joint_count && js[1] < skin_joint_count && js[2] < skin_joint_count && js[3] < skin_joint_count);
+					m_import_check(js[0] < skin_joint_count && js[1] < skin_joint_count && js[2] < skin_joint_count && js[3] < skin_joint_count);
 					vertex->joints = { (uint8)js[0], (uint8)js[1], (uint8)js[2], (uint8)js[3] };
 
 					vec4 ws = *(vec4 *)(weight_data + weight_stride * i);
-					m_assert(ws[0] >= 0 && ws[1] >= 0 && ws[2] >= 0 && ws[3] >= 0);
-					m_assert(ws[0] <= 1 && ws[1] <= 1 && ws[2] <= 1 && ws[3] <= 1);
+					m_import_check(ws[0] >= 0 && ws[1] >= 0 && ws[2] >= 0 && ws[3] >= 0);
+					m_import_check(ws[0] <= 1 && ws[1] <= 1 && ws[2] <= 1 && ws[3] <= 1);
 					vertex->weights = { (uint16)roundf(ws[0] * 65535.0f), (uint16)roundf(ws[1] * 65535.0f), (uint16)roundf(ws[2] * 65535.0f), (uint16)roundf(ws[3] * 65535.0f) };
 				}
 				else {
@@ -885,6 +1062,11 @@ void gltf_to_gpk(std::string gltf_file, std::string gpk_file) {
 					vertex->weights = { UINT16_MAX, 0, 0, 0 };
 				}
 			}
+			gpk_primitive.bound = aabb_empty();
+			for (auto &vertex : vertices) {
+				gpk_primitive.bound = aabb_expand(gpk_primitive.bound, aabb{ vertex.position, vertex.position });
+			}
+			gpk_model_vertices_pack(vertices.data(), gpk_primitive.vertex_count, gpk_primitive.bound, (gpk_model_vertex_packed *)(gpk_file_mapping.ptr + gpk_primitive.vertices_offset));
 		}
 	}
 	for (uint32 i = 0; i < gpk_model.skin_count; i += 1) {
@@ -892,19 +1074,19 @@ void gltf_to_gpk(std::string gltf_file, std::string gpk_file) {
 		mat4 *inverse_bind_mats = nullptr;
 		{
 			auto &accessor = gltf_model.accessors[skin.inverseBindMatrices];
-			m_assert(accessor.componentType == TINYGLTF_COMPONENT_TYPE_FLOAT);
-			m_assert(accessor.type == TINYGLTF_TYPE_MAT4);
-			m_assert(accessor.count == skin.joints.size());
+			m_import_check(accessor.componentType == TINYGLTF_COMPONENT_TYPE_FLOAT);
+			m_import_check(accessor.type == TINYGLTF_TYPE_MAT4);
+			m_import_check(accessor.count == skin.joints.size());
 			auto &buffer_view = gltf_model.bufferViews[accessor.bufferView];
-			m_assert(buffer_view.byteStride == 0 || buffer_view.byteStride == sizeof(mat4));
+			m_import_check(buffer_view.byteStride == 0 || buffer_view.byteStride == sizeof(mat4));
 			auto &buffer = gltf_model.buffers[buffer_view.buffer];
 			inverse_bind_mats = (mat4 *)(&buffer.data[accessor.byteOffset + buffer_view.byteOffset]);
 		}
 		auto &gpk_skin = gpk_model_skins[i];
 		gpk_model_joint *gpk_joints = (gpk_model_joint *)(gpk_file_mapping.ptr + gpk_skin.joints_offset);
-		m_assert(gpk_skin.joint_count == skin.joints.size());
+		m_import_check(gpk_skin.joint_count == skin.joints.size());
 		for (uint32 i = 0; i < gpk_skin.joint_count; i += 1) {
-			m_assert(skin.joints[i] >= 0 && skin.joints[i] < gltf_model.nodes.size());
+			m_import_check(skin.joints[i] >= 0 && skin.joints[i] < gltf_model.nodes.size());
 			gpk_joints[i].node_index = (uint32)skin.joints[i];
 			gpk_joints[i].inverse_bind_mat = inverse_bind_mats[i];
 		}
@@ -916,15 +1098,15 @@ void gltf_to_gpk(std::string gltf_file, std::string gpk_file) {
 		for (uint32 i = 0; i < gpk_animation.channel_count; i += 1) {
 			auto &channel = animation.channels[i];
 			auto &gpk_channel = gpk_channels[i];
-			m_assert(channel.target_node >= 0 && channel.target_node < gltf_model.nodes.size());
+			m_import_check(channel.target_node >= 0 && channel.target_node < gltf_model.nodes.size());
 			gpk_channel.node_index = (uint32)channel.target_node;
 			gpk_channel.channel_type = (
 				channel.target_path == "translation" ? gpk_model_animation_translate_channel :
 				channel.target_path == "rotation" ? gpk_model_animation_rotate_channel :
 				channel.target_path == "scale" ? gpk_model_animation_scale_channel :
 				channel.target_path == "weights" ? gpk_model_animation_weights_channel : UINT32_MAX);
-			m_assert(gpk_channel.channel_type != UINT32_MAX);
-			m_assert(channel.sampler >= 0 && channel.sampler < animation.samplers.size());
+			m_import_check(gpk_channel.channel_type != UINT32_MAX);
+			m_import_check(channel.sampler >= 0 && channel.sampler < animation.samplers.size());
 			gpk_channel.sampler_index = channel.sampler;
 		}
 		uint32 key_frame_offset = round_up(gpk_animation.sampler_offset + gpk_animation.sampler_count * (uint32)sizeof(struct gpk_model_animation_sampler), 16u);
@@ -937,7 +1119,7 @@ void gltf_to_gpk(std::string gltf_file, std::string gpk_file) {
 				sampler.interpolation == "STEP" ? gpk_model_animation_step_interpolation :
 				sampler.interpolation == "CATMULLROMSPLINE" ? gpk_model_animation_catmullromspline_interpolation :
 				sampler.interpolation == "CUBICSPLINE" ? gpk_model_animation_cubicspline_interpolation : UINT32_MAX);
-			m_assert(gpk_sampler.interpolation_type != UINT32_MAX);
+			m_import_check(gpk_sampler.interpolation_type != UINT32_MAX);
 
 			auto &input_accessor = gltf_model.accessors[sampler.input];
 			auto &input_buffer_view = gltf_model.bufferViews[input_accessor.bufferView];
@@ -963,7 +1145,7 @@ void gltf_to_gpk(std::string gltf_file, std::string gpk_file) {
 					output_data_stride = 16;
 				}
 				else {
-					m_assert(false);
+					m_import_check(false);
 				}
 			}
 			uint8 *output_data = &output_buffer.data[output_accessor.byteOffset + output_buffer_view.byteOffset];
@@ -1017,13 +1199,14 @@ void gltf_to_gpk(std::string gltf_file, std::string gpk_file) {
 			memcpy(gpk_ptr, remap.compressed_data, gpk_image.size);
 		}
 		else {
-			m_assert(false);
+			m_import_check(false);
 		}
 	}
 	file_mapping_flush(gpk_file_mapping);
-	file_mapping_close(gpk_file_mapping);
+	gpk_file_complete = true;
 
 	printf("done importing gltf: \"%s\" %s\n", gltf_file.c_str(), pretty_print_bytes(current_offset).data());
+	return true;
 }
 
 void gltf_to_vertices(std::string gltf_file, std::string text_file) {
@@ -1206,6 +1389,11 @@ void obj_to_gpk(std::string obj_file, std::string gpk_file) {
 	for (size_t i = 0; i < primitives.size(); i += 1) {
 		primitive *primitive = &primitives[i];
 		primitive->gpk_model_mesh_primitive.vertex_count = (uint32)primitive->vertices.size();
+		primitive->gpk_model_mesh_primitive.vertex_format = gpk_model_vertex_format_full;
+		primitive->gpk_model_mesh_primitive.bound = aabb_empty();
+		for (auto &vertex : primitive->vertices) {
+			primitive->gpk_model_mesh_primitive.bound = aabb_expand(primitive->gpk_model_mesh_primitive.bound, aabb{ vertex.position, vertex.position });
+		}
 		primitive->gpk_model_mesh_primitive.vertices_offset = file_offset;
 		file_offset = round_up(file_offset + (uint32)primitive->vertices.size() * (uint32)sizeof(gpk_model_vertex), 16u);
 	}
@@ -1234,10 +1422,10 @@ void obj_to_gpk(std::string obj_file, std::string gpk_file) {
 				else {
 					rgba_to_bgra(image_raw_data, width, height);
 				}
-				gen_mips_and_compress_image(
+				m_assert(gen_mips_and_compress_image(
 					image_raw_data, width, height, format,
 					&image_compressed_data, &image_compressed_mipmap_count, &image_compressed_size
-				);
+				));
 				gpk_model_image gpk_model_image = {};
 				gpk_model_image.width = width;
 				gpk_model_image.height = height;
@@ -1300,7 +1488,7 @@ void obj_to_gpk(std::string obj_file, std::string gpk_file) {
 	}
 
 	file_mapping file_mapping = {};
-	m_assert(file_mapping_create(gpk_file.c_str(), file_offset, &file_mapping));
+	m_assert(file_mapping_create(gpk_file.c_str(), file_offset, &file_mapping, file_mapping_hint_sequential));
 	memcpy(file_mapping.ptr, &gpk_model, sizeof(gpk_model));
 	memcpy(file_mapping.ptr + gpk_model.scene_offset, &gpk_model_scene, sizeof(gpk_model_scene));
 	memcpy(file_mapping.ptr + gpk_model.node_offset, &gpk_model_node, sizeof(gpk_model_node));
@@ -1355,34 +1543,9 @@ void from_json(const nlohmann::json &j, import_json_schema &import) {
 }
 
 void import_json(std::string json_file) {
+	m_profile_zone("import_json");
 	printf("begin importing json file: \"%s\" \n", json_file.c_str());
 
-	HANDLE job_object = CreateJobObject(nullptr, nullptr);
-	HANDLE io_port = CreateIoCompletionPort(INVALID_HANDLE_VALUE, nullptr, 0, 1);
-	m_assert(job_object);
-	m_assert(io_port);
-	auto release_resources = scope_exit([&] {
-		CloseHandle(job_object);
-		CloseHandle(io_port);
-	});
-	JOBOBJECT_ASSOCIATE_COMPLETION_PORT job_port;
-	job_port.CompletionKey = job_object;
-	job_port.CompletionPort = io_port;
-	m_assert(SetInformationJobObject(job_object, JobObjectAssociateCompletionPortInformation, &job_port, sizeof(job_port)));
-	uint32 job_count = 0;
-
-	auto create_import_process = [job_object](std::string cmdl_str) {
-		STARTUPINFOA startup_info = { sizeof(startup_info) };
-		startup_info.dwFlags = STARTF_USESHOWWINDOW;
-		startup_info.wShowWindow = SW_HIDE;
-		PROCESS_INFORMATION process_info;
-		m_assert(CreateProcessA("import.exe", (LPSTR)cmdl_str.c_str(), nullptr, nullptr, FALSE, CREATE_SUSPENDED, nullptr, nullptr, &startup_info, &process_info));
-		m_assert(AssignProcessToJobObject(job_object, process_info.hProcess));
-		ResumeThread(process_info.hThread);
-		CloseHandle(process_info.hThread);
-		CloseHandle(process_info.hProcess);
-	};
-
 	std::ifstream json_file_fstream(json_file.c_str());
 	nlohmann::json json_content;
 	import_json_schema import;
@@ -1397,30 +1560,41 @@ void import_json(std::string json_file) {
 	char json_dir_buf[256];
 	_splitpath(json_file.c_str(), json_drive_buf, json_dir_buf, nullptr, nullptr);
 	std::string json_dir = std::string(json_drive_buf) + json_dir_buf;
+
+	struct import_task {
+		bool skybox;
+		std::string src;
+		std::string gpk_file;
+	};
+	std::vector<import_task> tasks;
 	for (auto &model : import.models) {
 		if (model.import || import.force_import_all || import.force_import_models) {
-			std::string cmdl_str = std::string("import.exe -gltf ") + json_dir + model.gltf_file + " " + json_dir + model.gpk_file;
-			create_import_process(cmdl_str);
-			job_count += 1;
+			tasks.push_back({ false, json_dir + model.gltf_file, json_dir + model.gpk_file });
 		}
 	}
 	for (auto &skybox : import.skyboxes) {
 		if (skybox.import || import.force_import_all || import.force_import_skyboxes) {
-			std::string cmdl_str = std::string("import.exe -skybox ") + json_dir + skybox.dir + " " + json_dir + skybox.gpk_file;
-			create_import_process(cmdl_str);
-			job_count += 1;
+			tasks.push_back({ true, json_dir + skybox.dir, json_dir + skybox.gpk_file });
 		}
 	}
 
-	if (job_count > 0) {
-		DWORD completion_code;
-		ULONG_PTR completion_key;
-		LPOVERLAPPED overlappped;
-		while (GetQueuedCompletionStatus(io_port, &completion_code, &completion_key, &overlappped, INFINITE)) {
-			if ((HANDLE)completion_key == job_object && completion_code == JOB_OBJECT_MSG_ACTIVE_PROCESS_ZERO) {
-				break;
+	// The conversions run in this process on the job system, an importer that hits bad input returns false instead of
+	// stopping the whole run.
+	std::atomic<uint32> failed_count(0);
+	job_system js;
+	job_system_init(&js);
+	parallel_for(&js, tasks.size(), 1, [&](uint64 begin, uint64 end) {
+		for (uint64 i = begin; i < end; i += 1) {
+			bool success = tasks[i].skybox ? skybox_to_gpk(tasks[i].src, tasks[i].gpk_file) : gltf_to_gpk(tasks[i].src, tasks[i].gpk_file);
+			if (!success) {
+				printf("error: failed to import \"%s\" \n", tasks[i].src.c_str());
+				failed_count += 1;
 			}
 		}
+	});
+	job_system_destroy(&js);
+	if (failed_count > 0) {
+		printf("%u of %u imports failed\n", failed_count.load(), (uint32)tasks.size());
 	}
 	printf("done importing json file: \"%s\" \n", json_file.c_str());
 }
@@ -1434,7 +1608,9 @@ int main(int argc, char **argv) {
 		const char *mode_str = argv[1];
 		if (!strcmp(mode_str, "-gltf")) {
 			if (argc == 4) {
-				gltf_to_gpk(argv[2], argv[3]);
+				if (!gltf_to_gpk(argv[2], argv[3])) {
+					return 1;
+				}
 			}
 			else {
 				printf("error: expect -gltf gltf_file gpk_file");
@@ -1458,7 +1634,9 @@ int main(int argc, char **argv) {
 		}
 		else if (!strcmp(mode_str, "-skybox")) {
 			if (argc == 4) {
-				skybox_to_gpk(argv[2], argv[3]);
+				if (!skybox_to_gpk(argv[2], argv[3])) {
+					return 1;
+				}
 			}
 			else {
 				printf("error: expect -skybox skybox_dir gpk_file");
@@ -1468,8 +1646,17 @@ int main(int argc, char **argv) {
 			if (argc == 3) {
 				import_json(argv[2]);
 			}
+			else if (argc == 4) {
+				profiler_begin_capture();
+				import_json(argv[2]);
+				profiler_frame();
+				profiler_end_capture();
+				if (!profiler_export_chrome_trace(argv[3])) {
+					printf("error: cannot write profile trace file \"%s\"", argv[3]);
+				}
+			}
 			else {
-				printf("error: expect -import-json json_file");
+				printf("error: expect -import-json json_file [profile_trace_file]");
 			}
 		}
 		else {
@@ -7,6 +7,8 @@
 
 #include "common.cpp"
 
+#include <immintrin.h>
+
 union vec2 {
 	struct { float x, y; };
 	float e[2];
@@ -212,31 +214,29 @@ union mat4 {
 	mat4 operator+(mat4 m) const { return mat4{c1 + m.c1, c2 + m.c2, c3 + m.c3, c4 + m.c4}; }
 	mat4 operator*(float f) const { return mat4{c1 * f, c2 * f, c3 * f, c4 * f}; }
 	vec4 operator*(vec4 v) const {
-		float v0 = c1.x * v.x;
-		float v1 = c1.y * v.x;
-		float v2 = c1.z * v.x;
-		float v3 = c1.w * v.x;
-		v0 += c2.x * v.y;
-		v1 += c2.y * v.y;
-		v2 += c2.z * v.y;
-		v3 += c2.w * v.y;
-		v0 += c3.x * v.z;
-		v1 += c3.y * v.z;
-		v2 += c3.z * v.z;
-		v3 += c3.w * v.z;
-		v0 += c4.x * v.w;
-		v1 += c4.y * v.w;
-		v2 += c4.z * v.w;
-		v3 += c4.w * v.w;
-		return vec4{v0, v1, v2, v3};
+		__m128 r = _mm_mul_ps(_mm_loadu_ps(&c1.x), _mm_set1_ps(v.x));
+		r = _mm_add_ps(r, _mm_mul_ps(_mm_loadu_ps(&c2.x), _mm_set1_ps(v.y)));
+		r = _mm_add_ps(r, _mm_mul_ps(_mm_loadu_ps(&c3.x), _mm_set1_ps(v.z)));
+		r = _mm_add_ps(r, _mm_mul_ps(_mm_loadu_ps(&c4.x), _mm_set1_ps(v.w)));
+		vec4 result;
+		_mm_storeu_ps(&result.x, r);
+		return result;
 	}
 	vec3 operator*(vec3 v) const { vec4 v4 = *this * vec4{v.x, v.y, v.z, 1}; return vec3{v4.x, v4.y, v4.z}; }
 	mat4 operator*(mat4 m) const {
+		__m128 a1 = _mm_loadu_ps(&c1.x);
+		__m128 a2 = _mm_loadu_ps(&c2.x);
+		__m128 a3 = _mm_loadu_ps(&c3.x);
+		__m128 a4 = _mm_loadu_ps(&c4.x);
 		mat4 result;
-		result.c1 = c1 * m.c1.x + c2 * m.c1.y + c3 * m.c1.z + c4 * m.c1.w;
-		result.c2 = c1 * m.c2.x + c2 * m.c2.y + c3 * m.c2.z + c4 * m.c2.w;
-		result.c3 = c1 * m.c3.x + c2 * m.c3.y + c3 * m.c3.z + c4 * m.c3.w;
-		result.c4 = c1 * m.c4.x + c2 * m.c4.y + c3 * m.c4.z + c4 * m.c4.w;
+		for (uint32 i = 0; i < 4; i += 1) {
+			__m128 b = _mm_loadu_ps(&m.columns[i].x);
+			__m128 r = _mm_mul_ps(a1, _mm_shuffle_ps(b, b, _MM_SHUFFLE(0, 0, 0, 0)));
+			r = _mm_add_ps(r, _mm_mul_ps(a2, _mm_shuffle_ps(b, b, _MM_SHUFFLE(1, 1, 1, 1))));
+			r = _mm_add_ps(r, _mm_mul_ps(a3, _mm_shuffle_ps(b, b, _MM_SHUFFLE(2, 2, 2, 2))));
+			r = _mm_add_ps(r, _mm_mul_ps(a4, _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 3, 3, 3))));
+			_mm_storeu_ps(&result.columns[i].x, r);
+		}
 		return result;
 	}
 	vec4& operator[](uint32 i) { return columns[i]; }
@@ -329,6 +329,11 @@ struct ray {
 	float len;
 };
 
+// Planes face inwards, a point p is inside when vec3_dot(normal, p) >= distance for all of them.
+struct frustum {
+	plane planes[6];
+};
+
 float vec2_len(vec2 v) {
 	return sqrtf(v.x * v.x + v.y * v.y);
 }
@@ -493,56 +498,115 @@ mat4 mat4_identity() {
 }
 
 mat4 mat4_transpose(mat4 m) {
+	__m128 c1 = _mm_loadu_ps(&m.c1.x);
+	__m128 c2 = _mm_loadu_ps(&m.c2.x);
+	__m128 c3 = _mm_loadu_ps(&m.c3.x);
+	__m128 c4 = _mm_loadu_ps(&m.c4.x);
+	_MM_TRANSPOSE4_PS(c1, c2, c3, c4);
 	mat4 mat;
-	for (int i = 0; i < 4; i += 1) {
-		for (int j = 0; j < 4; j += 1) {
-			mat.columns[i].e[j] = m.columns[j].e[i];
-		}
-	}
+	_mm_storeu_ps(&mat.c1.x, c1);
+	_mm_storeu_ps(&mat.c2.x, c2);
+	_mm_storeu_ps(&mat.c3.x, c3);
+	_mm_storeu_ps(&mat.c4.x, c4);
 	return mat;
 }
 
+// 2x2 matrices packed into a __m128 as (m00, m01, m10, m11), used by mat4_inverse.
+__m128 mat2_mul(__m128 a, __m128 b) {
+	return _mm_add_ps(_mm_mul_ps(a, _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 0, 3, 0))), _mm_mul_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 3, 0, 1)), _mm_shuffle_ps(b, b, _MM_SHUFFLE(1, 2, 1, 2))));
+}
+
+// adjugate(a) * b
+__m128 mat2_adj_mul(__m128 a, __m128 b) {
+	return _mm_sub_ps(_mm_mul_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(0, 0, 3, 3)), b), _mm_mul_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 2, 1, 1)), _mm_shuffle_ps(b, b, _MM_SHUFFLE(1, 0, 3, 2))));
+}
+
+// a * adjugate(b)
+__m128 mat2_mul_adj(__m128 a, __m128 b) {
+	return _mm_sub_ps(_mm_mul_ps(a, _mm_shuffle_ps(b, b, _MM_SHUFFLE(0, 3, 0, 3))), _mm_mul_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 3, 0, 1)), _mm_shuffle_ps(b, b, _MM_SHUFFLE(1, 2, 1, 2))));
+}
+
+// Block inverse on the four 2x2 sub matrices. The formula is symmetric under transposition so it works on the
+// columns as if they were rows.
 mat4 mat4_inverse(mat4 m) {
-	float coef00 = m.c3.z * m.c4.w - m.c4.z * m.c3.w;
-	float coef02 = m.c2.z * m.c4.w - m.c4.z * m.c2.w;
-	float coef03 = m.c2.z * m.c3.w - m.c3.z * m.c2.w;
-	float coef04 = m.c3.y * m.c4.w - m.c4.y * m.c3.w;
-	float coef06 = m.c2.y * m.c4.w - m.c4.y * m.c2.w;
-	float coef07 = m.c2.y * m.c3.w - m.c3.y * m.c2.w;
-	float coef08 = m.c3.y * m.c4.z - m.c4.y * m.c3.z;
-	float coef10 = m.c2.y * m.c4.z - m.c4.y * m.c2.z;
-	float coef11 = m.c2.y * m.c3.z - m.c3.y * m.c2.z;
-	float coef12 = m.c3.x * m.c4.w - m.c4.x * m.c3.w;
-	float coef14 = m.c2.x * m.c4.w - m.c4.x * m.c2.w;
-	float coef15 = m.c2.x * m.c3.w - m.c3.x * m.c2.w;
-	float coef16 = m.c3.x * m.c4.z - m.c4.x * m.c3.z;
-	float coef18 = m.c2.x * m.c4.z - m.c4.x * m.c2.z;
-	float Coef19 = m.c2.x * m.c3.z - m.c3.x * m.c2.z;
-	float coef20 = m.c3.x * m.c4.y - m.c4.x * m.c3.y;
-	float coef22 = m.c2.x * m.c4.y - m.c4.x * m.c2.y;
-	float coef23 = m.c2.x * m.c3.y - m.c3.x * m.c2.y;
-	vec4 fac0 = {coef00, coef00, coef02, coef03};
-	vec4 fac1 = {coef04, coef04, coef06, coef07};
-	vec4 fac2 = {coef08, coef08, coef10, coef11};
-	vec4 fac3 = {coef12, coef12, coef14, coef15};
-	vec4 fac4 = {coef16, coef16, coef18, Coef19};
-	vec4 fac5 = {coef20, coef20, coef22, coef23};
-	vec4 vec0 = {m.c2.x, m.c1.x, m.c1.x, m.c1.x};
-	vec4 vec1 = {m.c2.y, m.c1.y, m.c1.y, m.c1.y};
-	vec4 vec2 = {m.c2.z, m.c1.z, m.c1.z, m.c1.z};
-	vec4 vec3 = {m.c2.w, m.c1.w, m.c1.w, m.c1.w};
-	vec4 inv0 = vec1 * fac0 - vec2 * fac1 + vec3 * fac2;
-	vec4 inv1 = vec0 * fac0 - vec2 * fac3 + vec3 * fac4;
-	vec4 inv2 = vec0 * fac1 - vec1 * fac3 + vec3 * fac5;
-	vec4 inv3 = vec0 * fac2 - vec1 * fac4 + vec2 * fac5;
-	vec4 sign_a = {+1, -1, +1, -1};
-	vec4 sign_b = {-1, +1, -1, +1};
-	mat4 inverse = {inv0 * sign_a, inv1 * sign_b, inv2 * sign_a, inv3 * sign_b};
-	vec4 row0 = {inverse.c1.x, inverse.c2.x, inverse.c3.x, inverse.c4.x};
-	vec4 dot0 = m.c1 * row0;
-	float dot1 = dot0.x + dot0.y + dot0.z + dot0.w;
-	float one_over_determinant = 1 / dot1;
-	return inverse * one_over_determinant;
+	__m128 c1 = _mm_loadu_ps(&m.c1.x);
+	__m128 c2 = _mm_loadu_ps(&m.c2.x);
+	__m128 c3 = _mm_loadu_ps(&m.c3.x);
+	__m128 c4 = _mm_loadu_ps(&m.c4.x);
+	__m128 a = _mm_movelh_ps(c1, c2);
+	__m128 b = _mm_movehl_ps(c2, c1);
+	__m128 c = _mm_movelh_ps(c3, c4);
+	__m128 d = _mm_movehl_ps(c4, c3);
+
+	__m128 sub_determinants = _mm_sub_ps(_mm_mul_ps(_mm_shuffle_ps(c1, c3, _MM_SHUFFLE(2, 0, 2, 0)), _mm_shuffle_ps(c2, c4, _MM_SHUFFLE(3, 1, 3, 1))),
+	                                     _mm_mul_ps(_mm_shuffle_ps(c1, c3, _MM_SHUFFLE(3, 1, 3, 1)), _mm_shuffle_ps(c2, c4, _MM_SHUFFLE(2, 0, 2, 0))));
+	__m128 determinant_a = _mm_shuffle_ps(sub_determinants, sub_determinants, _MM_SHUFFLE(0, 0, 0, 0));
+	__m128 determinant_b = _mm_shuffle_ps(sub_determinants, sub_determinants, _MM_SHUFFLE(1, 1, 1, 1));
+	__m128 determinant_c = _mm_shuffle_ps(sub_determinants, sub_determinants, _MM_SHUFFLE(2, 2, 2, 2));
+	__m128 determinant_d = _mm_shuffle_ps(sub_determinants, sub_determinants, _MM_SHUFFLE(3, 3, 3, 3));
+
+	__m128 d_c = mat2_adj_mul(d, c);
+	__m128 a_b = mat2_adj_mul(a, b);
+	__m128 x = _mm_sub_ps(_mm_mul_ps(determinant_d, a), mat2_mul(b, d_c));
+	__m128 w = _mm_sub_ps(_mm_mul_ps(determinant_a, d), mat2_mul(c, a_b));
+	__m128 y = _mm_sub_ps(_mm_mul_ps(determinant_b, c), mat2_mul_adj(d, a_b));
+	__m128 z = _mm_sub_ps(_mm_mul_ps(determinant_c, b), mat2_mul_adj(a, d_c));
+
+	__m128 trace = _mm_mul_ps(a_b, _mm_shuffle_ps(d_c, d_c, _MM_SHUFFLE(3, 1, 2, 0)));
+	trace = _mm_add_ps(trace, _mm_shuffle_ps(trace, trace, _MM_SHUFFLE(2, 3, 0, 1)));
+	trace = _mm_add_ps(trace, _mm_shuffle_ps(trace, trace, _MM_SHUFFLE(1, 0, 3, 2)));
+	__m128 determinant = _mm_sub_ps(_mm_add_ps(_mm_mul_ps(determinant_a, determinant_d), _mm_mul_ps(determinant_b, determinant_c)), trace);
+	__m128 one_over_determinant = _mm_div_ps(_mm_setr_ps(1, -1, -1, 1), determinant);
+	x = _mm_mul_ps(x, one_over_determinant);
+	y = _mm_mul_ps(y, one_over_determinant);
+	z = _mm_mul_ps(z, one_over_determinant);
+	w = _mm_mul_ps(w, one_over_determinant);
+
+	mat4 inverse;
+	_mm_storeu_ps(&inverse.c1.x, _mm_shuffle_ps(x, y, _MM_SHUFFLE(1, 3, 1, 3)));
+	_mm_storeu_ps(&inverse.c2.x, _mm_shuffle_ps(x, y, _MM_SHUFFLE(0, 2, 0, 2)));
+	_mm_storeu_ps(&inverse.c3.x, _mm_shuffle_ps(z, w, _MM_SHUFFLE(1, 3, 1, 3)));
+	_mm_storeu_ps(&inverse.c4.x, _mm_shuffle_ps(z, w, _MM_SHUFFLE(0, 2, 0, 2)));
+	return inverse;
+}
+
+__m128 mat4_cross(__m128 a, __m128 b) {
+	__m128 a_yzx = _mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 0, 2, 1));
+	__m128 b_yzx = _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 0, 2, 1));
+	__m128 c = _mm_sub_ps(_mm_mul_ps(a, b_yzx), _mm_mul_ps(a_yzx, b));
+	return _mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 0, 2, 1));
+}
+
+// Inverse of a matrix whose last row is (0, 0, 0, 1), the upper 3x3 is inverted through cross products and
+// the translation is rotated back. Cheaper and more accurate than mat4_inverse for node and camera transforms.
+mat4 mat4_affine_inverse(mat4 m) {
+	m_debug_assert(m.c1.w == 0 && m.c2.w == 0 && m.c3.w == 0 && m.c4.w == 1);
+	__m128 a = _mm_loadu_ps(&m.c1.x);
+	__m128 b = _mm_loadu_ps(&m.c2.x);
+	__m128 c = _mm_loadu_ps(&m.c3.x);
+	__m128 t = _mm_loadu_ps(&m.c4.x);
+	__m128 r1 = mat4_cross(b, c);
+	__m128 r2 = mat4_cross(c, a);
+	__m128 r3 = mat4_cross(a, b);
+	__m128 determinant = _mm_mul_ps(a, r1);
+	determinant = _mm_add_ps(determinant, _mm_shuffle_ps(determinant, determinant, _MM_SHUFFLE(2, 3, 0, 1)));
+	determinant = _mm_add_ps(determinant, _mm_shuffle_ps(determinant, determinant, _MM_SHUFFLE(1, 0, 3, 2)));
+	__m128 one_over_determinant = _mm_div_ps(_mm_set1_ps(1), determinant);
+	r1 = _mm_mul_ps(r1, one_over_determinant);
+	r2 = _mm_mul_ps(r2, one_over_determinant);
+	r3 = _mm_mul_ps(r3, one_over_determinant);
+	__m128 r4 = _mm_setzero_ps();
+	_MM_TRANSPOSE4_PS(r1, r2, r3, r4);
+	__m128 translate = _mm_mul_ps(r1, _mm_shuffle_ps(t, t, _MM_SHUFFLE(0, 0, 0, 0)));
+	translate = _mm_add_ps(translate, _mm_mul_ps(r2, _mm_shuffle_ps(t, t, _MM_SHUFFLE(1, 1, 1, 1))));
+	translate = _mm_add_ps(translate, _mm_mul_ps(r3, _mm_shuffle_ps(t, t, _MM_SHUFFLE(2, 2, 2, 2))));
+	translate = _mm_sub_ps(_mm_setr_ps(0, 0, 0, 1), translate);
+	mat4 inverse;
+	_mm_storeu_ps(&inverse.c1.x, r1);
+	_mm_storeu_ps(&inverse.c2.x, r2);
+	_mm_storeu_ps(&inverse.c3.x, r3);
+	_mm_storeu_ps(&inverse.c4.x, translate);
+	return inverse;
 }
 
 mat4 mat4_from_scale(vec3 scale) {
@@ -968,7 +1032,8 @@ void cosine_weighted_sample_hemisphere(float u1, float u2, vec3 *xyz, float *pdf
 	float r = sqrtf(u1);
 	float theta = 2 * (float)M_PI * u2;
 	*xyz = vec3{r * cosf(theta), sqrtf(max(0.0f, 1 - u1)), -r * sinf(theta)};
-	*pdf = cosf(theta) / (float)M_PI;
+	// the pdf goes to zero at the horizon as u1 goes to 1, and callers divide by it
+	*pdf = max(xyz->y, 1e-6f) / (float)M_PI;
 }
 
 float aabb_volume(aabb bound) {
@@ -1029,16 +1094,105 @@ bool aabb_intersect(aabb bound1, aabb bound2) {
 }
 
 aabb aabb_expand(aabb bound1, aabb bound2) {
-	aabb bound = bound1;
-	if (bound2.min.x < bound1.min.x || bound2.min.y < bound1.min.y || bound2.min.z < bound1.min.z) {
-		bound.min = bound2.min;
-	}
-	if (bound2.max.x > bound1.max.x || bound2.max.y > bound1.max.y || bound2.max.z > bound1.max.z) {
-		bound.max = bound2.max;
+	aabb bound;
+	for (int i = 0; i < 3; i += 1) {
+		bound.min.e[i] = min(bound1.min.e[i], bound2.min.e[i]);
+		bound.max.e[i] = max(bound1.max.e[i], bound2.max.e[i]);
 	}
 	return bound;
 }
 
+// Inside out box which aabb_expand leaves untouched, and which every frustum test rejects.
+aabb aabb_empty() {
+	return aabb{vec3{FLT_MAX, FLT_MAX, FLT_MAX}, vec3{-FLT_MAX, -FLT_MAX, -FLT_MAX}};
+}
+
+bool aabb_is_empty(aabb bound) {
+	return bound.min.x > bound.max.x || bound.min.y > bound.max.y || bound.min.z > bound.max.z;
+}
+
+// Bound of the box after an affine transform, from the transformed center and the extents projected onto each
+// axis (Arvo, "Transforming Axis-Aligned Bounding Boxes"). Empty boxes stay empty.
+aabb aabb_transform(aabb bound, const mat4& mat) {
+	if (aabb_is_empty(bound)) {
+		return bound;
+	}
+	vec3 center = mat * aabb_center(bound);
+	vec3 extent = aabb_size(bound) * 0.5f;
+	vec3 new_extent;
+	for (int i = 0; i < 3; i += 1) {
+		new_extent.e[i] = fabsf(mat.c1.e[i]) * extent.x + fabsf(mat.c2.e[i]) * extent.y + fabsf(mat.c3.e[i]) * extent.z;
+	}
+	return aabb{center - new_extent, center + new_extent};
+}
+
+// Planes of the clip volume of a view projection matrix (Gribb and Hartmann, "Fast Extraction of Viewing Frustum
+// Planes from the World-View-Projection Matrix"), with d3d's 0 to 1 clip depth. Normals are normalized so distances
+// are in world units. An infinite far plane comes out with a zero normal and a negative distance, which never culls.
+frustum frustum_from_mat4(const mat4& view_project) {
+	vec4 rows[4];
+	for (int i = 0; i < 4; i += 1) {
+		rows[i] = vec4{view_project.c1.e[i], view_project.c2.e[i], view_project.c3.e[i], view_project.c4.e[i]};
+	}
+	vec4 planes[6] = {
+		rows[3] + rows[0], rows[3] - rows[0],
+		rows[3] + rows[1], rows[3] - rows[1],
+		rows[2], rows[3] - rows[2]
+	};
+	frustum frustum;
+	for (int i = 0; i < 6; i += 1) {
+		vec3 normal = {planes[i].x, planes[i].y, planes[i].z};
+		float len = vec3_len(normal);
+		if (len > 0) {
+			frustum.planes[i] = plane{normal / len, -planes[i].w / len};
+		}
+		else {
+			frustum.planes[i] = plane{normal, -fabsf(planes[i].w)};
+		}
+	}
+	return frustum;
+}
+
+frustum camera_frustum(camera camera) {
+	return frustum_from_mat4(camera_view_project_mat4(camera));
+}
+
+enum frustum_cull_result {
+	frustum_cull_outside,
+	frustum_cull_intersect,
+	frustum_cull_inside
+};
+
+// Conservative box test against each plane in turn, with the corner furthest along the plane normal. Boxes near a
+// frustum corner can be reported intersecting while being outside, never the other way around.
+bool frustum_intersect_aabb(const frustum& frustum, aabb bound) {
+	const vec3* corners = &bound.min;
+	for (const plane& plane : frustum.planes) {
+		float d = plane.normal.x * corners[plane.normal.x >= 0].x + plane.normal.y * corners[plane.normal.y >= 0].y + plane.normal.z * corners[plane.normal.z >= 0].z;
+		if (!(d >= plane.distance)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+// Like frustum_intersect_aabb, also telling apart boxes that are entirely inside, whose contents need no more tests.
+frustum_cull_result frustum_cull_aabb(const frustum& frustum, aabb bound) {
+	const vec3* corners = &bound.min;
+	frustum_cull_result result = frustum_cull_inside;
+	for (const plane& plane : frustum.planes) {
+		float d = plane.normal.x * corners[plane.normal.x >= 0].x + plane.normal.y * corners[plane.normal.y >= 0].y + plane.normal.z * corners[plane.normal.z >= 0].z;
+		if (!(d >= plane.distance)) {
+			return frustum_cull_outside;
+		}
+		float d_near = plane.normal.x * corners[plane.normal.x < 0].x + plane.normal.y * corners[plane.normal.y < 0].y + plane.normal.z * corners[plane.normal.z < 0].z;
+		if (d_near < plane.distance) {
+			result = frustum_cull_intersect;
+		}
+	}
+	return result;
+}
+
 bool ray_hit_plane(ray ray, plane plane, float *hit) {
 	float t = (plane.distance - vec3_dot(plane.normal, ray.origin)) / vec3_dot(plane.normal, ray.dir * ray.len);
 	if (t < 0 && t > 1) {
@@ -1114,6 +1268,45 @@ bool ray_hit_aabb(ray ray, aabb bound, vec3 *hit_a = nullptr, vec3 *hit_b = null
 	return true;
 }
 
+// A ray with the reciprocal of its direction and the sign of each direction component cached, for testing one ray
+// against many boxes without dividing.
+struct ray_precomputed {
+	vec3 origin;
+	vec3 inv_dir;
+	float len;
+	uint32 sign[3];
+};
+
+ray_precomputed ray_precompute(ray ray) {
+	ray_precomputed r;
+	r.origin = ray.origin;
+	r.len = ray.len;
+	for (uint32 i = 0; i < 3; i += 1) {
+		r.inv_dir[i] = 1 / ray.dir[i];
+		r.sign[i] = std::signbit(ray.dir[i]) ? 1 : 0;
+	}
+	return r;
+}
+
+// Branchless slab test. The direction signs pick the entry plane of each slab so no swap is needed. A NaN slab distance,
+// from an origin on a face plane with a zero direction component, leaves the interval alone like ray_hit_aabb does.
+// hit is the entry distance, 0 when the origin is inside.
+bool ray_hit_aabb(const ray_precomputed& ray, aabb bound, float* hit = nullptr) {
+	const vec3* planes = &bound.min;
+	float t0 = 0;
+	float t1 = ray.len;
+	for (uint32 i = 0; i < 3; i += 1) {
+		float t_near = (planes[ray.sign[i]][i] - ray.origin[i]) * ray.inv_dir[i];
+		float t_far = (planes[1 - ray.sign[i]][i] - ray.origin[i]) * ray.inv_dir[i];
+		t0 = t_near > t0 ? t_near : t0;
+		t1 = t_far < t1 ? t_far : t1;
+	}
+	if (hit) {
+		*hit = t0;
+	}
+	return t0 <= t1;
+}
+
 bool ray_hit_triangle(ray ray, vec3 a, vec3 b, vec3 c, float *hit = nullptr, vec3 *hit_point = nullptr, vec3 *barycentric_coord = nullptr) {
 	vec3 ab = b - a;
 	vec3 ac = c - a;
@@ -1152,6 +1345,1687 @@ bool ray_hit_triangle(ray ray, vec3 a, vec3 b, vec3 c, float *hit = nullptr, vec
 	return true;
 }
 
+// Packets of 4 (SSE) and 8 (AVX) lanes in SoA layout, for running the same intersection and culling code several rays
+// or objects at a time. Arithmetic mirrors the scalar types, comparisons return a mask with all bits of a lane set
+// where the comparison holds, and ordered comparisons are false for NaN lanes just like their scalar counterparts.
+// The 8 wide types need AVX at runtime, callers are responsible for checking before using them.
+#if defined(_MSC_VER) || defined(__AVX__)
+#define MATH_AVX 1
+#endif
+
+struct maskx4 {
+	__m128 v;
+
+	maskx4 operator&(maskx4 m) const { return maskx4{_mm_and_ps(v, m.v)}; }
+	maskx4 operator|(maskx4 m) const { return maskx4{_mm_or_ps(v, m.v)}; }
+	maskx4 operator^(maskx4 m) const { return maskx4{_mm_xor_ps(v, m.v)}; }
+	maskx4 operator~() const { return maskx4{_mm_xor_ps(v, _mm_castsi128_ps(_mm_set1_epi32(-1)))}; }
+	void operator&=(maskx4 m) { v = _mm_and_ps(v, m.v); }
+	void operator|=(maskx4 m) { v = _mm_or_ps(v, m.v); }
+};
+
+struct floatx4 {
+	__m128 v;
+	static const uint32 lane_count = 4;
+
+	maskx4 operator==(floatx4 f) const { return maskx4{_mm_cmpeq_ps(v, f.v)}; }
+	maskx4 operator!=(floatx4 f) const { return maskx4{_mm_cmpneq_ps(v, f.v)}; }
+	maskx4 operator<(floatx4 f) const { return maskx4{_mm_cmplt_ps(v, f.v)}; }
+	maskx4 operator<=(floatx4 f) const { return maskx4{_mm_cmple_ps(v, f.v)}; }
+	maskx4 operator>(floatx4 f) const { return maskx4{_mm_cmpgt_ps(v, f.v)}; }
+	maskx4 operator>=(floatx4 f) const { return maskx4{_mm_cmpge_ps(v, f.v)}; }
+	floatx4 operator+(floatx4 f) const { return floatx4{_mm_add_ps(v, f.v)}; }
+	floatx4 operator+(float f) const { return floatx4{_mm_add_ps(v, _mm_set1_ps(f))}; }
+	floatx4 operator-() const { return floatx4{_mm_xor_ps(v, _mm_set1_ps(-0.0f))}; }
+	floatx4 operator-(floatx4 f) const { return floatx4{_mm_sub_ps(v, f.v)}; }
+	floatx4 operator-(float f) const { return floatx4{_mm_sub_ps(v, _mm_set1_ps(f))}; }
+	floatx4 operator*(floatx4 f) const { return floatx4{_mm_mul_ps(v, f.v)}; }
+	floatx4 operator*(float f) const { return floatx4{_mm_mul_ps(v, _mm_set1_ps(f))}; }
+	floatx4 operator/(floatx4 f) const { return floatx4{_mm_div_ps(v, f.v)}; }
+	floatx4 operator/(float f) const { return floatx4{_mm_div_ps(v, _mm_set1_ps(f))}; }
+	void operator+=(floatx4 f) { v = _mm_add_ps(v, f.v); }
+	void operator-=(floatx4 f) { v = _mm_sub_ps(v, f.v); }
+	void operator*=(floatx4 f) { v = _mm_mul_ps(v, f.v); }
+	void operator/=(floatx4 f) { v = _mm_div_ps(v, f.v); }
+};
+
+floatx4 floatx4_set1(float f) {
+	return floatx4{_mm_set1_ps(f)};
+}
+
+floatx4 floatx4_load(const float* f) {
+	return floatx4{_mm_loadu_ps(f)};
+}
+
+void floatx4_store(floatx4 f, float* dst) {
+	_mm_storeu_ps(dst, f.v);
+}
+
+float floatx4_get(floatx4 f, uint32 lane) {
+	m_debug_assert(lane < 4);
+	alignas(16) float e[4];
+	_mm_store_ps(e, f.v);
+	return e[lane];
+}
+
+floatx4 min(floatx4 a, floatx4 b) {
+	return floatx4{_mm_min_ps(a.v, b.v)};
+}
+
+floatx4 max(floatx4 a, floatx4 b) {
+	return floatx4{_mm_max_ps(a.v, b.v)};
+}
+
+float reduce_min(floatx4 f) {
+	__m128 m = _mm_min_ps(f.v, _mm_shuffle_ps(f.v, f.v, _MM_SHUFFLE(2, 3, 0, 1)));
+	m = _mm_min_ps(m, _mm_shuffle_ps(m, m, _MM_SHUFFLE(1, 0, 3, 2)));
+	return _mm_cvtss_f32(m);
+}
+
+floatx4 sqrt(floatx4 f) {
+	return floatx4{_mm_sqrt_ps(f.v)};
+}
+
+floatx4 abs(floatx4 f) {
+	return floatx4{_mm_andnot_ps(_mm_set1_ps(-0.0f), f.v)};
+}
+
+// Lanes of a where mask is set, lanes of b elsewhere.
+floatx4 select(maskx4 mask, floatx4 a, floatx4 b) {
+	return floatx4{_mm_or_ps(_mm_and_ps(mask.v, a.v), _mm_andnot_ps(mask.v, b.v))};
+}
+
+uint32 mask_bits(maskx4 mask) {
+	return (uint32)_mm_movemask_ps(mask.v);
+}
+
+bool mask_any(maskx4 mask) {
+	return mask_bits(mask) != 0;
+}
+
+bool mask_all(maskx4 mask) {
+	return mask_bits(mask) == 0xf;
+}
+
+struct vec3x4 {
+	floatx4 x, y, z;
+	static const uint32 lane_count = 4;
+
+	maskx4 operator==(vec3x4 v) const { return (x == v.x) & (y == v.y) & (z == v.z); }
+	maskx4 operator!=(vec3x4 v) const { return ~(*this == v); }
+	vec3x4 operator+(vec3x4 v) const { return vec3x4{x + v.x, y + v.y, z + v.z}; }
+	vec3x4 operator-() const { return vec3x4{-x, -y, -z}; }
+	vec3x4 operator-(vec3x4 v) const { return vec3x4{x - v.x, y - v.y, z - v.z}; }
+	vec3x4 operator-(float d) const { return vec3x4{x - d, y - d, z - d}; }
+	vec3x4 operator*(float d) const { return vec3x4{x * d, y * d, z * d}; }
+	vec3x4 operator*(floatx4 d) const { return vec3x4{x * d, y * d, z * d}; }
+	vec3x4 operator*(vec3x4 v) const { return vec3x4{x * v.x, y * v.y, z * v.z}; }
+	vec3x4 operator/(float d) const { return vec3x4{x / d, y / d, z / d}; }
+	vec3x4 operator/(floatx4 d) const { return vec3x4{x / d, y / d, z / d}; }
+	vec3x4 operator/(vec3x4 v) const { return vec3x4{x / v.x, y / v.y, z / v.z}; }
+	void operator+=(vec3x4 v) { x += v.x; y += v.y; z += v.z; }
+	void operator-=(vec3x4 v) { x -= v.x; y -= v.y; z -= v.z; }
+	void operator*=(vec3x4 v) { x *= v.x; y *= v.y; z *= v.z; }
+	void operator*=(floatx4 f) { x *= f; y *= f; z *= f; }
+	void operator/=(vec3x4 v) { x /= v.x; y /= v.y; z /= v.z; }
+	void operator/=(floatx4 f) { x /= f; y /= f; z /= f; }
+};
+
+vec3x4 vec3x4_set1(vec3 v) {
+	return vec3x4{floatx4_set1(v.x), floatx4_set1(v.y), floatx4_set1(v.z)};
+}
+
+// Transposes 4 consecutive vec3s into a packet.
+vec3x4 vec3x4_load(const vec3* v) {
+	__m128 a = _mm_loadu_ps(&v[0].x);
+	__m128 b = _mm_loadu_ps(&v[1].y);
+	__m128 c = _mm_loadu_ps(&v[2].z);
+	__m128 x_hi = _mm_shuffle_ps(b, c, _MM_SHUFFLE(1, 1, 2, 2));
+	__m128 y_lo = _mm_shuffle_ps(a, b, _MM_SHUFFLE(0, 0, 1, 1));
+	__m128 y_hi = _mm_shuffle_ps(b, c, _MM_SHUFFLE(2, 2, 3, 3));
+	__m128 z_lo = _mm_shuffle_ps(a, b, _MM_SHUFFLE(1, 1, 2, 2));
+	__m128 z_hi = _mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 3, 0, 0));
+	vec3x4 result;
+	result.x.v = _mm_shuffle_ps(a, x_hi, _MM_SHUFFLE(2, 0, 3, 0));
+	result.y.v = _mm_shuffle_ps(y_lo, y_hi, _MM_SHUFFLE(2, 0, 2, 0));
+	result.z.v = _mm_shuffle_ps(z_lo, z_hi, _MM_SHUFFLE(2, 0, 2, 0));
+	return result;
+}
+
+void vec3x4_store(vec3x4 v, vec3* dst) {
+	__m128 xy_lo = _mm_unpacklo_ps(v.x.v, v.y.v);
+	__m128 xy_hi = _mm_unpackhi_ps(v.x.v, v.y.v);
+	__m128 z0x1 = _mm_shuffle_ps(v.z.v, xy_lo, _MM_SHUFFLE(2, 2, 0, 0));
+	__m128 y1z1 = _mm_shuffle_ps(xy_lo, v.z.v, _MM_SHUFFLE(1, 1, 3, 3));
+	__m128 z2x3 = _mm_shuffle_ps(v.z.v, xy_hi, _MM_SHUFFLE(2, 2, 2, 2));
+	__m128 y3z3 = _mm_shuffle_ps(xy_hi, v.z.v, _MM_SHUFFLE(3, 3, 3, 3));
+	_mm_storeu_ps(&dst[0].x, _mm_shuffle_ps(xy_lo, z0x1, _MM_SHUFFLE(2, 0, 1, 0)));
+	_mm_storeu_ps(&dst[1].y, _mm_shuffle_ps(y1z1, xy_hi, _MM_SHUFFLE(1, 0, 2, 0)));
+	_mm_storeu_ps(&dst[2].z, _mm_shuffle_ps(z2x3, y3z3, _MM_SHUFFLE(2, 0, 2, 0)));
+}
+
+vec3 vec3x4_get(vec3x4 v, uint32 lane) {
+	return vec3{floatx4_get(v.x, lane), floatx4_get(v.y, lane), floatx4_get(v.z, lane)};
+}
+
+vec3x4 select(maskx4 mask, vec3x4 a, vec3x4 b) {
+	return vec3x4{select(mask, a.x, b.x), select(mask, a.y, b.y), select(mask, a.z, b.z)};
+}
+
+floatx4 vec3_dot(vec3x4 v1, vec3x4 v2) {
+	return v1.x * v2.x + v1.y * v2.y + v1.z * v2.z;
+}
+
+floatx4 vec3_len(vec3x4 v) {
+	return sqrt(vec3_dot(v, v));
+}
+
+vec3x4 vec3_normalize(vec3x4 v) {
+	return v / vec3_len(v);
+}
+
+vec3x4 vec3_cross(vec3x4 v1, vec3x4 v2) {
+	return vec3x4{v1.y * v2.z - v1.z * v2.y, v1.z * v2.x - v1.x * v2.z, v1.x * v2.y - v1.y * v2.x};
+}
+
+vec3x4 vec3_lerp(vec3x4 v1, vec3x4 v2, floatx4 t) {
+	return v1 + (v2 - v1) * t;
+}
+
+vec3x4 min(vec3x4 a, vec3x4 b) {
+	return vec3x4{min(a.x, b.x), min(a.y, b.y), min(a.z, b.z)};
+}
+
+vec3x4 max(vec3x4 a, vec3x4 b) {
+	return vec3x4{max(a.x, b.x), max(a.y, b.y), max(a.z, b.z)};
+}
+
+#ifdef MATH_AVX
+
+struct maskx8 {
+	__m256 v;
+
+	maskx8 operator&(maskx8 m) const { return maskx8{_mm256_and_ps(v, m.v)}; }
+	maskx8 operator|(maskx8 m) const { return maskx8{_mm256_or_ps(v, m.v)}; }
+	maskx8 operator^(maskx8 m) const { return maskx8{_mm256_xor_ps(v, m.v)}; }
+	maskx8 operator~() const { return maskx8{_mm256_xor_ps(v, _mm256_castsi256_ps(_mm256_set1_epi32(-1)))}; }
+	void operator&=(maskx8 m) { v = _mm256_and_ps(v, m.v); }
+	void operator|=(maskx8 m) { v = _mm256_or_ps(v, m.v); }
+};
+
+struct floatx8 {
+	__m256 v;
+	static const uint32 lane_count = 8;
+
+	maskx8 operator==(floatx8 f) const { return maskx8{_mm256_cmp_ps(v, f.v, _CMP_EQ_OQ)}; }
+	maskx8 operator!=(floatx8 f) const { return maskx8{_mm256_cmp_ps(v, f.v, _CMP_NEQ_UQ)}; }
+	maskx8 operator<(floatx8 f) const { return maskx8{_mm256_cmp_ps(v, f.v, _CMP_LT_OQ)}; }
+	maskx8 operator<=(floatx8 f) const { return maskx8{_mm256_cmp_ps(v, f.v, _CMP_LE_OQ)}; }
+	maskx8 operator>(floatx8 f) const { return maskx8{_mm256_cmp_ps(v, f.v, _CMP_GT_OQ)}; }
+	maskx8 operator>=(floatx8 f) const { return maskx8{_mm256_cmp_ps(v, f.v, _CMP_GE_OQ)}; }
+	floatx8 operator+(floatx8 f) const { return floatx8{_mm256_add_ps(v, f.v)}; }
+	floatx8 operator+(float f) const { return floatx8{_mm256_add_ps(v, _mm256_set1_ps(f))}; }
+	floatx8 operator-() const { return floatx8{_mm256_xor_ps(v, _mm256_set1_ps(-0.0f))}; }
+	floatx8 operator-(floatx8 f) const { return floatx8{_mm256_sub_ps(v, f.v)}; }
+	floatx8 operator-(float f) const { return floatx8{_mm256_sub_ps(v, _mm256_set1_ps(f))}; }
+	floatx8 operator*(floatx8 f) const { return floatx8{_mm256_mul_ps(v, f.v)}; }
+	floatx8 operator*(float f) const { return floatx8{_mm256_mul_ps(v, _mm256_set1_ps(f))}; }
+	floatx8 operator/(floatx8 f) const { return floatx8{_mm256_div_ps(v, f.v)}; }
+	floatx8 operator/(float f) const { return floatx8{_mm256_div_ps(v, _mm256_set1_ps(f))}; }
+	void operator+=(floatx8 f) { v = _mm256_add_ps(v, f.v); }
+	void operator-=(floatx8 f) { v = _mm256_sub_ps(v, f.v); }
+	void operator*=(floatx8 f) { v = _mm256_mul_ps(v, f.v); }
+	void operator/=(floatx8 f) { v = _mm256_div_ps(v, f.v); }
+};
+
+floatx8 floatx8_set1(float f) {
+	return floatx8{_mm256_set1_ps(f)};
+}
+
+floatx8 floatx8_load(const float* f) {
+	return floatx8{_mm256_loadu_ps(f)};
+}
+
+void floatx8_store(floatx8 f, float* dst) {
+	_mm256_storeu_ps(dst, f.v);
+}
+
+float floatx8_get(floatx8 f, uint32 lane) {
+	m_debug_assert(lane < 8);
+	alignas(32) float e[8];
+	_mm256_store_ps(e, f.v);
+	return e[lane];
+}
+
+floatx8 min(floatx8 a, floatx8 b) {
+	return floatx8{_mm256_min_ps(a.v, b.v)};
+}
+
+floatx8 max(floatx8 a, floatx8 b) {
+	return floatx8{_mm256_max_ps(a.v, b.v)};
+}
+
+float reduce_min(floatx8 f) {
+	return reduce_min(min(floatx4{_mm256_castps256_ps128(f.v)}, floatx4{_mm256_extractf128_ps(f.v, 1)}));
+}
+
+floatx8 sqrt(floatx8 f) {
+	return floatx8{_mm256_sqrt_ps(f.v)};
+}
+
+floatx8 abs(floatx8 f) {
+	return floatx8{_mm256_andnot_ps(_mm256_set1_ps(-0.0f), f.v)};
+}
+
+floatx8 select(maskx8 mask, floatx8 a, floatx8 b) {
+	return floatx8{_mm256_blendv_ps(b.v, a.v, mask.v)};
+}
+
+uint32 mask_bits(maskx8 mask) {
+	return (uint32)_mm256_movemask_ps(mask.v);
+}
+
+bool mask_any(maskx8 mask) {
+	return mask_bits(mask) != 0;
+}
+
+bool mask_all(maskx8 mask) {
+	return mask_bits(mask) == 0xff;
+}
+
+struct vec3x8 {
+	floatx8 x, y, z;
+	static const uint32 lane_count = 8;
+
+	maskx8 operator==(vec3x8 v) const { return (x == v.x) & (y == v.y) & (z == v.z); }
+	maskx8 operator!=(vec3x8 v) const { return ~(*this == v); }
+	vec3x8 operator+(vec3x8 v) const { return vec3x8{x + v.x, y + v.y, z + v.z}; }
+	vec3x8 operator-() const { return vec3x8{-x, -y, -z}; }
+	vec3x8 operator-(vec3x8 v) const { return vec3x8{x - v.x, y - v.y, z - v.z}; }
+	vec3x8 operator-(float d) const { return vec3x8{x - d, y - d, z - d}; }
+	vec3x8 operator*(float d) const { return vec3x8{x * d, y * d, z * d}; }
+	vec3x8 operator*(floatx8 d) const { return vec3x8{x * d, y * d, z * d}; }
+	vec3x8 operator*(vec3x8 v) const { return vec3x8{x * v.x, y * v.y, z * v.z}; }
+	vec3x8 operator/(float d) const { return vec3x8{x / d, y / d, z / d}; }
+	vec3x8 operator/(floatx8 d) const { return vec3x8{x / d, y / d, z / d}; }
+	vec3x8 operator/(vec3x8 v) const { return vec3x8{x / v.x, y / v.y, z / v.z}; }
+	void operator+=(vec3x8 v) { x += v.x; y += v.y; z += v.z; }
+	void operator-=(vec3x8 v) { x -= v.x; y -= v.y; z -= v.z; }
+	void operator*=(vec3x8 v) { x *= v.x; y *= v.y; z *= v.z; }
+	void operator*=(floatx8 f) { x *= f; y *= f; z *= f; }
+	void operator/=(vec3x8 v) { x /= v.x; y /= v.y; z /= v.z; }
+	void operator/=(floatx8 f) { x /= f; y /= f; z /= f; }
+};
+
+vec3x8 vec3x8_set1(vec3 v) {
+	return vec3x8{floatx8_set1(v.x), floatx8_set1(v.y), floatx8_set1(v.z)};
+}
+
+// Transposes 8 consecutive vec3s into a packet, the same shuffles as vec3x4_load on each 128 bit half.
+vec3x8 vec3x8_load(const vec3* v) {
+	__m256 a = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(&v[0].x)), _mm_loadu_ps(&v[4].x), 1);
+	__m256 b = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(&v[1].y)), _mm_loadu_ps(&v[5].y), 1);
+	__m256 c = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(&v[2].z)), _mm_loadu_ps(&v[6].z), 1);
+	__m256 x_hi = _mm256_shuffle_ps(b, c, _MM_SHUFFLE(1, 1, 2, 2));
+	__m256 y_lo = _mm256_shuffle_ps(a, b, _MM_SHUFFLE(0, 0, 1, 1));
+	__m256 y_hi = _mm256_shuffle_ps(b, c, _MM_SHUFFLE(2, 2, 3, 3));
+	__m256 z_lo = _mm256_shuffle_ps(a, b, _MM_SHUFFLE(1, 1, 2, 2));
+	__m256 z_hi = _mm256_shuffle_ps(c, c, _MM_SHUFFLE(3, 3, 0, 0));
+	vec3x8 result;
+	result.x.v = _mm256_shuffle_ps(a, x_hi, _MM_SHUFFLE(2, 0, 3, 0));
+	result.y.v = _mm256_shuffle_ps(y_lo, y_hi, _MM_SHUFFLE(2, 0, 2, 0));
+	result.z.v = _mm256_shuffle_ps(z_lo, z_hi, _MM_SHUFFLE(2, 0, 2, 0));
+	return result;
+}
+
+void vec3x8_store(vec3x8 v, vec3* dst) {
+	__m256 xy_lo = _mm256_unpacklo_ps(v.x.v, v.y.v);
+	__m256 xy_hi = _mm256_unpackhi_ps(v.x.v, v.y.v);
+	__m256 z0x1 = _mm256_shuffle_ps(v.z.v, xy_lo, _MM_SHUFFLE(2, 2, 0, 0));
+	__m256 y1z1 = _mm256_shuffle_ps(xy_lo, v.z.v, _MM_SHUFFLE(1, 1, 3, 3));
+	__m256 z2x3 = _mm256_shuffle_ps(v.z.v, xy_hi, _MM_SHUFFLE(2, 2, 2, 2));
+	__m256 y3z3 = _mm256_shuffle_ps(xy_hi, v.z.v, _MM_SHUFFLE(3, 3, 3, 3));
+	__m256 a = _mm256_shuffle_ps(xy_lo, z0x1, _MM_SHUFFLE(2, 0, 1, 0));
+	__m256 b = _mm256_shuffle_ps(y1z1, xy_hi, _MM_SHUFFLE(1, 0, 2, 0));
+	__m256 c = _mm256_shuffle_ps(z2x3, y3z3, _MM_SHUFFLE(2, 0, 2, 0));
+	_mm_storeu_ps(&dst[0].x, _mm256_castps256_ps128(a));
+	_mm_storeu_ps(&dst[1].y, _mm256_castps256_ps128(b));
+	_mm_storeu_ps(&dst[2].z, _mm256_castps256_ps128(c));
+	_mm_storeu_ps(&dst[4].x, _mm256_extractf128_ps(a, 1));
+	_mm_storeu_ps(&dst[5].y, _mm256_extractf128_ps(b, 1));
+	_mm_storeu_ps(&dst[6].z, _mm256_extractf128_ps(c, 1));
+}
+
+vec3 vec3x8_get(vec3x8 v, uint32 lane) {
+	return vec3{floatx8_get(v.x, lane), floatx8_get(v.y, lane), floatx8_get(v.z, lane)};
+}
+
+vec3x8 select(maskx8 mask, vec3x8 a, vec3x8 b) {
+	return vec3x8{select(mask, a.x, b.x), select(mask, a.y, b.y), select(mask, a.z, b.z)};
+}
+
+floatx8 vec3_dot(vec3x8 v1, vec3x8 v2) {
+	return v1.x * v2.x + v1.y * v2.y + v1.z * v2.z;
+}
+
+floatx8 vec3_len(vec3x8 v) {
+	return sqrt(vec3_dot(v, v));
+}
+
+vec3x8 vec3_normalize(vec3x8 v) {
+	return v / vec3_len(v);
+}
+
+vec3x8 vec3_cross(vec3x8 v1, vec3x8 v2) {
+	return vec3x8{v1.y * v2.z - v1.z * v2.y, v1.z * v2.x - v1.x * v2.z, v1.x * v2.y - v1.y * v2.x};
+}
+
+vec3x8 vec3_lerp(vec3x8 v1, vec3x8 v2, floatx8 t) {
+	return v1 + (v2 - v1) * t;
+}
+
+vec3x8 min(vec3x8 a, vec3x8 b) {
+	return vec3x8{min(a.x, b.x), min(a.y, b.y), min(a.z, b.z)};
+}
+
+vec3x8 max(vec3x8 a, vec3x8 b) {
+	return vec3x8{max(a.x, b.x), max(a.y, b.y), max(a.z, b.z)};
+}
+
+#endif // MATH_AVX
+
+// Broadcasts for code templated on the packet width.
+template <typename FLOATX>
+FLOATX floatx_set1(float f);
+
+template <>
+floatx4 floatx_set1<floatx4>(float f) {
+	return floatx4_set1(f);
+}
+
+template <typename VEC3X>
+VEC3X vec3x_set1(vec3 v) {
+	typedef decltype(VEC3X::x) FLOATX;
+	return VEC3X{floatx_set1<FLOATX>(v.x), floatx_set1<FLOATX>(v.y), floatx_set1<FLOATX>(v.z)};
+}
+
+#ifdef MATH_AVX
+
+template <>
+floatx8 floatx_set1<floatx8>(float f) {
+	return floatx8_set1(f);
+}
+
+#endif // MATH_AVX
+
+template <>
+float floatx_set1<float>(float f) {
+	return f;
+}
+
+float select(bool mask, float a, float b) {
+	return mask ? a : b;
+}
+
+// Fast approximations of libm functions for inner loops, each in a scalar form and 4 and 8 wide forms that share one
+// implementation. Call sites opt in by name, the full precision functions stay the default. Polynomials are from
+// Cephes, bounds are the largest errors found against double precision libm by m_test(fast_math), over the inputs
+// stated with each function. Infinities and NaNs are not handled.
+
+// Rounds to nearest even for |f| < 2^22 without leaving float registers, adding 1.5 * 2^23 drops all fraction bits.
+template <typename FLOATX>
+FLOATX round_nearest(FLOATX f) {
+	return (f + 12582912.0f) - 12582912.0f;
+}
+
+// Bit manipulation behind the range reductions. exp2_integer(n) is 2^n for integral n in [-126, 127], frexp_fast
+// splits a positive normal x into a mantissa in [0.5, 1) and its exponent.
+float exp2_integer(float n) {
+	uint32 bits = (uint32)((int32)n + 127) << 23;
+	float f;
+	memcpy(&f, &bits, sizeof(f));
+	return f;
+}
+
+float frexp_fast(float x, float* exponent) {
+	uint32 bits;
+	memcpy(&bits, &x, sizeof(bits));
+	*exponent = (float)((int32)(bits >> 23) - 126);
+	bits = (bits & 0x807fffff) | 0x3f000000;
+	float mantissa;
+	memcpy(&mantissa, &bits, sizeof(mantissa));
+	return mantissa;
+}
+
+floatx4 exp2_integer(floatx4 n) {
+	return floatx4{_mm_castsi128_ps(_mm_slli_epi32(_mm_add_epi32(_mm_cvttps_epi32(n.v), _mm_set1_epi32(127)), 23))};
+}
+
+floatx4 frexp_fast(floatx4 x, floatx4* exponent) {
+	__m128i bits = _mm_castps_si128(x.v);
+	exponent->v = _mm_cvtepi32_ps(_mm_sub_epi32(_mm_srli_epi32(bits, 23), _mm_set1_epi32(126)));
+	bits = _mm_or_si128(_mm_and_si128(bits, _mm_set1_epi32(0x807fffff)), _mm_set1_epi32(0x3f000000));
+	return floatx4{_mm_castsi128_ps(bits)};
+}
+
+// The hardware estimate, good to 12 bits, refined with one Newton step to 4 ulp for positive normal x.
+float rsqrt_fast(float x) {
+	float y = _mm_cvtss_f32(_mm_rsqrt_ss(_mm_set_ss(x)));
+	return y * (1.5f - 0.5f * x * y * y);
+}
+
+floatx4 rsqrt_fast(floatx4 x) {
+	floatx4 y = {_mm_rsqrt_ps(x.v)};
+	return y * (floatx4_set1(1.5f) - x * 0.5f * y * y);
+}
+
+#ifdef MATH_AVX
+
+// AVX has no 256 bit integer arithmetic, the exponent tricks go through the 128 bit halves.
+template <typename F>
+floatx8 floatx8_from_halves(floatx8 f, F func) {
+	floatx4 lo = func(floatx4{_mm256_castps256_ps128(f.v)});
+	floatx4 hi = func(floatx4{_mm256_extractf128_ps(f.v, 1)});
+	return floatx8{_mm256_insertf128_ps(_mm256_castps128_ps256(lo.v), hi.v, 1)};
+}
+
+floatx8 exp2_integer(floatx8 n) {
+	return floatx8_from_halves(n, [](floatx4 n) { return exp2_integer(n); });
+}
+
+floatx8 frexp_fast(floatx8 x, floatx8* exponent) {
+	*exponent = floatx8_from_halves(x, [](floatx4 x) { floatx4 e; frexp_fast(x, &e); return e; });
+	return floatx8_from_halves(x, [](floatx4 x) { floatx4 e; return frexp_fast(x, &e); });
+}
+
+floatx8 rsqrt_fast(floatx8 x) {
+	floatx8 y = {_mm256_rsqrt_ps(x.v)};
+	return y * (floatx8_set1(1.5f) - x * 0.5f * y * y);
+}
+
+#endif // MATH_AVX
+
+// Both at once for |x| <= 8192 with an absolute error under 1.2e-7. Relative to the result that is 2 ulp for sin over
+// [-pi, pi] but for cos only over [-1.5, 1.5], near its zeros at +-pi / 2 only the absolute bound holds. Precision falls
+// off past 8192 as the reduction by multiples of pi / 2, in three parts, runs out of bits.
+template <typename FLOATX>
+void sincos_fast(FLOATX x, FLOATX* sin, FLOATX* cos) {
+	using std::abs;
+	auto c = [](float f) { return floatx_set1<FLOATX>(f); };
+	FLOATX a = abs(x);
+	FLOATX q = round_nearest(a * (float)(2 / M_PI));
+	FLOATX quadrant = q - round_nearest(q * 0.25f - 0.375f) * 4;
+	FLOATX r = ((a - q * 1.5703125f) - q * 4.837512969970703125e-4f) - q * 7.54978995489188216e-8f;
+	FLOATX z = r * r;
+	FLOATX sin_r = ((c(-1.9515295891e-4f) * z + 8.3321608736e-3f) * z - 1.6666654611e-1f) * z * r + r;
+	FLOATX cos_r = ((c(2.443315711809948e-5f) * z - 1.388731625493765e-3f) * z + 4.166664568298827e-2f) * z * z - z * 0.5f + 1;
+	auto swap = (quadrant == c(1)) | (quadrant == c(3));
+	FLOATX sin_a = select(swap, cos_r, sin_r);
+	FLOATX cos_a = select(swap, sin_r, cos_r);
+	sin_a = select(quadrant >= c(2), -sin_a, sin_a);
+	*sin = select(x < c(0), -sin_a, sin_a);
+	*cos = select((quadrant == c(1)) | (quadrant == c(2)), -cos_a, cos_a);
+}
+
+template <typename FLOATX>
+FLOATX sin_fast(FLOATX x) {
+	FLOATX s, c;
+	sincos_fast(x, &s, &c);
+	return s;
+}
+
+template <typename FLOATX>
+FLOATX cos_fast(FLOATX x) {
+	FLOATX s, c;
+	sincos_fast(x, &s, &c);
+	return c;
+}
+
+// What float pi and pi / 2 are short of, added after subtracting from them to keep results near pi accurate.
+const float pi_lo = (float)(M_PI - (float)M_PI);
+const float pi_2_lo = (float)(M_PI / 2 - (float)(M_PI / 2));
+
+// Finite x and y, 3 ulp. atan2_fast(0, 0) is 0, the signs of zero inputs are ignored.
+template <typename FLOATX>
+FLOATX atan2_fast(FLOATX y, FLOATX x) {
+	using std::abs;
+	auto c = [](float f) { return floatx_set1<FLOATX>(f); };
+	FLOATX ax = abs(x);
+	FLOATX ay = abs(y);
+	FLOATX hi = max(ax, ay);
+	FLOATX t = min(ax, ay) / hi;
+	auto reduce = t > c(0.4142135623730950f);
+	t = select(reduce, (t - 1) / (t + 1), t);
+	FLOATX z = t * t;
+	FLOATX r = (((c(8.05374449538e-2f) * z - 1.38776856032e-1f) * z + 1.99777106478e-1f) * z - 3.33329491539e-1f) * z * t;
+	r = (r + select(reduce, c(pi_lo / 4), c(0))) + t + select(reduce, c((float)M_PI / 4), c(0));
+	r = select(ay > ax, (c((float)M_PI / 2) - r) + c(pi_2_lo), r);
+	r = select(x < c(0), (c((float)M_PI) - r) + c(pi_lo), r);
+	r = select(hi == c(0), c(0), r);
+	return select(y < c(0), -r, r);
+}
+
+// x in [-1, 1], 2 ulp.
+template <typename FLOATX>
+FLOATX acos_fast(FLOATX x) {
+	using std::abs;
+	using std::sqrt;
+	auto c = [](float f) { return floatx_set1<FLOATX>(f); };
+	FLOATX a = abs(x);
+	auto large = a > c(0.5f);
+	FLOATX z = select(large, (c(1) - a) * 0.5f, x * x);
+	FLOATX s = select(large, sqrt(z), x);
+	FLOATX asin_s = ((((c(4.2163199048e-2f) * z + 2.4181311049e-2f) * z + 4.5470025998e-2f) * z + 7.4953002686e-2f) * z + 1.6666752422e-1f) * z * s + s;
+	FLOATX acos_a = asin_s * 2;
+	acos_a = select(x < c(0), (c((float)M_PI) - acos_a) + c(pi_lo), acos_a);
+	return select(large, acos_a, (c((float)M_PI / 2) - asin_s) + c(pi_2_lo));
+}
+
+// 2 ulp for x in [-86.6, 88.7], 0 below and infinity above. Results never go denormal.
+template <typename FLOATX>
+FLOATX exp_fast(FLOATX x) {
+	auto c = [](float f) { return floatx_set1<FLOATX>(f); };
+	FLOATX clamped = min(max(x, c(-86.6f)), c(88.72283f));
+	FLOATX n = round_nearest(clamped * (float)M_LOG2E);
+	FLOATX r = (clamped - n * 0.693359375f) - n * -2.12194440e-4f;
+	FLOATX p = (((((c(1.9875691500e-4f) * r + 1.3981999507e-3f) * r + 8.3334519073e-3f) * r + 4.1665795894e-2f) * r + 1.6666665459e-1f) * r + 5.0000001201e-1f) * (r * r) + r + 1;
+	FLOATX result = p * exp2_integer(n - 1) * 2;
+	result = select(x > c(88.72283f), c(INFINITY), result);
+	return select(x < c(-86.6f), c(0), result);
+}
+
+// Positive normal x, 2 ulp.
+template <typename FLOATX>
+FLOATX log_fast(FLOATX x) {
+	auto c = [](float f) { return floatx_set1<FLOATX>(f); };
+	FLOATX e;
+	FLOATX m = frexp_fast(x, &e);
+	auto small = m < c(0.707106781186547524f);
+	e = select(small, e - 1, e);
+	m = select(small, m + m - 1, m - 1);
+	FLOATX z = m * m;
+	FLOATX y = ((((((((c(7.0376836292e-2f) * m - 1.1514610310e-1f) * m + 1.1676998740e-1f) * m - 1.2420140846e-1f) * m + 1.4249322787e-1f) * m - 1.6668057665e-1f) * m + 2.0000714765e-1f) * m - 2.4999993993e-1f) * m + 3.3333331174e-1f) * m * z;
+	y = y + e * -2.12194440e-4f;
+	y = y - z * 0.5f;
+	return m + y + e * 0.693359375f;
+}
+
+// Lengths of the results are within 4e-7 of 1. v must not be zero, like vec3_normalize.
+vec3 vec3_normalize_fast(vec3 v) {
+	return v * rsqrt_fast(v.x * v.x + v.y * v.y + v.z * v.z);
+}
+
+vec3x4 vec3_normalize_fast(vec3x4 v) {
+	return v * rsqrt_fast(vec3_dot(v, v));
+}
+
+#ifdef MATH_AVX
+
+vec3x8 vec3_normalize_fast(vec3x8 v) {
+	return v * rsqrt_fast(vec3_dot(v, v));
+}
+
+#endif // MATH_AVX
+
+quat quat_from_between_fast(vec3 a, vec3 b) {
+	float adb = vec3_dot(a, b);
+	if (adb < -0.999999f || adb > 0.999999f) {
+		return quat_from_between(a, b);
+	}
+	vec3 axb = vec3_cross(a, b);
+	quat q = {axb.x, axb.y, axb.z, 1 + adb};
+	return q * rsqrt_fast(q.x * q.x + q.y * q.y + q.z * q.z + q.w * q.w);
+}
+
+void cosine_weighted_sample_hemisphere_fast(float u1, float u2, vec3 *xyz, float *pdf) {
+	float r = sqrtf(u1);
+	float sin_theta, cos_theta;
+	sincos_fast(2 * (float)M_PI * u2, &sin_theta, &cos_theta);
+	*xyz = vec3{r * cos_theta, sqrtf(max(0.0f, 1 - u1)), -r * sin_theta};
+	*pdf = max(xyz->y, 1e-6f) / (float)M_PI;
+}
+
+// Schlick's approximation of the Fresnel reflectance, with the fifth power as multiplications rather than powf.
+float fresnel_schlick(float r0, float cosine) {
+	float c = 1 - cosine;
+	float c2 = c * c;
+	return r0 + (1 - r0) * (c2 * c2 * c);
+}
+
+// Vertex attribute compression. Octahedral encoding projects a direction onto the octahedron |x| + |y| + |z| = 1 and
+// folds the lower half over the diagonals, so two components cover the sphere with an even error. The inputs need not
+// be unit length, a zero vector encodes as +z. Packet forms take and return components.
+template <typename FLOATX>
+void octahedral_encode(FLOATX x, FLOATX y, FLOATX z, FLOATX* u, FLOATX* v) {
+	using std::abs;
+	auto c = [](float f) { return floatx_set1<FLOATX>(f); };
+	FLOATX inv_l1 = c(1) / max(abs(x) + abs(y) + abs(z), c(FLT_MIN));
+	FLOATX px = x * inv_l1;
+	FLOATX py = y * inv_l1;
+	FLOATX fold_x = (c(1) - abs(py)) * select(px >= c(0), c(1), c(-1));
+	FLOATX fold_y = (c(1) - abs(px)) * select(py >= c(0), c(1), c(-1));
+	*u = select(z < c(0), fold_x, px);
+	*v = select(z < c(0), fold_y, py);
+}
+
+// Unit length results.
+template <typename FLOATX>
+void octahedral_decode(FLOATX u, FLOATX v, FLOATX* x, FLOATX* y, FLOATX* z) {
+	using std::abs;
+	using std::sqrt;
+	auto c = [](float f) { return floatx_set1<FLOATX>(f); };
+	FLOATX nz = c(1) - abs(u) - abs(v);
+	FLOATX t = max(-nz, c(0));
+	FLOATX nx = u + select(u >= c(0), -t, t);
+	FLOATX ny = v + select(v >= c(0), -t, t);
+	FLOATX inv_len = c(1) / sqrt(nx * nx + ny * ny + nz * nz);
+	*x = nx * inv_len;
+	*y = ny * inv_len;
+	*z = nz * inv_len;
+}
+
+vec2 octahedral_encode(vec3 n) {
+	vec2 e;
+	octahedral_encode(n.x, n.y, n.z, &e.x, &e.y);
+	return e;
+}
+
+vec3 octahedral_decode(vec2 e) {
+	vec3 n;
+	octahedral_decode(e.x, e.y, &n.x, &n.y, &n.z);
+	return n;
+}
+
+// IEEE half precision conversions in integer ops, F16C is not guaranteed alongside AVX. Rounds to nearest even,
+// overflows to infinity and keeps NaNs NaN, denormals included. Packet lanes hold one half each in their low 16 bits.
+__m128i half_from_float(floatx4 f) {
+	__m128i bits = _mm_castps_si128(f.v);
+	__m128i sign = _mm_and_si128(bits, _mm_set1_epi32(INT32_MIN));
+	__m128i a = _mm_xor_si128(bits, sign);
+	__m128i inf_nan = _mm_or_si128(_mm_set1_epi32(0x7c00), _mm_and_si128(_mm_cmpgt_epi32(a, _mm_set1_epi32(0x7f800000)), _mm_set1_epi32(0x200)));
+	__m128i denormal_magic = _mm_set1_epi32((127 - 15 + 23 - 10 + 1) << 23);
+	__m128i denormal = _mm_sub_epi32(_mm_castps_si128(_mm_add_ps(_mm_castsi128_ps(a), _mm_castsi128_ps(denormal_magic))), denormal_magic);
+	__m128i odd = _mm_and_si128(_mm_srli_epi32(a, 13), _mm_set1_epi32(1));
+	__m128i normal = _mm_srli_epi32(_mm_add_epi32(_mm_add_epi32(a, _mm_set1_epi32(((15 - 127) << 23) + 0xfff)), odd), 13);
+	__m128i is_inf_nan = _mm_cmpgt_epi32(a, _mm_set1_epi32(((127 + 16) << 23) - 1));
+	__m128i is_denormal = _mm_cmplt_epi32(a, _mm_set1_epi32(113 << 23));
+	__m128i h = _mm_or_si128(_mm_and_si128(is_denormal, denormal), _mm_andnot_si128(is_denormal, normal));
+	h = _mm_or_si128(_mm_and_si128(is_inf_nan, inf_nan), _mm_andnot_si128(is_inf_nan, h));
+	return _mm_or_si128(h, _mm_srli_epi32(sign, 16));
+}
+
+floatx4 float_from_half(__m128i h) {
+	__m128i magnitude = _mm_slli_epi32(_mm_and_si128(h, _mm_set1_epi32(0x7fff)), 13);
+	__m128 f = _mm_mul_ps(_mm_castsi128_ps(magnitude), _mm_castsi128_ps(_mm_set1_epi32((254 - 15) << 23)));
+	__m128i is_inf_nan = _mm_cmpgt_epi32(magnitude, _mm_set1_epi32((0x7c00 << 13) - 1));
+	__m128i bits = _mm_or_si128(_mm_castps_si128(f), _mm_and_si128(is_inf_nan, _mm_set1_epi32(0x7f800000)));
+	bits = _mm_or_si128(bits, _mm_slli_epi32(_mm_and_si128(h, _mm_set1_epi32(0x8000)), 16));
+	return floatx4{_mm_castsi128_ps(bits)};
+}
+
+uint16 half_from_float(float f) {
+	return (uint16)_mm_cvtsi128_si32(half_from_float(floatx4{_mm_set_ss(f)}));
+}
+
+float float_from_half(uint16 h) {
+	return _mm_cvtss_f32(float_from_half(_mm_cvtsi32_si128(h)).v);
+}
+
+// Space filling curve keys for sorting by locality, 2d keys over 16 bit coordinates and 3d keys over 10 bit (30 bit
+// keys) or 21 bit (63 bit keys) coordinates. Morton keys interleave the coordinate bits with x in the lowest bit,
+// Hilbert keys follow a curve whose consecutive cells are always neighbors. Coordinate bits past the key width are
+// ignored. The _bmi2 forms use pdep/pext, which need BMI2 at runtime (implied by simd_isa_avx2 and up) and are slow
+// microcode on AMD before Zen 3.
+#if defined(_MSC_VER) || defined(__BMI2__)
+#define MATH_BMI2 1
+#endif
+
+uint32 morton_spread2(uint32 x) {
+	x &= 0xffff;
+	x = (x | (x << 8)) & 0x00ff00ff;
+	x = (x | (x << 4)) & 0x0f0f0f0f;
+	x = (x | (x << 2)) & 0x33333333;
+	x = (x | (x << 1)) & 0x55555555;
+	return x;
+}
+
+uint32 morton_compact2(uint32 x) {
+	x &= 0x55555555;
+	x = (x ^ (x >> 1)) & 0x33333333;
+	x = (x ^ (x >> 2)) & 0x0f0f0f0f;
+	x = (x ^ (x >> 4)) & 0x00ff00ff;
+	x = (x ^ (x >> 8)) & 0x0000ffff;
+	return x;
+}
+
+uint32 morton_spread3(uint32 x) {
+	x &= 0x3ff;
+	x = (x | (x << 16)) & 0x030000ff;
+	x = (x | (x << 8)) & 0x0300f00f;
+	x = (x | (x << 4)) & 0x030c30c3;
+	x = (x | (x << 2)) & 0x09249249;
+	return x;
+}
+
+uint32 morton_compact3(uint32 x) {
+	x &= 0x09249249;
+	x = (x ^ (x >> 2)) & 0x030c30c3;
+	x = (x ^ (x >> 4)) & 0x0300f00f;
+	x = (x ^ (x >> 8)) & 0x030000ff;
+	x = (x ^ (x >> 16)) & 0x000003ff;
+	return x;
+}
+
+uint64 morton_spread3(uint64 x) {
+	x &= 0x1fffff;
+	x = (x | (x << 32)) & 0x001f00000000ffffull;
+	x = (x | (x << 16)) & 0x001f0000ff0000ffull;
+	x = (x | (x << 8)) & 0x100f00f00f00f00full;
+	x = (x | (x << 4)) & 0x10c30c30c30c30c3ull;
+	x = (x | (x << 2)) & 0x1249249249249249ull;
+	return x;
+}
+
+uint64 morton_compact3(uint64 x) {
+	x &= 0x1249249249249249ull;
+	x = (x ^ (x >> 2)) & 0x10c30c30c30c30c3ull;
+	x = (x ^ (x >> 4)) & 0x100f00f00f00f00full;
+	x = (x ^ (x >> 8)) & 0x001f0000ff0000ffull;
+	x = (x ^ (x >> 16)) & 0x001f00000000ffffull;
+	x = (x ^ (x >> 32)) & 0x00000000001fffffull;
+	return x;
+}
+
+uint32 morton2d_encode(uint32 x, uint32 y) {
+	return morton_spread2(x) | (morton_spread2(y) << 1);
+}
+
+void morton2d_decode(uint32 key, uint32* x, uint32* y) {
+	*x = morton_compact2(key);
+	*y = morton_compact2(key >> 1);
+}
+
+uint32 morton3d_encode(uint32 x, uint32 y, uint32 z) {
+	return morton_spread3(x) | (morton_spread3(y) << 1) | (morton_spread3(z) << 2);
+}
+
+void morton3d_decode(uint32 key, uint32* x, uint32* y, uint32* z) {
+	*x = morton_compact3(key);
+	*y = morton_compact3(key >> 1);
+	*z = morton_compact3(key >> 2);
+}
+
+uint64 morton3d_encode64(uint32 x, uint32 y, uint32 z) {
+	return morton_spread3((uint64)x) | (morton_spread3((uint64)y) << 1) | (morton_spread3((uint64)z) << 2);
+}
+
+void morton3d_decode64(uint64 key, uint32* x, uint32* y, uint32* z) {
+	*x = (uint32)morton_compact3(key);
+	*y = (uint32)morton_compact3(key >> 1);
+	*z = (uint32)morton_compact3(key >> 2);
+}
+
+#ifdef MATH_BMI2
+
+uint32 morton2d_encode_bmi2(uint32 x, uint32 y) {
+	return _pdep_u32(x, 0x55555555) | _pdep_u32(y, 0xaaaaaaaa);
+}
+
+void morton2d_decode_bmi2(uint32 key, uint32* x, uint32* y) {
+	*x = _pext_u32(key, 0x55555555);
+	*y = _pext_u32(key, 0xaaaaaaaa);
+}
+
+uint32 morton3d_encode_bmi2(uint32 x, uint32 y, uint32 z) {
+	return _pdep_u32(x, 0x09249249) | _pdep_u32(y, 0x12492492) | _pdep_u32(z, 0x24924924);
+}
+
+void morton3d_decode_bmi2(uint32 key, uint32* x, uint32* y, uint32* z) {
+	*x = _pext_u32(key, 0x09249249);
+	*y = _pext_u32(key, 0x12492492);
+	*z = _pext_u32(key, 0x24924924);
+}
+
+uint64 morton3d_encode64_bmi2(uint32 x, uint32 y, uint32 z) {
+	return _pdep_u64(x, 0x1249249249249249ull) | _pdep_u64(y, 0x2492492492492492ull) | _pdep_u64(z, 0x4924924924924924ull);
+}
+
+void morton3d_decode64_bmi2(uint64 key, uint32* x, uint32* y, uint32* z) {
+	*x = (uint32)_pext_u64(key, 0x1249249249249249ull);
+	*y = (uint32)_pext_u64(key, 0x2492492492492492ull);
+	*z = (uint32)_pext_u64(key, 0x4924924924924924ull);
+}
+
+#endif // MATH_BMI2
+
+uint32 hilbert2d_encode(uint32 x, uint32 y) {
+	uint32 key = 0;
+	for (uint32 s = 1u << 15; s > 0; s >>= 1) {
+		uint32 rx = (x & s) ? 1 : 0;
+		uint32 ry = (y & s) ? 1 : 0;
+		key += s * s * ((3 * rx) ^ ry);
+		uint32 flip = 0 - (rx & (ry ^ 1));
+		uint32 swap = (x ^ y) & (0 - (ry ^ 1));
+		x ^= flip ^ swap;
+		y ^= flip ^ swap;
+	}
+	return key;
+}
+
+// Skilling's transform ("Programming the Hilbert curve", 2004), it leaves the Hilbert key of the cell spread across
+// the coordinates with the most significant bit of each 3 bit group in x. Branchless, the branches on coordinate
+// bits mispredict about half the time on unsorted input.
+void hilbert3d_transpose(uint32 bits, uint32* x, uint32* y, uint32* z) {
+	uint32 c[3] = {*x & ((1u << bits) - 1), *y & ((1u << bits) - 1), *z & ((1u << bits) - 1)};
+	for (uint32 q = 1u << (bits - 1); q > 1; q >>= 1) {
+		uint32 p = q - 1;
+		for (uint32 i = 0; i < 3; i += 1) {
+			uint32 set = 0 - (uint32)((c[i] & q) != 0);
+			uint32 t = (c[0] ^ c[i]) & p & ~set;
+			c[0] ^= (p & set) | t;
+			c[i] ^= t;
+		}
+	}
+	c[1] ^= c[0];
+	c[2] ^= c[1];
+	uint32 t = 0;
+	for (uint32 q = 1u << (bits - 1); q > 1; q >>= 1) {
+		t ^= (q - 1) & (0 - (uint32)((c[2] & q) != 0));
+	}
+	*x = c[0] ^ t;
+	*y = c[1] ^ t;
+	*z = c[2] ^ t;
+}
+
+uint32 hilbert3d_encode(uint32 x, uint32 y, uint32 z) {
+	hilbert3d_transpose(10, &x, &y, &z);
+	return morton3d_encode(z, y, x);
+}
+
+uint64 hilbert3d_encode64(uint32 x, uint32 y, uint32 z) {
+	hilbert3d_transpose(21, &x, &y, &z);
+	return morton3d_encode64(z, y, x);
+}
+
+// Keys of positions quantized to 2^bits cells along each axis of bound, positions outside are clamped to the border
+// cells. 4 positions are quantized at a time, a partial last group goes through a padded copy.
+template <typename KEY, typename ENCODE>
+void spatial_keys(const vec3* positions, uint32 count, aabb bound, uint32 bits, KEY* keys, ENCODE encode) {
+	vec3 extent = bound.max - bound.min;
+	float cells = (float)(1u << bits);
+	vec3x4 scale = vec3x4_set1({extent.x > 0 ? cells / extent.x : 0, extent.y > 0 ? cells / extent.y : 0, extent.z > 0 ? cells / extent.z : 0});
+	vec3x4 origin = vec3x4_set1(bound.min);
+	floatx4 zero = floatx4_set1(0);
+	floatx4 last_cell = floatx4_set1(cells - 1);
+	auto quantize = [&](vec3x4 p, uint32 n, KEY* k) {
+		p = (p - origin) * scale;
+		alignas(16) int32 cell[3][4];
+		_mm_store_si128((__m128i*)cell[0], _mm_cvttps_epi32(min(max(p.x, zero), last_cell).v));
+		_mm_store_si128((__m128i*)cell[1], _mm_cvttps_epi32(min(max(p.y, zero), last_cell).v));
+		_mm_store_si128((__m128i*)cell[2], _mm_cvttps_epi32(min(max(p.z, zero), last_cell).v));
+		for (uint32 i = 0; i < n; i += 1) {
+			k[i] = encode((uint32)cell[0][i], (uint32)cell[1][i], (uint32)cell[2][i]);
+		}
+	};
+	uint32 i = 0;
+	for (; i + 4 <= count; i += 4) {
+		quantize(vec3x4_load(positions + i), 4, keys + i);
+	}
+	if (i < count) {
+		vec3 tail[4];
+		for (uint32 j = 0; j < 4; j += 1) {
+			tail[j] = positions[min(i + j, count - 1)];
+		}
+		quantize(vec3x4_load(tail), count - i, keys + i);
+	}
+}
+
+void morton3d_keys(const vec3* positions, uint32 count, aabb bound, uint32* keys) {
+	spatial_keys(positions, count, bound, 10, keys, morton3d_encode);
+}
+
+void morton3d_keys64(const vec3* positions, uint32 count, aabb bound, uint64* keys) {
+	spatial_keys(positions, count, bound, 21, keys, morton3d_encode64);
+}
+
+void hilbert3d_keys(const vec3* positions, uint32 count, aabb bound, uint32* keys) {
+	spatial_keys(positions, count, bound, 10, keys, hilbert3d_encode);
+}
+
+void hilbert3d_keys64(const vec3* positions, uint32 count, aabb bound, uint64* keys) {
+	spatial_keys(positions, count, bound, 21, keys, hilbert3d_encode64);
+}
+
+#ifdef MATH_BMI2
+
+void morton3d_keys_bmi2(const vec3* positions, uint32 count, aabb bound, uint32* keys) {
+	spatial_keys(positions, count, bound, 10, keys, morton3d_encode_bmi2);
+}
+
+void morton3d_keys64_bmi2(const vec3* positions, uint32 count, aabb bound, uint64* keys) {
+	spatial_keys(positions, count, bound, 21, keys, morton3d_encode64_bmi2);
+}
+
+#endif // MATH_BMI2
+
+// Wide slab tests for BVH traversal, one ray against a packet of boxes or a packet of rays against one box. They do the
+// same operations in the same order as the scalar ray_hit_aabb(ray_precomputed), max and min keep their second operand
+// for NaN inputs, so every lane agrees with the scalar test bit for bit.
+template <typename FLOATX, typename PLANE, typename ORIGIN, typename INV_DIR>
+void ray_slab(PLANE near_plane, PLANE far_plane, ORIGIN origin, INV_DIR inv_dir, FLOATX* t0, FLOATX* t1) {
+	*t0 = max((near_plane - origin) * inv_dir, *t0);
+	*t1 = min((far_plane - origin) * inv_dir, *t1);
+}
+
+template <typename MASKX, typename FLOATX, typename AABBX>
+MASKX ray_hit_aabbs(const ray_precomputed& ray, const AABBX& bounds, FLOATX* hit) {
+	const decltype(bounds.min)* planes = &bounds.min;
+	FLOATX t0 = floatx_set1<FLOATX>(0);
+	FLOATX t1 = floatx_set1<FLOATX>(ray.len);
+	ray_slab(planes[ray.sign[0]].x, planes[1 - ray.sign[0]].x, ray.origin.x, ray.inv_dir.x, &t0, &t1);
+	ray_slab(planes[ray.sign[1]].y, planes[1 - ray.sign[1]].y, ray.origin.y, ray.inv_dir.y, &t0, &t1);
+	ray_slab(planes[ray.sign[2]].z, planes[1 - ray.sign[2]].z, ray.origin.z, ray.inv_dir.z, &t0, &t1);
+	if (hit) {
+		*hit = t0;
+	}
+	return t0 <= t1;
+}
+
+template <typename MASKX, typename FLOATX, typename RAYX>
+MASKX rays_hit_aabb(const RAYX& rays, aabb bound, FLOATX* hit) {
+	FLOATX t0 = floatx_set1<FLOATX>(0);
+	FLOATX t1 = rays.len;
+	FLOATX min_x = floatx_set1<FLOATX>(bound.min.x), min_y = floatx_set1<FLOATX>(bound.min.y), min_z = floatx_set1<FLOATX>(bound.min.z);
+	FLOATX max_x = floatx_set1<FLOATX>(bound.max.x), max_y = floatx_set1<FLOATX>(bound.max.y), max_z = floatx_set1<FLOATX>(bound.max.z);
+	ray_slab(select(rays.sign[0], max_x, min_x), select(rays.sign[0], min_x, max_x), rays.origin.x, rays.inv_dir.x, &t0, &t1);
+	ray_slab(select(rays.sign[1], max_y, min_y), select(rays.sign[1], min_y, max_y), rays.origin.y, rays.inv_dir.y, &t0, &t1);
+	ray_slab(select(rays.sign[2], max_z, min_z), select(rays.sign[2], min_z, max_z), rays.origin.z, rays.inv_dir.z, &t0, &t1);
+	if (hit) {
+		*hit = t0;
+	}
+	return t0 <= t1;
+}
+
+struct aabbx4 {
+	vec3x4 min;
+	vec3x4 max;
+};
+
+aabbx4 aabbx4_load(const aabb* bounds) {
+	aabbx4 result;
+	result.min.x.v = _mm_setr_ps(bounds[0].min.x, bounds[1].min.x, bounds[2].min.x, bounds[3].min.x);
+	result.min.y.v = _mm_setr_ps(bounds[0].min.y, bounds[1].min.y, bounds[2].min.y, bounds[3].min.y);
+	result.min.z.v = _mm_setr_ps(bounds[0].min.z, bounds[1].min.z, bounds[2].min.z, bounds[3].min.z);
+	result.max.x.v = _mm_setr_ps(bounds[0].max.x, bounds[1].max.x, bounds[2].max.x, bounds[3].max.x);
+	result.max.y.v = _mm_setr_ps(bounds[0].max.y, bounds[1].max.y, bounds[2].max.y, bounds[3].max.y);
+	result.max.z.v = _mm_setr_ps(bounds[0].max.z, bounds[1].max.z, bounds[2].max.z, bounds[3].max.z);
+	return result;
+}
+
+struct ray_precomputedx4 {
+	vec3x4 origin;
+	vec3x4 inv_dir;
+	floatx4 len;
+	maskx4 sign[3];
+};
+
+ray_precomputedx4 ray_precomputedx4_load(const ray* rays) {
+	ray_precomputedx4 result;
+	vec3 origins[4] = {rays[0].origin, rays[1].origin, rays[2].origin, rays[3].origin};
+	vec3 dirs[4] = {rays[0].dir, rays[1].dir, rays[2].dir, rays[3].dir};
+	vec3x4 dir = vec3x4_load(dirs);
+	result.origin = vec3x4_load(origins);
+	result.inv_dir = vec3x4{floatx4_set1(1) / dir.x, floatx4_set1(1) / dir.y, floatx4_set1(1) / dir.z};
+	result.len.v = _mm_setr_ps(rays[0].len, rays[1].len, rays[2].len, rays[3].len);
+	result.sign[0].v = _mm_castsi128_ps(_mm_srai_epi32(_mm_castps_si128(dir.x.v), 31));
+	result.sign[1].v = _mm_castsi128_ps(_mm_srai_epi32(_mm_castps_si128(dir.y.v), 31));
+	result.sign[2].v = _mm_castsi128_ps(_mm_srai_epi32(_mm_castps_si128(dir.z.v), 31));
+	return result;
+}
+
+maskx4 ray_hit_aabb(const ray_precomputed& ray, const aabbx4& bounds, floatx4* hit = nullptr) {
+	return ray_hit_aabbs<maskx4>(ray, bounds, hit);
+}
+
+maskx4 ray_hit_aabb(const ray_precomputedx4& rays, aabb bound, floatx4* hit = nullptr) {
+	return rays_hit_aabb<maskx4>(rays, bound, hit);
+}
+
+#ifdef MATH_AVX
+
+struct aabbx8 {
+	vec3x8 min;
+	vec3x8 max;
+};
+
+aabbx8 aabbx8_load(const aabb* bounds) {
+	aabbx4 lo = aabbx4_load(bounds);
+	aabbx4 hi = aabbx4_load(bounds + 4);
+	aabbx8 result;
+	result.min.x.v = _mm256_insertf128_ps(_mm256_castps128_ps256(lo.min.x.v), hi.min.x.v, 1);
+	result.min.y.v = _mm256_insertf128_ps(_mm256_castps128_ps256(lo.min.y.v), hi.min.y.v, 1);
+	result.min.z.v = _mm256_insertf128_ps(_mm256_castps128_ps256(lo.min.z.v), hi.min.z.v, 1);
+	result.max.x.v = _mm256_insertf128_ps(_mm256_castps128_ps256(lo.max.x.v), hi.max.x.v, 1);
+	result.max.y.v = _mm256_insertf128_ps(_mm256_castps128_ps256(lo.max.y.v), hi.max.y.v, 1);
+	result.max.z.v = _mm256_insertf128_ps(_mm256_castps128_ps256(lo.max.z.v), hi.max.z.v, 1);
+	return result;
+}
+
+struct ray_precomputedx8 {
+	vec3x8 origin;
+	vec3x8 inv_dir;
+	floatx8 len;
+	maskx8 sign[3];
+};
+
+ray_precomputedx8 ray_precomputedx8_load(const ray* rays) {
+	ray_precomputedx4 lo = ray_precomputedx4_load(rays);
+	ray_precomputedx4 hi = ray_precomputedx4_load(rays + 4);
+	auto combine = [](__m128 a, __m128 b) { return _mm256_insertf128_ps(_mm256_castps128_ps256(a), b, 1); };
+	ray_precomputedx8 result;
+	result.origin = vec3x8{{combine(lo.origin.x.v, hi.origin.x.v)}, {combine(lo.origin.y.v, hi.origin.y.v)}, {combine(lo.origin.z.v, hi.origin.z.v)}};
+	result.inv_dir = vec3x8{{combine(lo.inv_dir.x.v, hi.inv_dir.x.v)}, {combine(lo.inv_dir.y.v, hi.inv_dir.y.v)}, {combine(lo.inv_dir.z.v, hi.inv_dir.z.v)}};
+	result.len.v = combine(lo.len.v, hi.len.v);
+	for (uint32 i = 0; i < 3; i += 1) {
+		result.sign[i].v = combine(lo.sign[i].v, hi.sign[i].v);
+	}
+	return result;
+}
+
+maskx8 ray_hit_aabb(const ray_precomputed& ray, const aabbx8& bounds, floatx8* hit = nullptr) {
+	return ray_hit_aabbs<maskx8>(ray, bounds, hit);
+}
+
+maskx8 ray_hit_aabb(const ray_precomputedx8& rays, aabb bound, floatx8* hit = nullptr) {
+	return rays_hit_aabb<maskx8>(rays, bound, hit);
+}
+
+#endif // MATH_AVX
+
+// Wide frustum_intersect_aabb, lanes agree with the scalar test. Each plane picks its furthest corner once for the
+// whole packet, the same way ray_hit_aabbs picks slab planes from the ray direction signs.
+template <typename MASKX, typename FLOATX, typename AABBX>
+MASKX frustum_intersect_aabbs(const frustum& frustum, const AABBX& bounds) {
+	const decltype(bounds.min)* corners = &bounds.min;
+	MASKX inside = floatx_set1<FLOATX>(0) == floatx_set1<FLOATX>(0);
+	for (const plane& plane : frustum.planes) {
+		FLOATX d = corners[plane.normal.x >= 0].x * plane.normal.x + corners[plane.normal.y >= 0].y * plane.normal.y + corners[plane.normal.z >= 0].z * plane.normal.z;
+		inside &= d >= floatx_set1<FLOATX>(plane.distance);
+	}
+	return inside;
+}
+
+// Writes the indices of the bounds intersecting the frustum to visible_indices in ascending order and returns how
+// many there are. The last partial packet is padded with copies of the last bound and its extra lanes dropped.
+template <uint32 LANE_COUNT, typename MASKX, typename FLOATX, typename AABBX, typename LOAD>
+uint32 frustum_cull_aabbs(const frustum& frustum, const aabb* bounds, uint32 count, uint32* visible_indices, LOAD load) {
+	uint32 visible_count = 0;
+	for (uint32 i = 0; i < count; i += LANE_COUNT) {
+		uint32 bits = 0;
+		if (count - i >= LANE_COUNT) {
+			bits = mask_bits(frustum_intersect_aabbs<MASKX, FLOATX>(frustum, load(bounds + i)));
+		}
+		else {
+			aabb tail[LANE_COUNT];
+			for (uint32 j = 0; j < LANE_COUNT; j += 1) {
+				tail[j] = bounds[min(i + j, count - 1)];
+			}
+			bits = mask_bits(frustum_intersect_aabbs<MASKX, FLOATX>(frustum, load(tail))) & ((1u << (count - i)) - 1);
+		}
+		while (bits) {
+			visible_indices[visible_count] = i + count_trailing_zeros(bits);
+			visible_count += 1;
+			bits &= bits - 1;
+		}
+	}
+	return visible_count;
+}
+
+maskx4 frustum_intersect_aabb(const frustum& frustum, const aabbx4& bounds) {
+	return frustum_intersect_aabbs<maskx4, floatx4>(frustum, bounds);
+}
+
+uint32 frustum_cull_aabbs(const frustum& frustum, const aabb* bounds, uint32 count, uint32* visible_indices) {
+	return frustum_cull_aabbs<4, maskx4, floatx4, aabbx4>(frustum, bounds, count, visible_indices, aabbx4_load);
+}
+
+#ifdef MATH_AVX
+
+maskx8 frustum_intersect_aabb(const frustum& frustum, const aabbx8& bounds) {
+	return frustum_intersect_aabbs<maskx8, floatx8>(frustum, bounds);
+}
+
+uint32 frustum_cull_aabbs_avx(const frustum& frustum, const aabb* bounds, uint32 count, uint32* visible_indices) {
+	return frustum_cull_aabbs<8, maskx8, floatx8, aabbx8>(frustum, bounds, count, visible_indices, aabbx8_load);
+}
+
+#endif // MATH_AVX
+
+// Triangles in SoA packets for testing one ray against several at once. trianglex4/x8 keep the first vertex and the two
+// edges for Moller-Trumbore. The watertight packets keep the vertices themselves, shared edges of neighbouring
+// triangles must come out of the exact same vertex values for the test to be watertight.
+struct trianglex4 {
+	vec3x4 a;
+	vec3x4 e1;
+	vec3x4 e2;
+};
+
+struct trianglex4_watertight {
+	vec3x4 a;
+	vec3x4 b;
+	vec3x4 c;
+};
+
+// Packs triangle_count triangles (3 vertices each) into packets of LANE_COUNT, the last packet is padded with
+// triangles which never hit. Returns the packet count. Moller-Trumbore padding has zero edges and fails on its zero
+// determinant. Watertight padding has NaN vertices, whose edge functions fail every comparison, zero vertices there
+// would give exactly zero edge functions and send the whole packet through the double precision recompute.
+template <uint32 LANE_COUNT, typename TRIANGLEX, typename LOAD>
+uint32 triangle_pack(const vec3* vertices, uint32 triangle_count, TRIANGLEX* dst, LOAD load, bool edges) {
+	uint32 packet_count = (triangle_count + LANE_COUNT - 1) / LANE_COUNT;
+	for (uint32 i = 0; i < packet_count; i += 1) {
+		vec3 a[LANE_COUNT], b[LANE_COUNT], c[LANE_COUNT];
+		for (uint32 lane = 0; lane < LANE_COUNT; lane += 1) {
+			uint32 triangle = i * LANE_COUNT + lane;
+			if (triangle < triangle_count) {
+				a[lane] = vertices[triangle * 3];
+				b[lane] = vertices[triangle * 3 + 1];
+				c[lane] = vertices[triangle * 3 + 2];
+			}
+			else {
+				a[lane] = b[lane] = c[lane] = edges ? vec3{0, 0, 0} : vec3{NAN, NAN, NAN};
+			}
+			if (edges) {
+				b[lane] = b[lane] - a[lane];
+				c[lane] = c[lane] - a[lane];
+			}
+		}
+		dst[i] = TRIANGLEX{load(a), load(b), load(c)};
+	}
+	return packet_count;
+}
+
+uint32 trianglex4_pack(const vec3* vertices, uint32 triangle_count, trianglex4* dst) {
+	return triangle_pack<4, trianglex4>(vertices, triangle_count, dst, vec3x4_load, true);
+}
+
+uint32 trianglex4_watertight_pack(const vec3* vertices, uint32 triangle_count, trianglex4_watertight* dst) {
+	return triangle_pack<4, trianglex4_watertight>(vertices, triangle_count, dst, vec3x4_load, false);
+}
+
+// Moller-Trumbore against every lane, culling back faces like ray_hit_triangle. t is the distance along ray.dir,
+// u and v are the barycentric weights of the second and third vertex.
+template <typename MASKX, typename FLOATX, typename VEC3X, typename TRIANGLEX>
+MASKX ray_hit_triangle_packet(const VEC3X& origin, const VEC3X& dir, FLOATX t_max, const TRIANGLEX& triangles, FLOATX* t, FLOATX* u, FLOATX* v) {
+	VEC3X p = vec3_cross(dir, triangles.e2);
+	FLOATX det = vec3_dot(triangles.e1, p);
+	FLOATX zero = floatx_set1<FLOATX>(0);
+	FLOATX inv_det = floatx_set1<FLOATX>(1) / det;
+	VEC3X s = origin - triangles.a;
+	*u = vec3_dot(s, p) * inv_det;
+	VEC3X q = vec3_cross(s, triangles.e1);
+	*v = vec3_dot(dir, q) * inv_det;
+	*t = vec3_dot(triangles.e2, q) * inv_det;
+	return (det > zero) & (*u >= zero) & (*v >= zero) & (*u + *v <= floatx_set1<FLOATX>(1)) & (*t >= zero) & (*t <= t_max);
+}
+
+// The ray in the space of the watertight test of Woop, Benthin and Wald, "Watertight Ray/Triangle Intersection": kz is
+// the dominant axis of the direction, and the shear makes the ray point down +z.
+struct ray_watertight {
+	vec3 origin;
+	uint32 kx, ky, kz;
+	float sx, sy, sz;
+	float len;
+};
+
+ray_watertight ray_watertight_precompute(ray ray) {
+	ray_watertight r;
+	r.origin = ray.origin;
+	r.len = ray.len;
+	vec3 abs_dir = {fabsf(ray.dir.x), fabsf(ray.dir.y), fabsf(ray.dir.z)};
+	r.kz = abs_dir.x > abs_dir.y ? (abs_dir.x > abs_dir.z ? 0 : 2) : (abs_dir.y > abs_dir.z ? 1 : 2);
+	r.kx = (r.kz + 1) % 3;
+	r.ky = (r.kx + 1) % 3;
+	if (ray.dir[r.kz] < 0) {
+		uint32 k = r.kx;
+		r.kx = r.ky;
+		r.ky = k;
+	}
+	r.sx = ray.dir[r.kx] / ray.dir[r.kz];
+	r.sy = ray.dir[r.ky] / ray.dir[r.kz];
+	r.sz = 1 / ray.dir[r.kz];
+	return r;
+}
+
+// Edge functions of the sheared triangle. When one comes out exactly 0 it is recomputed in double, so a ray through a
+// shared edge or vertex is never missed by both triangles.
+void ray_watertight_edge_functions(const ray_watertight& ray, vec3 a, vec3 b, vec3 c, float* u, float* v, float* w) {
+	float ax = a[ray.kx] - ray.sx * a[ray.kz], ay = a[ray.ky] - ray.sy * a[ray.kz];
+	float bx = b[ray.kx] - ray.sx * b[ray.kz], by = b[ray.ky] - ray.sy * b[ray.kz];
+	float cx = c[ray.kx] - ray.sx * c[ray.kz], cy = c[ray.ky] - ray.sy * c[ray.kz];
+	*u = cx * by - cy * bx;
+	*v = ax * cy - ay * cx;
+	*w = bx * ay - by * ax;
+	if (*u == 0 || *v == 0 || *w == 0) {
+		*u = (float)((double)cx * (double)by - (double)cy * (double)bx);
+		*v = (float)((double)ax * (double)cy - (double)ay * (double)cx);
+		*w = (float)((double)bx * (double)ay - (double)by * (double)ax);
+	}
+}
+
+// Scalar watertight test, front faces only like ray_hit_triangle. hit is the fraction of ray.len, barycentric_coord the
+// weights of a, b and c.
+bool ray_hit_triangle_watertight(const ray_watertight& ray, vec3 a, vec3 b, vec3 c, float* hit = nullptr, vec3* barycentric_coord = nullptr) {
+	a = a - ray.origin;
+	b = b - ray.origin;
+	c = c - ray.origin;
+	float u, v, w;
+	ray_watertight_edge_functions(ray, a, b, c, &u, &v, &w);
+	if (u < 0 || v < 0 || w < 0) {
+		return false;
+	}
+	float det = u + v + w;
+	if (det == 0) {
+		return false;
+	}
+	float t = (u * a[ray.kz] + v * b[ray.kz] + w * c[ray.kz]) * ray.sz;
+	if (t < 0 || t > ray.len * det) {
+		return false;
+	}
+	float inv_det = 1 / det;
+	if (hit) {
+		*hit = t * inv_det / ray.len;
+	}
+	if (barycentric_coord) {
+		*barycentric_coord = vec3{u * inv_det, v * inv_det, w * inv_det};
+	}
+	return true;
+}
+
+template <typename FLOATX, typename VEC3X>
+FLOATX vec3_component(const VEC3X& v, uint32 i) {
+	return i == 0 ? v.x : (i == 1 ? v.y : v.z);
+}
+
+template <typename MASKX, typename FLOATX, typename VEC3X, typename TRIANGLEX>
+MASKX ray_hit_triangle_watertight_packet(const ray_watertight& ray, const VEC3X& origin, FLOATX t_max, const TRIANGLEX& triangles, FLOATX* t, FLOATX* u, FLOATX* v) {
+	VEC3X a = triangles.a - origin;
+	VEC3X b = triangles.b - origin;
+	VEC3X c = triangles.c - origin;
+	FLOATX az = vec3_component<FLOATX>(a, ray.kz), bz = vec3_component<FLOATX>(b, ray.kz), cz = vec3_component<FLOATX>(c, ray.kz);
+	FLOATX ax = vec3_component<FLOATX>(a, ray.kx) - az * ray.sx, ay = vec3_component<FLOATX>(a, ray.ky) - az * ray.sy;
+	FLOATX bx = vec3_component<FLOATX>(b, ray.kx) - bz * ray.sx, by = vec3_component<FLOATX>(b, ray.ky) - bz * ray.sy;
+	FLOATX cx = vec3_component<FLOATX>(c, ray.kx) - cz * ray.sx, cy = vec3_component<FLOATX>(c, ray.ky) - cz * ray.sy;
+	FLOATX eu = cx * by - cy * bx;
+	FLOATX ev = ax * cy - ay * cx;
+	FLOATX ew = bx * ay - by * ax;
+	FLOATX zero = floatx_set1<FLOATX>(0);
+	if (mask_any((eu == zero) | (ev == zero) | (ew == zero))) {
+		// rare, only for rays through edges or vertices, redo every lane in double like the scalar test
+		const uint32 lane_count = FLOATX::lane_count;
+		alignas(32) float e[9][lane_count];
+		FLOATX* values[9] = {&ax, &ay, &bx, &by, &cx, &cy, &eu, &ev, &ew};
+		for (uint32 i = 0; i < 9; i += 1) {
+			memcpy(e[i], values[i], sizeof(FLOATX));
+		}
+		for (uint32 lane = 0; lane < lane_count; lane += 1) {
+			double dax = e[0][lane], day = e[1][lane], dbx = e[2][lane], dby = e[3][lane], dcx = e[4][lane], dcy = e[5][lane];
+			e[6][lane] = (float)(dcx * dby - dcy * dbx);
+			e[7][lane] = (float)(dax * dcy - day * dcx);
+			e[8][lane] = (float)(dbx * day - dby * dax);
+		}
+		memcpy(&eu, e[6], sizeof(FLOATX));
+		memcpy(&ev, e[7], sizeof(FLOATX));
+		memcpy(&ew, e[8], sizeof(FLOATX));
+	}
+	FLOATX det = eu + ev + ew;
+	FLOATX tt = (eu * az + ev * bz + ew * cz) * ray.sz;
+	FLOATX inv_det = floatx_set1<FLOATX>(1) / det;
+	*t = tt * inv_det;
+	*u = ev * inv_det;
+	*v = ew * inv_det;
+	return (eu >= zero) & (ev >= zero) & (ew >= zero) & (det != zero) & (tt >= zero) & (tt <= t_max * det);
+}
+
+// Nearest front facing hit over packet_count packets. The search interval shrinks to the nearest hit so far, and the
+// lowest triangle index wins ties. hit is the fraction of ray.len and barycentric_coord the weights of the three
+// vertices, as in ray_hit_triangle. Returns false when nothing is hit.
+template <typename MASKX, typename FLOATX, typename VEC3X, typename TRIANGLEX, typename KERNEL>
+bool ray_hit_triangles_nearest(ray ray, const TRIANGLEX* triangles, uint32 packet_count, float* hit, uint32* triangle_index, vec3* barycentric_coord, KERNEL kernel) {
+	const uint32 lane_count = FLOATX::lane_count;
+	VEC3X origin = vec3x_set1<VEC3X>(ray.origin);
+	VEC3X dir = vec3x_set1<VEC3X>(ray.dir);
+	FLOATX infinity = floatx_set1<FLOATX>(INFINITY);
+	float nearest = INFINITY;
+	FLOATX t_max = floatx_set1<FLOATX>(ray.len);
+	uint32 nearest_index = UINT32_MAX;
+	float nearest_u = 0, nearest_v = 0;
+	for (uint32 i = 0; i < packet_count; i += 1) {
+		FLOATX t, u, v;
+		MASKX mask = kernel(origin, dir, t_max, triangles[i], &t, &u, &v);
+		if (!mask_any(mask)) {
+			continue;
+		}
+		FLOATX t_masked = select(mask, t, infinity);
+		float t_min = reduce_min(t_masked);
+		if (t_min < nearest) {
+			uint32 lane = count_trailing_zeros(mask_bits(t_masked == floatx_set1<FLOATX>(t_min)));
+			nearest = t_min;
+			nearest_index = i * lane_count + lane;
+			alignas(32) float us[lane_count], vs[lane_count];
+			memcpy(us, &u, sizeof(FLOATX));
+			memcpy(vs, &v, sizeof(FLOATX));
+			nearest_u = us[lane];
+			nearest_v = vs[lane];
+			t_max = floatx_set1<FLOATX>(t_min);
+		}
+	}
+	if (nearest_index == UINT32_MAX) {
+		return false;
+	}
+	if (hit) {
+		*hit = nearest / ray.len;
+	}
+	if (triangle_index) {
+		*triangle_index = nearest_index;
+	}
+	if (barycentric_coord) {
+		*barycentric_coord = vec3{1 - nearest_u - nearest_v, nearest_u, nearest_v};
+	}
+	return true;
+}
+
+bool ray_hit_triangles(ray ray, const trianglex4* triangles, uint32 packet_count, float* hit = nullptr, uint32* triangle_index = nullptr, vec3* barycentric_coord = nullptr) {
+	return ray_hit_triangles_nearest<maskx4, floatx4, vec3x4>(ray, triangles, packet_count, hit, triangle_index, barycentric_coord,
+		[](const vec3x4& origin, const vec3x4& dir, floatx4 t_max, const trianglex4& t, floatx4* tt, floatx4* u, floatx4* v) {
+			return ray_hit_triangle_packet<maskx4>(origin, dir, t_max, t, tt, u, v);
+		});
+}
+
+bool ray_hit_triangles_watertight(ray ray, const trianglex4_watertight* triangles, uint32 packet_count, float* hit = nullptr, uint32* triangle_index = nullptr, vec3* barycentric_coord = nullptr) {
+	ray_watertight r = ray_watertight_precompute(ray);
+	return ray_hit_triangles_nearest<maskx4, floatx4, vec3x4>(ray, triangles, packet_count, hit, triangle_index, barycentric_coord,
+		[&r](const vec3x4& origin, const vec3x4&, floatx4 t_max, const trianglex4_watertight& t, floatx4* tt, floatx4* u, floatx4* v) {
+			return ray_hit_triangle_watertight_packet<maskx4>(r, origin, t_max, t, tt, u, v);
+		});
+}
+
+#ifdef MATH_AVX
+
+struct trianglex8 {
+	vec3x8 a;
+	vec3x8 e1;
+	vec3x8 e2;
+};
+
+struct trianglex8_watertight {
+	vec3x8 a;
+	vec3x8 b;
+	vec3x8 c;
+};
+
+uint32 trianglex8_pack(const vec3* vertices, uint32 triangle_count, trianglex8* dst) {
+	return triangle_pack<8, trianglex8>(vertices, triangle_count, dst, vec3x8_load, true);
+}
+
+uint32 trianglex8_watertight_pack(const vec3* vertices, uint32 triangle_count, trianglex8_watertight* dst) {
+	return triangle_pack<8, trianglex8_watertight>(vertices, triangle_count, dst, vec3x8_load, false);
+}
+
+bool ray_hit_triangles(ray ray, const trianglex8* triangles, uint32 packet_count, float* hit = nullptr, uint32* triangle_index = nullptr, vec3* barycentric_coord = nullptr) {
+	return ray_hit_triangles_nearest<maskx8, floatx8, vec3x8>(ray, triangles, packet_count, hit, triangle_index, barycentric_coord,
+		[](const vec3x8& origin, const vec3x8& dir, floatx8 t_max, const trianglex8& t, floatx8* tt, floatx8* u, floatx8* v) {
+			return ray_hit_triangle_packet<maskx8>(origin, dir, t_max, t, tt, u, v);
+		});
+}
+
+bool ray_hit_triangles_watertight(ray ray, const trianglex8_watertight* triangles, uint32 packet_count, float* hit = nullptr, uint32* triangle_index = nullptr, vec3* barycentric_coord = nullptr) {
+	ray_watertight r = ray_watertight_precompute(ray);
+	return ray_hit_triangles_nearest<maskx8, floatx8, vec3x8>(ray, triangles, packet_count, hit, triangle_index, barycentric_coord,
+		[&r](const vec3x8& origin, const vec3x8&, floatx8 t_max, const trianglex8_watertight& t, floatx8* tt, floatx8* u, floatx8* v) {
+			return ray_hit_triangle_watertight_packet<maskx8>(r, origin, t_max, t, tt, u, v);
+		});
+}
+
+#endif // MATH_AVX
+
+// m * (p, 1) for count points, or m * (v, 0) for count vectors, 4 at a time with the remainder done one by one.
+// Results match mat4::operator*, dst may alias src.
+template <bool POINTS>
+void mat4_transform(const mat4& m, const vec3* src, vec3* dst, uint32 count) {
+	floatx4 m00 = floatx4_set1(m.c1.x), m01 = floatx4_set1(m.c1.y), m02 = floatx4_set1(m.c1.z);
+	floatx4 m10 = floatx4_set1(m.c2.x), m11 = floatx4_set1(m.c2.y), m12 = floatx4_set1(m.c2.z);
+	floatx4 m20 = floatx4_set1(m.c3.x), m21 = floatx4_set1(m.c3.y), m22 = floatx4_set1(m.c3.z);
+	floatx4 m30 = floatx4_set1(m.c4.x), m31 = floatx4_set1(m.c4.y), m32 = floatx4_set1(m.c4.z);
+	uint32 i = 0;
+	for (; i + 4 <= count; i += 4) {
+		vec3x4 p = vec3x4_load(src + i);
+		vec3x4 r = {m00 * p.x + m10 * p.y + m20 * p.z, m01 * p.x + m11 * p.y + m21 * p.z, m02 * p.x + m12 * p.y + m22 * p.z};
+		if (POINTS) {
+			r.x += m30;
+			r.y += m31;
+			r.z += m32;
+		}
+		vec3x4_store(r, dst + i);
+	}
+	for (; i < count; i += 1) {
+		vec4 r = m * vec4{src[i].x, src[i].y, src[i].z, POINTS ? 1.0f : 0.0f};
+		dst[i] = vec3{r.x, r.y, r.z};
+	}
+}
+
+void mat4_transform_points(const mat4& m, const vec3* points, vec3* dst, uint32 count) {
+	mat4_transform<true>(m, points, dst, count);
+}
+
+void mat4_transform_vectors(const mat4& m, const vec3* vectors, vec3* dst, uint32 count) {
+	mat4_transform<false>(m, vectors, dst, count);
+}
+
+#ifdef MATH_AVX
+
+// Two result columns per iteration, a's columns are broadcast to both 128 bit halves.
+mat4 mat4_mul_avx(const mat4& a, const mat4& b) {
+	__m256 a1 = _mm256_broadcast_ps((const __m128*)&a.c1.x);
+	__m256 a2 = _mm256_broadcast_ps((const __m128*)&a.c2.x);
+	__m256 a3 = _mm256_broadcast_ps((const __m128*)&a.c3.x);
+	__m256 a4 = _mm256_broadcast_ps((const __m128*)&a.c4.x);
+	mat4 result;
+	for (uint32 i = 0; i < 4; i += 2) {
+		__m256 b2 = _mm256_loadu_ps(&b.columns[i].x);
+		__m256 r = _mm256_mul_ps(a1, _mm256_permute_ps(b2, _MM_SHUFFLE(0, 0, 0, 0)));
+		r = _mm256_add_ps(r, _mm256_mul_ps(a2, _mm256_permute_ps(b2, _MM_SHUFFLE(1, 1, 1, 1))));
+		r = _mm256_add_ps(r, _mm256_mul_ps(a3, _mm256_permute_ps(b2, _MM_SHUFFLE(2, 2, 2, 2))));
+		r = _mm256_add_ps(r, _mm256_mul_ps(a4, _mm256_permute_ps(b2, _MM_SHUFFLE(3, 3, 3, 3))));
+		_mm256_storeu_ps(&result.columns[i].x, r);
+	}
+	return result;
+}
+
+template <bool POINTS>
+void mat4_transform_avx(const mat4& m, const vec3* src, vec3* dst, uint32 count) {
+	floatx8 m00 = floatx8_set1(m.c1.x), m01 = floatx8_set1(m.c1.y), m02 = floatx8_set1(m.c1.z);
+	floatx8 m10 = floatx8_set1(m.c2.x), m11 = floatx8_set1(m.c2.y), m12 = floatx8_set1(m.c2.z);
+	floatx8 m20 = floatx8_set1(m.c3.x), m21 = floatx8_set1(m.c3.y), m22 = floatx8_set1(m.c3.z);
+	floatx8 m30 = floatx8_set1(m.c4.x), m31 = floatx8_set1(m.c4.y), m32 = floatx8_set1(m.c4.z);
+	uint32 i = 0;
+	for (; i + 8 <= count; i += 8) {
+		vec3x8 p = vec3x8_load(src + i);
+		vec3x8 r = {m00 * p.x + m10 * p.y + m20 * p.z, m01 * p.x + m11 * p.y + m21 * p.z, m02 * p.x + m12 * p.y + m22 * p.z};
+		if (POINTS) {
+			r.x += m30;
+			r.y += m31;
+			r.z += m32;
+		}
+		vec3x8_store(r, dst + i);
+	}
+	mat4_transform<POINTS>(m, src + i, dst + i, count - i);
+}
+
+void mat4_transform_points_avx(const mat4& m, const vec3* points, vec3* dst, uint32 count) {
+	mat4_transform_avx<true>(m, points, dst, count);
+}
+
+void mat4_transform_vectors_avx(const mat4& m, const vec3* vectors, vec3* dst, uint32 count) {
+	mat4_transform_avx<false>(m, vectors, dst, count);
+}
+
+#endif // MATH_AVX
+
+struct quatx4 {
+	floatx4 x, y, z, w;
+	static const uint32 lane_count = 4;
+
+	quatx4 operator-() const { return quatx4{-x, -y, -z, -w}; }
+	quatx4 operator+(quatx4 q) const { return quatx4{x + q.x, y + q.y, z + q.z, w + q.w}; }
+	quatx4 operator*(floatx4 f) const { return quatx4{x * f, y * f, z * f, w * f}; }
+};
+
+quatx4 quatx4_load(const quat* q) {
+	quatx4 result = {_mm_loadu_ps(&q[0].x), _mm_loadu_ps(&q[1].x), _mm_loadu_ps(&q[2].x), _mm_loadu_ps(&q[3].x)};
+	_MM_TRANSPOSE4_PS(result.x.v, result.y.v, result.z.v, result.w.v);
+	return result;
+}
+
+void quatx4_store(quatx4 q, quat* dst) {
+	_MM_TRANSPOSE4_PS(q.x.v, q.y.v, q.z.v, q.w.v);
+	_mm_storeu_ps(&dst[0].x, q.x.v);
+	_mm_storeu_ps(&dst[1].x, q.y.v);
+	_mm_storeu_ps(&dst[2].x, q.z.v);
+	_mm_storeu_ps(&dst[3].x, q.w.v);
+}
+
+quatx4 select(maskx4 mask, quatx4 a, quatx4 b) {
+	return quatx4{select(mask, a.x, b.x), select(mask, a.y, b.y), select(mask, a.z, b.z), select(mask, a.w, b.w)};
+}
+
+floatx4 quat_dot(quatx4 q1, quatx4 q2) {
+	return q1.x * q2.x + q1.y * q2.y + q1.z * q2.z + q1.w * q2.w;
+}
+
+quatx4 quat_normalize(quatx4 q) {
+	floatx4 len = sqrt(quat_dot(q, q));
+	return quatx4{q.x / len, q.y / len, q.z / len, q.w / len};
+}
+
+// Normalized linear interpolation along the shorter arc. Compared to slerp the rotation drifts ahead near the ends
+// and behind in the middle, by at most 2e-5 radians for rotations 10 degrees apart, 1.7e-4 for 20 degrees,
+// 2e-3 for 45 degrees and 0.016 for 90 degrees.
+quatx4 quat_nlerp(quatx4 q1, quatx4 q2, floatx4 t) {
+	maskx4 flip = quat_dot(q1, q2) < floatx4_set1(0);
+	q2 = select(flip, -q2, q2);
+	return quat_normalize(q1 * (floatx4_set1(1) - t) + q2 * t);
+}
+
+// sin(t * angle) / sin(angle) where x_minus_1 is cos(angle) - 1 and cos(angle) is in [0, 1], as the series
+// from Eberly's "A Fast and Accurate Algorithm for Computing SLERP". The last of the 12 terms is scaled by 1.89375
+// to absorb the truncated tail, which keeps the error under 1e-6 without calling acos or sin.
+floatx4 quat_slerp_weight(floatx4 t, floatx4 x_minus_1) {
+	static const float u[12] = {
+		1.0f / (1 * 3), 1.0f / (2 * 5), 1.0f / (3 * 7), 1.0f / (4 * 9), 1.0f / (5 * 11), 1.0f / (6 * 13),
+		1.0f / (7 * 15), 1.0f / (8 * 17), 1.0f / (9 * 19), 1.0f / (10 * 21), 1.0f / (11 * 23), 1.89375f / (12 * 25)
+	};
+	static const float v[12] = {
+		1.0f / 3, 2.0f / 5, 3.0f / 7, 4.0f / 9, 5.0f / 11, 6.0f / 13,
+		7.0f / 15, 8.0f / 17, 9.0f / 19, 10.0f / 21, 11.0f / 23, 1.89375f * 12 / 25
+	};
+	floatx4 t2 = t * t;
+	floatx4 result = floatx4_set1(1);
+	for (int i = 11; i >= 0; i -= 1) {
+		result = (t2 * u[i] - floatx4_set1(v[i])) * x_minus_1 * result + 1;
+	}
+	return t * result;
+}
+
+// Spherical interpolation along the shorter arc, accurate to about 1e-6 for any angle.
+quatx4 quat_slerp(quatx4 q1, quatx4 q2, floatx4 t) {
+	floatx4 cos_angle = quat_dot(q1, q2);
+	maskx4 flip = cos_angle < floatx4_set1(0);
+	q2 = select(flip, -q2, q2);
+	floatx4 x_minus_1 = abs(cos_angle) - 1;
+	return q1 * quat_slerp_weight(floatx4_set1(1) - t, x_minus_1) + q2 * quat_slerp_weight(t, x_minus_1);
+}
+
+// Interpolates count quaternion pairs 4 at a time, the last partial packet goes through copies padded with identities.
+template <typename KERNEL>
+void quat_interpolate_batch(const quat* q1, const quat* q2, const float* t, quat* dst, uint32 count, KERNEL kernel) {
+	uint32 i = 0;
+	for (; i + 4 <= count; i += 4) {
+		quatx4_store(kernel(quatx4_load(q1 + i), quatx4_load(q2 + i), floatx4_load(t + i)), dst + i);
+	}
+	if (i < count) {
+		quat q1_tail[4] = {{0, 0, 0, 1}, {0, 0, 0, 1}, {0, 0, 0, 1}, {0, 0, 0, 1}};
+		quat q2_tail[4] = {{0, 0, 0, 1}, {0, 0, 0, 1}, {0, 0, 0, 1}, {0, 0, 0, 1}};
+		float t_tail[4] = {};
+		quat dst_tail[4];
+		memcpy(q1_tail, q1 + i, (count - i) * sizeof(quat));
+		memcpy(q2_tail, q2 + i, (count - i) * sizeof(quat));
+		memcpy(t_tail, t + i, (count - i) * sizeof(float));
+		quatx4_store(kernel(quatx4_load(q1_tail), quatx4_load(q2_tail), floatx4_load(t_tail)), dst_tail);
+		memcpy(dst + i, dst_tail, (count - i) * sizeof(quat));
+	}
+}
+
+void quat_slerp_batch(const quat* q1, const quat* q2, const float* t, quat* dst, uint32 count) {
+	quat_interpolate_batch(q1, q2, t, dst, count, [](quatx4 a, quatx4 b, floatx4 t) { return quat_slerp(a, b, t); });
+}
+
+void quat_nlerp_batch(const quat* q1, const quat* q2, const float* t, quat* dst, uint32 count) {
+	quat_interpolate_batch(q1, q2, t, dst, count, [](quatx4 a, quatx4 b, floatx4 t) { return quat_nlerp(a, b, t); });
+}
+
+void vec3_lerp_batch(const vec3* v1, const vec3* v2, const float* t, vec3* dst, uint32 count) {
+	uint32 i = 0;
+	for (; i + 4 <= count; i += 4) {
+		vec3x4_store(vec3_lerp(vec3x4_load(v1 + i), vec3x4_load(v2 + i), floatx4_load(t + i)), dst + i);
+	}
+	for (; i < count; i += 1) {
+		dst[i] = v1[i] + (v2[i] - v1[i]) * t[i];
+	}
+}
+
+// mat4_from_transform for count transforms. Each group of 4 is loaded with overlapping 16 byte reads and transposed,
+// the rotation matrix is built in SoA and transposed back into columns.
+void mat4_from_transform_batch(const transform* transforms, mat4* dst, uint32 count) {
+	static_assert(sizeof(struct transform) == 40 && offsetof(struct transform, rotate) == 12 && offsetof(struct transform, translate) == 28, "");
+	uint32 i = 0;
+	for (; i + 4 <= count; i += 4) {
+		const transform* t = transforms + i;
+		__m128 sx = _mm_loadu_ps(&t[0].scale.x), sy = _mm_loadu_ps(&t[1].scale.x), sz = _mm_loadu_ps(&t[2].scale.x), s_unused = _mm_loadu_ps(&t[3].scale.x);
+		_MM_TRANSPOSE4_PS(sx, sy, sz, s_unused);
+		__m128 qx = _mm_loadu_ps(&t[0].rotate.x), qy = _mm_loadu_ps(&t[1].rotate.x), qz = _mm_loadu_ps(&t[2].rotate.x), qw = _mm_loadu_ps(&t[3].rotate.x);
+		_MM_TRANSPOSE4_PS(qx, qy, qz, qw);
+		__m128 t_unused = _mm_loadu_ps(&t[0].rotate.w), tx = _mm_loadu_ps(&t[1].rotate.w), ty = _mm_loadu_ps(&t[2].rotate.w), tz = _mm_loadu_ps(&t[3].rotate.w);
+		_MM_TRANSPOSE4_PS(t_unused, tx, ty, tz);
+
+		quatx4 q = {qx, qy, qz, qw};
+		vec3x4 scale = {sx, sy, sz};
+		floatx4 qxx = q.x * q.x, qyy = q.y * q.y, qzz = q.z * q.z;
+		floatx4 qxz = q.x * q.z, qxy = q.x * q.y, qyz = q.y * q.z;
+		floatx4 qwx = q.w * q.x, qwy = q.w * q.y, qwz = q.w * q.z;
+		floatx4 one = floatx4_set1(1);
+		vec3x4 c1 = vec3x4{one - (qyy + qzz) * 2, (qxy + qwz) * 2, (qxz - qwy) * 2} * scale.x;
+		vec3x4 c2 = vec3x4{(qxy - qwz) * 2, one - (qxx + qzz) * 2, (qyz + qwx) * 2} * scale.y;
+		vec3x4 c3 = vec3x4{(qxz + qwy) * 2, (qyz - qwx) * 2, one - (qxx + qyy) * 2} * scale.z;
+
+		__m128 zero = _mm_setzero_ps();
+		__m128 c1w = zero, c2w = zero, c3w = zero, c4w = _mm_set1_ps(1);
+		_MM_TRANSPOSE4_PS(c1.x.v, c1.y.v, c1.z.v, c1w);
+		_MM_TRANSPOSE4_PS(c2.x.v, c2.y.v, c2.z.v, c2w);
+		_MM_TRANSPOSE4_PS(c3.x.v, c3.y.v, c3.z.v, c3w);
+		_MM_TRANSPOSE4_PS(tx, ty, tz, c4w);
+		__m128 columns[4][4] = {{c1.x.v, c2.x.v, c3.x.v, tx}, {c1.y.v, c2.y.v, c3.y.v, ty}, {c1.z.v, c2.z.v, c3.z.v, tz}, {c1w, c2w, c3w, c4w}};
+		for (uint32 j = 0; j < 4; j += 1) {
+			for (uint32 k = 0; k < 4; k += 1) {
+				_mm_storeu_ps(&dst[i + j].columns[k].x, columns[j][k]);
+			}
+		}
+	}
+	for (; i < count; i += 1) {
+		dst[i] = mat4_from_transform(transforms[i]);
+	}
+}
+
 #include <directxmath.h>
 using namespace DirectX;
 
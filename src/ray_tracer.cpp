@@ -5,8 +5,6 @@
 #include "common.cpp"
 #include "math.cpp"
 
-#include <atomic>
-
 #include <d3d11_1.h>
 #include <directxcolors.h>
 
@@ -75,8 +73,6 @@ const block_position *block_positions = [] {
 }();
 
 uint32 block_index = 0;
-std::atomic<uint32> block_pixel_index(0);
-HANDLE block_pixel_semaphore = CreateSemaphoreA(nullptr, block_pixel_count, block_pixel_count, nullptr);
 
 struct rng {
 	uint32 rng_state;
@@ -348,7 +344,7 @@ void init_d3d(d3d *d3d, window *window) {
 			if (ray_hit_sphere(ray, scene->spheres[i].sphere, &t)) {
 				if (t > 0.0001f) {
 					vec3 p = ray.origin + ray.dir * t;
-					ray_hits[ray_hit_count++] = { t, p, vec3_normalize(p - scene->spheres[i].sphere.center), &scene->spheres[i].material };
+					ray_hits[ray_hit_count++] = { t, p, vec3_normalize_fast(p - scene->spheres[i].sphere.center), &scene->spheres[i].material };
 				}
 			}
 		}
@@ -393,9 +389,9 @@ void init_d3d(d3d *d3d, window *window) {
 				for (uint32 i = 0; i < m_countof(random_rays); i += 1) {
 					vec3 dir = {};
 					float pdf = 0;
-					cosine_weighted_sample_hemisphere(rng->gen(), rng->gen(), &dir, &pdf);
+					cosine_weighted_sample_hemisphere_fast(rng->gen(), rng->gen(), &dir, &pdf);
 					random_rays[i].origin = hit.point;
-					random_rays[i].dir = quat_from_between(vec3{ 0, 1, 0 }, hit.normal) * dir;
+					random_rays[i].dir = quat_from_between_fast(vec3{ 0, 1, 0 }, hit.normal) * dir;
 					random_rays[i].len = scene->camera.zfar;
 					diffuse_color += trace(scene, rng, random_rays[i], bounce + 1) * hit.material->color * vec3_dot(hit.normal, random_rays[i].dir) / (float)M_PI / pdf;
 				}
@@ -435,7 +431,7 @@ void init_d3d(d3d *d3d, window *window) {
 				if (refract(ray.dir, outward_normal, ni_over_nt, &refracted)) {
 					float r0 = (1.0f - hit.material->refractive_index) / (1.0f + hit.material->refractive_index);
 					r0 = r0 * r0;
-					reflect_prob = r0 + (1.0f - r0) * powf(1.0f - cosine, 5.0f);
+					reflect_prob = fresnel_schlick(r0, cosine);
 				}
 				else {
 					reflect_prob = 1.0f;
@@ -465,60 +461,34 @@ void init_d3d(d3d *d3d, window *window) {
 		}
 	}
 
-	struct thread_param {
-		scene *scene;
-	};
-
-	DWORD thread_func(void *param) {
-		rng rng;
-		rng.rng_state = 1;
-
-		scene *scene = ((thread_param *)param)->scene;
-
+	void trace_block(job_system *js, scene *scene) {
+		m_profile_zone("trace_block");
+		m_profile_counter_add("pixels traced", block_pixel_count);
 		mat4 view_mat = camera_view_mat4(scene->camera);
 		mat4 proj_mat = camera_project_mat4(scene->camera);
 		vec4 view_port = { 0, 0, (float)image_width, (float)image_height };
 
-		while (true) {
-			uint32 pixel_index = block_pixel_index.load();
-			do {
-				if (pixel_index >= block_pixel_count) {
-					break;
-				}
-			} while (!block_pixel_index.compare_exchange_strong(pixel_index, pixel_index + 1));
-
-			if (pixel_index < block_pixel_count) {
-				uint32 x = block_positions[block_index].x + pixel_index % block_width;
-				uint32 y = block_positions[block_index].y + pixel_index / block_width;
+		parallel_for(js, block_pixel_count, 4, [&](uint64 begin, uint64 end) {
+			m_profile_zone("trace pixels");
+			for (uint64 pixel_index = begin; pixel_index < end; pixel_index += 1) {
+				uint32 x = block_positions[block_index].x + (uint32)pixel_index % block_width;
+				uint32 y = block_positions[block_index].y + (uint32)pixel_index / block_width;
+				uint32 seed = image_width * y + x;
+				rng rng;
+				rng.rng_state = (uint32)hash64(&seed, sizeof(seed)) | 1;
 				vec3 window_coord = { (float)x, (float)(image_height - y), 0.5f };
 				vec3 unproj = mat4_unproject(window_coord, view_mat, proj_mat, view_port);
-				ray ray = { scene->camera.position, vec3_normalize(unproj - scene->camera.position), scene->camera.zfar };
+				ray ray = { scene->camera.position, vec3_normalize_fast(unproj - scene->camera.position), scene->camera.zfar };
 				vec3 color = trace(scene, &rng, ray, 0);
 				for (uint32 i = 0; i < 3; i += 1) {
 					color[i] = clamp(color[i], 0.0f, 1.0f);
 				}
 				image[image_width * y + x] = vec4{ color.x, color.y, color.z, 0 };
-				WaitForSingleObject(block_pixel_semaphore, INFINITE);
 			}
-		}
-
-		return 0;
+		});
 	}
 
-	bool current_block_done() {
-		if (block_index >= block_count) {
-			return false;
-		}
-		LONG previous_count = 0;
-		return ReleaseSemaphore(block_pixel_semaphore, block_pixel_count, &previous_count);
-	}
-
-	void next_block() {
-		block_index += 1;
-		if (block_index < block_count) {
-			block_pixel_index.store(0);
-		}
-	}
+	bool window_closed = false;
 
 	LRESULT window_message_callback(HWND hwnd, UINT msg, WPARAM wparam, LPARAM lparam) {
 		switch (msg) {
@@ -527,13 +497,15 @@ void init_d3d(d3d *d3d, window *window) {
 		} break;
 		case WM_CLOSE:
 		case WM_QUIT: {
-			ExitProcess(0);
+			window_closed = true;
 			return 0;
 		} break;
 		}
 	}
 
-	int main() {
+	// usage: ray_tracer.exe [profile_trace_file], the profiler only captures when a trace file is given.
+	int main(int argc, char **argv) {
+		const char *profile_trace_file = argc > 1 ? argv[1] : nullptr;
 		set_current_dir_to_exe_dir();
 
 		window *window = new struct window;
@@ -586,28 +558,30 @@ void init_d3d(d3d *d3d, window *window) {
 			m_d3d_assert(d3d->swap_chain->Present(0, 0));
 		}
 #else
-		thread_param thread_param;
-		thread_param.scene = scene;
-
-		SYSTEM_INFO sysinfo;
-		GetSystemInfo(&sysinfo);
-		uint32 thread_count = sysinfo.dwNumberOfProcessors - 1;
-		HANDLE *thread_handles = new HANDLE[thread_count];
-		for (uint32 i = 0; i < thread_count; i += 1) {
-			thread_handles[i] = CreateThread(nullptr, 0, thread_func, &thread_param, 0, nullptr);
-			m_assert(thread_handles[i]);
+		job_system js;
+		job_system_init(&js);
+		if (profile_trace_file) {
+			profiler_begin_capture();
 		}
 
-		while (true) {
+		while (!window_closed) {
 			window_handle_messages(window);
-			if (current_block_done()) {
+			if (block_index < block_count) {
+				profiler_frame();
+				trace_block(&js, scene);
+				block_index += 1;
+				if (block_index == block_count && profile_trace_file) {
+					profiler_end_capture();
+					if (!profiler_export_chrome_trace(profile_trace_file)) {
+						printf("error: cannot write profile trace file \"%s\"", profile_trace_file);
+					}
+				}
+
 				D3D11_MAPPED_SUBRESOURCE mapped_subresource = {};
 				m_d3d_assert(d3d->context->Map(d3d->image, 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped_subresource));
 				memcpy(mapped_subresource.pData, image, image_width * image_height * sizeof(vec4));
 				d3d->context->Unmap(d3d->image, 0);
 
-				next_block();
-
 				D3D11_VIEWPORT viewport = {};
 				viewport.Width = (float)d3d->swap_chain_desc.Width;
 				viewport.Height = (float)d3d->swap_chain_desc.Height;
@@ -629,5 +603,6 @@ void init_d3d(d3d *d3d, window *window) {
 				m_d3d_assert(d3d->swap_chain->Present(0, 0));
 			}
 		}
+		job_system_destroy(&js);
 #endif
 	}
@@ -5,13 +5,83 @@
 #ifndef __SIMD_CPP__
 #define __SIMD_CPP__
 
-#include <mmintrin.h>
-#include <xmmintrin.h>
-#include <emmintrin.h>
-#include <pmmintrin.h>
-#include <tmmintrin.h> 
+#include "types.cpp"
 
-#include <intrin.h>
+#ifndef _MSC_VER
+#include <cpuid.h>
+#endif
+
+// Kernels for wider instruction sets are compiled alongside the baseline build and picked at startup, GCC and Clang
+// need the target attribute to accept their intrinsics outside of -m flags, MSVC accepts them anywhere.
+#if defined(_MSC_VER) && !defined(__clang__)
+#define m_simd_target(isa)
+#else
+#define m_simd_target(isa) __attribute__((target(isa)))
+#endif
+
+enum simd_isa {
+	simd_isa_scalar,
+	simd_isa_sse4_1,
+	simd_isa_avx2,
+	simd_isa_avx512,
+	simd_isa_count
+};
+
+const char* simd_isa_names[simd_isa_count] = {"scalar", "sse4.1", "avx2", "avx512"};
+
+void simd_cpuid(uint32 leaf, uint32 subleaf, uint32 regs[4]) {
+#ifdef _MSC_VER
+	__cpuidex((int*)regs, (int)leaf, (int)subleaf);
+#else
+	regs[0] = regs[1] = regs[2] = regs[3] = 0;
+	__get_cpuid_count(leaf, subleaf, &regs[0], &regs[1], &regs[2], &regs[3]);
+#endif
+}
+
+uint64 simd_xgetbv() {
+#ifdef _MSC_VER
+	return _xgetbv(0);
+#else
+	uint32 lo, hi;
+	__asm__ volatile("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+	return ((uint64)hi << 32) | lo;
+#endif
+}
+
+// The widest instruction set that both the cpu and the os (through the saved xsave state) support. simd_isa_avx2 also
+// requires BMI1 and BMI2, which every AVX2 cpu has, so code can rely on them from that level on.
+simd_isa simd_detect_isa() {
+	uint32 regs[4];
+	simd_cpuid(0, 0, regs);
+	uint32 max_leaf = regs[0];
+	simd_cpuid(1, 0, regs);
+	bool sse4_1 = (regs[2] & (1 << 19)) && (regs[2] & (1 << 23));
+	bool osxsave = regs[2] & (1 << 27);
+	bool avx = regs[2] & (1 << 28);
+	if (!sse4_1) {
+		return simd_isa_scalar;
+	}
+	if (!osxsave || !avx || max_leaf < 7) {
+		return simd_isa_sse4_1;
+	}
+	uint64 xcr0 = simd_xgetbv();
+	simd_cpuid(7, 0, regs);
+	bool avx2 = (regs[1] & (1 << 5)) && (regs[1] & (1 << 3)) && (regs[1] & (1 << 8)) && (xcr0 & 0x6) == 0x6;
+	bool avx512 = (regs[1] & (1 << 16)) && (xcr0 & 0xe6) == 0xe6;
+	if (!avx2) {
+		return simd_isa_sse4_1;
+	}
+	return avx512 ? simd_isa_avx512 : simd_isa_avx2;
+}
+
+const simd_isa simd_supported_isa = simd_detect_isa();
+simd_isa simd_current_isa = simd_supported_isa;
+
+// For tests and benchmarks, isa is clamped to what the cpu supports. Returns the isa now in use.
+simd_isa simd_set_isa(simd_isa isa) {
+	simd_current_isa = isa < simd_supported_isa ? isa : simd_supported_isa;
+	return simd_current_isa;
+}
 
 #define x (char)(0x80)
 alignas(16) static const __m128i simd_left_pack_shuffle_table[16] = {
@@ -34,6 +104,7 @@ alignas(16) static const __m128i simd_left_pack_shuffle_table[16] = {
 };
 #undef x
 
+m_simd_target("ssse3")
 __m128 simd_left_pack(__m128 val, __m128 mask) {
 	int index = _mm_movemask_ps(mask);
 	__m128i shuffle = _mm_load_si128(&simd_left_pack_shuffle_table[index]);
@@ -41,33 +112,171 @@ __m128 simd_left_pack(__m128 val, __m128 mask) {
 	return _mm_castsi128_ps(shuffled);
 }
 
+// Lane indices of the set bits of an 8 bit mask, packed one per nibble, for _mm256_permutevar8x32_ps.
+struct simd_left_pack_index_table {
+	uint32 indices[256];
+	constexpr simd_left_pack_index_table() : indices() {
+		for (uint32 mask = 0; mask < 256; mask += 1) {
+			uint32 n = 0;
+			for (uint32 lane = 0; lane < 8; lane += 1) {
+				if (mask & (1 << lane)) {
+					indices[mask] |= lane << (n * 4);
+					n += 1;
+				}
+			}
+		}
+	}
+};
+
+static constexpr simd_left_pack_index_table simd_left_pack_avx2_table = {};
+
+m_simd_target("avx2")
+__m256 simd_left_pack_avx2(__m256 val, uint32 mask) {
+	__m256i indices = _mm256_srlv_epi32(_mm256_set1_epi32((int)simd_left_pack_avx2_table.indices[mask]), _mm256_setr_epi32(0, 4, 8, 12, 16, 20, 24, 28));
+	return _mm256_permutevar8x32_ps(val, _mm256_and_si256(indices, _mm256_set1_epi32(7)));
+}
+
 enum compare_op {
 	compare_op_gt,
 	compare_op_ge,
 	compare_op_eq,
 	compare_op_le,
-	compare_op_lt
+	compare_op_lt,
+	compare_op_count
 };
 
-uint32 simd_filter_floats(const float *in, float *out, uint32 count, float limit, compare_op cmp) {
-	m_debug_assert(count % 4 == 0);
+// The compare op is a template argument so each kernel is compiled with its comparison fixed, the switches below
+// fold away. Every compare is ordered, a NaN value never passes.
+template <compare_op op>
+bool simd_compare(float a, float b) {
+	switch (op) {
+	case compare_op_gt: return a > b;
+	case compare_op_ge: return a >= b;
+	case compare_op_eq: return a == b;
+	case compare_op_le: return a <= b;
+	default: return a < b;
+	}
+}
+
+template <compare_op op>
+m_simd_target("sse4.1")
+__m128 simd_compare_sse(__m128 a, __m128 b) {
+	switch (op) {
+	case compare_op_gt: return _mm_cmpgt_ps(a, b);
+	case compare_op_ge: return _mm_cmpge_ps(a, b);
+	case compare_op_eq: return _mm_cmpeq_ps(a, b);
+	case compare_op_le: return _mm_cmple_ps(a, b);
+	default: return _mm_cmplt_ps(a, b);
+	}
+}
+
+template <compare_op op>
+m_simd_target("avx2")
+__m256 simd_compare_avx2(__m256 a, __m256 b) {
+	switch (op) {
+	case compare_op_gt: return _mm256_cmp_ps(a, b, _CMP_GT_OQ);
+	case compare_op_ge: return _mm256_cmp_ps(a, b, _CMP_GE_OQ);
+	case compare_op_eq: return _mm256_cmp_ps(a, b, _CMP_EQ_OQ);
+	case compare_op_le: return _mm256_cmp_ps(a, b, _CMP_LE_OQ);
+	default: return _mm256_cmp_ps(a, b, _CMP_LT_OQ);
+	}
+}
+
+template <compare_op op>
+m_simd_target("avx512f")
+__mmask16 simd_compare_avx512(__m512 a, __m512 b) {
+	switch (op) {
+	case compare_op_gt: return _mm512_cmp_ps_mask(a, b, _CMP_GT_OQ);
+	case compare_op_ge: return _mm512_cmp_ps_mask(a, b, _CMP_GE_OQ);
+	case compare_op_eq: return _mm512_cmp_ps_mask(a, b, _CMP_EQ_OQ);
+	case compare_op_le: return _mm512_cmp_ps_mask(a, b, _CMP_LE_OQ);
+	default: return _mm512_cmp_ps_mask(a, b, _CMP_LT_OQ);
+	}
+}
+
+// Filter kernels copy the values of in that pass the compare against limit to out, keeping their order, and return
+// how many passed. The vector loops store whole vectors at the current output offset, which never runs ahead of the
+// input offset, so out only needs room for count floats. Remaining elements go through the scalar loop.
+template <compare_op op>
+uint32 simd_filter_floats_tail(const float* in, float* out, uint32 count, float limit, uint32 i, uint32 out_offset) {
+	for (; i < count; i += 1) {
+		if (simd_compare<op>(in[i], limit)) {
+			out[out_offset++] = in[i];
+		}
+	}
+	return out_offset;
+}
+
+template <compare_op op>
+uint32 simd_filter_floats_scalar(const float* in, float* out, uint32 count, float limit) {
+	return simd_filter_floats_tail<op>(in, out, count, limit, 0, 0);
+}
+
+template <compare_op op>
+m_simd_target("sse4.1,popcnt")
+uint32 simd_filter_floats_sse4_1(const float* in, float* out, uint32 count, float limit) {
 	__m128 limits = _mm_set1_ps(limit);
 	uint32 out_offset = 0;
-	for (uint32 i = 0; i < count; i += 4) {
-		__m128 val = _mm_load_ps(in + i);
-		__m128 mask;
-		switch (cmp) {
-		case compare_op_gt: mask = _mm_cmpgt_ps(val, limits); break;
-		case compare_op_ge: mask = _mm_cmpge_ps(val, limits); break;
-		case compare_op_eq: mask = _mm_cmpeq_ps(val, limits); break;
-		case compare_op_le: mask = _mm_cmple_ps(val, limits); break;
-		case compare_op_lt: mask = _mm_cmplt_ps(val, limits); break;
-		}
-		__m128 result = simd_left_pack(val, mask);
-		_mm_storeu_ps(out + out_offset, result);
-		out_offset += __popcnt(_mm_movemask_ps(mask));
+	uint32 i = 0;
+	for (; i + 4 <= count; i += 4) {
+		__m128 val = _mm_loadu_ps(in + i);
+		__m128 mask = simd_compare_sse<op>(val, limits);
+		_mm_storeu_ps(out + out_offset, simd_left_pack(val, mask));
+		out_offset += pop_count((uint32)_mm_movemask_ps(mask));
+	}
+	return simd_filter_floats_tail<op>(in, out, count, limit, i, out_offset);
+}
+
+template <compare_op op>
+m_simd_target("avx2,bmi,popcnt")
+uint32 simd_filter_floats_avx2(const float* in, float* out, uint32 count, float limit) {
+	__m256 limits = _mm256_set1_ps(limit);
+	uint32 out_offset = 0;
+	uint32 i = 0;
+	for (; i + 8 <= count; i += 8) {
+		__m256 val = _mm256_loadu_ps(in + i);
+		uint32 mask = (uint32)_mm256_movemask_ps(simd_compare_avx2<op>(val, limits));
+		_mm256_storeu_ps(out + out_offset, simd_left_pack_avx2(val, mask));
+		out_offset += pop_count(mask);
+	}
+	return simd_filter_floats_tail<op>(in, out, count, limit, i, out_offset);
+}
+
+template <compare_op op>
+m_simd_target("avx512f,popcnt")
+uint32 simd_filter_floats_avx512(const float* in, float* out, uint32 count, float limit) {
+	__m512 limits = _mm512_set1_ps(limit);
+	uint32 out_offset = 0;
+	for (uint32 i = 0; i < count; i += 16) {
+		__mmask16 load_mask = count - i >= 16 ? (__mmask16)0xffff : (__mmask16)((1 << (count - i)) - 1);
+		__m512 val = _mm512_maskz_loadu_ps(load_mask, in + i);
+		__mmask16 mask = simd_compare_avx512<op>(val, limits) & load_mask;
+		_mm512_mask_compressstoreu_ps(out + out_offset, mask, val);
+		out_offset += pop_count((uint32)mask);
 	}
 	return out_offset;
 }
 
+typedef uint32 (*simd_filter_floats_func)(const float* in, float* out, uint32 count, float limit);
+
+#define m_simd_filter_floats_kernels(isa) {                                                                             \
+  simd_filter_floats_##isa<compare_op_gt>, simd_filter_floats_##isa<compare_op_ge>, simd_filter_floats_##isa<compare_op_eq>, \
+  simd_filter_floats_##isa<compare_op_le>, simd_filter_floats_##isa<compare_op_lt>                                        \
+}
+
+const simd_filter_floats_func simd_filter_floats_kernels[simd_isa_count][compare_op_count] = {
+	m_simd_filter_floats_kernels(scalar),
+	m_simd_filter_floats_kernels(sse4_1),
+	m_simd_filter_floats_kernels(avx2),
+	m_simd_filter_floats_kernels(avx512)
+};
+
+#undef m_simd_filter_floats_kernels
+
+// Copies the values of in that pass the compare against limit to out in order, returns how many passed. Any count
+// works, out needs room for count floats.
+uint32 simd_filter_floats(const float* in, float* out, uint32 count, float limit, compare_op cmp) {
+	return simd_filter_floats_kernels[simd_current_isa][cmp](in, out, count, limit);
+}
+
 #endif // __SIMD_CPP__
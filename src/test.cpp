@@ -5,8 +5,11 @@
 #include "common.cpp"
 #include "math.cpp"
 #include "simd.cpp"
+#include "gpk.cpp"
 
-#include "ispc/simple.ispc.h"
+#include <unordered_map>
+
+#include "ispc/kernels.ispc.h"
 
 struct test_guard {
 	uint32 counter;
@@ -79,6 +82,24 @@ struct test_case_guard {
 #undef m_assert
 #define m_assert(expr) if (!(expr)) { _test_case.passed = false; snprintf(_test_case.error, sizeof(_test_case.error), "expr: \"%s\", line: %d", #expr, __LINE__); }
 
+// Uniform in [begin, end] from rand(), tests that need repeatable inputs call srand first.
+float random_float(float begin, float end) {
+	return begin + (end - begin) * (float)rand() / (float)RAND_MAX;
+}
+
+// Average nanoseconds per call over iterations calls of f.
+template <typename F>
+double benchmark_ns(uint32 iterations, F&& f) {
+	timer timer = {};
+	timer_init(&timer);
+	timer_start(&timer);
+	for (uint32 i = 0; i < iterations; i += 1) {
+		f();
+	}
+	timer_stop(&timer);
+	return timer_get_duration(timer) / iterations * 1e9;
+}
+
 int main(int argc, char **argv) {
 	for (int32 i = 1; i < argc; i += 1) {
 		if (!strcmp(argv[i], "-help")) {
@@ -126,6 +147,54 @@ int main(int argc, char **argv) {
 				m_assert(integer_array_size == 0);
 			}
 		}
+		m_case(reserve_resize_emplace) {
+			struct pair {
+				uint32 a;
+				float b;
+			};
+			array<pair> pairs = {};
+			pairs.reserve(100);
+			m_assert(pairs.capacity == 100 && pairs.size == 0);
+			pairs.emplace_back(1u, 2.0f);
+			m_assert(pairs[0].a == 1 && pairs[0].b == 2.0f);
+			pairs.resize(300);
+			m_assert(pairs.size == 300 && pairs.capacity >= 300);
+			m_assert(pairs[0].a == 1 && pairs[299].a == 0);
+			pairs.release();
+			m_assert(!pairs.elems && pairs.size == 0);
+		}
+		m_case(arena_storage) {
+			memory_arena arena = {};
+			memory_arena_init(m_megabytes(64), &arena);
+			array<uint32> integers = { nullptr, 0, 0, &arena };
+			for (uint32 i = 0; i < 1000; i += 1) {
+				integers.append(i);
+			}
+			m_assert(integers.size == 1000);
+			m_assert((uint8*)integers.elems >= arena.memory && (uint8*)integers.elems < arena.memory + arena.size);
+			for (uint32 i = 0; i < 1000; i += 1) {
+				m_assert(integers[i] == i);
+			}
+			memory_arena_destroy(&arena);
+		}
+		m_case(small_array) {
+			small_array<uint32, 8> integers = {};
+			for (uint32 i = 0; i < 8; i += 1) {
+				integers.append(i);
+			}
+			m_assert(!integers.heap_elems);
+			integers.append(8);
+			m_assert(integers.heap_elems && integers.size == 9);
+			for (uint32 i = 0; i < 9; i += 1) {
+				m_assert(integers[i] == i);
+			}
+			integers.pop_back();
+			m_assert(integers.back() == 7);
+			integers.release();
+			small_array<uint32, 4> stack = {};
+			stack.resize(3);
+			m_assert(stack.size == 3 && !stack.heap_elems && stack[2] == 0);
+		}
 	}
 	m_test(ring_buffer) {
 		m_case(double_elems) {
@@ -160,6 +229,721 @@ int main(int argc, char **argv) {
 			m_assert(rb.read_index == 10);
 		}
 	}
+	m_test(file_mapping) {
+		const char* file_name = "file_mapping_test_file.bin";
+		m_case(create_write_open_read) {
+			uint64 file_size = m_megabytes(8) + 17;
+			file_mapping fm = {};
+			m_assert(file_mapping_create(file_name, file_size, &fm, file_mapping_hint_sequential));
+			m_assert(fm.size == file_size);
+			for (uint64 i = 0; i < file_size; i += 1) {
+				fm.ptr[i] = (uint8)(i * 13);
+			}
+			file_mapping_flush(fm);
+			file_mapping_close(fm);
+
+			uint32 hints[] = { 0, file_mapping_hint_sequential, file_mapping_hint_random | file_mapping_hint_will_need, file_mapping_hint_populate };
+			for (uint32 hint : hints) {
+				file_mapping fm = {};
+				m_assert(file_mapping_open(file_name, &fm, true, hint));
+				m_assert(fm.size == file_size);
+				file_mapping_prefetch(&fm, m_megabytes(1) + 5, m_megabytes(2));
+				file_mapping_prefetch(&fm, file_size - 10, m_megabytes(2));
+				file_mapping_prefetch(&fm, file_size + 10, 1);
+				bool same = true;
+				for (uint64 i = 0; i < file_size; i += 4093) {
+					same = same && fm.ptr[i] == (uint8)(i * 13);
+				}
+				m_assert(same && fm.ptr[file_size - 1] == (uint8)((file_size - 1) * 13));
+				file_mapping_close(fm);
+			}
+		}
+		m_case(resize) {
+			file_mapping fm = {};
+			m_assert(file_mapping_open(file_name, &fm, false));
+			file_mapping_resize(&fm, 4096 * 3);
+			fm.ptr[4096 * 3 - 1] = 42;
+			file_mapping_flush(fm);
+			file_mapping_close(fm);
+			m_assert(file_mapping_open(file_name, &fm, true));
+			m_assert(fm.size == 4096 * 3 && fm.ptr[4096 * 3 - 1] == 42 && fm.ptr[4096] == (uint8)(4096 * 13));
+			file_mapping_close(fm);
+			m_assert(!file_mapping_open("file_mapping_missing_file.bin", &fm, true));
+		}
+		m_case(benchmark_populate) {
+			uint64 file_size = m_megabytes(256);
+			file_mapping fm = {};
+			m_assert(file_mapping_create(file_name, file_size, &fm, file_mapping_hint_sequential));
+			for (uint64 i = 0; i < file_size; i += 64) {
+				fm.ptr[i] = (uint8)i;
+			}
+			file_mapping_close(fm);
+			for (uint32 hints : { 0u, file_mapping_hint_sequential | file_mapping_hint_populate }) {
+				timer timer = {};
+				timer_init(&timer);
+				timer_start(&timer);
+				m_assert(file_mapping_open(file_name, &fm, true, hints));
+				uint64 sum = 0;
+				for (uint64 i = 0; i < file_size; i += 64) {
+					sum += fm.ptr[i];
+				}
+				file_mapping_close(fm);
+				timer_stop(&timer);
+				m_assert(sum > 0);
+				printf("(%s %.1f ms) ", hints ? "populate" : "no hints", timer_get_duration(timer) * 1000);
+			}
+		}
+		remove(file_name);
+	}
+	m_test(async_io) {
+		const char* file_name = "async_io_test_file.bin";
+		const uint64 file_size = m_megabytes(16) + 123;
+		{
+			FILE* file = fopen(file_name, "wb");
+			uint8* data = new uint8[file_size];
+			for (uint64 i = 0; i < file_size; i += 1) {
+				data[i] = (uint8)(i * 7 + (i >> 12));
+			}
+			fwrite(data, 1, file_size, file);
+			fclose(file);
+			delete[] data;
+		}
+		auto check_bytes = [&](const uint8* buffer, uint64 offset, uint64 size) {
+			for (uint64 i = 0; i < size; i += 1) {
+				uint64 n = offset + i;
+				if (buffer[i] != (uint8)(n * 7 + (n >> 12))) {
+					return false;
+				}
+			}
+			return true;
+		};
+		auto read_chunks = [&](async_io* io, bool direct, double* duration) {
+			async_file file = {};
+			if (!async_file_open(file_name, &file, direct)) {
+				return direct;
+			}
+			uint64 chunk_size = m_kilobytes(256);
+			uint32 chunk_count = (uint32)((file.size + chunk_size - 1) / chunk_size);
+			uint8* buffer = async_io_buffer_alloc(chunk_count * chunk_size);
+			async_io_request* requests = new async_io_request[chunk_count]();
+			std::atomic<uint32> callback_count(0);
+			job_counter counter = {};
+			timer timer = {};
+			timer_init(&timer);
+			timer_start(&timer);
+			for (uint32 i = 0; i < chunk_count; i += 1) {
+				async_io_request* request = &requests[i];
+				request->file = &file;
+				request->offset = i * chunk_size;
+				request->size = min(chunk_size, file.size - request->offset);
+				request->buffer = buffer + request->offset;
+				request->priority = i % async_io_priority_count;
+				request->callback = [](async_io_request* request) { ((std::atomic<uint32>*)request->callback_data)->fetch_add(1); };
+				request->callback_data = &callback_count;
+				request->counter = &counter;
+				async_io_read(io, request);
+			}
+			async_io_wait(io, &counter);
+			timer_stop(&timer);
+			*duration = timer_get_duration(timer);
+			bool success = callback_count == chunk_count;
+			for (uint32 i = 0; i < chunk_count; i += 1) {
+				success = success && requests[i].success && requests[i].bytes_read == requests[i].size;
+			}
+			success = success && check_bytes(buffer, 0, file.size);
+			delete[] requests;
+			async_io_buffer_free(buffer, chunk_count * chunk_size);
+			async_file_close(&file);
+			return success;
+		};
+		m_case(thread_pool) {
+			async_io io;
+			async_io_init(&io);
+			double duration = 0;
+			m_assert(read_chunks(&io, false, &duration));
+			m_assert(read_chunks(&io, true, &duration));
+			async_io_destroy(&io);
+			printf("(%.2f GB/s) ", file_size / duration / (1 << 30));
+		}
+		m_case(single_thread) {
+			async_io io;
+			async_io_init(&io, 1);
+			double duration = 0;
+			m_assert(read_chunks(&io, false, &duration));
+			m_assert(read_chunks(&io, true, &duration));
+			async_io_destroy(&io);
+			printf("(%.2f GB/s) ", file_size / duration / (1 << 30));
+		}
+		m_case(destroy_finishes_queued_reads) {
+			async_io io;
+			async_io_init(&io, 1);
+			async_file file = {};
+			m_assert(async_file_open(file_name, &file));
+			const uint32 request_count = 64;
+			const uint64 chunk_size = m_kilobytes(64);
+			uint8* buffer = async_io_buffer_alloc(request_count * chunk_size);
+			async_io_request requests[request_count] = {};
+			std::atomic<uint32> callback_count(0);
+			job_counter counter = {};
+			for (uint32 i = 0; i < request_count; i += 1) {
+				requests[i].file = &file;
+				requests[i].offset = i * chunk_size;
+				requests[i].size = chunk_size;
+				requests[i].buffer = buffer + i * chunk_size;
+				requests[i].priority = async_io_priority_normal;
+				requests[i].callback = [](async_io_request* request) { ((std::atomic<uint32>*)request->callback_data)->fetch_add(1); };
+				requests[i].callback_data = &callback_count;
+				requests[i].counter = &counter;
+				async_io_read(&io, &requests[i]);
+			}
+			async_io_destroy(&io);
+			m_assert(callback_count == request_count && counter.count == 0);
+			for (uint32 i = 0; i < request_count; i += 1) {
+				m_assert(requests[i].success && requests[i].bytes_read == chunk_size);
+			}
+			m_assert(check_bytes(buffer, 0, request_count * chunk_size));
+			async_io_buffer_free(buffer, request_count * chunk_size);
+			async_file_close(&file);
+		}
+		m_case(eof_and_missing_file) {
+			async_io io;
+			async_io_init(&io);
+			async_file file = {};
+			m_assert(!async_file_open("async_io_missing_file.bin", &file));
+			m_assert(async_file_open(file_name, &file));
+			uint8* buffer = async_io_buffer_alloc(4096);
+			async_io_request request = {};
+			request.file = &file;
+			request.offset = file.size - 100;
+			request.size = 4096;
+			request.buffer = buffer;
+			request.priority = async_io_priority_high;
+			job_counter counter = {};
+			request.counter = &counter;
+			async_io_read(&io, &request);
+			async_io_wait(&io, &counter);
+			m_assert(request.success && request.bytes_read == 100);
+			m_assert(check_bytes(buffer, file.size - 100, 100));
+			async_io_buffer_free(buffer, 4096);
+			async_file_close(&file);
+			async_io_destroy(&io);
+		}
+		remove(file_name);
+	}
+	m_test(profiler) {
+		m_case(capture_and_export) {
+			{
+				m_profile_zone("outside capture");
+			}
+			profiler_begin_capture();
+			{
+				m_profile_zone("outer");
+				{
+					m_profile_zone("inner");
+				}
+				m_profile_gauge("gauge", 3.5);
+			}
+			std::thread thread([] {
+				profiler_set_thread_name("test thread");
+				for (uint32 i = 0; i < 100; i += 1) {
+					m_profile_zone("thread zone");
+					m_profile_counter_add("test counter", 2);
+				}
+			});
+			thread.join();
+			profiler_frame();
+			profiler_end_capture();
+			{
+				m_profile_zone("after capture");
+			}
+			profiler_thread* this_thread = profiler_get_thread();
+			m_assert(this_thread->event_count == 4);
+			m_assert(!strcmp(this_thread->events[0].name, "inner"));
+			m_assert(!strcmp(this_thread->events[1].name, "gauge") && this_thread->events[1].value == 3.5);
+			m_assert(!strcmp(this_thread->events[2].name, "outer"));
+			m_assert(this_thread->events[2].duration >= this_thread->events[0].duration);
+			m_assert(this_thread->events[3].type == profiler_event_value && this_thread->events[3].value == 200);
+
+			const char* trace_file = "profiler_test_trace.json";
+			m_assert(profiler_export_chrome_trace(trace_file));
+			FILE* file = fopen(trace_file, "r");
+			m_assert(file);
+			static char trace[1 << 16];
+			size_t trace_size = fread(trace, 1, sizeof(trace) - 1, file);
+			trace[trace_size] = '\0';
+			fclose(file);
+			remove(trace_file);
+			m_assert(strstr(trace, "\"name\":\"test thread\""));
+			m_assert(strstr(trace, "\"name\":\"inner\",\"ph\":\"X\""));
+			m_assert(strstr(trace, "\"name\":\"test counter\",\"ph\":\"C\""));
+			m_assert(!strstr(trace, "outside capture") && !strstr(trace, "after capture"));
+
+			profiler_begin_capture();
+			profiler_end_capture();
+			m_assert(profiler_get_thread()->event_count == 0);
+		}
+		m_case(zone_cost) {
+			uint32 count = 100000;
+			timer timer = {};
+			timer_init(&timer);
+			timer_start(&timer);
+			for (uint32 i = 0; i < count; i += 1) {
+				m_profile_zone("idle zone");
+			}
+			timer_stop(&timer);
+			double idle_time = timer_get_duration(timer);
+			profiler_begin_capture();
+			timer_start(&timer);
+			for (uint32 i = 0; i < count; i += 1) {
+				m_profile_zone("capture zone");
+			}
+			timer_stop(&timer);
+			profiler_end_capture();
+			double capture_time = timer_get_duration(timer);
+			m_assert(profiler_get_thread()->event_count == count);
+			printf("(idle %.1f ns, capturing %.1f ns per zone) ", idle_time / count * 1e9, capture_time / count * 1e9);
+		}
+	}
+	m_test(memory_tracker) {
+		m_case(tags_and_threads) {
+			uint32 tag = memory_tag_register("test tag");
+			m_assert(memory_tag_register("test tag") == tag);
+			uint32 other_tag = memory_tag_register("test other tag");
+			m_assert(other_tag != tag);
+
+			memory_tag_stats stats[memory_tag_capacity];
+			uint32 tag_count = memory_tracker_snapshot(stats);
+			m_assert(tag_count > other_tag && !strcmp(stats[tag].name, "test tag"));
+			int64 base_bytes = stats[tag].bytes;
+			int64 base_count = stats[tag].count;
+
+			uint64* ptrs[4] = {};
+			std::thread threads[4];
+			for (uint32 i = 0; i < 4; i += 1) {
+				threads[i] = std::thread([&, i] {
+					for (uint32 j = 0; j < 1000; j += 1) {
+						memory_track_alloc(tag, 16);
+						memory_track_free(tag, 16);
+					}
+					ptrs[i] = memory_tracked_new<uint64>(tag, 100);
+				});
+			}
+			for (auto& thread : threads) {
+				thread.join();
+			}
+			tag_count = memory_tracker_snapshot(stats);
+			m_assert(stats[tag].bytes == base_bytes + 4 * 100 * sizeof(uint64));
+			m_assert(stats[tag].count == base_count + 4);
+			m_assert(stats[tag].peak_bytes >= stats[tag].bytes);
+			int64 peak_bytes = stats[tag].peak_bytes;
+
+			for (uint32 i = 0; i < 4; i += 1) {
+				memory_tracked_delete(tag, ptrs[i], 100);
+			}
+			tag_count = memory_tracker_snapshot(stats);
+			m_assert(stats[tag].bytes == base_bytes && stats[tag].count == base_count);
+			m_assert(stats[tag].peak_bytes == peak_bytes);
+		}
+		m_case(report) {
+			uint32 tag = memory_tag_register("test report tag");
+			memory_track_alloc(tag, 1234);
+			const char* report_file = "memory_tracker_test_report.json";
+			FILE* file = fopen(report_file, "w");
+			m_assert(file);
+			fprintf(file, "{");
+			memory_tracker_write_report(file, true);
+			fprintf(file, "}");
+			fclose(file);
+			file = fopen(report_file, "r");
+			m_assert(file);
+			static char report[1 << 16];
+			size_t report_size = fread(report, 1, sizeof(report) - 1, file);
+			report[report_size] = '\0';
+			fclose(file);
+			remove(report_file);
+			m_assert(strstr(report, "{\"name\":\"test report tag\",\"bytes\":1234,\"count\":1,\"peak_bytes\":1234}"));
+			memory_track_free(tag, 1234);
+		}
+		m_case(track_cost) {
+			uint32 tag = memory_tag_register("test cost tag");
+			uint32 count = 1000000;
+			timer timer = {};
+			timer_init(&timer);
+			timer_start(&timer);
+			for (uint32 i = 0; i < count; i += 1) {
+				memory_track_alloc(tag, i);
+			}
+			timer_stop(&timer);
+			memory_tag_stats stats[memory_tag_capacity];
+			memory_tracker_snapshot(stats);
+			m_assert(stats[tag].count == count);
+			printf("(%.1f ns per tracked allocation) ", timer_get_duration(timer) / count * 1e9);
+		}
+	}
+	m_test(concurrent_queue) {
+		m_case(spsc_wrap_and_batch) {
+			spsc_queue<uint32> queue;
+			spsc_queue_init(&queue, 6);
+			m_assert(queue.capacity == 8);
+			uint32 elems[16] = {};
+			for (uint32 i = 0; i < 16; i += 1) {
+				elems[i] = i;
+			}
+			for (uint32 round = 0; round < 100; round += 1) {
+				uint32 push_count = spsc_queue_try_push_batch(&queue, elems, 16);
+				m_assert(push_count == 8);
+				m_assert(!spsc_queue_try_push(&queue, 0u));
+				uint32 popped[16] = {};
+				m_assert(spsc_queue_try_pop_batch(&queue, popped, 3) == 3);
+				m_assert(spsc_queue_try_pop_batch(&queue, popped + 3, 16) == 5);
+				for (uint32 i = 0; i < 8; i += 1) {
+					m_assert(popped[i] == i);
+				}
+				uint32 elem = 0;
+				m_assert(!spsc_queue_try_pop(&queue, &elem));
+			}
+			spsc_queue_destroy(&queue);
+		}
+		m_case(spsc_threads) {
+			spsc_queue<uint64> queue;
+			spsc_queue_init(&queue, 1024);
+			uint64 count = 1000000;
+			std::thread producer([&] {
+				for (uint64 i = 0; i < count; i += 1) {
+					spsc_queue_push(&queue, i);
+				}
+			});
+			bool in_order = true;
+			for (uint64 i = 0; i < count; i += 1) {
+				in_order &= spsc_queue_pop(&queue) == i;
+			}
+			producer.join();
+			m_assert(in_order);
+			spsc_queue_destroy(&queue);
+		}
+		m_case(mpmc_threads) {
+			mpmc_queue<uint64> queue;
+			mpmc_queue_init(&queue, 256);
+			const uint32 producer_count = 4;
+			const uint32 consumer_count = 4;
+			const uint64 count_per_producer = 200000;
+			std::atomic<uint64> sum(0);
+			std::atomic<uint64> popped_count(0);
+			std::thread threads[producer_count + consumer_count];
+			for (uint32 i = 0; i < producer_count; i += 1) {
+				threads[i] = std::thread([&, i] {
+					uint64 batch[16];
+					for (uint64 j = 0; j < count_per_producer; j += 16) {
+						for (uint32 k = 0; k < 16; k += 1) {
+							batch[k] = i * count_per_producer + j + k;
+						}
+						mpmc_queue_push_batch(&queue, batch, 16);
+					}
+				});
+			}
+			for (uint32 i = 0; i < consumer_count; i += 1) {
+				threads[producer_count + i] = std::thread([&] {
+					uint64 local_sum = 0;
+					uint64 batch[8];
+					while (popped_count.load() < producer_count * count_per_producer) {
+						uint32 n = mpmc_queue_try_pop_batch(&queue, batch, 8);
+						for (uint32 k = 0; k < n; k += 1) {
+							local_sum += batch[k];
+						}
+						popped_count += n;
+					}
+					sum += local_sum;
+				});
+			}
+			for (auto& thread : threads) {
+				thread.join();
+			}
+			uint64 total = producer_count * count_per_producer;
+			m_assert(popped_count == total);
+			m_assert(sum == total * (total - 1) / 2);
+			mpmc_queue_destroy(&queue);
+		}
+		m_case(benchmark) {
+			const uint64 count = 4000000;
+			for (uint32 batch_size : { 1u, 32u }) {
+				spsc_queue<uint64> queue;
+				spsc_queue_init(&queue, 4096);
+				timer timer = {};
+				timer_init(&timer);
+				timer_start(&timer);
+				std::thread producer([&] {
+					uint64 batch[32];
+					for (uint64 i = 0; i < count; i += batch_size) {
+						for (uint32 k = 0; k < batch_size; k += 1) {
+							batch[k] = i + k;
+						}
+						spsc_queue_push_batch(&queue, batch, batch_size);
+					}
+				});
+				uint64 batch[32];
+				uint64 popped_count = 0;
+				while (popped_count < count) {
+					popped_count += spsc_queue_pop_batch(&queue, batch, batch_size);
+				}
+				producer.join();
+				timer_stop(&timer);
+				printf("\n  spsc batch %2u: %.1f M/s", batch_size, count / timer_get_duration(timer) / 1e6);
+				spsc_queue_destroy(&queue);
+			}
+			uint32 thread_counts[][2] = { { 1, 1 }, { 2, 2 }, { 4, 1 }, { 1, 4 }, { 4, 4 } };
+			for (uint32 batch_size : { 1u, 32u }) {
+				for (auto& thread_count : thread_counts) {
+					mpmc_queue<uint64> queue;
+					mpmc_queue_init(&queue, 4096);
+					uint64 count_per_producer = count / thread_count[0];
+					uint64 total = count_per_producer * thread_count[0];
+					std::atomic<uint64> popped_count(0);
+					std::thread threads[8];
+					timer timer = {};
+					timer_init(&timer);
+					timer_start(&timer);
+					for (uint32 i = 0; i < thread_count[0]; i += 1) {
+						threads[i] = std::thread([&] {
+							uint64 batch[32] = {};
+							for (uint64 j = 0; j < count_per_producer; j += batch_size) {
+								mpmc_queue_push_batch(&queue, batch, (uint32)min((uint64)batch_size, count_per_producer - j));
+							}
+						});
+					}
+					for (uint32 i = 0; i < thread_count[1]; i += 1) {
+						threads[thread_count[0] + i] = std::thread([&] {
+							uint64 batch[32];
+							uint32 spin_count = 0;
+							while (popped_count.load(std::memory_order_relaxed) < total) {
+								uint32 n = mpmc_queue_try_pop_batch(&queue, batch, batch_size);
+								if (n == 0) {
+									queue_backoff(&spin_count);
+								}
+								popped_count += n;
+							}
+						});
+					}
+					for (uint32 i = 0; i < thread_count[0] + thread_count[1]; i += 1) {
+						threads[i].join();
+					}
+					timer_stop(&timer);
+					printf("\n  mpmc batch %2u, %u producers %u consumers: %.1f M/s", batch_size, thread_count[0], thread_count[1], total / timer_get_duration(timer) / 1e6);
+					mpmc_queue_destroy(&queue);
+				}
+			}
+			printf("\n");
+		}
+	}
+	m_test(file_tokenizer) {
+		auto make_token = [](const char* str) {
+			token tk = { str, (int)strlen(str) };
+			return tk;
+		};
+		m_case(tokens) {
+			char data[] = "  model:\tassets/a.gpk\r\n\v\fx                                      0123456789012345678901234567890123456789  y\n";
+			char copy[sizeof(data)];
+			memcpy(copy, data, sizeof(data));
+			file_tokenizer ft = { nullptr, sizeof(data) - 1, data, 0 };
+			const char* expected[] = { "model:", "assets/a.gpk", "x", "0123456789012345678901234567890123456789", "y" };
+			token tk;
+			for (const char* e : expected) {
+				m_assert(ft.get_token(&tk) && tk.equals(e));
+			}
+			m_assert(!ft.get_token(&tk));
+			m_assert(!memcmp(data, copy, sizeof(data)));
+			m_assert(!make_token("model").equals("model:") && !make_token("model:").equals("model"));
+		}
+		m_case(to_float) {
+			const char* valid[] = { "0", "-0", "1", "+1.5", "-2.25", "3.", ".5", "1e10", "1.5E-3", "123.456789", "0.000001", "-1e-7",
+			                        "340282346638528859811704183484516925440", "1.17549435e-38", "0x1p3", "inf", "-nan",
+			                        "16777217", "0.1000000000000000055511151231257827021181583404541015625", "7.038531e-26" };
+			for (const char* str : valid) {
+				float f = 0;
+				m_assert(make_token(str).to_float(&f));
+				float expected = strtof(str, nullptr);
+				m_assert(!memcmp(&f, &expected, sizeof(f)) || (f != f && expected != expected));
+			}
+			const char* invalid[] = { "", "-", ".", "e5", "1e", "1e+", "1.5x", "1..5", "--1", "1e100", "abc" };
+			for (const char* str : invalid) {
+				float f = 0;
+				m_assert(!make_token(str).to_float(&f));
+			}
+			srand(14);
+			char str[64];
+			for (uint32 i = 0; i < 1000000; i += 1) {
+				int len = 0;
+				switch (i % 3) {
+				case 0: {
+					float v = (float)(rand() - RAND_MAX / 2) / (float)(rand() + 1) * powf(10.0f, (float)(rand() % 20 - 10));
+					len = snprintf(str, sizeof(str), "%.*g", rand() % 12 + 1, v);
+				} break;
+				case 1: {
+					len = snprintf(str, sizeof(str), "%f", (float)(rand() - RAND_MAX / 2) / 1024.0f);
+				} break;
+				case 2: {
+					int digit_count = rand() % 20 + 1;
+					int point = rand() % (digit_count + 1);
+					for (int j = 0; j < digit_count; j += 1) {
+						if (j == point) {
+							str[len++] = '.';
+						}
+						str[len++] = (char)('0' + rand() % 10);
+					}
+					len += snprintf(str + len, sizeof(str) - len, "e%d", rand() % 30 - 15);
+				} break;
+				}
+				float f = 0;
+				m_assert(make_token(str).to_float(&f));
+				float expected = strtof(str, nullptr);
+				m_assert(!memcmp(&f, &expected, sizeof(f)));
+			}
+		}
+		m_case(to_int) {
+			int64 i64 = 0;
+			int32 i32 = 0;
+			m_assert(make_token("0").to_int(&i64) && i64 == 0);
+			m_assert(make_token("-42").to_int(&i32) && i32 == -42);
+			m_assert(make_token("+7").to_int(&i32) && i32 == 7);
+			m_assert(make_token("9223372036854775807").to_int(&i64) && i64 == INT64_MAX);
+			m_assert(make_token("-9223372036854775808").to_int(&i64) && i64 == INT64_MIN);
+			m_assert(!make_token("9223372036854775808").to_int(&i64));
+			m_assert(!make_token("99999999999999999999").to_int(&i64));
+			m_assert(make_token("-2147483648").to_int(&i32) && i32 == INT32_MIN);
+			m_assert(!make_token("2147483648").to_int(&i32));
+			m_assert(!make_token("").to_int(&i32) && !make_token("-").to_int(&i32) && !make_token("1.0").to_int(&i32));
+		}
+		m_case(world_file_benchmark) {
+			const uint32 line_count = 1000000;
+			uint64 data_capacity = line_count * 96ull;
+			char* data = new char[data_capacity];
+			auto delete_data = scope_exit([&] { delete[] data; });
+			uint64 data_size = 0;
+			srand(1);
+			for (uint32 i = 0; i < line_count; i += 1) {
+				float v[7];
+				for (float& f : v) {
+					f = (float)(rand() - RAND_MAX / 2) / 1024.0f;
+				}
+				if (i % 4 == 0) {
+					data_size += snprintf(data + data_size, data_capacity - data_size, "model: assets/models/model_%u.gpk\n", i);
+				}
+				else if (i % 4 == 1) {
+					data_size += snprintf(data + data_size, data_capacity - data_size, "directional_light: %f %f %f %f %f %f\n", v[0], v[1], v[2], v[3], v[4], v[5]);
+				}
+				else {
+					data_size += snprintf(data + data_size, data_capacity - data_size, "spherical_light: %f %f %f %f %f %f %f\n", v[0], v[1], v[2], v[3], v[4], v[5], v[6]);
+				}
+			}
+			const char* world_file = "file_tokenizer_test_world.txt";
+			FILE* file = fopen(world_file, "wb");
+			m_assert(file && fwrite(data, 1, data_size, file) == data_size);
+			fclose(file);
+
+			timer timer = {};
+			timer_init(&timer);
+			timer_start(&timer);
+			file_tokenizer ft;
+			m_assert(file_tokenizer_init(&ft, world_file));
+			token tk;
+			uint32 token_count = 0;
+			double sum = 0;
+			while (ft.get_token(&tk)) {
+				float f;
+				if (tk.ptr[0] != 'm' && tk.ptr[0] != 'a' && tk.ptr[0] != 'd' && tk.ptr[0] != 's') {
+					m_assert(tk.to_float(&f));
+					sum += f;
+				}
+				token_count += 1;
+			}
+			file_tokenizer_delete(ft);
+			timer_stop(&timer);
+			remove(world_file);
+			double time = timer_get_duration(timer);
+
+			timer_start(&timer);
+			uint32 strtof_token_count = 0;
+			double strtof_sum = 0;
+			for (char* p = data; p < data + data_size;) {
+				while (p < data + data_size && isspace(*p)) {
+					p += 1;
+				}
+				if (p >= data + data_size) {
+					break;
+				}
+				char* token_begin = p;
+				while (p < data + data_size && !isspace(*p)) {
+					p += 1;
+				}
+				char c = *p;
+				*p = '\0';
+				if (*token_begin != 'm' && *token_begin != 'a' && *token_begin != 'd' && *token_begin != 's') {
+					strtof_sum += strtof(token_begin, nullptr);
+				}
+				*p = c;
+				strtof_token_count += 1;
+			}
+			timer_stop(&timer);
+			m_assert(token_count == strtof_token_count && sum == strtof_sum);
+			printf("(%.0f MB/s, isspace + strtof %.0f MB/s) ", data_size / time / 1e6, data_size / timer_get_duration(timer) / 1e6);
+		}
+	}
+	m_test(hash64) {
+		m_case(streaming_matches_one_shot) {
+			uint8 data[5000];
+			for (uint32 i = 0; i < m_countof(data); i += 1) {
+				data[i] = (uint8)(i * 131 + 7);
+			}
+			uint32 lens[] = { 0, 1, 3, 4, 8, 15, 16, 17, 33, 63, 64, 65, 127, 128, 129, 1023, 1024, 1025, 4999, 5000 };
+			uint32 splits[] = { 1, 7, 64, 100, 1000 };
+			for (uint32 len : lens) {
+				uint64 hash = hash64(data, len, 42);
+				for (uint32 split : splits) {
+					hash64_state state;
+					hash64_init(&state, 42);
+					for (uint32 i = 0; i < len; i += split) {
+						hash64_update(&state, data + i, min(split, len - i));
+					}
+					m_assert(hash64_final(&state) == hash);
+				}
+			}
+		}
+		m_case(sensitivity) {
+			uint8 data[3000] = {};
+			uint32 lens[] = { 1, 4, 16, 40, 64, 65, 200, 3000 };
+			for (uint32 len : lens) {
+				uint64 hash = hash64(data, len);
+				m_assert(hash != hash64(data, len - 1));
+				m_assert(hash != hash64(data, len, 1));
+				for (uint32 i = 0; i < len; i += max(len / 8, 1u)) {
+					data[i] ^= 1;
+					m_assert(hash != hash64(data, len));
+					data[i] ^= 1;
+				}
+			}
+		}
+		m_case(benchmark) {
+			// 16 MB buffer, about 32 MB hashed per size, so the default run stays short
+			uint32 sizes[] = { 16, 256, 4096, 1 << 20, 16 << 20 };
+			uint32 data_size = 16 << 20;
+			uint8* data = new uint8[data_size];
+			auto delete_data = scope_exit([&] { delete[] data; });
+			for (uint32 i = 0; i < data_size; i += 1) {
+				data[i] = (uint8)(i ^ (i >> 8));
+			}
+			for (uint32 size : sizes) {
+				uint32 iteration_count = max((32u << 20) / size, 2u);
+				uint64 sum = 0;
+				uint32 i = 0;
+				double ns = benchmark_ns(iteration_count, [&] {
+					sum += hash64(data + (i & 15), size - (i & 15));
+					i += 1;
+				});
+				double gb_per_second = size / ns * 1e9 / (1 << 30);
+				m_assert(sum != 0);
+				printf("(%u bytes %.2f GB/s) ", size, gb_per_second);
+			}
+		}
+	}
 	m_test(hash_map) {
 		m_case(insert) {
 			hash_map<string, int> map;
@@ -171,10 +955,10 @@ int main(int argc, char **argv) {
 			m_assert(hash_map_insert(&map, key, 0x1234));
 			m_assert(hash_map_get(&map, key, &value));
 			m_assert(value == 0x1234);
+			static char key_strs[1024][8];
 			for (int i = 0; i < 256; i += 1) {
-				char str[8];
-				snprintf(str, sizeof(str), "%d", i);
-				string key = { str, (uint32)strlen(str) };
+				snprintf(key_strs[i], sizeof(key_strs[i]), "%d", i);
+				string key = { key_strs[i], (uint32)strlen(key_strs[i]) };
 				m_assert(hash_map_insert(&map, key, i));
 			}
 			for (int i = 0; i < 256; i += 1) {
@@ -186,9 +970,8 @@ int main(int argc, char **argv) {
 				m_assert(value == i);
 			}
 			for (int i = 256; i < 1024; i += 1) {
-				char str[8];
-				snprintf(str, sizeof(str), "%d", i);
-				string key = { str, (uint32)strlen(str) };
+				snprintf(key_strs[i], sizeof(key_strs[i]), "%d", i);
+				string key = { key_strs[i], (uint32)strlen(key_strs[i]) };
 				m_assert(hash_map_insert(&map, key, i));
 			}
 			for (int i = 256; i < 1024; i += 1) {
@@ -202,6 +985,198 @@ int main(int argc, char **argv) {
 			m_assert(hash_map_remove(&map, key));
 			hash_map_delete(&map);
 		}
+		m_case(const_char_lookup) {
+			hash_map<string, int> map;
+			hash_map_initialize(&map, 16);
+			string key = { "models/sponza.gpk", (uint32)strlen("models/sponza.gpk") };
+			m_assert(hash_map_insert(&map, key, 7));
+			int value = 0;
+			m_assert(hash_map_get(&map, "models/sponza.gpk", &value));
+			m_assert(value == 7);
+			m_assert(!hash_map_find(&map, "models/sponza"));
+			m_assert(hash_map_remove(&map, "models/sponza.gpk"));
+			m_assert(map.size == 0);
+			hash_map_delete(&map);
+		}
+		m_case(remove_keeps_probe_chains) {
+			hash_map<uint64, uint64> map;
+			hash_map_initialize(&map, 16);
+			hash_map_reserve(&map, 10000);
+			uint32 capacity = map.capacity;
+			for (uint64 i = 0; i < 10000; i += 1) {
+				m_assert(hash_map_insert(&map, i, i * 3));
+			}
+			m_assert(map.capacity == capacity);
+			m_assert(!hash_map_insert(&map, (uint64)5, (uint64)0));
+			for (uint64 i = 0; i < 10000; i += 2) {
+				m_assert(hash_map_remove(&map, i));
+			}
+			m_assert(map.size == 5000);
+			for (uint64 i = 0; i < 10000; i += 1) {
+				uint64* value = hash_map_find(&map, i);
+				m_assert((i % 2 == 0) ? !value : (value && *value == i * 3));
+			}
+			hash_map_delete(&map);
+		}
+		m_case(struct_key) {
+			struct cell {
+				int32 x, y, z;
+				bool operator==(const cell& c) const { return x == c.x && y == c.y && z == c.z; }
+			};
+			hash_map<cell, uint32> map;
+			hash_map_initialize(&map, 16);
+			for (int32 i = 0; i < 1000; i += 1) {
+				m_assert(hash_map_insert(&map, cell{ i, -i, i * 7 }, (uint32)i));
+			}
+			uint32 value = 0;
+			m_assert(hash_map_get(&map, cell{ 500, -500, 3500 }, &value));
+			m_assert(value == 500);
+			m_assert(!hash_map_find(&map, cell{ 500, 500, 3500 }));
+			hash_map_delete(&map);
+		}
+		m_case(heterogeneous_lookup) {
+			hash_map<uint64, uint32> map;
+			hash_map_initialize(&map, 16);
+			for (uint64 i = 0; i < 1000; i += 1) {
+				m_assert(hash_map_insert(&map, i * 977, (uint32)i));
+			}
+			for (uint32 i = 0; i < 1000; i += 1) {
+				uint32* value = hash_map_find(&map, i * 977u);
+				m_assert(value && *value == i);
+			}
+			m_assert(hash_map_remove(&map, 977));
+			m_assert(!hash_map_find(&map, 977));
+			hash_map_delete(&map);
+		}
+		m_case(benchmark) {
+			for (uint32 count : { 1000u, 100000u, 1000000u, 10000000u }) {
+				uint64* keys = new uint64[count];
+				for (uint32 i = 0; i < count; i += 1) {
+					keys[i] = ((uint64)i * 0x9e3779b97f4a7c15ull) ^ 0xdeadbeef;
+				}
+				timer timer = {};
+				timer_init(&timer);
+				hash_map<uint64, uint32> map;
+				hash_map_initialize(&map, 16);
+				timer_start(&timer);
+				for (uint32 i = 0; i < count; i += 1) {
+					hash_map_insert(&map, keys[i], i);
+				}
+				timer_stop(&timer);
+				double insert_time = timer_get_duration(timer);
+				uint64 sum = 0;
+				timer_start(&timer);
+				for (uint32 i = 0; i < count; i += 1) {
+					sum += *hash_map_find(&map, keys[(uint64)i * 7919 % count]);
+				}
+				timer_stop(&timer);
+				double lookup_time = timer_get_duration(timer);
+				m_assert(sum == (uint64)count * (count - 1) / 2);
+				hash_map_delete(&map);
+
+				std::unordered_map<uint64, uint32> std_map;
+				timer_start(&timer);
+				for (uint32 i = 0; i < count; i += 1) {
+					std_map.insert({ keys[i], i });
+				}
+				timer_stop(&timer);
+				double std_insert_time = timer_get_duration(timer);
+				sum = 0;
+				timer_start(&timer);
+				for (uint32 i = 0; i < count; i += 1) {
+					sum += std_map.find(keys[(uint64)i * 7919 % count])->second;
+				}
+				timer_stop(&timer);
+				double std_lookup_time = timer_get_duration(timer);
+				m_assert(sum == (uint64)count * (count - 1) / 2);
+				printf("\n  %8u entries: insert %.1f ns (std %.1f ns), lookup %.1f ns (std %.1f ns)", count,
+					insert_time * 1e9 / count, std_insert_time * 1e9 / count, lookup_time * 1e9 / count, std_lookup_time * 1e9 / count);
+				delete[] keys;
+			}
+			printf("\n");
+		}
+	}
+	m_test(atom) {
+		m_case(intern) {
+			atom a = atom_intern("models/sponza.gpk");
+			char path[] = "models/sponza.gpk";
+			atom b = atom_intern(path);
+			atom c = atom_intern("models/sponza.gpk", 6);
+			m_assert(a == b);
+			m_assert(a != c);
+			m_assert(!strcmp(atom_str(a), "models/sponza.gpk"));
+			m_assert(atom_len(c) == 6 && !strcmp(atom_str(c), "models"));
+			m_assert(atom_intern("") == atom{ 0 });
+			atom found = {};
+			m_assert(atom_find("models", &found) && found == c);
+			m_assert(!atom_find("models/", &found));
+		}
+		m_case(stable_pointers) {
+			const char* str = atom_str(atom_intern("stable"));
+			for (uint32 i = 0; i < 100000; i += 1) {
+				char name[32];
+				snprintf(name, sizeof(name), "object_%u", i);
+				atom_intern(name);
+			}
+			m_assert(atom_str(atom_intern("stable")) == str);
+			atom found = {};
+			m_assert(atom_find("object_99999", &found));
+		}
+	}
+	m_test(memory_arena) {
+		memory_arena arena = {};
+		memory_arena_init(m_gigabytes(1), &arena);
+		auto destroy_arena = scope_exit([&] {
+			memory_arena_destroy(&arena);
+		});
+		m_case(commit_on_demand) {
+			m_assert(arena.committed == 0);
+			uint8* bytes = memory_arena_alloc<uint8>(&arena, m_megabytes(3));
+			m_assert(bytes);
+			m_assert(arena.committed >= m_megabytes(3) && arena.committed < m_megabytes(4));
+			bytes[m_megabytes(3) - 1] = 1;
+			memory_arena_reset(&arena);
+		}
+		m_case(nested_markers) {
+			memory_arena_marker marker_0 = memory_arena_get_marker(&arena);
+			uint32* a = memory_arena_alloc<uint32>(&arena, 16);
+			memory_arena_marker marker_1 = memory_arena_get_marker(&arena);
+			memory_arena_alloc<uint32>(&arena, 1024);
+			{
+				memory_arena_undo_alloc_scope_exit undo_alloc(&arena);
+				memory_arena_alloc<uint32>(&arena, 1024);
+			}
+			m_assert(arena.size == marker_1.size + 1024 * sizeof(uint32));
+			memory_arena_rewind(&arena, marker_1);
+			m_assert(memory_arena_alloc<uint32>(&arena, 1) == a + 16);
+			memory_arena_rewind(&arena, marker_0);
+			m_assert(arena.size == marker_0.size);
+		}
+		m_case(zero_after_rewind) {
+			memory_arena_marker marker = memory_arena_get_marker(&arena);
+			uint32* a = memory_arena_alloc<uint32>(&arena, 256);
+			for (uint32 i = 0; i < 256; i += 1) {
+				a[i] = 0xffffffff;
+			}
+			memory_arena_rewind(&arena, marker);
+			uint32* b = memory_arena_alloc<uint32>(&arena, 512);
+			m_assert(a == b);
+			for (uint32 i = 0; i < 512; i += 1) {
+				m_assert(b[i] == 0);
+			}
+			memory_arena_reset(&arena);
+		}
+		m_case(peak_and_trim) {
+			memory_arena_alloc<uint8>(&arena, m_megabytes(64));
+			memory_arena_reset(&arena);
+			memory_arena_alloc<uint8>(&arena, 16);
+			m_assert(arena.peak_size >= m_megabytes(64));
+			memory_arena_trim(&arena);
+			m_assert(arena.committed == arena.commit_granularity);
+			uint8* bytes = memory_arena_alloc<uint8>(&arena, m_megabytes(8));
+			m_assert(bytes[m_megabytes(8) - 1] == 0);
+			memory_arena_reset(&arena);
+		}
 	}
 	m_test(memory_pool) {
 		memory_pool memory_pool = {};
@@ -229,8 +1204,78 @@ int main(int argc, char **argv) {
 			m_assert(!block);
 			memory_pool_clear(&memory_pool);
 		}
+		m_case(concurrent_alloc_free) {
+			job_system js = {};
+			job_system_init(&js, 8);
+			struct memory_pool concurrent_pool = {};
+			memory_arena_init(&concurrent_pool, 16384, sizeof(mat4), alignof(mat4), js.worker_count);
+			std::atomic<uint32> corrupt_count(0);
+			std::atomic<uint32> null_count(0);
+			parallel_for(&js, 256, 1, [&](uint64 begin, uint64 end) {
+				mat4* blocks[32];
+				for (uint32 round = 0; round < 256; round += 1) {
+					for (uint32 i = 0; i < m_countof(blocks); i += 1) {
+						blocks[i] = memory_pool_alloc<mat4>(&concurrent_pool);
+						if (!blocks[i]) {
+							null_count.fetch_add(1);
+							continue;
+						}
+						blocks[i]->c1.e[0] = (float)begin;
+						blocks[i]->c4.e[3] = (float)(round * 32 + i);
+					}
+					for (uint32 i = 0; i < m_countof(blocks); i += 1) {
+						if (blocks[i]) {
+							if (blocks[i]->c1.e[0] != (float)begin || blocks[i]->c4.e[3] != (float)(round * 32 + i)) {
+								corrupt_count.fetch_add(1);
+							}
+							memory_pool_free(&concurrent_pool, blocks[i]);
+						}
+					}
+				}
+			});
+			job_system_destroy(&js);
+			m_assert(corrupt_count.load() == 0);
+			m_assert(null_count.load() == 0);
+			memory_pool_flush_caches(&concurrent_pool);
+			uint32 free_block_count = 0;
+			while (memory_pool_alloc<mat4>(&concurrent_pool)) {
+				free_block_count += 1;
+			}
+			m_assert(free_block_count == 16384);
+			memory_pool_destroy(&concurrent_pool);
+		}
+		m_case(benchmark_vs_malloc) {
+			job_system js = {};
+			job_system_init(&js, 8);
+			struct memory_pool benchmark_pool = {};
+			memory_arena_init(&benchmark_pool, 16384, sizeof(mat4), alignof(mat4), js.worker_count);
+			auto run_benchmark = [&](auto alloc, auto free) {
+				return benchmark_ns(1, [&] {
+					parallel_for(&js, 64, 1, [&](uint64, uint64) {
+						mat4* blocks[64];
+						for (uint32 round = 0; round < 2048; round += 1) {
+							for (uint32 i = 0; i < m_countof(blocks); i += 1) {
+								blocks[i] = alloc();
+								blocks[i]->c1.x = 1;
+							}
+							for (uint32 i = 0; i < m_countof(blocks); i += 1) {
+								free(blocks[i]);
+							}
+						}
+					});
+				});
+			};
+			double pool_time = run_benchmark([&] { return memory_pool_alloc<mat4>(&benchmark_pool); }, [&](mat4* block) { memory_pool_free(&benchmark_pool, block); });
+			double malloc_time = run_benchmark([] { return (mat4*)malloc(sizeof(mat4)); }, [](mat4* block) { ::free(block); });
+			printf("(pool %.2f ms, malloc %.2f ms) ", pool_time / 1e6, malloc_time / 1e6);
+			job_system_destroy(&js);
+			memory_pool_destroy(&benchmark_pool);
+		}
 	}
 	m_test(collision) {
+#ifdef MATH_AVX
+		bool avx = simd_current_isa >= simd_isa_avx2;
+#endif
 		m_case(ray_hit_sphere) {
 			float h;
 			sphere s = { {0, 0, 0}, 1 };
@@ -258,8 +1303,443 @@ int main(int argc, char **argv) {
 			vec3 hp = {};
 			m_assert(ray_hit_triangle(ray, a, b, c, &h, &hp));
 		}
+		m_case(ray_hit_triangles) {
+			const uint32 triangle_count = 1003;
+			vec3* vertices = new vec3[triangle_count * 3];
+			trianglex4* triangles4 = new trianglex4[triangle_count / 4 + 1];
+			trianglex4_watertight* watertight4 = new trianglex4_watertight[triangle_count / 4 + 1];
+			auto delete_arrays = scope_exit([&] { delete[] vertices; delete[] triangles4; delete[] watertight4; });
+			for (uint32 i = 0; i < triangle_count; i += 1) {
+				vec3 center = { random_float(-10, 10), random_float(-10, 10), random_float(-10, 10) };
+				for (uint32 j = 0; j < 3; j += 1) {
+					vertices[i * 3 + j] = center + vec3{ random_float(-10, 10), random_float(-10, 10), random_float(-10, 10) } * 0.2f;
+				}
+			}
+			uint32 packet_count4 = trianglex4_pack(vertices, triangle_count, triangles4);
+			m_assert(packet_count4 == triangle_count / 4 + 1);
+			m_assert(trianglex4_watertight_pack(vertices, triangle_count, watertight4) == packet_count4);
+			// padding lanes must not have exactly zero edge functions, which would send every ray through the double recompute
+			m_assert(std::isnan(floatx4_get(watertight4[packet_count4 - 1].a.x, triangle_count % 4)));
+#ifdef MATH_AVX
+			// new only guarantees 16 byte alignment before c++17
+			trianglex8* triangles8 = (trianglex8*)_mm_malloc(sizeof(trianglex8) * (triangle_count / 8 + 1), 32);
+			trianglex8_watertight* watertight8 = (trianglex8_watertight*)_mm_malloc(sizeof(trianglex8_watertight) * (triangle_count / 8 + 1), 32);
+			auto delete_arrays8 = scope_exit([&] { _mm_free(triangles8); _mm_free(watertight8); });
+			uint32 packet_count8 = 0;
+			if (avx) {
+				packet_count8 = trianglex8_pack(vertices, triangle_count, triangles8);
+				m_assert(trianglex8_watertight_pack(vertices, triangle_count, watertight8) == packet_count8);
+			}
+#endif
+			uint32 hit_count = 0;
+			for (uint32 n = 0; n < 256; n += 1) {
+				ray ray = { { random_float(-10, 10), random_float(-10, 10), random_float(-10, 10) }, vec3_normalize({ random_float(-10, 10), random_float(-10, 10), random_float(-10, 10) + 0.001f }), 15 };
+				float reference_hit = 2;
+				uint32 reference_index = UINT32_MAX;
+				vec3 reference_barycentric = {};
+				for (uint32 i = 0; i < triangle_count; i += 1) {
+					float h;
+					vec3 barycentric;
+					if (ray_hit_triangle(ray, vertices[i * 3], vertices[i * 3 + 1], vertices[i * 3 + 2], &h, nullptr, &barycentric) && h < reference_hit) {
+						reference_hit = h;
+						reference_index = i;
+						reference_barycentric = barycentric;
+					}
+				}
+				float h;
+				uint32 index;
+				vec3 barycentric;
+				auto check = [&](bool result) {
+					m_assert(result == (reference_index != UINT32_MAX));
+					if (result) {
+						// two hits closer than the formulas' rounding may come back in either order
+						m_assert(fabsf(h - reference_hit) < 1e-5f);
+						if (index == reference_index) {
+							m_assert(vec3_len(barycentric - reference_barycentric) < 1e-4f);
+						}
+					}
+				};
+				check(ray_hit_triangles(ray, triangles4, packet_count4, &h, &index, &barycentric));
+				check(ray_hit_triangles_watertight(ray, watertight4, packet_count4, &h, &index, &barycentric));
+#ifdef MATH_AVX
+				if (avx) {
+					check(ray_hit_triangles(ray, triangles8, packet_count8, &h, &index, &barycentric));
+					check(ray_hit_triangles_watertight(ray, watertight8, packet_count8, &h, &index, &barycentric));
+				}
+#endif
+				ray_watertight watertight_ray = ray_watertight_precompute(ray);
+				for (uint32 i = 0; i < triangle_count; i += 1) {
+					m_assert(ray_hit_triangle_watertight(watertight_ray, vertices[i * 3], vertices[i * 3 + 1], vertices[i * 3 + 2]) ==
+					         ray_hit_triangle(ray, vertices[i * 3], vertices[i * 3 + 1], vertices[i * 3 + 2]));
+				}
+				hit_count += reference_index != UINT32_MAX ? 1 : 0;
+			}
+			m_assert(hit_count > 16);
+		}
+		m_case(ray_hit_triangles_edges_and_vertices) {
+			// a closed height field, rays aimed at its interior edges and vertices must always hit one of the triangles
+			const uint32 grid_size = 16;
+			vec3 grid[grid_size + 1][grid_size + 1];
+			for (uint32 y = 0; y <= grid_size; y += 1) {
+				for (uint32 x = 0; x <= grid_size; x += 1) {
+					grid[y][x] = { x + (rand() % 101 - 50) / 200.0f, y + (rand() % 101 - 50) / 200.0f, (rand() % 101) / 100.0f };
+				}
+			}
+			const uint32 triangle_count = grid_size * grid_size * 2;
+			vec3 vertices[triangle_count * 3];
+			for (uint32 y = 0; y < grid_size; y += 1) {
+				for (uint32 x = 0; x < grid_size; x += 1) {
+					vec3* v = vertices + (y * grid_size + x) * 6;
+					v[0] = grid[y][x], v[1] = grid[y][x + 1], v[2] = grid[y + 1][x + 1];
+					v[3] = grid[y][x], v[4] = grid[y + 1][x + 1], v[5] = grid[y + 1][x];
+				}
+			}
+			trianglex4_watertight watertight4[triangle_count / 4];
+			trianglex4 triangles4[triangle_count / 4];
+			trianglex4_watertight_pack(vertices, triangle_count, watertight4);
+			trianglex4_pack(vertices, triangle_count, triangles4);
+#ifdef MATH_AVX
+			trianglex8_watertight watertight8[triangle_count / 8];
+			if (avx) {
+				trianglex8_watertight_pack(vertices, triangle_count, watertight8);
+			}
+#endif
+			uint32 moller_trumbore_misses = 0;
+			uint32 ray_count = 0;
+			for (uint32 y = 1; y < grid_size; y += 1) {
+				for (uint32 x = 1; x < grid_size; x += 1) {
+					vec3 targets[4] = { grid[y][x], (grid[y][x] + grid[y][x + 1]) * 0.5f, (grid[y][x] + grid[y + 1][x]) * 0.5f, (grid[y][x] + grid[y + 1][x + 1]) * 0.5f };
+					for (vec3 target : targets) {
+						for (uint32 i = 0; i < 4; i += 1) {
+							vec3 origin = target + vec3{ (rand() % 101 - 50) / 10.0f, (rand() % 101 - 50) / 10.0f, 20 };
+							ray ray = { origin, vec3_normalize(target - origin), 100 };
+							float h;
+							uint32 index;
+							vec3 barycentric;
+							m_assert(ray_hit_triangles_watertight(ray, watertight4, triangle_count / 4, &h, &index, &barycentric));
+							m_assert(barycentric.x >= -1e-6f && barycentric.y >= 0 && barycentric.z >= 0);
+							m_assert(fabsf(barycentric.x + barycentric.y + barycentric.z - 1) < 1e-5f);
+#ifdef MATH_AVX
+							if (avx) {
+								m_assert(ray_hit_triangles_watertight(ray, watertight8, triangle_count / 8));
+							}
+#endif
+							moller_trumbore_misses += ray_hit_triangles(ray, triangles4, triangle_count / 4) ? 0 : 1;
+							ray_count += 1;
+						}
+					}
+				}
+			}
+			printf("(moller-trumbore missed %u of %u edge and vertex rays) ", moller_trumbore_misses, ray_count);
+		}
+		m_case(ray_hit_triangles_benchmark) {
+			const uint32 triangle_count = 4096;
+			vec3* vertices = new vec3[triangle_count * 3];
+			trianglex4* triangles4 = new trianglex4[triangle_count / 4];
+			trianglex4_watertight* watertight4 = new trianglex4_watertight[triangle_count / 4];
+			auto delete_arrays = scope_exit([&] { delete[] vertices; delete[] triangles4; delete[] watertight4; });
+			for (uint32 i = 0; i < triangle_count * 3; i += 1) {
+				vertices[i] = { (rand() % 2001 - 1000) / 100.0f, (rand() % 2001 - 1000) / 100.0f, (rand() % 2001 - 1000) / 100.0f };
+			}
+			trianglex4_pack(vertices, triangle_count, triangles4);
+			trianglex4_watertight_pack(vertices, triangle_count, watertight4);
+			ray ray = { { 0, 0, -20 }, { 0, 0, 1 }, 40 };
+			auto rate = [&](auto&& f) {
+				uint32 hits = 0;
+				double ns = benchmark_ns(100, [&] { hits += f() ? 1 : 0; });
+				m_assert(hits == 0 || hits == 100);
+				return triangle_count / ns * 1e3;
+			};
+			double scalar = rate([&] {
+				bool hit = false;
+				for (uint32 i = 0; i < triangle_count; i += 1) {
+					hit |= ray_hit_triangle(ray, vertices[i * 3], vertices[i * 3 + 1], vertices[i * 3 + 2]);
+				}
+				return hit;
+			});
+			double moller_trumbore4 = rate([&] { return ray_hit_triangles(ray, triangles4, triangle_count / 4); });
+			double watertight4_rate = rate([&] { return ray_hit_triangles_watertight(ray, watertight4, triangle_count / 4); });
+			printf("(Mtri-tests/s: scalar %.0f, x4 %.0f, watertight x4 %.0f", scalar, moller_trumbore4, watertight4_rate);
+#ifdef MATH_AVX
+			if (avx) {
+				trianglex8* triangles8 = (trianglex8*)_mm_malloc(sizeof(trianglex8) * (triangle_count / 8), 32);
+				trianglex8_watertight* watertight8 = (trianglex8_watertight*)_mm_malloc(sizeof(trianglex8_watertight) * (triangle_count / 8), 32);
+				auto delete_arrays8 = scope_exit([&] { _mm_free(triangles8); _mm_free(watertight8); });
+				trianglex8_pack(vertices, triangle_count, triangles8);
+				trianglex8_watertight_pack(vertices, triangle_count, watertight8);
+				double moller_trumbore8 = rate([&] { return ray_hit_triangles(ray, triangles8, triangle_count / 8); });
+				double watertight8_rate = rate([&] { return ray_hit_triangles_watertight(ray, watertight8, triangle_count / 8); });
+				printf(", x8 %.0f, watertight x8 %.0f", moller_trumbore8, watertight8_rate);
+			}
+#endif
+			printf(") ");
+		}
+		m_case(ray_hit_aabb_edge_cases) {
+			aabb box = { { -1, -1, -1 }, { 1, 1, 1 } };
+			auto hit = [&](ray r, aabb b, float* h) {
+				return ray_hit_aabb(ray_precompute(r), b, h);
+			};
+			float h;
+			m_assert(hit({ { 0, 0, -5 }, { 0, 0, 1 }, 10 }, box, &h) && h == 4);
+			m_assert(hit({ { 0, 0, 0 }, { 0, 0, 1 }, 10 }, box, &h) && h == 0);
+			m_assert(!hit({ { 0, 0, -5 }, { 0, 0, -1 }, 10 }, box, &h));
+			m_assert(!hit({ { 0, 0, -5 }, { 0, 0, 1 }, 3.9f }, box, &h));
+			m_assert(hit({ { 0, 0, -5 }, { 0, 0, 1 }, 4 }, box, &h));
+			// axis parallel rays, the zero components give infinite reciprocals, -0 flips which plane is entered first
+			m_assert(hit({ { 0.5f, -0.5f, -5 }, { 0, -0.0f, 1 }, 10 }, box, &h) && h == 4);
+			m_assert(!hit({ { 2, 0, -5 }, { 0, 0, 1 }, 10 }, box, &h));
+			m_assert(!hit({ { -2, 0, -5 }, { -0.0f, 0, 1 }, 10 }, box, &h));
+			// origin on a face plane with a zero component, 0 * inf is NaN and the slab is ignored
+			m_assert(hit({ { 1, 0, -5 }, { 0, 0, 1 }, 10 }, box, &h) && h == 4);
+			m_assert(hit({ { -1, 1, -5 }, { -0.0f, 0, 1 }, 10 }, box, &h) && h == 4);
+			// ray_hit_aabb only ignores the NaN when it comes from the entry plane
+			m_assert(ray_hit_aabb(ray{ { 1, 0, -5 }, { 0, 0, 1 }, 10 }, box));
+			m_assert(!ray_hit_aabb(ray{ { -1, 1, -5 }, { -0.0f, 0, 1 }, 10 }, box));
+			// grazing an edge and a flat box
+			m_assert(hit({ { -5, -5, 1 }, vec3_normalize({ 1, 1, 0 }), 20 }, box, &h));
+			m_assert(hit({ { 0, 0, -5 }, { 0, 0, 1 }, 10 }, aabb{ { -1, -1, 0 }, { 1, 1, 0 } }, &h) && h == 5);
+			m_assert(!hit({ { 0, 0, -5 }, { 0, 0, 1 }, 4.5f }, aabb{ { -1, -1, 0 }, { 1, 1, 0 } }, &h));
+		}
+		m_case(ray_hit_aabb_wide) {
+			const uint32 count = 4096;
+			aabb* boxes = new aabb[count];
+			ray* rays = new ray[count];
+			auto delete_arrays = scope_exit([&] { delete[] boxes; delete[] rays; });
+			for (uint32 i = 0; i < count; i += 1) {
+				vec3 center = { random_float(-10, 10), random_float(-10, 10), random_float(-10, 10) };
+				vec3 extent = { fabsf(random_float(-10, 10)) * 0.3f, fabsf(random_float(-10, 10)) * 0.3f, fabsf(random_float(-10, 10)) * 0.3f };
+				boxes[i] = { center - extent, center + extent };
+				// aim around the ray's own box or the first box of its packet, so both wide variants see hits and misses
+				aabb target_box = boxes[(i % 2) ? i : (i & ~7u)];
+				vec3 target = (target_box.min + target_box.max) * 0.5f + (target_box.max - target_box.min) * vec3{ random_float(-10, 10), random_float(-10, 10), random_float(-10, 10) } * 0.1f;
+				vec3 origin = { random_float(-10, 10), random_float(-10, 10), random_float(-10, 10) };
+				vec3 dir = target - origin;
+				for (uint32 j = 0; j < 3; j += 1) {
+					if (i % 7 == j) {
+						dir[j] = (i % 2) ? 0.0f : -0.0f;
+					}
+				}
+				rays[i] = { origin, vec3_normalize(dir), 40 };
+				if (i % 11 == 0) {
+					rays[i].origin.x = boxes[i].min.x;
+				}
+			}
+			uint32 hit_count = 0;
+			for (uint32 i = 0; i < count; i += 1) {
+				bool reference = ray_hit_aabb(rays[i], boxes[i]);
+				hit_count += reference ? 1 : 0;
+				// division and reciprocal multiplication can only disagree on rays grazing the box
+				if (i % 11 != 0 && ray_hit_aabb(ray_precompute(rays[i]), boxes[i]) != reference) {
+					vec3 epsilon = { 1e-3f, 1e-3f, 1e-3f };
+					m_assert(ray_hit_aabb(rays[i], aabb{ boxes[i].min - epsilon, boxes[i].max + epsilon }));
+					m_assert(!ray_hit_aabb(rays[i], aabb{ boxes[i].min + epsilon, boxes[i].max - epsilon }));
+				}
+			}
+			m_assert(hit_count > count / 20);
+			for (uint32 n = 0; n < count; n += 8) {
+				ray_precomputed ray = ray_precompute(rays[n]);
+				floatx4 hits4;
+				uint32 bits4 = mask_bits(ray_hit_aabb(ray, aabbx4_load(boxes + n), &hits4)) | (mask_bits(ray_hit_aabb(ray, aabbx4_load(boxes + n + 4))) << 4);
+				ray_precomputedx4 rays4 = ray_precomputedx4_load(rays + n);
+				floatx4 packet_hits4;
+				uint32 packet_bits4 = mask_bits(ray_hit_aabb(rays4, boxes[n], &packet_hits4));
+				for (uint32 i = 0; i < 8; i += 1) {
+					float h;
+					m_assert(((bits4 >> i) & 1) == (ray_hit_aabb(ray, boxes[n + i], &h) ? 1u : 0u));
+					if (i < 4) {
+						m_assert(floatx4_get(hits4, i) == h);
+						float packet_h;
+						m_assert(((packet_bits4 >> i) & 1) == (ray_hit_aabb(ray_precompute(rays[n + i]), boxes[n], &packet_h) ? 1u : 0u));
+						m_assert(floatx4_get(packet_hits4, i) == packet_h);
+					}
+				}
+#ifdef MATH_AVX
+				if (avx) {
+					floatx8 hits8;
+					m_assert(mask_bits(ray_hit_aabb(ray, aabbx8_load(boxes + n), &hits8)) == bits4);
+					floatx8 packet_hits8;
+					uint32 packet_bits8 = mask_bits(ray_hit_aabb(ray_precomputedx8_load(rays + n), boxes[n], &packet_hits8));
+					for (uint32 i = 0; i < 8; i += 1) {
+						float h;
+						ray_hit_aabb(ray, boxes[n + i], &h);
+						m_assert(floatx8_get(hits8, i) == h);
+						m_assert(((packet_bits8 >> i) & 1) == (ray_hit_aabb(ray_precompute(rays[n + i]), boxes[n], &h) ? 1u : 0u));
+						m_assert(floatx8_get(packet_hits8, i) == h);
+					}
+				}
+#endif
+			}
+			auto time = [&](auto&& f) {
+				uint32 hits = 0;
+				uint32 n = 0;
+				double ns = benchmark_ns(100, [&] { hits += f(rays[n++]); });
+				m_assert(hits > 0);
+				return ns / count;
+			};
+			double divide = time([&](ray r) {
+				uint32 hits = 0;
+				for (uint32 i = 0; i < count; i += 1) {
+					hits += ray_hit_aabb(r, boxes[i]) ? 1 : 0;
+				}
+				return hits;
+			});
+			double precomputed = time([&](ray r) {
+				ray_precomputed ray = ray_precompute(r);
+				uint32 hits = 0;
+				for (uint32 i = 0; i < count; i += 1) {
+					hits += ray_hit_aabb(ray, boxes[i]) ? 1 : 0;
+				}
+				return hits;
+			});
+			aabbx4* boxes4 = new aabbx4[count / 4];
+			auto delete_boxes4 = scope_exit([&] { delete[] boxes4; });
+			for (uint32 i = 0; i < count / 4; i += 1) {
+				boxes4[i] = aabbx4_load(boxes + i * 4);
+			}
+			double wide4 = time([&](ray r) {
+				ray_precomputed ray = ray_precompute(r);
+				uint32 hits = 0;
+				for (uint32 i = 0; i < count / 4; i += 1) {
+					hits += pop_count(mask_bits(ray_hit_aabb(ray, boxes4[i])));
+				}
+				return hits;
+			});
+			printf("(ns per box: divide %.2f, precomputed %.2f, x4 %.2f) ", divide, precomputed, wide4);
+		}
+	}
+	m_test(frustum) {
+#ifdef MATH_AVX
+		bool avx = simd_current_isa >= simd_isa_avx2;
+#endif
+		camera camera = { { 0, 0, 0 }, { 0, 0, -1 }, 1, (float)M_PI / 2, 1, 100 };
+		frustum frustum = camera_frustum(camera);
+		auto point_inside = [&](vec3 p) {
+			for (const plane& plane : frustum.planes) {
+				if (vec3_dot(plane.normal, p) < plane.distance - 1e-4f) {
+					return false;
+				}
+			}
+			return true;
+		};
+		m_case(planes) {
+			m_assert(point_inside({ 0, 0, -1 }));
+			m_assert(point_inside({ 0, 0, -100 }));
+			m_assert(point_inside({ 9.9f, -9.9f, -10 }));
+			m_assert(!point_inside({ 0, 0, -0.9f }));
+			m_assert(!point_inside({ 0, 0, -100.1f }));
+			m_assert(!point_inside({ 10.1f, 0, -10 }));
+			m_assert(!point_inside({ 0, -10.1f, -10 }));
+			m_assert(!point_inside({ 0, 0, 10 }));
+			for (const plane& plane : frustum.planes) {
+				m_assert(fabsf(vec3_len(plane.normal) - 1) < 1e-5f);
+			}
+		}
+		m_case(aabbs) {
+			aabb unit = { { -1, -1, -1 }, { 1, 1, 1 } };
+			m_assert(frustum_cull_aabb(frustum, aabb_translate(unit, { 0, 0, -10 })) == frustum_cull_inside);
+			m_assert(frustum_cull_aabb(frustum, aabb_translate(unit, { 10, 0, -10 })) == frustum_cull_intersect);
+			m_assert(frustum_cull_aabb(frustum, aabb_translate(unit, { 0, 0, 0 })) == frustum_cull_intersect);
+			m_assert(frustum_cull_aabb(frustum, aabb_translate(unit, { 0, 0, 5 })) == frustum_cull_outside);
+			m_assert(frustum_cull_aabb(frustum, aabb_translate(unit, { 13, 0, -10 })) == frustum_cull_outside);
+			m_assert(frustum_cull_aabb(frustum, aabb_translate(unit, { 0, 0, -102 })) == frustum_cull_outside);
+			m_assert(frustum_cull_aabb(frustum, aabb{ { -1000, -1000, -1000 }, { 1000, 1000, 1000 } }) == frustum_cull_intersect);
+			m_assert(!frustum_intersect_aabb(frustum, aabb_empty()));
+			m_assert(aabb_is_empty(aabb_transform(aabb_empty(), mat4_from_translate({ 0, 0, -10 }))));
+			aabb expanded = aabb_expand(aabb_empty(), aabb{ { 0, -2, 0 }, { 1, 0, 3 } });
+			expanded = aabb_expand(expanded, aabb{ { -1, 0, 1 }, { 0, 2, 2 } });
+			m_assert(expanded.min == (vec3{ -1, -2, 0 }) && expanded.max == (vec3{ 1, 2, 3 }));
+			// a box rotated 45 degrees around y grows by sqrt(2) on x and z
+			aabb rotated = aabb_transform(unit, mat4_from_rotate(quat_from_axis_rotate({ 0, 1, 0 }, (float)M_PI / 4)));
+			m_assert(fabsf(rotated.max.x - sqrtf(2)) < 1e-5f && fabsf(rotated.max.z - sqrtf(2)) < 1e-5f && fabsf(rotated.max.y - 1) < 1e-5f);
+			// infinite reverse z projections leave one plane with a zero normal that never culls
+			::frustum reverse_z = frustum_from_mat4(mat4_project_reverse_z(camera.fovy, 1, 1) * camera_view_mat4(camera));
+			m_assert(frustum_intersect_aabb(reverse_z, aabb_translate(unit, { 0, 0, -10000 })));
+			m_assert(!frustum_intersect_aabb(reverse_z, aabb_translate(unit, { 0, 0, 5 })));
+		}
+		const uint32 count = 4099;
+		aabb* bounds = new aabb[count];
+		uint32* visible = new uint32[count];
+		auto delete_arrays = scope_exit([&] { delete[] bounds; delete[] visible; });
+		for (uint32 i = 0; i < count; i += 1) {
+			vec3 center = { random_float(-100, 100), random_float(-100, 100), random_float(-100, 100) };
+			vec3 extent = { fabsf(random_float(-100, 100)) * 0.05f, fabsf(random_float(-100, 100)) * 0.05f, fabsf(random_float(-100, 100)) * 0.05f };
+			bounds[i] = (i % 97 == 0) ? aabb_empty() : aabb{ center - extent, center + extent };
+		}
+		m_case(cull_aabbs) {
+			uint32 reference_count = 0;
+			for (uint32 i = 0; i < count; i += 1) {
+				bool intersect = frustum_intersect_aabb(frustum, bounds[i]);
+				m_assert(intersect == (frustum_cull_aabb(frustum, bounds[i]) != frustum_cull_outside));
+				reference_count += intersect ? 1 : 0;
+			}
+			m_assert(reference_count > count / 20 && reference_count < count / 2);
+			for (uint32 n : { 0u, 1u, 3u, 4u, 7u, 9u, count }) {
+				auto check = [&](uint32 visible_count) {
+					uint32 j = 0;
+					for (uint32 i = 0; i < n; i += 1) {
+						if (frustum_intersect_aabb(frustum, bounds[i])) {
+							m_assert(j < visible_count && visible[j] == i);
+							j += 1;
+						}
+					}
+					m_assert(j == visible_count);
+				};
+				check(frustum_cull_aabbs(frustum, bounds, n, visible));
+#ifdef MATH_AVX
+				if (avx) {
+					check(frustum_cull_aabbs_avx(frustum, bounds, n, visible));
+				}
+#endif
+			}
+		}
+		m_case(benchmark) {
+			auto time = [&](auto&& f) {
+				uint32 visible_count = 0;
+				double ns = benchmark_ns(100, [&] { visible_count += f(); });
+				m_assert(visible_count > 0);
+				return ns / count;
+			};
+			double scalar = time([&] {
+				uint32 visible_count = 0;
+				for (uint32 i = 0; i < count; i += 1) {
+					if (frustum_intersect_aabb(frustum, bounds[i])) {
+						visible[visible_count] = i;
+						visible_count += 1;
+					}
+				}
+				return visible_count;
+			});
+			double wide4 = time([&] { return frustum_cull_aabbs(frustum, bounds, count, visible); });
+			printf("(ns per box: scalar %.2f, x4 %.2f", scalar, wide4);
+#ifdef MATH_AVX
+			if (avx) {
+				double wide8 = time([&] { return frustum_cull_aabbs_avx(frustum, bounds, count, visible); });
+				printf(", x8 %.2f", wide8);
+			}
+#endif
+			printf(") ");
+		}
 	}
 	m_test(simd) {
+		auto filter_floats_reference = [](const float* in, float* out, uint32 count, float limit, compare_op cmp) {
+			uint32 n = 0;
+			for (uint32 i = 0; i < count; i += 1) {
+				bool pass = false;
+				switch (cmp) {
+				case compare_op_gt: pass = in[i] > limit; break;
+				case compare_op_ge: pass = in[i] >= limit; break;
+				case compare_op_eq: pass = in[i] == limit; break;
+				case compare_op_le: pass = in[i] <= limit; break;
+				case compare_op_lt: pass = in[i] < limit; break;
+				default: break;
+				}
+				if (pass) {
+					out[n++] = in[i];
+				}
+			}
+			return n;
+		};
+		auto restore_isa = scope_exit([] { simd_set_isa(simd_supported_isa); });
 		m_case(filter_floats) {
 			const uint32 array_size = 100000;
 			const uint32 test_num = 5;
@@ -269,25 +1749,1181 @@ int main(int argc, char **argv) {
 			for (uint32 i = 0; i < array_size; i += 1) {
 				in[i] = (float)(rand() % 10);
 			}
-			uint32 count = 0;
-			{
-				for (uint32 i = 0; i < array_size; i += 1) {
-					if (in[i] <= (float)test_num) {
-						out[count++] = in[i];
+			in[7] = NAN;
+			for (uint32 isa = 0; isa <= simd_supported_isa; isa += 1) {
+				simd_set_isa((simd_isa)isa);
+				for (uint32 cmp = 0; cmp < compare_op_count; cmp += 1) {
+					uint32 count = filter_floats_reference(in, out, array_size, (float)test_num, (compare_op)cmp);
+					uint32 n = simd_filter_floats(in, out_simd, array_size, (float)test_num, (compare_op)cmp);
+					m_assert(n == count);
+					m_assert(!memcmp(out_simd, out, count * sizeof(float)));
+				}
+			}
+			delete[]in;
+			delete[]out;
+			delete[]out_simd;
+		}
+		m_case(tails) {
+			float in[64];
+			float out[64];
+			float out_simd[64 + 16];
+			for (uint32 i = 0; i < 64; i += 1) {
+				in[i] = (float)(rand() % 4);
+			}
+			for (uint32 isa = 0; isa <= simd_supported_isa; isa += 1) {
+				simd_set_isa((simd_isa)isa);
+				for (uint32 count = 0; count <= 64; count += 1) {
+					for (uint32 i = 0; i < m_countof(out_simd); i += 1) {
+						out_simd[i] = -1;
+					}
+					uint32 n = filter_floats_reference(in, out, count, 2, compare_op_lt);
+					m_assert(simd_filter_floats(in, out_simd, count, 2, compare_op_lt) == n);
+					m_assert(!memcmp(out_simd, out, n * sizeof(float)));
+					for (uint32 i = count; i < m_countof(out_simd); i += 1) {
+						m_assert(out_simd[i] == -1);
 					}
 				}
 			}
-			{
-				uint32 n = simd_filter_floats(in, out_simd, array_size, (float)test_num, compare_op_le);
-				// uint32 n = ispc::filter_floats(in, out_simd, array_size, (float)test_num);
-				m_assert(n == count);
+		}
+		m_case(benchmark) {
+			const uint32 array_size = 1 << 16;
+			float *in = new float[array_size];
+			float *out = new float[array_size];
+			auto delete_arrays = scope_exit([&] { delete[] in; delete[] out; });
+			for (uint32 i = 0; i < array_size; i += 1) {
+				in[i] = (float)(rand() % 100);
+			}
+			printf("(ns per float:");
+			for (uint32 isa = 0; isa <= simd_supported_isa; isa += 1) {
+				simd_set_isa((simd_isa)isa);
+				uint32 n = 0;
+				double ns = benchmark_ns(200, [&] { n += simd_filter_floats(in, out, array_size, 50, compare_op_lt); });
+				m_assert(n > 0);
+				printf(" %s %.3f", simd_isa_names[isa], ns / array_size);
+			}
+			printf(") ");
+		}
+	}
+	m_test(ispc) {
+		m_case(filter_floats) {
+			const uint32 count = 100003;
+			float* in = new float[count];
+			float* out = new float[count];
+			float* out_ispc = new float[count];
+			auto delete_arrays = scope_exit([&] { delete[] in; delete[] out; delete[] out_ispc; });
+			for (uint32 i = 0; i < count; i += 1) {
+				in[i] = (float)(rand() % 10);
+			}
+			in[3] = NAN;
+			simd_set_isa(simd_isa_scalar);
+			uint32 n = simd_filter_floats(in, out, count, 5, compare_op_le);
+			m_assert(ispc::filter_floats(in, out_ispc, count, 5) == n);
+			m_assert(!memcmp(out, out_ispc, n * sizeof(float)));
+			double scalar = benchmark_ns(100, [&] { simd_filter_floats(in, out, count, 5, compare_op_le); });
+			simd_set_isa(simd_supported_isa);
+			double simd = benchmark_ns(100, [&] { simd_filter_floats(in, out, count, 5, compare_op_le); });
+			double ispc = benchmark_ns(100, [&] { ispc::filter_floats(in, out_ispc, count, 5); });
+			printf("(speed up over scalar: %s %.1fx, ispc %.1fx) ", simd_isa_names[simd_supported_isa], scalar / simd, scalar / ispc);
+		}
+		m_case(ray_hit_triangles) {
+			const uint32 count = 10007;
+			vec3* triangles = new vec3[count * 3];
+			float* hits = new float[count];
+			auto delete_arrays = scope_exit([&] { delete[] triangles; delete[] hits; });
+			for (uint32 i = 0; i < count; i += 1) {
+				vec3 center = { random_float(-1, 1) * 4, random_float(-1, 1) * 4, random_float(-1, 1) * 10 };
+				for (uint32 j = 0; j < 3; j += 1) {
+					triangles[i * 3 + j] = center + vec3{ random_float(-1, 1), random_float(-1, 1), random_float(-1, 1) * 0.1f };
+				}
+			}
+			ray ray = { { 0.1f, -0.2f, 20 }, vec3_normalize({ 0.01f, 0.02f, -1 }), 40 };
+			auto nearest_hit_reference = [&] {
+				int32 nearest = -1;
+				float nearest_hit = 2;
 				for (uint32 i = 0; i < count; i += 1) {
-					m_assert(out_simd[i] == out[i]);
+					float h;
+					if (ray_hit_triangle(ray, triangles[i * 3], triangles[i * 3 + 1], triangles[i * 3 + 2], &h) && h < nearest_hit) {
+						nearest = (int32)i;
+						nearest_hit = h;
+					}
+				}
+				return nearest;
+			};
+			int32 nearest = nearest_hit_reference();
+			m_assert(nearest >= 0);
+			m_assert(ispc::ray_hit_triangles(&ray.origin.x, &ray.dir.x, ray.len, &triangles[0].x, count, hits) == nearest);
+			uint32 hit_count = 0;
+			for (uint32 i = 0; i < count; i += 1) {
+				float h;
+				if (ray_hit_triangle(ray, triangles[i * 3], triangles[i * 3 + 1], triangles[i * 3 + 2], &h)) {
+					m_assert(fabsf(hits[i] - h) < 1e-5f);
+					hit_count += 1;
+				}
+				else {
+					m_assert(hits[i] == -1);
 				}
 			}
-			delete[]in;
-			delete[]out;
-			delete[]out_simd;
+			m_assert(hit_count > 1);
+			int32 nearest_scalar = -1;
+			int32 nearest_ispc = -1;
+			double scalar = benchmark_ns(100, [&] { nearest_scalar = nearest_hit_reference(); });
+			double ispc = benchmark_ns(100, [&] { nearest_ispc = ispc::ray_hit_triangles(&ray.origin.x, &ray.dir.x, ray.len, &triangles[0].x, count, hits); });
+			m_assert(nearest_scalar == nearest_ispc);
+			printf("(speed up over scalar: ispc %.1fx) ", scalar / ispc);
+		}
+		m_case(skin_vertices) {
+			const uint32 vertex_count = 20011;
+			const uint32 joint_count = 64;
+			vec3* positions = new vec3[vertex_count];
+			vec3* normals = new vec3[vertex_count];
+			u8vec4* joints = new u8vec4[vertex_count];
+			u16vec4* weights = new u16vec4[vertex_count];
+			vec3* out_positions = new vec3[vertex_count];
+			vec3* out_normals = new vec3[vertex_count];
+			mat4* joint_mats = new mat4[joint_count];
+			auto delete_arrays = scope_exit([&] {
+				delete[] positions; delete[] normals; delete[] joints; delete[] weights; delete[] out_positions; delete[] out_normals; delete[] joint_mats;
+			});
+			for (uint32 i = 0; i < joint_count; i += 1) {
+				quat rotate = quat_normalize(quat{ random_float(-1, 1), random_float(-1, 1), random_float(-1, 1), random_float(-1, 1) + 0.001f });
+				joint_mats[i] = mat4_from_transform(transform{ { 1, 1, 1 }, rotate, { random_float(-1, 1) * 10, random_float(-1, 1) * 10, random_float(-1, 1) * 10 } });
+			}
+			for (uint32 i = 0; i < vertex_count; i += 1) {
+				positions[i] = { random_float(-1, 1), random_float(-1, 1), random_float(-1, 1) };
+				normals[i] = vec3_normalize({ random_float(-1, 1), random_float(-1, 1), random_float(-1, 1) + 0.001f });
+				uint32 w0 = (uint32)rand() % 65536;
+				uint32 w1 = (uint32)rand() % (65536 - w0);
+				uint32 w2 = (uint32)rand() % (65536 - w0 - w1);
+				weights[i] = { (uint16)w0, (uint16)w1, (uint16)w2, (uint16)(65535 - w0 - w1 - w2) };
+				joints[i] = { (uint8)(rand() % joint_count), (uint8)(rand() % joint_count), (uint8)(rand() % joint_count), (uint8)(rand() % joint_count) };
+			}
+			auto skin_vertices_reference = [&] {
+				for (uint32 i = 0; i < vertex_count; i += 1) {
+					mat4 m = joint_mats[joints[i].x] * (weights[i].x / 65535.0f) + joint_mats[joints[i].y] * (weights[i].y / 65535.0f) +
+					         joint_mats[joints[i].z] * (weights[i].z / 65535.0f) + joint_mats[joints[i].w] * (weights[i].w / 65535.0f);
+					vec4 p = m * vec4{ positions[i].x, positions[i].y, positions[i].z, 1 };
+					vec4 n = m * vec4{ normals[i].x, normals[i].y, normals[i].z, 0 };
+					out_positions[i] = { p.x, p.y, p.z };
+					out_normals[i] = vec3_normalize({ n.x, n.y, n.z });
+				}
+			};
+			vec3* ispc_positions = new vec3[vertex_count];
+			vec3* ispc_normals = new vec3[vertex_count];
+			auto delete_ispc_arrays = scope_exit([&] { delete[] ispc_positions; delete[] ispc_normals; });
+			auto skin_vertices_ispc = [&] {
+				ispc::skin_vertices(&positions[0].x, &normals[0].x, &joints[0].x, &weights[0].x, (const float*)joint_mats, vertex_count, &ispc_positions[0].x, &ispc_normals[0].x);
+			};
+			skin_vertices_reference();
+			skin_vertices_ispc();
+			for (uint32 i = 0; i < vertex_count; i += 1) {
+				m_assert(vec3_len(ispc_positions[i] - out_positions[i]) < 1e-4f);
+				m_assert(vec3_len(ispc_normals[i] - out_normals[i]) < 1e-4f);
+			}
+			double scalar = benchmark_ns(20, skin_vertices_reference);
+			double ispc = benchmark_ns(20, skin_vertices_ispc);
+			printf("(speed up over scalar: ispc %.1fx) ", scalar / ispc);
+		}
+		m_case(rgba32f_to_rgba8) {
+			const uint32 pixel_count = 512 * 512 + 3;
+			vec4* image = new vec4[pixel_count];
+			u8vec4* out = new u8vec4[pixel_count];
+			u8vec4* out_ispc = new u8vec4[pixel_count];
+			auto delete_arrays = scope_exit([&] { delete[] image; delete[] out; delete[] out_ispc; });
+			for (uint32 i = 0; i < pixel_count; i += 1) {
+				image[i] = { random_float(-1, 1) * 1.2f, random_float(-1, 1) * 1.2f, random_float(-1, 1) * 1.2f, random_float(-1, 1) * 1.2f };
+			}
+			image[0] = { 0, 1, 0.5f, 1.0f / 255 };
+			auto rgba32f_to_rgba8_reference = [&](bool bgra) {
+				for (uint32 i = 0; i < pixel_count; i += 1) {
+					for (uint32 j = 0; j < 4; j += 1) {
+						out[i][j] = (uint8)(clamp(image[i][j], 0.0f, 1.0f) * 255 + 0.5f);
+					}
+					if (bgra) {
+						std::swap(out[i].x, out[i].z);
+					}
+				}
+			};
+			for (bool bgra : { false, true }) {
+				rgba32f_to_rgba8_reference(bgra);
+				ispc::rgba32f_to_rgba8(&image[0].x, &out_ispc[0].x, pixel_count, bgra);
+				// ispc may fuse the multiply add, which can move a value sitting on a rounding boundary by one
+				for (uint32 i = 0; i < pixel_count; i += 1) {
+					for (uint32 j = 0; j < 4; j += 1) {
+						m_assert(abs(out[i][j] - out_ispc[i][j]) <= 1);
+					}
+				}
+				m_assert(out[0] == out_ispc[0]);
+			}
+			m_assert(out[0] == (u8vec4{ 128, 255, 0, 1 }));
+			double scalar = benchmark_ns(20, [&] { rgba32f_to_rgba8_reference(false); });
+			double ispc = benchmark_ns(20, [&] { ispc::rgba32f_to_rgba8(&image[0].x, &out_ispc[0].x, pixel_count, false); });
+			printf("(speed up over scalar: ispc %.1fx) ", scalar / ispc);
+		}
+	}
+	m_test(packet_math) {
+#ifdef MATH_AVX
+		bool avx = simd_current_isa >= simd_isa_avx2;
+#endif
+		auto random_vec3 = [] {
+			return vec3{ (float)(rand() % 2001 - 1000) / 100.0f, (float)(rand() % 2001 - 1000) / 100.0f, (float)(rand() % 2001 - 1000) / 100.0f };
+		};
+		auto near_equal = [](float a, float b) {
+			return fabsf(a - b) <= 1e-5f * max(1.0f, fabsf(b));
+		};
+		m_case(vec3x4) {
+			srand(15);
+			for (uint32 n = 0; n < 1000; n += 1) {
+				vec3 a[4], b[4], c[4];
+				for (uint32 i = 0; i < 4; i += 1) {
+					a[i] = random_vec3();
+					b[i] = (i == 2) ? a[i] : random_vec3();
+				}
+				vec3x4 pa = vec3x4_load(a);
+				vec3x4 pb = vec3x4_load(b);
+				vec3x4_store(pa, c);
+				m_assert(!memcmp(a, c, sizeof(a)));
+				vec3x4 sum = pa + pb;
+				vec3x4 difference = pa - pb;
+				vec3x4 product = pa * pb * 0.5f;
+				vec3x4 cross = vec3_cross(pa, pb);
+				floatx4 dot = vec3_dot(pa, pb);
+				vec3x4 normalized = vec3_normalize(pa);
+				vec3x4 lerped = vec3_lerp(pa, pb, floatx4_set1(0.25f));
+				maskx4 equal = pa == pb;
+				maskx4 dot_positive = dot > floatx4_set1(0);
+				vec3x4 selected = select(dot_positive, pa, pb);
+				for (uint32 i = 0; i < 4; i += 1) {
+					m_assert(vec3x4_get(sum, i) == a[i] + b[i]);
+					m_assert(vec3x4_get(difference, i) == a[i] - b[i]);
+					m_assert(vec3x4_get(product, i) == a[i] * b[i] * 0.5f);
+					vec3 scalar_cross = vec3_cross(a[i], b[i]);
+					m_assert(near_equal(floatx4_get(cross.x, i), scalar_cross.x) && near_equal(floatx4_get(cross.y, i), scalar_cross.y) && near_equal(floatx4_get(cross.z, i), scalar_cross.z));
+					m_assert(near_equal(floatx4_get(dot, i), vec3_dot(a[i], b[i])));
+					vec3 scalar_normalized = vec3_normalize(a[i]);
+					m_assert(near_equal(floatx4_get(normalized.x, i), scalar_normalized.x) && near_equal(floatx4_get(normalized.y, i), scalar_normalized.y));
+					vec3 scalar_lerped = vec3_lerp(a[i], b[i], 0.25f);
+					m_assert(near_equal(floatx4_get(lerped.z, i), scalar_lerped.z));
+					m_assert(((mask_bits(equal) >> i) & 1) == (a[i] == b[i]));
+					m_assert(((mask_bits(dot_positive) >> i) & 1) == (floatx4_get(dot, i) > 0));
+					m_assert(vec3x4_get(selected, i) == (floatx4_get(dot, i) > 0 ? a[i] : b[i]));
+				}
+				m_assert(mask_any(equal) && !mask_all(equal) && mask_all(equal | ~equal) && !mask_any(equal & ~equal));
+			}
+		}
+		m_case(floatx4_nan) {
+			float values[4] = { 1.0f, NAN, -2.0f, 0.0f };
+			floatx4 f = floatx4_load(values);
+			floatx4 zero = floatx4_set1(0);
+			m_assert(mask_bits(f > zero) == 0x1);
+			m_assert(mask_bits(f <= zero) == 0xc);
+			m_assert(mask_bits(f == f) == 0xd);
+			m_assert(mask_bits(f != f) == 0x2);
+			m_assert(floatx4_get(abs(f), 2) == 2.0f && floatx4_get(-f, 0) == -1.0f);
+		}
+#ifdef MATH_AVX
+		if (avx) {
+			m_case(vec3x8) {
+				srand(16);
+				for (uint32 n = 0; n < 1000; n += 1) {
+					vec3 a[8], b[8], c[8];
+					for (uint32 i = 0; i < 8; i += 1) {
+						a[i] = random_vec3();
+						b[i] = (i == 5) ? a[i] : random_vec3();
+					}
+					vec3x8 pa = vec3x8_load(a);
+					vec3x8 pb = vec3x8_load(b);
+					vec3x8_store(pa, c);
+					m_assert(!memcmp(a, c, sizeof(a)));
+					vec3x8 sum = pa + pb;
+					vec3x8 difference = pa - pb;
+					vec3x8 product = pa * pb * 0.5f;
+					vec3x8 cross = vec3_cross(pa, pb);
+					floatx8 dot = vec3_dot(pa, pb);
+					vec3x8 normalized = vec3_normalize(pa);
+					maskx8 equal = pa == pb;
+					maskx8 dot_positive = dot > floatx8_set1(0);
+					vec3x8 selected = select(dot_positive, pa, pb);
+					for (uint32 i = 0; i < 8; i += 1) {
+						m_assert(vec3x8_get(sum, i) == a[i] + b[i]);
+						m_assert(vec3x8_get(difference, i) == a[i] - b[i]);
+						m_assert(vec3x8_get(product, i) == a[i] * b[i] * 0.5f);
+						vec3 scalar_cross = vec3_cross(a[i], b[i]);
+						m_assert(near_equal(floatx8_get(cross.x, i), scalar_cross.x) && near_equal(floatx8_get(cross.y, i), scalar_cross.y) && near_equal(floatx8_get(cross.z, i), scalar_cross.z));
+						m_assert(near_equal(floatx8_get(dot, i), vec3_dot(a[i], b[i])));
+						vec3 scalar_normalized = vec3_normalize(a[i]);
+						m_assert(near_equal(floatx8_get(normalized.x, i), scalar_normalized.x) && near_equal(floatx8_get(normalized.y, i), scalar_normalized.y));
+						m_assert(((mask_bits(equal) >> i) & 1) == (a[i] == b[i]));
+						m_assert(vec3x8_get(selected, i) == (floatx8_get(dot, i) > 0 ? a[i] : b[i]));
+					}
+					m_assert(mask_any(equal) && !mask_all(equal) && mask_all(equal | ~equal));
+				}
+			}
+		}
+#endif
+	}
+	m_test(fast_math) {
+#ifdef MATH_AVX
+		bool avx = simd_current_isa >= simd_isa_avx2;
+#endif
+		auto ulp_error = [](float approx, double exact) {
+			float rounded = fabsf((float)exact);
+			return fabs(approx - exact) / (nextafterf(rounded, INFINITY) - rounded);
+		};
+		// largest error of the scalar and wide forms of f against reference over count inputs spread evenly in
+		// [begin, end], measured in ulp or, with absolute set, as a plain difference
+		auto max_error = [&](auto f, double (*reference)(double), float begin, float end, bool absolute = false) {
+			const uint32 count = 200000;
+			double error = 0;
+			alignas(32) float inputs[8];
+			alignas(32) float outputs[8];
+			for (uint32 i = 0; i < count; i += 8) {
+				for (uint32 j = 0; j < 8; j += 1) {
+					inputs[j] = begin + (end - begin) * (float)(i + j) / (float)(count - 1);
+				}
+				for (uint32 j = 0; j < 8; j += 4) {
+					floatx4_store(f(floatx4_load(inputs + j)), outputs + j);
+				}
+				auto measure = [&](float approx, float x) {
+					double exact = reference(x);
+					error = max(error, absolute ? fabs(approx - exact) : ulp_error(approx, exact));
+				};
+				for (uint32 j = 0; j < 8; j += 1) {
+					measure(f(inputs[j]), inputs[j]);
+					measure(outputs[j], inputs[j]);
+				}
+#ifdef MATH_AVX
+				if (avx) {
+					floatx8_store(f(floatx8_load(inputs)), outputs);
+					for (uint32 j = 0; j < 8; j += 1) {
+						measure(outputs[j], inputs[j]);
+					}
+				}
+#endif
+			}
+			return error;
+		};
+		m_case(trigonometric) {
+			auto sin = [](auto x) { return sin_fast(x); };
+			auto cos = [](auto x) { return cos_fast(x); };
+			auto acos = [](auto x) { return acos_fast(x); };
+			auto atan = [](auto x) { return atan2_fast(x, floatx_set1<decltype(x)>(1)); };
+			auto atan_inverse = [](auto x) { return atan2_fast(floatx_set1<decltype(x)>(-1), x); };
+			double sin_error = max_error(sin, ::sin, -8192, 8192, true);
+			double cos_error = max_error(cos, ::cos, -8192, 8192, true);
+			double sin_ulp = max_error(sin, ::sin, -(float)M_PI, (float)M_PI);
+			double cos_ulp = max_error(cos, ::cos, -1.5f, 1.5f);
+			double acos_ulp = max_error(acos, ::acos, -1, 1);
+			double atan_ulp = max_error(atan, ::atan, -100, 100);
+			double atan_inverse_ulp = max_error(atan_inverse, [](double x) { return atan2(-1.0, x); }, -100, 100);
+			printf("(sin %.1e %.2f ulp, cos %.1e %.2f ulp, acos %.2f ulp, atan2 %.2f %.2f ulp) ", sin_error, sin_ulp, cos_error, cos_ulp, acos_ulp, atan_ulp, atan_inverse_ulp);
+			m_assert(sin_error < 1.2e-7 && cos_error < 1.2e-7);
+			m_assert(sin_ulp < 2 && cos_ulp < 2);
+			m_assert(acos_ulp < 2 && atan_ulp < 3 && atan_inverse_ulp < 3);
+			m_assert(atan2_fast(0.0f, 0.0f) == 0);
+			m_assert(fabsf(atan2_fast(1.0f, 0.0f) - (float)M_PI / 2) < 1e-7f);
+			m_assert(fabsf(atan2_fast(0.0f, -1.0f) - (float)M_PI) < 1e-7f);
+		}
+		m_case(exponential) {
+			auto exp = [](auto x) { return exp_fast(x); };
+			auto log = [](auto x) { return log_fast(x); };
+			auto rsqrt = [](auto x) { return rsqrt_fast(x); };
+			double exp_ulp = max_error(exp, ::exp, -86.6f, 88.7f);
+			double log_ulp = max(max_error(log, ::log, 1e-30f, 1e-20f), max(max_error(log, ::log, 0.01f, 10), max_error(log, ::log, 1, 1e30f)));
+			double rsqrt_ulp = max(max_error(rsqrt, [](double x) { return 1 / ::sqrt(x); }, 1e-30f, 1), max_error(rsqrt, [](double x) { return 1 / ::sqrt(x); }, 1, 1e30f));
+			printf("(exp %.2f ulp, log %.2f ulp, rsqrt %.2f ulp) ", exp_ulp, log_ulp, rsqrt_ulp);
+			m_assert(exp_ulp < 2 && log_ulp < 2 && rsqrt_ulp < 4);
+			m_assert(exp_fast(-100.0f) == 0 && exp_fast(100.0f) == INFINITY && exp_fast(0.0f) == 1);
+			m_assert(log_fast(1.0f) == 0);
+		}
+		m_case(vectors) {
+			uint32 count = 10000;
+			double max_len_error = 0;
+			double max_angle_error = 0;
+			for (uint32 i = 0; i < count; i += 1) {
+				vec3 v = { (float)(rand() % 2001 - 1000), (float)(rand() % 2001 - 1000), (float)(rand() % 2001 - 1000) + 0.5f };
+				vec3 n = vec3_normalize_fast(v);
+				max_len_error = max(max_len_error, fabs(sqrt((double)n.x * n.x + (double)n.y * n.y + (double)n.z * n.z) - 1));
+				vec3 b = vec3_normalize(vec3{ (float)(rand() % 2001 - 1000), (float)(rand() % 2001 - 1000), 0.5f });
+				vec3 a = vec3_normalize(v);
+				vec3 rotated = quat_from_between_fast(a, b) * a;
+				max_angle_error = max(max_angle_error, (double)vec3_len(rotated - quat_from_between(a, b) * a));
+				vec3 xyz;
+				float pdf;
+				float u1 = (float)(rand() % 1000) / 1000.0f;
+				float u2 = (float)(rand() % 1000) / 1000.0f;
+				cosine_weighted_sample_hemisphere_fast(u1, u2, &xyz, &pdf);
+				vec3 reference_xyz;
+				float reference_pdf;
+				cosine_weighted_sample_hemisphere(u1, u2, &reference_xyz, &reference_pdf);
+				m_assert(vec3_len(xyz - reference_xyz) < 1e-6f && fabsf(pdf - reference_pdf) < 1e-6f && pdf > 0);
+			}
+			vec3 horizon_xyz;
+			float horizon_pdf;
+			cosine_weighted_sample_hemisphere(1, 0.25f, &horizon_xyz, &horizon_pdf);
+			m_assert(horizon_pdf > 0);
+			cosine_weighted_sample_hemisphere_fast(1, 0.25f, &horizon_xyz, &horizon_pdf);
+			m_assert(horizon_pdf > 0);
+			vec3x4 v4 = vec3x4_set1({ 3, 4, 12 });
+			m_assert(fabsf(vec3_len(vec3x4_get(vec3_normalize_fast(v4), 2)) - 1) < 4e-7f);
+			m_assert(max_len_error < 4e-7 && max_angle_error < 2e-6);
+			m_assert(fabsf(fresnel_schlick(0.04f, 0.3f) - (0.04f + 0.96f * powf(0.7f, 5))) < 1e-7f);
+		}
+		m_case(benchmark) {
+			const uint32 count = 1 << 16;
+			float* inputs = new float[count];
+			float* outputs = new float[count];
+			auto delete_arrays = scope_exit([&] { delete[] inputs; delete[] outputs; });
+			for (uint32 i = 0; i < count; i += 1) {
+				inputs[i] = (float)(i + 1) / (float)count * 4;
+			}
+			auto scalar = [&](float (*f)(float)) {
+				return benchmark_ns(20, [&] {
+					for (uint32 i = 0; i < count; i += 1) {
+						outputs[i] = f(inputs[i]);
+					}
+				}) / count;
+			};
+			auto wide = [&](floatx4 (*f)(floatx4)) {
+				return benchmark_ns(20, [&] {
+					for (uint32 i = 0; i < count; i += 4) {
+						floatx4_store(f(floatx4_load(inputs + i)), outputs + i);
+					}
+				}) / count;
+			};
+			printf("(ns per call, libm / fast / fast x4: sin %.2f %.2f %.2f, acos %.2f %.2f %.2f, exp %.2f %.2f %.2f, log %.2f %.2f %.2f) ",
+				scalar(sinf), scalar(sin_fast<float>), wide(sin_fast<floatx4>),
+				scalar([](float x) { return acosf(x * 0.25f); }), scalar([](float x) { return acos_fast(x * 0.25f); }), wide([](floatx4 x) { return acos_fast(x * 0.25f); }),
+				scalar(expf), scalar(exp_fast<float>), wide(exp_fast<floatx4>),
+				scalar(logf), scalar(log_fast<float>), wide(log_fast<floatx4>));
+		}
+	}
+	m_test(vertex_packing) {
+		auto random_direction = [&] {
+			vec3 v;
+			do {
+				v = vec3{random_float(-1, 1), random_float(-1, 1), random_float(-1, 1)};
+			} while (vec3_len(v) < 0.01f || vec3_len(v) > 1);
+			return vec3_normalize(v);
+		};
+		auto angle = [](vec3 a, vec3 b) {
+			double cx = (double)a.y * b.z - (double)a.z * b.y, cy = (double)a.z * b.x - (double)a.x * b.z, cz = (double)a.x * b.y - (double)a.y * b.x;
+			return atan2(sqrt(cx * cx + cy * cy + cz * cz), (double)a.x * b.x + (double)a.y * b.y + (double)a.z * b.z);
+		};
+		m_case(octahedral) {
+			double max_angle = 0;
+			for (uint32 i = 0; i < 100000; i += 1) {
+				vec3 n = random_direction();
+				vec2 e = octahedral_encode(n);
+				m_assert(fabsf(e.x) <= 1 && fabsf(e.y) <= 1);
+				vec3 decoded = octahedral_decode(e);
+				m_assert(fabsf(vec3_len(decoded) - 1) < 1e-6f && angle(n, decoded) < 1e-5);
+				vec2 snorm = {roundf(e.x * 32767) / 32767, roundf(e.y * 32767) / 32767};
+				max_angle = max(max_angle, angle(n, octahedral_decode(snorm)));
+			}
+			m_assert(max_angle < 7e-5);
+			vec3 axes[] = {{1, 0, 0}, {-1, 0, 0}, {0, 1, 0}, {0, -1, 0}, {0, 0, 1}, {0, 0, -1}};
+			for (vec3 axis : axes) {
+				m_assert(vec3_len(octahedral_decode(octahedral_encode(axis)) - axis) < 1e-7f);
+			}
+			m_assert((octahedral_decode(octahedral_encode(vec3{0, 0, 0})) == vec3{0, 0, 1}));
+			floatx4 u, v;
+			octahedral_encode(floatx4_set1(0.3f), floatx4_set1(-0.5f), floatx4_set1(-0.8f), &u, &v);
+			vec2 e = octahedral_encode(vec3{0.3f, -0.5f, -0.8f});
+			m_assert(floatx4_get(u, 3) == e.x && floatx4_get(v, 3) == e.y);
+		}
+		m_case(half) {
+			for (uint32 h = 0; h < 0x10000; h += 1) {
+				float f = float_from_half((uint16)h);
+				bool nan = (h & 0x7c00) == 0x7c00 && (h & 0x3ff) != 0;
+				m_assert(nan ? (f != f && (half_from_float(f) & 0x7e00) == 0x7e00) : half_from_float(f) == h);
+				if (!nan && (h & 0x7fff) < 0x7bff) {
+					float next = float_from_half((uint16)(h + 1));
+					float midpoint = (f + next) * 0.5f;
+					uint16 even = (h & 1) ? (uint16)(h + 1) : (uint16)h;
+					m_assert(half_from_float(midpoint) == even);
+					m_assert(half_from_float(nextafterf(midpoint, 0)) == h && half_from_float(nextafterf(midpoint, copysignf(INFINITY, f))) == h + 1);
+				}
+			}
+			m_assert(half_from_float(65519.0f) == 0x7bff && half_from_float(65520.0f) == 0x7c00 && half_from_float(1e10f) == 0x7c00);
+			m_assert(half_from_float(-INFINITY) == 0xfc00 && half_from_float(-0.0f) == 0x8000);
+			m_assert(half_from_float(2.9802322e-08f) == 0 && half_from_float(2.9802326e-08f) == 1 && float_from_half(1) == 5.9604645e-08f);
+		}
+		m_case(round_trip) {
+			for (uint32 count = 1; count <= 67; count += 11) {
+				gpk_model_vertex* vertices = new gpk_model_vertex[count]();
+				gpk_model_vertex_packed* packed = new gpk_model_vertex_packed[count];
+				gpk_model_vertex* unpacked = new gpk_model_vertex[count];
+				auto delete_arrays = scope_exit([&] { delete[] vertices; delete[] packed; delete[] unpacked; });
+				aabb bound = aabb_empty();
+				for (uint32 i = 0; i < count; i += 1) {
+					gpk_model_vertex& v = vertices[i];
+					v.position = vec3{random_float(-50, 50), random_float(0, 2), 7};
+					v.color = {(uint8)rand(), (uint8)rand(), (uint8)rand(), (uint8)rand()};
+					v.uv = {random_float(-4, 4), random_float(0, 1)};
+					vec3 n = random_direction() * 32767;
+					vec3 t = random_direction() * 32767;
+					v.normal = {(int16)roundf(n.x), (int16)roundf(n.y), (int16)roundf(n.z), 0};
+					v.tangent = {(int16)roundf(t.x), (int16)roundf(t.y), (int16)roundf(t.z), (int16)(rand() % 2 ? 32767 : -32767)};
+					v.joints = {(uint8)rand(), (uint8)rand(), (uint8)rand(), (uint8)rand()};
+					v.weights = {(uint16)rand(), (uint16)rand(), (uint16)rand(), (uint16)rand()};
+					bound = aabb_expand(bound, aabb{v.position, v.position});
+				}
+				gpk_model_vertices_pack(vertices, count, bound, packed);
+				gpk_model_vertices_unpack(packed, count, bound, unpacked);
+				vec3 step = (bound.max - bound.min) / 65535.0f;
+				for (uint32 i = 0; i < count; i += 1) {
+					gpk_model_vertex& a = vertices[i];
+					gpk_model_vertex& b = unpacked[i];
+					vec3 d = b.position - a.position;
+					m_assert(fabsf(d.x) <= step.x * 0.51f && fabsf(d.y) <= step.y * 0.51f && d.z == 0);
+					m_assert(fabsf(b.uv.x - a.uv.x) <= 4.0f / 2048 && fabsf(b.uv.y - a.uv.y) <= 1.0f / 2048);
+					vec3 an = {(float)a.normal.x, (float)a.normal.y, (float)a.normal.z};
+					vec3 bn = {(float)b.normal.x, (float)b.normal.y, (float)b.normal.z};
+					vec3 at = {(float)a.tangent.x, (float)a.tangent.y, (float)a.tangent.z};
+					vec3 bt = {(float)b.tangent.x, (float)b.tangent.y, (float)b.tangent.z};
+					m_assert(angle(an, bn) < 2e-4 && angle(at, bt) < 2e-4 && b.normal.w == 0 && b.tangent.w == a.tangent.w);
+					m_assert(b.color == a.color && b.joints == a.joints && b.weights == a.weights);
+				}
+			}
+		}
+		m_case(benchmark) {
+			const uint32 count = 1 << 16;
+			gpk_model_vertex* vertices = new gpk_model_vertex[count]();
+			gpk_model_vertex_packed* packed = new gpk_model_vertex_packed[count];
+			auto delete_arrays = scope_exit([&] { delete[] vertices; delete[] packed; });
+			aabb bound = aabb_empty();
+			for (uint32 i = 0; i < count; i += 1) {
+				gpk_model_vertex& v = vertices[i];
+				v.position = vec3{random_float(-50, 50), random_float(-50, 50), random_float(-50, 50)};
+				vec3 n = random_direction() * 32767;
+				v.normal = {(int16)roundf(n.x), (int16)roundf(n.y), (int16)roundf(n.z), 0};
+				v.tangent = v.normal;
+				bound = aabb_expand(bound, aabb{v.position, v.position});
+			}
+			gpk_model_vertices_pack(vertices, count, bound, packed);
+			double pack_time = benchmark_ns(1, [&] { gpk_model_vertices_pack(vertices, count, bound, packed); }) / count;
+			double unpack_time = benchmark_ns(1, [&] { gpk_model_vertices_unpack(packed, count, bound, vertices); }) / count;
+			printf("(%u vertices, %u to %u bytes, pack %.2f ns, unpack %.2f ns per vertex) ", count, (uint32)sizeof(gpk_model_vertex), (uint32)sizeof(gpk_model_vertex_packed), pack_time, unpack_time);
+		}
+	}
+	m_test(spatial_keys) {
+		auto random_uint32 = [] { return ((uint32)rand() << 16) ^ (uint32)rand(); };
+		// reference interleaving, bit i of coordinate c lands on bit i * dimension + c
+		auto interleave = [](const uint32* coords, uint32 dimension, uint32 bits) {
+			uint64 key = 0;
+			for (uint32 i = 0; i < bits; i += 1) {
+				for (uint32 c = 0; c < dimension; c += 1) {
+					key |= (uint64)((coords[c] >> i) & 1) << (i * dimension + c);
+				}
+			}
+			return key;
+		};
+#ifdef MATH_BMI2
+		bool bmi2 = simd_current_isa >= simd_isa_avx2;
+#endif
+		m_case(morton) {
+			for (uint32 i = 0; i < 100000; i += 1) {
+				uint32 c[3] = {random_uint32(), random_uint32(), random_uint32()};
+				uint32 x, y, z;
+				uint32 key2 = morton2d_encode(c[0], c[1]);
+				morton2d_decode(key2, &x, &y);
+				m_assert(key2 == interleave(c, 2, 16) && x == (c[0] & 0xffff) && y == (c[1] & 0xffff));
+				uint32 key3 = morton3d_encode(c[0], c[1], c[2]);
+				morton3d_decode(key3, &x, &y, &z);
+				m_assert(key3 == interleave(c, 3, 10) && x == (c[0] & 0x3ff) && y == (c[1] & 0x3ff) && z == (c[2] & 0x3ff));
+				uint64 key3_64 = morton3d_encode64(c[0], c[1], c[2]);
+				morton3d_decode64(key3_64, &x, &y, &z);
+				m_assert(key3_64 == interleave(c, 3, 21) && x == (c[0] & 0x1fffff) && y == (c[1] & 0x1fffff) && z == (c[2] & 0x1fffff));
+#ifdef MATH_BMI2
+				if (bmi2) {
+					uint32 bx, by, bz;
+					m_assert(morton2d_encode_bmi2(c[0] & 0xffff, c[1] & 0xffff) == key2);
+					morton2d_decode_bmi2(key2, &bx, &by);
+					m_assert(bx == (c[0] & 0xffff) && by == (c[1] & 0xffff));
+					m_assert(morton3d_encode_bmi2(c[0] & 0x3ff, c[1] & 0x3ff, c[2] & 0x3ff) == key3);
+					morton3d_decode_bmi2(key3, &bx, &by, &bz);
+					m_assert(bx == (c[0] & 0x3ff) && by == (c[1] & 0x3ff) && bz == (c[2] & 0x3ff));
+					m_assert(morton3d_encode64_bmi2(c[0] & 0x1fffff, c[1] & 0x1fffff, c[2] & 0x1fffff) == key3_64);
+					morton3d_decode64_bmi2(key3_64, &bx, &by, &bz);
+					m_assert(bx == x && by == y && bz == z);
+				}
+#endif
+			}
+			m_assert(morton3d_encode(0x3ff, 0x3ff, 0x3ff) == (1u << 30) - 1 && morton3d_encode64(0x1fffff, 0x1fffff, 0x1fffff) == (1ull << 63) - 1);
+		}
+		m_case(hilbert) {
+			// the keys of the cells in [0, 2^k) per axis are exactly [0, 2^(k * dimension)), walk them in key order and
+			// check that every step moves to a face neighbor
+			const uint32 side = 16;
+			uint32 cells_2d[side * side][2];
+			bool visited_2d[side * side] = {};
+			for (uint32 y = 0; y < side; y += 1) {
+				for (uint32 x = 0; x < side; x += 1) {
+					uint32 key = hilbert2d_encode(x, y);
+					m_assert(key < side * side && !visited_2d[key]);
+					visited_2d[key] = true;
+					cells_2d[key][0] = x;
+					cells_2d[key][1] = y;
+				}
+			}
+			for (uint32 i = 1; i < side * side; i += 1) {
+				m_assert(abs((int)cells_2d[i][0] - (int)cells_2d[i - 1][0]) + abs((int)cells_2d[i][1] - (int)cells_2d[i - 1][1]) == 1);
+			}
+			auto walk_3d = [&](auto encode) {
+				uint32 cells[side * side * side][3];
+				bool visited[side * side * side] = {};
+				for (uint32 z = 0; z < side; z += 1) {
+					for (uint32 y = 0; y < side; y += 1) {
+						for (uint32 x = 0; x < side; x += 1) {
+							uint64 key = encode(x, y, z);
+							if (key >= side * side * side || visited[key]) {
+								return false;
+							}
+							visited[key] = true;
+							cells[key][0] = x;
+							cells[key][1] = y;
+							cells[key][2] = z;
+						}
+					}
+				}
+				for (uint32 i = 1; i < side * side * side; i += 1) {
+					int d = 0;
+					for (uint32 c = 0; c < 3; c += 1) {
+						d += abs((int)cells[i][c] - (int)cells[i - 1][c]);
+					}
+					if (d != 1) {
+						return false;
+					}
+				}
+				return true;
+			};
+			m_assert(walk_3d(hilbert3d_encode) && walk_3d(hilbert3d_encode64));
+			m_assert(hilbert2d_encode(0, 0) == 0 && hilbert3d_encode(0, 0, 0) == 0 && hilbert3d_encode64(0, 0, 0) == 0);
+			m_assert(hilbert3d_encode(0x3ff, 0x3ff, 0x3ff) < (1u << 30) && hilbert3d_encode64(0x1fffff, 0x1fffff, 0x1fffff) < (1ull << 63));
+		}
+		m_case(keys) {
+			aabb bound = {{-10, 0, 5}, {30, 1, 5}};
+			for (uint32 count = 1; count <= 45; count += 11) {
+				vec3* positions = new vec3[count];
+				uint32* keys = new uint32[count];
+				uint64* keys64 = new uint64[count];
+				auto delete_arrays = scope_exit([&] { delete[] positions; delete[] keys; delete[] keys64; });
+				for (uint32 i = 0; i < count; i += 1) {
+					positions[i] = vec3{-12 + 44 * (float)rand() / RAND_MAX, 1.2f * (float)rand() / RAND_MAX, 5};
+				}
+				positions[0] = bound.max;
+				// reference quantization, cells along each axis of bound clamped to the border ones
+				auto cell = [&](vec3 p, uint32 bits) {
+					float cells = (float)(1u << bits);
+					uint32 c[3];
+					for (uint32 a = 0; a < 3; a += 1) {
+						float extent = bound.max[a] - bound.min[a];
+						float f = extent > 0 ? (p[a] - bound.min[a]) * (cells / extent) : 0;
+						c[a] = (uint32)min(max(f, 0.0f), cells - 1);
+					}
+					return std::array<uint32, 3>{c[0], c[1], c[2]};
+				};
+				morton3d_keys(positions, count, bound, keys);
+				morton3d_keys64(positions, count, bound, keys64);
+				for (uint32 i = 0; i < count; i += 1) {
+					auto c = cell(positions[i], 10);
+					auto c64 = cell(positions[i], 21);
+					m_assert(keys[i] == morton3d_encode(c[0], c[1], c[2]) && keys64[i] == morton3d_encode64(c64[0], c64[1], c64[2]));
+				}
+				m_assert(keys[0] == morton3d_encode(1023, 1023, 0));
+				hilbert3d_keys(positions, count, bound, keys);
+				hilbert3d_keys64(positions, count, bound, keys64);
+				for (uint32 i = 0; i < count; i += 1) {
+					auto c = cell(positions[i], 10);
+					auto c64 = cell(positions[i], 21);
+					m_assert(keys[i] == hilbert3d_encode(c[0], c[1], c[2]) && keys64[i] == hilbert3d_encode64(c64[0], c64[1], c64[2]));
+				}
+#ifdef MATH_BMI2
+				if (bmi2) {
+					morton3d_keys_bmi2(positions, count, bound, keys);
+					morton3d_keys64_bmi2(positions, count, bound, keys64);
+					for (uint32 i = 0; i < count; i += 1) {
+						auto c = cell(positions[i], 10);
+						auto c64 = cell(positions[i], 21);
+						m_assert(keys[i] == morton3d_encode(c[0], c[1], c[2]) && keys64[i] == morton3d_encode64(c64[0], c64[1], c64[2]));
+					}
+				}
+#endif
+			}
+		}
+		m_case(benchmark) {
+			const uint32 count = 1 << 16;
+			vec3* positions = new vec3[count];
+			uint64* keys = new uint64[count];
+			auto delete_arrays = scope_exit([&] { delete[] positions; delete[] keys; });
+			for (uint32 i = 0; i < count; i += 1) {
+				positions[i] = vec3{(float)(rand() % 1000), (float)(rand() % 1000), (float)(rand() % 1000)};
+			}
+			aabb bound = {{0, 0, 0}, {1000, 1000, 1000}};
+			auto time = [&](auto&& f) {
+				f();
+				return benchmark_ns(1, f) / count;
+			};
+			double morton = time([&] { morton3d_keys(positions, count, bound, (uint32*)keys); });
+			double morton64 = time([&] { morton3d_keys64(positions, count, bound, keys); });
+			double hilbert = time([&] { hilbert3d_keys(positions, count, bound, (uint32*)keys); });
+			double morton_bmi2 = 0;
+			double morton64_bmi2 = 0;
+#ifdef MATH_BMI2
+			if (bmi2) {
+				morton_bmi2 = time([&] { morton3d_keys_bmi2(positions, count, bound, (uint32*)keys); });
+				morton64_bmi2 = time([&] { morton3d_keys64_bmi2(positions, count, bound, keys); });
+			}
+#endif
+			printf("(ns per key: morton %.2f, bmi2 %.2f, morton64 %.2f, bmi2 %.2f, hilbert %.2f) ", morton, morton_bmi2, morton64, morton64_bmi2, hilbert);
+		}
+	}
+	m_test(mat4_simd) {
+#ifdef MATH_AVX
+		bool avx = simd_current_isa >= simd_isa_avx2;
+#endif
+		auto random_transform_mat = [&] {
+			transform t = {};
+			t.scale = { 0.1f + fabsf(random_float(-10, 10)), 0.1f + fabsf(random_float(-10, 10)), 0.1f + fabsf(random_float(-10, 10)) };
+			t.rotate = quat_normalize(quat{ random_float(-10, 10), random_float(-10, 10), random_float(-10, 10), random_float(-10, 10) + 0.01f });
+			t.translate = { random_float(-10, 10) * 10, random_float(-10, 10) * 10, random_float(-10, 10) * 10 };
+			return mat4_from_transform(t);
+		};
+		auto mat4_mul_reference = [](const mat4& a, const mat4& b) {
+			mat4 result;
+			for (uint32 i = 0; i < 4; i += 1) {
+				for (uint32 j = 0; j < 4; j += 1) {
+					double sum = 0;
+					for (uint32 k = 0; k < 4; k += 1) {
+						sum += (double)a.columns[k].e[j] * b.columns[i].e[k];
+					}
+					result.columns[i].e[j] = (float)sum;
+				}
+			}
+			return result;
+		};
+		auto mat4_inverse_reference = [](const mat4& m) {
+			double a[4][8] = {};
+			for (uint32 i = 0; i < 4; i += 1) {
+				for (uint32 j = 0; j < 4; j += 1) {
+					a[i][j] = m.columns[j].e[i];
+				}
+				a[i][4 + i] = 1;
+			}
+			for (uint32 i = 0; i < 4; i += 1) {
+				uint32 pivot = i;
+				for (uint32 j = i + 1; j < 4; j += 1) {
+					if (fabs(a[j][i]) > fabs(a[pivot][i])) {
+						pivot = j;
+					}
+				}
+				for (uint32 k = 0; k < 8; k += 1) {
+					double t = a[i][k];
+					a[i][k] = a[pivot][k];
+					a[pivot][k] = t;
+				}
+				double p = a[i][i];
+				for (uint32 k = 0; k < 8; k += 1) {
+					a[i][k] /= p;
+				}
+				for (uint32 j = 0; j < 4; j += 1) {
+					if (j != i) {
+						double f = a[j][i];
+						for (uint32 k = 0; k < 8; k += 1) {
+							a[j][k] -= f * a[i][k];
+						}
+					}
+				}
+			}
+			mat4 inverse;
+			for (uint32 i = 0; i < 4; i += 1) {
+				for (uint32 j = 0; j < 4; j += 1) {
+					inverse.columns[j].e[i] = (float)a[i][4 + j];
+				}
+			}
+			return inverse;
+		};
+		auto mat4_near_equal = [](const mat4& a, const mat4& b, float tolerance) {
+			float scale = 1;
+			for (uint32 i = 0; i < 16; i += 1) {
+				scale = max(scale, fabsf(((const float*)b)[i]));
+			}
+			for (uint32 i = 0; i < 16; i += 1) {
+				if (!(fabsf(((const float*)a)[i] - ((const float*)b)[i]) <= tolerance * scale)) {
+					return false;
+				}
+			}
+			return true;
+		};
+		m_case(mul_and_transpose) {
+			srand(16);
+			for (uint32 n = 0; n < 10000; n += 1) {
+				mat4 a, b;
+				for (uint32 i = 0; i < 16; i += 1) {
+					((float*)a)[i] = random_float(-10, 10);
+					((float*)b)[i] = random_float(-10, 10);
+				}
+				mat4 product = a * b;
+				m_assert(mat4_near_equal(product, mat4_mul_reference(a, b), 1e-5f));
+#ifdef MATH_AVX
+				if (avx) {
+					m_assert(mat4_near_equal(mat4_mul_avx(a, b), product, 1e-5f));
+				}
+#endif
+				vec4 v = { random_float(-10, 10), random_float(-10, 10), random_float(-10, 10), random_float(-10, 10) };
+				vec4 av = a * v;
+				for (uint32 j = 0; j < 4; j += 1) {
+					double sum = 0;
+					for (uint32 k = 0; k < 4; k += 1) {
+						sum += (double)a.columns[k].e[j] * v.e[k];
+					}
+					m_assert(fabs(av.e[j] - sum) <= 1e-5 * max(1.0, fabs(sum)) + 1e-4);
+				}
+				mat4 transposed = mat4_transpose(a);
+				for (uint32 i = 0; i < 4; i += 1) {
+					for (uint32 j = 0; j < 4; j += 1) {
+						m_assert(transposed.columns[i].e[j] == a.columns[j].e[i]);
+					}
+				}
+			}
+		}
+		m_case(inverse) {
+			srand(17);
+			for (uint32 n = 0; n < 10000; n += 1) {
+				mat4 m = random_transform_mat();
+				mat4 reference = mat4_inverse_reference(m);
+				m_assert(mat4_near_equal(mat4_inverse(m), reference, 1e-4f));
+				m_assert(mat4_near_equal(mat4_affine_inverse(m), reference, 1e-4f));
+				m_assert(mat4_near_equal(mat4_affine_inverse(m) * m, mat4_identity(), 1e-4f));
+
+				mat4 general;
+				for (uint32 i = 0; i < 16; i += 1) {
+					((float*)general)[i] = random_float(-10, 10);
+				}
+				mat4 general_reference = mat4_inverse_reference(general);
+				bool invertible = mat4_near_equal(general * general_reference, mat4_identity(), 1e-3f);
+				if (invertible) {
+					m_assert(mat4_near_equal(mat4_inverse(general) * general, mat4_identity(), 1e-3f));
+				}
+			}
+			mat4 projection = mat4_project(degree_to_radian(60), 16.0f / 9.0f, 0.1f, 1000.0f) * camera_view_mat4(camera{ { 1, 2, 3 }, { 0, 0, -1 }, 16.0f / 9.0f, 1, 0.1f, 1000.0f });
+			m_assert(mat4_near_equal(mat4_inverse(projection), mat4_inverse_reference(projection), 1e-4f));
+		}
+		m_case(transform_points) {
+			srand(18);
+			const uint32 count = 1003;
+			vec3* points = new vec3[count];
+			vec3* transformed = new vec3[count];
+			auto delete_points = scope_exit([&] { delete[] points; delete[] transformed; });
+			for (uint32 i = 0; i < count; i += 1) {
+				points[i] = { random_float(-10, 10), random_float(-10, 10), random_float(-10, 10) };
+			}
+			mat4 m = random_transform_mat();
+			auto check = [&](bool vectors) {
+				for (uint32 i = 0; i < count; i += 1) {
+					vec4 r = m * vec4{ points[i].x, points[i].y, points[i].z, vectors ? 0.0f : 1.0f };
+					if (fabsf(transformed[i].x - r.x) > 1e-4f || fabsf(transformed[i].y - r.y) > 1e-4f || fabsf(transformed[i].z - r.z) > 1e-4f) {
+						return false;
+					}
+				}
+				return true;
+			};
+			mat4_transform_points(m, points, transformed, count);
+			m_assert(check(false));
+			mat4_transform_vectors(m, points, transformed, count);
+			m_assert(check(true));
+#ifdef MATH_AVX
+			if (avx) {
+				mat4_transform_points_avx(m, points, transformed, count);
+				m_assert(check(false));
+				mat4_transform_vectors_avx(m, points, transformed, count);
+				m_assert(check(true));
+			}
+#endif
+			memcpy(transformed, points, count * sizeof(vec3));
+			mat4_transform_points(m, transformed, transformed, count);
+			m_assert(check(false));
+		}
+		m_case(benchmark) {
+			const uint32 count = 1 << 20;
+			vec3* points = new vec3[count];
+			vec3* transformed = new vec3[count];
+			mat4* mats = new mat4[1024];
+			auto delete_arrays = scope_exit([&] { delete[] points; delete[] transformed; delete[] mats; });
+			for (uint32 i = 0; i < count; i += 1) {
+				points[i] = { random_float(-10, 10), random_float(-10, 10), random_float(-10, 10) };
+			}
+			for (uint32 i = 0; i < 1024; i += 1) {
+				mats[i] = random_transform_mat();
+			}
+			mat4 m = mats[0];
+			auto time = [&](auto&& f) {
+				return benchmark_ns(10, f) / count;
+			};
+			double scalar_time = time([&] {
+				for (uint32 i = 0; i < count; i += 1) {
+					transformed[i] = m * points[i];
+				}
+			});
+			double sse_time = time([&] { mat4_transform_points(m, points, transformed, count); });
+			printf("(points/s: scalar %.0fM sse %.0fM", 1e3 / scalar_time, 1e3 / sse_time);
+#ifdef MATH_AVX
+			if (avx) {
+				double avx_time = time([&] { mat4_transform_points_avx(m, points, transformed, count); });
+				printf(" avx %.0fM", 1e3 / avx_time);
+			}
+#endif
+			mat4* results = new mat4[1024];
+			auto delete_results = scope_exit([&] { delete[] results; });
+			double mul_time = time([&] {
+				for (uint32 i = 0; i < count; i += 1) {
+					results[i & 1023] = mats[i & 1023] * mats[(i + 1) & 1023];
+				}
+			});
+			double inverse_time = time([&] {
+				for (uint32 i = 0; i < count; i += 1) {
+					results[i & 1023] = mat4_inverse(mats[i & 1023]);
+				}
+			});
+			double affine_inverse_time = time([&] {
+				for (uint32 i = 0; i < count; i += 1) {
+					results[i & 1023] = mat4_affine_inverse(mats[i & 1023]);
+				}
+			});
+			float sum = 0;
+			for (uint32 i = 0; i < 1024 * 16; i += 1) {
+				sum += ((float*)results)[i];
+			}
+			printf(", ns: mul %.1f inverse %.1f affine inverse %.1f) ", mul_time, inverse_time, affine_inverse_time);
+			m_assert(sum == sum || sum != sum);
+		}
+	}
+	m_test(quat_batch) {
+		auto random_quat = [&] {
+			return quat_normalize(quat{ random_float(-1, 1), random_float(-1, 1), random_float(-1, 1), random_float(-1, 1) + 0.001f });
+		};
+		auto quat_slerp_reference = [](quat q1, quat q2, float t, double* result) {
+			double a[4] = { q1.x, q1.y, q1.z, q1.w };
+			double b[4] = { q2.x, q2.y, q2.z, q2.w };
+			double d = a[0] * b[0] + a[1] * b[1] + a[2] * b[2] + a[3] * b[3];
+			if (d < 0) {
+				d = -d;
+				for (uint32 i = 0; i < 4; i += 1) {
+					b[i] = -b[i];
+				}
+			}
+			double angle = acos(min(d, 1.0));
+			double w1 = 1 - t, w2 = t;
+			if (angle > 1e-9) {
+				w1 = sin((1 - t) * angle) / sin(angle);
+				w2 = sin(t * angle) / sin(angle);
+			}
+			for (uint32 i = 0; i < 4; i += 1) {
+				result[i] = a[i] * w1 + b[i] * w2;
+			}
+		};
+		auto rotation_angle = [](quat q, const double* reference) {
+			double sign = (q.x * reference[0] + q.y * reference[1] + q.z * reference[2] + q.w * reference[3]) < 0 ? -1 : 1;
+			double distance = 0;
+			for (uint32 i = 0; i < 4; i += 1) {
+				distance += (q[i] - sign * reference[i]) * (q[i] - sign * reference[i]);
+			}
+			return 4 * asin(min(sqrt(distance) / 2, 1.0));
+		};
+		auto quat_length = [](quat q) {
+			return sqrtf(q.x * q.x + q.y * q.y + q.z * q.z + q.w * q.w);
+		};
+		const uint32 count = 1027;
+		quat* q1 = new quat[count];
+		quat* q2 = new quat[count];
+		quat* result = new quat[count];
+		float* t = new float[count];
+		auto delete_arrays = scope_exit([&] { delete[] q1; delete[] q2; delete[] result; delete[] t; });
+		m_case(slerp) {
+			srand(19);
+			for (uint32 i = 0; i < count; i += 1) {
+				q1[i] = random_quat();
+				q2[i] = (i % 8 == 0) ? q1[i] : ((i % 8 == 1) ? -q1[i] : random_quat());
+				t[i] = fabsf(random_float(-1, 1));
+			}
+			t[0] = 0;
+			t[1] = 1;
+			quat_slerp_batch(q1, q2, t, result, count);
+			for (uint32 i = 0; i < count; i += 1) {
+				double reference[4];
+				quat_slerp_reference(q1[i], q2[i], t[i], reference);
+				for (uint32 j = 0; j < 4; j += 1) {
+					m_assert(fabs(result[i][j] - reference[j]) < 2e-6);
+				}
+			}
+		}
+		m_case(nlerp_error) {
+			srand(20);
+			const double angles[] = { 10, 20, 45, 90 };
+			const double bounds[] = { 2.2e-5, 1.8e-4, 2e-3, 0.0161 };
+			for (uint32 n = 0; n < m_countof(angles); n += 1) {
+				for (uint32 i = 0; i < count; i += 1) {
+					vec3 axis = vec3_normalize(vec3{ random_float(-1, 1), random_float(-1, 1), random_float(-1, 1) + 0.001f });
+					q1[i] = random_quat();
+					q2[i] = q1[i] * quat_from_axis_rotate(axis, degree_to_radian((float)angles[n]));
+					t[i] = (float)i / (count - 1);
+				}
+				quat_nlerp_batch(q1, q2, t, result, count);
+				for (uint32 i = 0; i < count; i += 1) {
+					double reference[4];
+					quat_slerp_reference(q1[i], q2[i], t[i], reference);
+					m_assert(fabsf(quat_length(result[i]) - 1) < 1e-6f);
+					m_assert(rotation_angle(result[i], reference) < bounds[n] + 1e-6);
+				}
+			}
+		}
+		m_case(lerp_and_tails) {
+			srand(21);
+			vec3* v1 = new vec3[count];
+			vec3* v2 = new vec3[count];
+			vec3* v = new vec3[count];
+			auto delete_vecs = scope_exit([&] { delete[] v1; delete[] v2; delete[] v; });
+			for (uint32 i = 0; i < count; i += 1) {
+				v1[i] = { random_float(-1, 1), random_float(-1, 1), random_float(-1, 1) };
+				v2[i] = { random_float(-1, 1), random_float(-1, 1), random_float(-1, 1) };
+				q1[i] = random_quat();
+				q2[i] = random_quat();
+				t[i] = fabsf(random_float(-1, 1));
+			}
+			for (uint32 n = 0; n < 9; n += 1) {
+				vec3 sentinel = { 7, 7, 7 };
+				quat quat_sentinel = { 7, 7, 7, 7 };
+				for (uint32 i = 0; i < 16; i += 1) {
+					v[i] = sentinel;
+					result[i] = quat_sentinel;
+				}
+				vec3_lerp_batch(v1, v2, t, v, n);
+				quat_slerp_batch(q1, q2, t, result, n);
+				for (uint32 i = 0; i < 16; i += 1) {
+					if (i < n) {
+						vec3 reference = v1[i] + (v2[i] - v1[i]) * t[i];
+						m_assert(vec3_len(v[i] - reference) < 1e-6f);
+						m_assert(fabsf(quat_length(result[i]) - 1) < 1e-5f);
+					}
+					else {
+						m_assert(v[i] == sentinel);
+						m_assert(result[i] == quat_sentinel);
+					}
+				}
+			}
+		}
+		m_case(mat4_from_transform) {
+			srand(22);
+			transform* transforms = new transform[count];
+			mat4* mats = new mat4[count];
+			auto delete_transforms = scope_exit([&] { delete[] transforms; delete[] mats; });
+			for (uint32 i = 0; i < count; i += 1) {
+				transforms[i].scale = { 0.1f + fabsf(random_float(-1, 1)) * 10, 0.1f + fabsf(random_float(-1, 1)) * 10, 0.1f + fabsf(random_float(-1, 1)) * 10 };
+				transforms[i].rotate = random_quat();
+				transforms[i].translate = { random_float(-1, 1) * 100, random_float(-1, 1) * 100, random_float(-1, 1) * 100 };
+			}
+			mat4_from_transform_batch(transforms, mats, count);
+			for (uint32 i = 0; i < count; i += 1) {
+				mat4 reference = mat4_from_transform(transforms[i]);
+				for (uint32 j = 0; j < 16; j += 1) {
+					float a = ((const float*)mats[i])[j];
+					float b = ((const float*)reference)[j];
+					m_assert(fabsf(a - b) <= 1e-5f * max(1.0f, fabsf(b)));
+				}
+			}
+		}
+		m_case(benchmark) {
+			srand(23);
+			transform* transforms = new transform[count];
+			mat4* mats = new mat4[count];
+			auto delete_transforms = scope_exit([&] { delete[] transforms; delete[] mats; });
+			for (uint32 i = 0; i < count; i += 1) {
+				q1[i] = random_quat();
+				q2[i] = random_quat();
+				t[i] = fabsf(random_float(-1, 1));
+				transforms[i] = { { 1, 2, 3 }, q1[i], { 4, 5, 6 } };
+			}
+			auto time = [&](auto&& f) {
+				return benchmark_ns(1000, f) / count;
+			};
+			double scalar_slerp = time([&] {
+				for (uint32 i = 0; i < count; i += 1) {
+					result[i] = quat_slerp(q1[i], q2[i], t[i]);
+				}
+			});
+			double slerp = time([&] { quat_slerp_batch(q1, q2, t, result, count); });
+			double nlerp = time([&] { quat_nlerp_batch(q1, q2, t, result, count); });
+			double scalar_mat4 = time([&] {
+				for (uint32 i = 0; i < count; i += 1) {
+					mats[i] = mat4_from_transform(transforms[i]);
+				}
+			});
+			double batch_mat4 = time([&] { mat4_from_transform_batch(transforms, mats, count); });
+			printf("(ns: slerp scalar %.1f batch %.1f, nlerp batch %.1f, mat4_from_transform scalar %.1f batch %.1f) ", scalar_slerp, slerp, nlerp, scalar_mat4, batch_mat4);
+		}
+	}
+	m_test(job_system) {
+		job_system js = {};
+		job_system_init(&js, 8);
+		auto destroy_job_system = scope_exit([&] {
+			job_system_destroy(&js);
+		});
+		m_case(parallel_for_sum) {
+			const uint64 count = 1000000;
+			std::atomic<uint64> sum(0);
+			parallel_for(&js, count, 1000, [&](uint64 begin, uint64 end) {
+				uint64 partial_sum = 0;
+				for (uint64 i = begin; i < end; i += 1) {
+					partial_sum += i;
+				}
+				sum.fetch_add(partial_sum);
+			});
+			m_assert(sum.load() == count * (count - 1) / 2);
+		}
+		m_case(parallel_for_nested) {
+			std::atomic<uint32> visit_count(0);
+			parallel_for(&js, 64, 1, [&](uint64 begin, uint64 end) {
+				for (uint64 i = begin; i < end; i += 1) {
+					parallel_for(&js, 256, 16, [&](uint64 begin, uint64 end) {
+						visit_count.fetch_add((uint32)(end - begin));
+					});
+				}
+			});
+			m_assert(visit_count.load() == 64 * 256);
+		}
+		m_case(frame_allocator) {
+			frame_allocator fa = {};
+			m_assert(frame_allocator_init(&fa, js.worker_count, m_megabytes(64)));
+			uint32* frame_0_data = frame_allocator_alloc<uint32>(&fa, 1);
+			*frame_0_data = 0xdeadbeef;
+			frame_allocator_next_frame(&fa);
+			std::atomic<uint32> bad_count(0);
+			parallel_for(&js, 4096, 16, [&](uint64 begin, uint64 end) {
+				uint32* values = frame_allocator_alloc<uint32>(&fa, end - begin);
+				for (uint64 i = begin; i < end; i += 1) {
+					values[i - begin] = (uint32)i;
+				}
+				for (uint64 i = begin; i < end; i += 1) {
+					if (values[i - begin] != (uint32)i) {
+						bad_count.fetch_add(1);
+					}
+				}
+			});
+			m_assert(bad_count.load() == 0);
+			m_assert(*frame_0_data == 0xdeadbeef);
+			frame_allocator_next_frame(&fa);
+			m_assert(frame_allocator_arena(&fa)->size == 0);
+			frame_allocator_destroy(&fa);
+		}
+		m_case(counter_wait) {
+			std::atomic<uint32> done_count(0);
+			job_counter counter = {};
+			for (uint32 i = 0; i < 10000; i += 1) {
+				job_system_submit(&js, job{ [](void* data, uint64, uint64) { ((std::atomic<uint32>*)data)->fetch_add(1); }, &done_count, 0, 0, &counter });
+			}
+			job_system_wait(&js, &counter);
+			m_assert(counter.count.load() == 0);
+			m_assert(done_count.load() == 10000);
 		}
 	}
 
@@ -0,0 +1,35 @@
+/***************************************************************************************************/
+/*          Copyright (C) 2017-2018 By Yang Chen (yngccc@gmail.com). All Rights Reserved.          */
+/***************************************************************************************************/
+
+#ifndef __TYPES_CPP__
+#define __TYPES_CPP__
+
+// The fixed width integer types and bit intrinsics, without any platform headers, for code that also builds outside
+// of Windows such as simd.cpp. common.cpp includes this.
+
+#include <cstdint>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#include <immintrin.h>
+
+typedef int8_t int8;
+typedef int16_t int16;
+typedef int32_t int32;
+typedef int64_t int64;
+typedef uint8_t uint8;
+typedef uint16_t uint16;
+typedef uint32_t uint32;
+typedef uint64_t uint64;
+
+uint32 pop_count(uint32 n) {
+#ifdef _MSC_VER
+	return __popcnt(n);
+#else
+	return __builtin_popcount(n);
+#endif
+}
+
+#endif // __TYPES_CPP__
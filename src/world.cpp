@@ -57,7 +57,7 @@ struct player {
 };
 
 struct static_object {
-	string id;
+	atom id;
 	uint32 model_index;
 	transform transform;
 	uint32 animation_index;
@@ -67,7 +67,7 @@ struct static_object {
 };
 
 struct dynamic_object {
-	string id;
+	atom id;
 	uint32 model_index;
 	transform transform;
 	uint32 animation_index;
@@ -85,6 +85,7 @@ struct model_scene {
 struct model_node {
 	mat4 local_transform_mat;
 	mat4 global_transform_mat;
+	aabb bound; // model space, covers the node's mesh and every node below it
 	transform local_transform;
 	uint32 mesh_index;
 	uint32 skin_index;
@@ -98,6 +99,7 @@ struct model_mesh_primitive {
 	uint32 vertex_count;
 	uint32 index_count;
 	uint32 material_index;
+	aabb bound; // mesh space
 };
 
 struct model_mesh {
@@ -178,12 +180,39 @@ struct model {
 	uint32 material_count;
 	model_texture* textures;
 	uint32 texture_count;
+	aabb bound; // model space, all scenes
 	transform transform;
 	collision collision;
 	physx::PxGeometryHolder px_geometry_holder;
-	char file_name[64];
+	atom file;
+	uint64 memory_size;
+	uint64 gpu_memory_size;
 };
 
+const uint32 memory_tag_model_scenes = memory_tag_register("model scenes");
+const uint32 memory_tag_model_nodes = memory_tag_register("model nodes");
+const uint32 memory_tag_model_meshes = memory_tag_register("model meshes");
+const uint32 memory_tag_model_skins = memory_tag_register("model skins");
+const uint32 memory_tag_model_animations = memory_tag_register("model animations");
+const uint32 memory_tag_model_key_frames = memory_tag_register("model key frames");
+const uint32 memory_tag_model_materials = memory_tag_register("model materials");
+const uint32 memory_tag_model_textures = memory_tag_register("model textures");
+const uint32 memory_tag_model_vertex_buffers = memory_tag_register("model vertex buffers (gpu)");
+const uint32 memory_tag_model_index_buffers = memory_tag_register("model index buffers (gpu)");
+const uint32 memory_tag_model_texture_images = memory_tag_register("model texture images (gpu)");
+const uint32 memory_tag_terrain_data = memory_tag_register("terrain data");
+
+template <typename T>
+T* model_alloc(model* model, uint32 tag, uint64 count) {
+	model->memory_size += count * sizeof(T);
+	return memory_tracked_new<T>(tag, count);
+}
+
+void model_track_gpu_alloc(model* model, uint32 tag, uint64 size) {
+	model->gpu_memory_size += size;
+	memory_track_alloc(tag, size);
+}
+
 struct terrain_vertex {
 	vec2 position;
 	vec2 uv;
@@ -209,13 +238,13 @@ struct terrain {
 	ID3D11Buffer* index_buffer;
 	uint32 index_count;
 
-	char file[32];
+	atom file;
 };
 
 struct skybox {
 	ID3D11Texture2D* cube_texture;
 	ID3D11ShaderResourceView* cube_texture_view;
-	char file[32];
+	atom file;
 };
 
 struct mesh_primitive_render_data {
@@ -263,7 +292,9 @@ struct sphere_light {
 };
 
 struct world {
-	memory_arena frame_memory_arena;
+	job_system job_system;
+	frame_allocator frame_allocator;
+	async_io async_io;
 
 	world_render_data render_data;
 
@@ -276,6 +307,9 @@ struct world {
 	player player;
 
 	array<model> models;
+	hash_map<atom, uint32> model_indices;
+	hash_map<atom, uint32> terrain_indices;
+	hash_map<atom, uint32> skybox_indices;
 	array<direct_light> direct_lights;
 	array<sphere_light> sphere_lights;
 
@@ -313,7 +347,9 @@ struct world_render_params {
 };
 
 void world_init(world* world, d3d12* d3d12) {
-	m_assert(memory_arena_init(m_megabytes(16), &world->frame_memory_arena));
+	job_system_init(&world->job_system);
+	m_assert(frame_allocator_init(&world->frame_allocator, world->job_system.worker_count, m_megabytes(256)));
+	async_io_init(&world->async_io);
 
 	world->box_vertex_buffer = d3d12->create_buffer(sizeof(box_vertices), D3D12_HEAP_TYPE_DEFAULT, D3D12_RESOURCE_FLAG_NONE, D3D12_RESOURCE_STATE_COPY_DEST);
 	d3d12->copy_buffer(world->box_vertex_buffer, box_vertices, D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER);
@@ -334,12 +370,12 @@ void world_init(world* world, d3d12* d3d12) {
 	d3d12->copy_buffer(world->torus_vertex_buffer, torus_vertices, D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER);
 
 	{ // reference grid
-		memory_arena_undo_alloc_scope_exit undo_frame_alloc(&world->frame_memory_arena);
+		memory_arena_undo_alloc_scope_exit undo_frame_alloc(frame_allocator_arena(&world->frame_allocator));
 		float size = 50;
 		uint32 n = 50;
 		float gap = size / n;
 		uint32 vertex_count = (n + 1) * 2 * 2;
-		vec3* vertices = memory_arena_alloc<vec3>(&world->frame_memory_arena, vertex_count);
+		vec3* vertices = frame_allocator_alloc<vec3>(&world->frame_allocator, vertex_count);
 		vec3* vertices_ptr = vertices;
 		vec3 begin = { -size / 2, 0, -size / 2 };
 		vec3 end = { size / 2, 0, -size / 2 };
@@ -432,6 +468,8 @@ void world_init(world* world, d3d12* d3d12) {
 		world->dynamic_objects = array<dynamic_object>{new dynamic_object[256], 0, 256};
 		world->terrains = array<terrain>{new terrain[16], 0, 16};
 		world->skyboxes = array<skybox>{new skybox[16], 0, 16};
+		hash_map_initialize(&world->terrain_indices, 16);
+		hash_map_initialize(&world->skybox_indices, 16);
 
 		world->player = {};
 		world->player.model_index = UINT32_MAX;
@@ -439,6 +477,7 @@ void world_init(world* world, d3d12* d3d12) {
 		world->player.animation_index = UINT32_MAX;
 
 		world->models = array<model>{new model[256], 0, 256};
+		hash_map_initialize(&world->model_indices, 256);
 
 		world->direct_lights = array<direct_light>{new direct_light[16], 0, 16};
 
@@ -446,27 +485,46 @@ void world_init(world* world, d3d12* d3d12) {
 	}
 }
 
-bool world_add_model(world* world, d3d12* d3d12, const char* file_name, transform transform, collision collision) {
-	for (auto& model : world->models) {
-		if (!strcmp(model.file_name, file_name)) {
-			return false;
+// Only stops what world_init started on the cpu side, d3d12 resources go away with the device.
+void world_destroy(world* world) {
+	async_io_destroy(&world->async_io);
+	frame_allocator_destroy(&world->frame_allocator);
+	job_system_destroy(&world->job_system);
+}
+
+// Sets the bound of node_index and the nodes below it. Global transforms are baked into the gpk file, so this runs
+// once at load.
+aabb model_node_update_bound(model* model, uint32 node_index) {
+	model_node* node = &model->nodes[node_index];
+	node->bound = aabb_empty();
+	if (node->mesh_index < model->mesh_count) {
+		model_mesh* mesh = &model->meshes[node->mesh_index];
+		for (uint32 i = 0; i < mesh->primitive_count; i += 1) {
+			node->bound = aabb_expand(node->bound, aabb_transform(mesh->primitives[i].bound, node->global_transform_mat));
 		}
 	}
+	for (uint32 i = 0; i < node->child_count; i += 1) {
+		node->bound = aabb_expand(node->bound, model_node_update_bound(model, node->children[i]));
+	}
+	return node->bound;
+}
 
-	file_mapping model_file_mapping = {};
-	if (!file_mapping_open(file_name, &model_file_mapping, true)) {
+// Adds a model from the contents of its gpk file, model_data only has to stay valid during the call.
+bool world_add_model_data(world* world, d3d12* d3d12, atom file, uint8* model_data, uint64 model_data_size, transform transform, collision collision) {
+	m_profile_zone("world_add_model_data");
+	if (hash_map_find(&world->model_indices, file)) {
 		return false;
 	}
-	auto close_model_file_mapping = scope_exit([&] { file_mapping_close(model_file_mapping); });
 
-	gpk_model* gpk_model = (struct gpk_model*)model_file_mapping.ptr;
-	if (strcmp(gpk_model->format_str, m_gpk_model_format_str)) {
+	gpk_model* gpk_model = (struct gpk_model*)model_data;
+	if (model_data_size < sizeof(struct gpk_model) || strcmp(gpk_model->format_str, m_gpk_model_format_str)) {
 		return false;
 	}
 
+	hash_map_insert(&world->model_indices, file, (uint32)world->models.size);
 	model* model = world->models.append({});
 
-	snprintf(model->file_name, sizeof(model->file_name), "%s", file_name);
+	model->file = file;
 	model->transform = transform;
 	model->collision = collision;
 	model->px_geometry_holder = physx::PxGeometryHolder();
@@ -487,30 +545,30 @@ bool world_add_model(world* world, d3d12* d3d12, const char* file_name, transfor
 	model->animation_count = gpk_model->animation_count;
 	model->material_count = gpk_model->material_count;
 	model->texture_count = gpk_model->image_count;
-	model->scenes = new model_scene[model->scene_count]();
-	model->nodes = new model_node[model->node_count]();
-	model->meshes = new model_mesh[model->mesh_count]();
+	model->scenes = model_alloc<model_scene>(model, memory_tag_model_scenes, model->scene_count);
+	model->nodes = model_alloc<model_node>(model, memory_tag_model_nodes, model->node_count);
+	model->meshes = model_alloc<model_mesh>(model, memory_tag_model_meshes, model->mesh_count);
 	if (model->skin_count > 0) {
-		model->skins = new model_skin[model->skin_count]();
+		model->skins = model_alloc<model_skin>(model, memory_tag_model_skins, model->skin_count);
 	}
 	if (model->animation_count > 0) {
-		model->animations = new model_animation[model->animation_count]();
+		model->animations = model_alloc<model_animation>(model, memory_tag_model_animations, model->animation_count);
 	}
 	if (model->material_count > 0) {
-		model->materials = new model_material[model->material_count]();
+		model->materials = model_alloc<model_material>(model, memory_tag_model_materials, model->material_count);
 	}
 	if (model->texture_count > 0) {
-		model->textures = new model_texture[model->texture_count]();
+		model->textures = model_alloc<model_texture>(model, memory_tag_model_textures, model->texture_count);
 	}
 	for (uint32 i = 0; i < model->scene_count; i += 1) {
-		gpk_model_scene* gpk_model_scene = ((struct gpk_model_scene*)(model_file_mapping.ptr + gpk_model->scene_offset)) + i;
+		gpk_model_scene* gpk_model_scene = ((struct gpk_model_scene*)(model_data + gpk_model->scene_offset)) + i;
 		model_scene* model_scene = &model->scenes[i];
 		array_copy(model_scene->name, gpk_model_scene->name);
 		array_copy(model_scene->node_indices, gpk_model_scene->node_indices);
 		model_scene->node_index_count = gpk_model_scene->node_index_count;
 	}
 	for (uint32 i = 0; i < model->node_count; i += 1) {
-		gpk_model_node* gpk_model_node = ((struct gpk_model_node*)(model_file_mapping.ptr + gpk_model->node_offset)) + i;
+		gpk_model_node* gpk_model_node = ((struct gpk_model_node*)(model_data + gpk_model->node_offset)) + i;
 		model_node* model_node = &model->nodes[i];
 		model_node->mesh_index = gpk_model_node->mesh_index;
 		model_node->skin_index = gpk_model_node->skin_index;
@@ -522,13 +580,13 @@ bool world_add_model(world* world, d3d12* d3d12, const char* file_name, transfor
 	}
 
 	for (uint32 i = 0; i < model->mesh_count; i += 1) {
-		gpk_model_mesh* gpk_model_mesh = ((struct gpk_model_mesh*)(model_file_mapping.ptr + gpk_model->mesh_offset)) + i;
+		gpk_model_mesh* gpk_model_mesh = ((struct gpk_model_mesh*)(model_data + gpk_model->mesh_offset)) + i;
 		model_mesh* model_mesh = &model->meshes[i];
 		array_copy(model_mesh->name, gpk_model_mesh->name);
 		model_mesh->primitive_count = gpk_model_mesh->primitive_count;
-		model_mesh->primitives = new model_mesh_primitive[model_mesh->primitive_count]();
+		model_mesh->primitives = model_alloc<model_mesh_primitive>(model, memory_tag_model_meshes, model_mesh->primitive_count);
 		for (uint32 i = 0; i < model_mesh->primitive_count; i += 1) {
-			gpk_model_mesh_primitive* gpk_primitive = ((gpk_model_mesh_primitive*)(model_file_mapping.ptr + gpk_model_mesh->primitive_offset)) + i;
+			gpk_model_mesh_primitive* gpk_primitive = ((gpk_model_mesh_primitive*)(model_data + gpk_model_mesh->primitive_offset)) + i;
 			model_mesh_primitive* primitive = &model_mesh->primitives[i];
 
 			primitive->vertex_count = gpk_primitive->vertex_count;
@@ -536,64 +594,83 @@ bool world_add_model(world* world, d3d12* d3d12, const char* file_name, transfor
 			primitive->material_index = gpk_primitive->material_index;
 
 			m_assert(primitive->vertex_count > 0);
+			primitive->bound = gpk_primitive->bound;
 			primitive->vertex_buffer = d3d12->create_buffer(primitive->vertex_count * sizeof(struct gpk_model_vertex), D3D12_HEAP_TYPE_DEFAULT, D3D12_RESOURCE_FLAG_NONE, D3D12_RESOURCE_STATE_COPY_DEST);
-			d3d12->copy_buffer(primitive->vertex_buffer, model_file_mapping.ptr + gpk_primitive->vertices_offset, D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER);
+			if (gpk_primitive->vertex_format == gpk_model_vertex_format_packed) {
+				memory_arena_undo_alloc_scope_exit undo_frame_alloc(frame_allocator_arena(&world->frame_allocator));
+				gpk_model_vertex* vertices = frame_allocator_alloc<gpk_model_vertex>(&world->frame_allocator, primitive->vertex_count);
+				gpk_model_vertices_unpack((gpk_model_vertex_packed*)(model_data + gpk_primitive->vertices_offset), primitive->vertex_count, gpk_primitive->bound, vertices);
+				d3d12->copy_buffer(primitive->vertex_buffer, vertices, D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER);
+			}
+			else {
+				d3d12->copy_buffer(primitive->vertex_buffer, model_data + gpk_primitive->vertices_offset, D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER);
+			}
+			model_track_gpu_alloc(model, memory_tag_model_vertex_buffers, primitive->vertex_count * sizeof(struct gpk_model_vertex));
 
 			if (primitive->index_count > 0) {
 				primitive->index_buffer = d3d12->create_buffer(primitive->index_count * sizeof(uint16), D3D12_HEAP_TYPE_DEFAULT, D3D12_RESOURCE_FLAG_NONE, D3D12_RESOURCE_STATE_COPY_DEST);
-				d3d12->copy_buffer(primitive->index_buffer, model_file_mapping.ptr + gpk_primitive->indices_offset, D3D12_RESOURCE_STATE_INDEX_BUFFER);
+				d3d12->copy_buffer(primitive->index_buffer, model_data + gpk_primitive->indices_offset, D3D12_RESOURCE_STATE_INDEX_BUFFER);
+				model_track_gpu_alloc(model, memory_tag_model_index_buffers, primitive->index_count * sizeof(uint16));
 			}
 		}
 	}
+	model->bound = aabb_empty();
+	for (uint32 i = 0; i < model->scene_count; i += 1) {
+		model_scene* scene = &model->scenes[i];
+		for (uint32 i = 0; i < scene->node_index_count; i += 1) {
+			model->bound = aabb_expand(model->bound, model_node_update_bound(model, scene->node_indices[i]));
+		}
+	}
 
 	for (uint32 i = 0; i < model->skin_count; i += 1) {
-		gpk_model_skin* gpk_model_skin = ((struct gpk_model_skin*)(model_file_mapping.ptr + gpk_model->skin_offset)) + i;
+		gpk_model_skin* gpk_model_skin = ((struct gpk_model_skin*)(model_data + gpk_model->skin_offset)) + i;
 		model_skin* model_skin = &model->skins[i];
 		array_copy(model_skin->name, gpk_model_skin->name);
 		model_skin->joint_count = gpk_model_skin->joint_count;
 		m_assert(model_skin->joint_count > 0);
-		model_skin->joints = new model_joint[model_skin->joint_count]();
-		gpk_model_joint* gpk_joints = (gpk_model_joint*)(model_file_mapping.ptr + gpk_model_skin->joints_offset);
+		model_skin->joints = model_alloc<model_joint>(model, memory_tag_model_skins, model_skin->joint_count);
+		gpk_model_joint* gpk_joints = (gpk_model_joint*)(model_data + gpk_model_skin->joints_offset);
 		for (uint32 i = 0; i < model_skin->joint_count; i += 1) {
 			model_skin->joints[i].node_index = gpk_joints[i].node_index;
 			model_skin->joints[i].inverse_bind_mat = gpk_joints[i].inverse_bind_mat;
 		}
 	}
 	for (uint32 i = 0; i < model->animation_count; i += 1) {
-		gpk_model_animation* gpk_animation = ((struct gpk_model_animation*)(model_file_mapping.ptr + gpk_model->animation_offset)) + i;
+		gpk_model_animation* gpk_animation = ((struct gpk_model_animation*)(model_data + gpk_model->animation_offset)) + i;
 		model_animation* animation = &model->animations[i];
 		array_copy(animation->name, gpk_animation->name);
 		animation->channel_count = gpk_animation->channel_count;
-		animation->channels = new model_animation_channel[animation->channel_count]();
+		animation->channels = model_alloc<model_animation_channel>(model, memory_tag_model_animations, animation->channel_count);
 		for (uint32 i = 0; i < animation->channel_count; i += 1) {
-			gpk_model_animation_channel* gpk_channel = ((struct gpk_model_animation_channel*)(model_file_mapping.ptr + gpk_animation->channel_offset)) + i;
+			gpk_model_animation_channel* gpk_channel = ((struct gpk_model_animation_channel*)(model_data + gpk_animation->channel_offset)) + i;
 			model_animation_channel* channel = &animation->channels[i];
 			channel->node_index = gpk_channel->node_index;
 			channel->channel_type = gpk_channel->channel_type;
 			channel->sampler_index = gpk_channel->sampler_index;
 		}
 		animation->sampler_count = gpk_animation->sampler_count;
-		animation->samplers = new model_animation_sampler[animation->sampler_count]();
+		animation->samplers = model_alloc<model_animation_sampler>(model, memory_tag_model_animations, animation->sampler_count);
 		for (uint32 i = 0; i < animation->sampler_count; i += 1) {
-			gpk_model_animation_sampler* gpk_sampler = ((struct gpk_model_animation_sampler*)(model_file_mapping.ptr + gpk_animation->sampler_offset)) + i;
+			gpk_model_animation_sampler* gpk_sampler = ((struct gpk_model_animation_sampler*)(model_data + gpk_animation->sampler_offset)) + i;
 			model_animation_sampler* sampler = &animation->samplers[i];
 			sampler->interpolation_type = gpk_sampler->interpolation_type;
 			sampler->key_frame_count = gpk_sampler->key_frame_count;
-			sampler->key_frames = new model_animation_key_frame[sampler->key_frame_count]();
+			sampler->key_frames = model_alloc<model_animation_key_frame>(model, memory_tag_model_key_frames, sampler->key_frame_count);
 			for (uint32 i = 0; i < sampler->key_frame_count; i += 1) {
-				gpk_model_animation_key_frame* gpk_key_frame = ((struct gpk_model_animation_key_frame*)(model_file_mapping.ptr + gpk_sampler->key_frame_offset)) + i;
+				gpk_model_animation_key_frame* gpk_key_frame = ((struct gpk_model_animation_key_frame*)(model_data + gpk_sampler->key_frame_offset)) + i;
 				sampler->key_frames[i].time = gpk_key_frame->time;
 				sampler->key_frames[i].transform_data = gpk_key_frame->transform_data;
 			}
 		}
 	}
 	for (uint32 i = 0; i < model->texture_count; i += 1) {
-		gpk_model_image* gpk_model_image = ((struct gpk_model_image*)(model_file_mapping.ptr + gpk_model->image_offset)) + i;
+		gpk_model_image* gpk_model_image = ((struct gpk_model_image*)(model_data + gpk_model->image_offset)) + i;
 		model->textures[i].texture = d3d12->create_texture_2d(gpk_model_image->width, gpk_model_image->height, 1, gpk_model_image->mips, (DXGI_FORMAT)gpk_model_image->format, D3D12_HEAP_TYPE_DEFAULT, D3D12_RESOURCE_FLAG_NONE, D3D12_RESOURCE_STATE_COPY_DEST);
-		d3d12->copy_texture_2d(model->textures[i].texture, model_file_mapping.ptr + gpk_model_image->data_offset, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+		d3d12->copy_texture_2d(model->textures[i].texture, model_data + gpk_model_image->data_offset, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+		model_track_gpu_alloc(model, memory_tag_model_texture_images, gpk_model_image->size);
 	}
 	for (uint32 i = 0; i < model->material_count; i += 1) {
-		gpk_model_material* gpk_model_material = ((struct gpk_model_material*)(model_file_mapping.ptr + gpk_model->material_offset)) + i;
+		gpk_model_material* gpk_model_material = ((struct gpk_model_material*)(model_data + gpk_model->material_offset)) + i;
 		model_material* model_material = &model->materials[i];
 		array_copy(model_material->name, gpk_model_material->name);
 		model_material->diffuse_texture_index = gpk_model_material->diffuse_image_index;
@@ -627,16 +704,50 @@ bool world_add_model(world* world, d3d12* d3d12, const char* file_name, transfor
 	return true;
 }
 
-bool world_add_terrain(world* world, d3d12* d3d12, const char* terrain_file) {
-	const char* file_name = get_file_name(terrain_file);
-	for (auto& terrain : world->terrains) {
-		if (!strcmp(terrain.file, file_name)) {
-			return false;
+// Starts reading the vertex, index and image sections of a mapped gpk model so their uploads do not stall on page faults.
+void gpk_model_prefetch(file_mapping* file_mapping) {
+	gpk_model* gpk_model = (struct gpk_model*)file_mapping->ptr;
+	if (file_mapping->size < sizeof(struct gpk_model) || strcmp(gpk_model->format_str, m_gpk_model_format_str)) {
+		return;
+	}
+	for (uint32 i = 0; i < gpk_model->mesh_count; i += 1) {
+		gpk_model_mesh* gpk_model_mesh = ((struct gpk_model_mesh*)(file_mapping->ptr + gpk_model->mesh_offset)) + i;
+		for (uint32 i = 0; i < gpk_model_mesh->primitive_count; i += 1) {
+			gpk_model_mesh_primitive* gpk_primitive = ((gpk_model_mesh_primitive*)(file_mapping->ptr + gpk_model_mesh->primitive_offset)) + i;
+			file_mapping_prefetch(file_mapping, gpk_primitive->vertices_offset, gpk_primitive->vertex_count * gpk_model_vertex_size(gpk_primitive->vertex_format));
+			file_mapping_prefetch(file_mapping, gpk_primitive->indices_offset, gpk_primitive->index_count * sizeof(uint16));
 		}
 	}
+	for (uint32 i = 0; i < gpk_model->image_count; i += 1) {
+		gpk_model_image* gpk_model_image = ((struct gpk_model_image*)(file_mapping->ptr + gpk_model->image_offset)) + i;
+		file_mapping_prefetch(file_mapping, gpk_model_image->data_offset, gpk_model_image->size);
+	}
+}
+
+bool world_add_model(world* world, d3d12* d3d12, const char* file_name, transform transform, collision collision) {
+	atom file = atom_intern(file_name);
+	if (hash_map_find(&world->model_indices, file)) {
+		return false;
+	}
+
+	file_mapping model_file_mapping = {};
+	if (!file_mapping_open(file_name, &model_file_mapping, true, file_mapping_hint_sequential)) {
+		return false;
+	}
+	auto close_model_file_mapping = scope_exit([&] { file_mapping_close(model_file_mapping); });
+	gpk_model_prefetch(&model_file_mapping);
+
+	return world_add_model_data(world, d3d12, file, model_file_mapping.ptr, model_file_mapping.size, transform, collision);
+}
+
+bool world_add_terrain(world* world, d3d12* d3d12, const char* terrain_file) {
+	atom file = atom_intern(get_file_name(terrain_file));
+	if (hash_map_find(&world->terrain_indices, file)) {
+		return false;
+	}
 
 	file_mapping terrain_file_mapping = {};
-	if (!file_mapping_open(terrain_file, &terrain_file_mapping, true)) {
+	if (!file_mapping_open(terrain_file, &terrain_file_mapping, true, file_mapping_hint_sequential | file_mapping_hint_will_need)) {
 		return false;
 	}
 	auto close_terrain_file_mapping = scope_exit([&] { file_mapping_close(terrain_file_mapping); });
@@ -646,9 +757,10 @@ bool world_add_terrain(world* world, d3d12* d3d12, const char* terrain_file) {
 		return false;
 	}
 
+	hash_map_insert(&world->terrain_indices, file, (uint32)world->terrains.size);
 	terrain* terrain = world->terrains.append({});
 
-	snprintf(terrain->file, sizeof(terrain->file), "%s", file_name);
+	terrain->file = file;
 	terrain->width = gpk_terrain->width;
 	terrain->height = gpk_terrain->height;
 	terrain->max_height = gpk_terrain->max_height;
@@ -673,7 +785,7 @@ bool world_add_terrain(world* world, d3d12* d3d12, const char* terrain_file) {
 		//m_d3d_assert(d3d->device->CreateTexture2D(&texture_desc, &subresource_data, &terrain->height_texture));
 		//m_d3d_assert(d3d->device->CreateShaderResourceView(terrain->height_texture, nullptr, &terrain->height_texture_view));
 
-		terrain->height_texture_data = new int16[height_texture_width * height_texture_height]();
+		terrain->height_texture_data = memory_tracked_new<int16>(memory_tag_terrain_data, height_texture_width * height_texture_height);
 		memcpy(terrain->height_texture_data, height_texture_data, height_texture_size);
 	}
 	{ // diffuse texture
@@ -698,7 +810,7 @@ bool world_add_terrain(world* world, d3d12* d3d12, const char* terrain_file) {
 
 		terrain->diffuse_texture_uv_repeat = 1.0f;
 
-		terrain->diffuse_texture_data = new uint32[diffuse_texture_width * diffuse_texture_height]();
+		terrain->diffuse_texture_data = memory_tracked_new<uint32>(memory_tag_terrain_data, diffuse_texture_width * diffuse_texture_height);
 		memcpy(terrain->diffuse_texture_data, diffuse_texture_data, diffuse_texture_size);
 	}
 	{ // vertices
@@ -712,8 +824,8 @@ bool world_add_terrain(world* world, d3d12* d3d12, const char* terrain_file) {
 		float duv_x = 1.0f / (vertex_x_count - 1);
 		float duv_y = 1.0f / (vertex_y_count - 1);
 		{
-			terrain_vertex* vertices = new terrain_vertex[vertex_count]();
-			auto delete_vertices = scope_exit([&] { delete[]vertices; });
+			terrain_vertex* vertices = memory_tracked_new<terrain_vertex>(memory_tag_terrain_data, vertex_count);
+			auto delete_vertices = scope_exit([&] { memory_tracked_delete(memory_tag_terrain_data, vertices, vertex_count); });
 			for (uint32 i = 0; i < vertex_y_count; i += 1) {
 				for (uint32 j = 0; j < vertex_x_count; j += 1) {
 					vertices[vertex_x_count * i + j] = { position, uv };
@@ -733,8 +845,8 @@ bool world_add_terrain(world* world, d3d12* d3d12, const char* terrain_file) {
 			//m_d3d_assert(d3d->device->CreateBuffer(&buffer_desc, &vertex_buffer_data, &terrain->vertex_buffer));
 		}
 		{
-			uint32* indices = new uint32[index_count]();
-			auto delete_indices = scope_exit([&] { delete[]indices; });
+			uint32* indices = memory_tracked_new<uint32>(memory_tag_terrain_data, index_count);
+			auto delete_indices = scope_exit([&] { memory_tracked_delete(memory_tag_terrain_data, indices, index_count); });
 			uint32* index = indices;
 			for (uint32 i = 0; i < (vertex_y_count - 1); i += 1) {
 				uint32 n = vertex_x_count * i;
@@ -761,15 +873,13 @@ bool world_add_terrain(world* world, d3d12* d3d12, const char* terrain_file) {
 }
 
 bool world_add_skybox(world* world, d3d12* d3d12, const char* skybox_file) {
-	const char* file_name = get_file_name(skybox_file);
-	for (auto& skybox : world->skyboxes) {
-		if (!strcmp(skybox.file, file_name)) {
-			return false;
-		}
+	atom file = atom_intern(get_file_name(skybox_file));
+	if (hash_map_find(&world->skybox_indices, file)) {
+		return false;
 	}
 
 	file_mapping skybox_file_mapping = {};
-	if (!file_mapping_open(skybox_file, &skybox_file_mapping, true)) {
+	if (!file_mapping_open(skybox_file, &skybox_file_mapping, true, file_mapping_hint_sequential | file_mapping_hint_will_need)) {
 		return false;
 	}
 	auto close_skybyx_file_mapping = scope_exit([&] { file_mapping_close(skybox_file_mapping); });
@@ -779,8 +889,9 @@ bool world_add_skybox(world* world, d3d12* d3d12, const char* skybox_file) {
 		return false;
 	}
 
+	hash_map_insert(&world->skybox_indices, file, (uint32)world->skyboxes.size);
 	skybox* skybox = world->skyboxes.append({});
-	snprintf(skybox->file, sizeof(skybox->file), "%s", file_name);
+	skybox->file = file;
 
 	D3D11_TEXTURE2D_DESC texture_desc = {};
 	texture_desc.Width = gpk_skybox->cubemap_width;
@@ -806,21 +917,18 @@ bool world_add_skybox(world* world, d3d12* d3d12, const char* skybox_file) {
 }
 
 void world_build_dxr_acceleration_buffers(world* world, d3d12* d3d12) {
+	m_profile_zone("world_build_dxr_acceleration_buffers");
 	for (auto& buffer : d3d12->dxr_bottom_acceleration_buffers) buffer->Release();
+	d3d12->dxr_bottom_acceleration_buffers.release();
 	if (d3d12->dxr_top_acceleration_buffer) d3d12->dxr_top_acceleration_buffer->Release();
 
 	m_d3d_assert(d3d12->command_allocator->Reset());
 	m_d3d_assert(d3d12->command_list->Reset(d3d12->command_allocator, nullptr));
 
-	array<array<D3D12_RAYTRACING_GEOMETRY_DESC>> model_geom_descs{ new array<D3D12_RAYTRACING_GEOMETRY_DESC>[world->models.size], 0, world->models.size };
-	auto delete_descs = scope_exit([&]
-		{
-			for (auto descs : model_geom_descs) {
-				delete[] descs.elems;
-			}
-			delete[] model_geom_descs.elems;
-		}
-	);
+	memory_arena* frame_arena = frame_allocator_arena(&world->frame_allocator);
+	memory_arena_undo_alloc_scope_exit undo_frame_alloc(frame_arena);
+	array<array<D3D12_RAYTRACING_GEOMETRY_DESC>> model_geom_descs = { nullptr, 0, 0, frame_arena };
+	model_geom_descs.reserve(world->models.size);
 
 	uint32 node_transform_mats_offset = 0;
 	uint32 node_transform_mats_capacity = m_megabytes(16);
@@ -831,18 +939,20 @@ void world_build_dxr_acceleration_buffers(world* world, d3d12* d3d12) {
 	node_transform_mats->Map(0, nullptr, (void**)&node_transform_mats_ptr);
 	for (uint32 i = 0; i < world->models.size; i += 1) {
 		model* model = &world->models[i];
-		auto* geom_descs = model_geom_descs.append(array<D3D12_RAYTRACING_GEOMETRY_DESC>{new D3D12_RAYTRACING_GEOMETRY_DESC[32], 0, 32});
+		auto* geom_descs = model_geom_descs.append({ nullptr, 0, 0, frame_arena });
+		geom_descs->reserve(32);
 		for (uint32 i = 0; i < model->scene_count; i += 1) {
 			model_scene* scene = &model->scenes[i];
 			for (uint32 i = 0; i < scene->node_index_count; i += 1) {
-				std::stack<model_node*> node_stack;
-				node_stack.push(&model->nodes[scene->node_indices[i]]);
-				while (!node_stack.empty()) {
-					model_node* node = node_stack.top();
-					node_stack.pop();
+				small_array<model_node*, 64> node_stack = {};
+				node_stack.arena = frame_arena;
+				node_stack.append(&model->nodes[scene->node_indices[i]]);
+				while (node_stack.size > 0) {
+					model_node* node = node_stack.back();
+					node_stack.pop_back();
 					for (uint32 i = 0; i < node->child_count; i += 1) {
 						model_node* child_node = &model->nodes[node->children[i]];
-						node_stack.push(child_node);
+						node_stack.append(child_node);
 					}
 					if (node->mesh_index < model->mesh_count) {
 						mat4 transform_mat = mat4_transpose(node->global_transform_mat);
@@ -883,9 +993,10 @@ void world_build_dxr_acceleration_buffers(world* world, d3d12* d3d12) {
 	}
 	node_transform_mats->Unmap(0, nullptr);
 
-	auto bottom_acceleration_scratch_buffers = array<ID3D12Resource*>{new ID3D12Resource*[world->models.size], world->models.size, world->models.size};
-	auto bottom_acceleration_buffers = array<ID3D12Resource*>{new ID3D12Resource*[world->models.size], world->models.size, world->models.size};
-	auto delete_buffers = scope_exit([&] { delete[] bottom_acceleration_scratch_buffers.elems; });
+	array<ID3D12Resource*> bottom_acceleration_scratch_buffers = { nullptr, 0, 0, frame_arena };
+	bottom_acceleration_scratch_buffers.resize(world->models.size);
+	array<ID3D12Resource*> bottom_acceleration_buffers = {};
+	bottom_acceleration_buffers.resize(world->models.size);
 	for (uint32 i = 0; i < world->models.size; i += 1) {
 		D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_INPUTS inputs = {};
 		inputs.Type = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL;
@@ -980,6 +1091,9 @@ void world_build_dxr_acceleration_buffers(world* world, d3d12* d3d12) {
 }
 
 void world_render_commands(world* world, d3d12* d3d12, world_render_params* params) {
+	m_profile_zone("world_render_commands");
+	frame_allocator_next_frame(&world->frame_allocator);
+
 	d3d12->frame_constants_buffer_size = 0;
 	uint8* frame_constants_buffer = nullptr;
 	d3d12->frame_constants_buffer->Map(0, nullptr, (void**)&frame_constants_buffer);
@@ -1005,6 +1119,7 @@ void world_render_commands(world* world, d3d12* d3d12, world_render_params* para
 	d3d12->command_list->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
 	d3d12->command_list->SetDescriptorHeaps(1, &d3d12->cbv_srv_uav_descriptor_heap);
 	{
+		m_profile_zone("gbuffer pass");
 		D3D12_RESOURCE_BARRIER barriers[m_countof(d3d12->gbuffer_textures)] = {};
 		for (uint32 i = 0; i < m_countof(barriers); i += 1) {
 			barriers[i].Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
@@ -1043,9 +1158,49 @@ void world_render_commands(world* world, d3d12* d3d12, world_render_params* para
 		uint32 default_material_constants_offset = 0;
 		frame_constants_buffer_append(&default_material_constants, sizeof(default_material_constants), &default_material_constants_offset);
 
-		for (uint32 i = 0; i < world->models.size; i += 1) {
-			model* model = &world->models[i];
-			mat4 model_mat = mat4_identity();
+		// Culling goes coarse to fine: models in packets, then each visible model's node tree where a subtree outside
+		// the frustum is skipped whole and one inside needs no more tests, then the primitives of partially visible nodes
+		// in packets. Constants are only appended for what survives.
+		mat4 camera_view_project_mat;
+		// XMMATRIX rows are the columns of the same transform in mat4's column vector convention
+		XMStoreFloat4x4((XMFLOAT4X4*)&camera_view_project_mat, params->camera_view_project_mat);
+		frustum camera_frustum = frustum_from_mat4(camera_view_project_mat);
+		memory_arena* frame_arena = frame_allocator_arena(&world->frame_allocator);
+		auto cull_aabbs = [](const frustum& frustum, const aabb* bounds, uint32 count, uint32* visible_indices) {
+#ifdef MATH_AVX
+			if (simd_current_isa >= simd_isa_avx2) {
+				return frustum_cull_aabbs_avx(frustum, bounds, count, visible_indices);
+			}
+#endif
+			return frustum_cull_aabbs(frustum, bounds, count, visible_indices);
+		};
+
+		mat4 model_mat = mat4_identity();
+		aabb* model_bounds = frame_allocator_alloc<aabb>(&world->frame_allocator, world->models.size);
+		uint32* visible_model_indices = frame_allocator_alloc<uint32>(&world->frame_allocator, world->models.size);
+		parallel_for(&world->job_system, world->models.size, 256, [&](uint64 begin, uint64 end) {
+			for (uint64 i = begin; i < end; i += 1) {
+				model_bounds[i] = aabb_transform(world->models[i].bound, model_mat);
+			}
+		});
+		uint32 visible_model_count = cull_aabbs(camera_frustum, model_bounds, (uint32)world->models.size, visible_model_indices);
+
+		struct draw {
+			model* model;
+			model_mesh_primitive* primitive;
+			uint32 model_mat_offset;
+			uint32 node_mat_offset;
+			uint32 first_material_constants_offset;
+		};
+		array<draw> draws = { nullptr, 0, 0, frame_arena };
+		array<draw> partial_draws = { nullptr, 0, 0, frame_arena };
+		array<aabb> partial_draw_bounds = { nullptr, 0, 0, frame_arena };
+		struct node_visit {
+			model_node* node;
+			bool inside;
+		};
+		for (uint32 i = 0; i < visible_model_count; i += 1) {
+			model* model = &world->models[visible_model_indices[i]];
 			uint32 model_mat_offset = 0;
 			frame_constants_buffer_append(&model_mat, sizeof(model_mat), &model_mat_offset);
 
@@ -1063,50 +1218,36 @@ void world_render_commands(world* world, d3d12* d3d12, world_render_params* para
 			for (uint32 i = 0; i < model->scene_count; i += 1) {
 				model_scene* scene = &model->scenes[i];
 				for (uint32 i = 0; i < scene->node_index_count; i += 1) {
-					std::stack<model_node*> node_stack;
-					node_stack.push(&model->nodes[scene->node_indices[i]]);
-					while (!node_stack.empty()) {
-						model_node* node = node_stack.top();
-						node_stack.pop();
+					small_array<node_visit, 64> node_stack = {};
+					node_stack.arena = frame_arena;
+					node_stack.append({&model->nodes[scene->node_indices[i]], false});
+					while (node_stack.size > 0) {
+						node_visit visit = node_stack.back();
+						node_stack.pop_back();
+						if (!visit.inside) {
+							frustum_cull_result cull_result = frustum_cull_aabb(camera_frustum, aabb_transform(visit.node->bound, model_mat));
+							if (cull_result == frustum_cull_outside) {
+								continue;
+							}
+							visit.inside = cull_result == frustum_cull_inside;
+						}
+						model_node* node = visit.node;
 						for (uint32 i = 0; i < node->child_count; i += 1) {
-							model_node* child_node = &model->nodes[node->children[i]];
-							node_stack.push(child_node);
+							node_stack.append({&model->nodes[node->children[i]], visit.inside});
 						}
 						if (node->mesh_index < model->mesh_count) {
 							uint32 node_mat_offset = 0;
 							frame_constants_buffer_append(&node->global_transform_mat, sizeof(node->global_transform_mat), &node_mat_offset);
 							model_mesh* mesh = &model->meshes[node->mesh_index];
+							mat4 primitive_mat = model_mat * node->global_transform_mat;
 							for (uint32 i = 0; i < mesh->primitive_count; i += 1) {
-								model_mesh_primitive* primitive = &mesh->primitives[i];
-								uint32 primitive_constants_offset = default_material_constants_offset;
-								D3D12_GPU_DESCRIPTOR_HANDLE material_gpu_descriptor_handle = world->default_material_srv_descriptors;
-								if (primitive->material_index < model->material_count) {
-									primitive_constants_offset = first_material_constants_offset + primitive->material_index * material_constants_increment_size;
-									material_gpu_descriptor_handle = model->materials[primitive->material_index].texture_srv_descriptors;
-								}
-
-								d3d12->command_list->SetGraphicsRootConstantBufferView(0, frame_constants_buffer_gpu_address + world_constants_offset);
-								d3d12->command_list->SetGraphicsRootConstantBufferView(1, frame_constants_buffer_gpu_address + model_mat_offset);
-								d3d12->command_list->SetGraphicsRootConstantBufferView(2, frame_constants_buffer_gpu_address + node_mat_offset);
-								d3d12->command_list->SetGraphicsRootConstantBufferView(3, frame_constants_buffer_gpu_address + primitive_constants_offset);
-								d3d12->command_list->SetGraphicsRootDescriptorTable(4, material_gpu_descriptor_handle);
-
-								D3D12_VERTEX_BUFFER_VIEW vertex_buffer_view = {};
-								vertex_buffer_view.BufferLocation = primitive->vertex_buffer->GetGPUVirtualAddress();
-								vertex_buffer_view.SizeInBytes = primitive->vertex_count * sizeof(gpk_model_vertex);
-								vertex_buffer_view.StrideInBytes = sizeof(gpk_model_vertex);
-								d3d12->command_list->IASetVertexBuffers(0, 1, &vertex_buffer_view);
-
-								if (primitive->index_count == 0) {
-									d3d12->command_list->DrawInstanced(primitive->vertex_count, 1, 0, 0);
+								draw draw = {model, &mesh->primitives[i], model_mat_offset, node_mat_offset, first_material_constants_offset};
+								if (visit.inside) {
+									draws.append(draw);
 								}
 								else {
-									D3D12_INDEX_BUFFER_VIEW index_buffer_view = {};
-									index_buffer_view.BufferLocation = primitive->index_buffer->GetGPUVirtualAddress();
-									index_buffer_view.SizeInBytes = primitive->index_count * sizeof(uint16);
-									index_buffer_view.Format = DXGI_FORMAT_R16_UINT;
-									d3d12->command_list->IASetIndexBuffer(&index_buffer_view);
-									d3d12->command_list->DrawIndexedInstanced(primitive->index_count, 1, 0, 0, 0);
+									partial_draws.append(draw);
+									partial_draw_bounds.append(aabb_transform(mesh->primitives[i].bound, primitive_mat));
 								}
 							}
 						}
@@ -1114,6 +1255,49 @@ void world_render_commands(world* world, d3d12* d3d12, world_render_params* para
 				}
 			}
 		}
+		uint32* visible_partial_draw_indices = frame_allocator_alloc<uint32>(&world->frame_allocator, partial_draws.size);
+		uint32 visible_partial_draw_count = cull_aabbs(camera_frustum, partial_draw_bounds.elems, (uint32)partial_draw_bounds.size, visible_partial_draw_indices);
+		for (uint32 i = 0; i < visible_partial_draw_count; i += 1) {
+			draws.append(partial_draws[visible_partial_draw_indices[i]]);
+		}
+		m_profile_counter_add("culled models", world->models.size - visible_model_count);
+		m_profile_counter_add("culled primitives", partial_draws.size - visible_partial_draw_count);
+
+		for (draw& draw : draws) {
+			model* model = draw.model;
+			model_mesh_primitive* primitive = draw.primitive;
+			uint32 primitive_constants_offset = default_material_constants_offset;
+			D3D12_GPU_DESCRIPTOR_HANDLE material_gpu_descriptor_handle = world->default_material_srv_descriptors;
+			if (primitive->material_index < model->material_count) {
+				primitive_constants_offset = draw.first_material_constants_offset + primitive->material_index * material_constants_increment_size;
+				material_gpu_descriptor_handle = model->materials[primitive->material_index].texture_srv_descriptors;
+			}
+
+			d3d12->command_list->SetGraphicsRootConstantBufferView(0, frame_constants_buffer_gpu_address + world_constants_offset);
+			d3d12->command_list->SetGraphicsRootConstantBufferView(1, frame_constants_buffer_gpu_address + draw.model_mat_offset);
+			d3d12->command_list->SetGraphicsRootConstantBufferView(2, frame_constants_buffer_gpu_address + draw.node_mat_offset);
+			d3d12->command_list->SetGraphicsRootConstantBufferView(3, frame_constants_buffer_gpu_address + primitive_constants_offset);
+			d3d12->command_list->SetGraphicsRootDescriptorTable(4, material_gpu_descriptor_handle);
+
+			D3D12_VERTEX_BUFFER_VIEW vertex_buffer_view = {};
+			vertex_buffer_view.BufferLocation = primitive->vertex_buffer->GetGPUVirtualAddress();
+			vertex_buffer_view.SizeInBytes = primitive->vertex_count * sizeof(gpk_model_vertex);
+			vertex_buffer_view.StrideInBytes = sizeof(gpk_model_vertex);
+			d3d12->command_list->IASetVertexBuffers(0, 1, &vertex_buffer_view);
+
+			m_profile_counter_add("draw calls", 1);
+			if (primitive->index_count == 0) {
+				d3d12->command_list->DrawInstanced(primitive->vertex_count, 1, 0, 0);
+			}
+			else {
+				D3D12_INDEX_BUFFER_VIEW index_buffer_view = {};
+				index_buffer_view.BufferLocation = primitive->index_buffer->GetGPUVirtualAddress();
+				index_buffer_view.SizeInBytes = primitive->index_count * sizeof(uint16);
+				index_buffer_view.Format = DXGI_FORMAT_R16_UINT;
+				d3d12->command_list->IASetIndexBuffer(&index_buffer_view);
+				d3d12->command_list->DrawIndexedInstanced(primitive->index_count, 1, 0, 0, 0);
+			}
+		}
 
 		for (uint32 i = 0; i < m_countof(barriers); i += 1) {
 			barriers[i].Transition.StateBefore = D3D12_RESOURCE_STATE_RENDER_TARGET;
@@ -1257,15 +1441,18 @@ void world_render_commands(world* world, d3d12* d3d12, world_render_params* para
 }
 
 bool world_load_from_file(world* world, d3d12* d3d12, const char* file_name) {
+	m_profile_zone("world_load_from_file");
 	file_tokenizer ft;
 	if (!file_tokenizer_init(&ft, file_name)) {
 		return false;
 	}
 	auto delete_ft = scope_exit([&] { file_tokenizer_delete(ft); });
 
+	array<atom> model_files = {};
+	auto release_model_files = scope_exit([&] { model_files.release(); });
 	token object;
 	while (ft.get_token(&object)) {
-		if (!strncmp(object.ptr, "directional_light:", object.len)) {
+		if (object.equals("directional_light:")) {
 			token x, y, z, r, g, b;
 			if (!ft.get_token(&x) || !ft.get_token(&y) || !ft.get_token(&z) ||
 				!ft.get_token(&r) || !ft.get_token(&g) || !ft.get_token(&b)) {
@@ -1282,7 +1469,7 @@ bool world_load_from_file(world* world, d3d12* d3d12, const char* file_name) {
 			l.color = { fr, fg, fb };
 			world->direct_lights.append(l);
 		}
-		else if (!strncmp(object.ptr, "spherical_light:", object.len)) {
+		else if (object.equals("spherical_light:")) {
 			token x, y, z, r, g, b, radius;
 			if (!ft.get_token(&x) || !ft.get_token(&y) || !ft.get_token(&z) ||
 				!ft.get_token(&r) || !ft.get_token(&g) || !ft.get_token(&b) ||
@@ -1301,20 +1488,80 @@ bool world_load_from_file(world* world, d3d12* d3d12, const char* file_name) {
 			l.radius = fradius;
 			world->sphere_lights.append(l);
 		}
-		else if (!strncmp(object.ptr, "model:", object.len)) {
+		else if (object.equals("model:")) {
 			token file;
 			if (!ft.get_token(&file)) {
 				return false;
 			}
-			char c = file.ptr[file.len];
-			file.ptr[file.len] = '\0';
-			auto restore_char = scope_exit([&] { file.ptr[file.len] = c; });
-			if (!world_add_model(world, d3d12, file.ptr, transform_identity(), collision{ collision_type_none })) {
+			// Duplicates would fail in world_add_model_data anyway, reject them before their files are read.
+			atom model_file = atom_intern(file.ptr, file.len);
+			if (hash_map_find(&world->model_indices, model_file)) {
 				return false;
 			}
+			for (atom f : model_files) {
+				if (f == model_file) {
+					return false;
+				}
+			}
+			model_files.append(model_file);
 		}
 	}
 
+	// Model files are read in the background up to read_ahead_size bytes ahead of the model being added,
+	// so uploading one model overlaps with reading the next ones.
+	struct model_read {
+		async_file file;
+		uint8* buffer;
+		async_io_request request;
+		job_counter counter;
+	};
+	const uint64 read_ahead_size = m_megabytes(512);
+	model_read* model_reads = new model_read[model_files.size]();
+	uint32 model_read_count = 0;
+	uint64 pending_read_size = 0;
+	auto finish_model_reads = scope_exit([&] {
+		for (uint32 i = 0; i < model_read_count; i += 1) {
+			if (model_reads[i].buffer) {
+				async_io_wait(&world->async_io, &model_reads[i].counter);
+				async_io_buffer_free(model_reads[i].buffer, model_reads[i].file.size);
+			}
+			async_file_close(&model_reads[i].file);
+		}
+		delete[] model_reads;
+	});
+	for (uint32 i = 0; i < model_files.size; i += 1) {
+		while (model_read_count < model_files.size && pending_read_size < read_ahead_size) {
+			model_read* read = &model_reads[model_read_count];
+			if (!async_file_open(atom_str(model_files[model_read_count]), &read->file)) {
+				return false;
+			}
+			model_read_count += 1;
+			read->buffer = async_io_buffer_alloc(read->file.size);
+			if (!read->buffer) {
+				return false;
+			}
+			read->request.file = &read->file;
+			read->request.offset = 0;
+			read->request.size = read->file.size;
+			read->request.buffer = read->buffer;
+			read->request.priority = async_io_priority_normal;
+			read->request.counter = &read->counter;
+			async_io_read(&world->async_io, &read->request);
+			pending_read_size += read->file.size;
+		}
+		model_read* read = &model_reads[i];
+		async_io_wait(&world->async_io, &read->counter);
+		if (!read->request.success || read->request.bytes_read != read->file.size) {
+			return false;
+		}
+		if (!world_add_model_data(world, d3d12, model_files[i], read->buffer, read->file.size, transform_identity(), collision{ collision_type_none })) {
+			return false;
+		}
+		async_io_buffer_free(read->buffer, read->file.size);
+		read->buffer = nullptr;
+		pending_read_size -= read->file.size;
+	}
+
 	if (d3d12->dxr_enabled) {
 		world_build_dxr_acceleration_buffers(world, d3d12);
 	}
@@ -1343,7 +1590,7 @@ bool world_save_to_file(world* world, const char* file_name) {
 		file_data.append(buffer, len);
 	}
 	for (auto& m : world->models) {
-		int len = snprintf(buffer, sizeof(buffer), "model: %s\n", m.file_name);
+		int len = snprintf(buffer, sizeof(buffer), "model: %s\n", atom_str(m.file));
 		if (len < 0 || len >= sizeof(buffer)) {
 			return false;
 		}
@@ -1364,6 +1611,50 @@ bool world_save_to_file(world* world, const char* file_name) {
 	return true;
 }
 
+// Fills model_indices with the index of every model, largest memory_size + gpu_memory_size first.
+void world_sort_models_by_memory_size(world* world, uint32* model_indices) {
+	for (uint32 i = 0; i < world->models.size; i += 1) {
+		model_indices[i] = i;
+	}
+	std::sort(model_indices, model_indices + world->models.size, [world](uint32 a, uint32 b) {
+		return (world->models[a].memory_size + world->models[a].gpu_memory_size) > (world->models[b].memory_size + world->models[b].gpu_memory_size);
+	});
+}
+
+bool world_write_memory_report(world* world, const char* file_name, bool json) {
+	FILE* file = fopen(file_name, "w");
+	if (!file) {
+		return false;
+	}
+	auto close_file = scope_exit([&] { fclose(file); });
+
+	uint32* model_indices = new uint32[world->models.size + 1];
+	auto delete_model_indices = scope_exit([&] { delete[] model_indices; });
+	world_sort_models_by_memory_size(world, model_indices);
+
+	if (json) {
+		fprintf(file, "{");
+		memory_tracker_write_report(file, true);
+		fprintf(file, ",\"models\":[");
+		for (uint32 i = 0; i < world->models.size; i += 1) {
+			model* model = &world->models[model_indices[i]];
+			fprintf(file, "%s\n{\"file\":", i == 0 ? "" : ",");
+			profiler_write_json_string(file, atom_str(model->file));
+			fprintf(file, ",\"bytes\":%llu,\"gpu_bytes\":%llu}", (unsigned long long)model->memory_size, (unsigned long long)model->gpu_memory_size);
+		}
+		fprintf(file, "]}\n");
+	}
+	else {
+		memory_tracker_write_report(file, false);
+		fprintf(file, "\n%-64s %16s %16s\n", "model", "bytes", "gpu bytes");
+		for (uint32 i = 0; i < world->models.size; i += 1) {
+			model* model = &world->models[model_indices[i]];
+			fprintf(file, "%-64s %16llu %16llu\n", atom_str(model->file), (unsigned long long)model->memory_size, (unsigned long long)model->gpu_memory_size);
+		}
+	}
+	return !ferror(file);
+}
+
 //uint32 world_append_constant_buffer(world *world, void *data, uint32 data_size) {
 //	round_up(&world->constant_buffer_offset, 256u);
 //	uint32 offset = world->constant_buffer_offset;
@@ -1382,10 +1673,10 @@ bool world_save_to_file(world* world, const char* file_name) {
 //		XMMatrixMultiply(xmmatrix_transform(&model->transform), xmmatrix_transform(&transform))
 //	};
 //
-//	model_render_data *model_render_data = memory_arena_alloc<struct model_render_data>(&world->frame_memory_arena, 1);
+//	model_render_data *model_render_data = frame_allocator_alloc<struct model_render_data>(&world->frame_allocator, 1);
 //	model_render_data->model = model;
 //	model_render_data->model_mat_constant_buffer_offset = world_append_constant_buffer(world, &model_constant_buffer, sizeof(model_constant_buffer));
-//	model_render_data->meshes = memory_arena_alloc<struct mesh_render_data>(&world->frame_memory_arena, model->mesh_node_count);
+//	model_render_data->meshes = frame_allocator_alloc<struct mesh_render_data>(&world->frame_allocator, model->mesh_node_count);
 //	model_render_data->mesh_count = model->mesh_node_count;
 //	model_render_data->render_collision_shapes = render_collision_shapes;
 //	model_render_data->next = world->render_data.model_list;
@@ -1393,15 +1684,15 @@ bool world_save_to_file(world* world, const char* file_name) {
 //	world->render_data.model_list = model_render_data;
 //	world->render_data.model_count += 1;
 //
-//	uint32 *joint_mats_offsets = memory_arena_alloc<uint32>(&world->frame_memory_arena, model->skin_count);
+//	uint32 *joint_mats_offsets = frame_allocator_alloc<uint32>(&world->frame_allocator, model->skin_count);
 //	{
-//		memory_arena_undo_alloc_scope_exit(&world->frame_memory_arena);
+//		memory_arena_undo_alloc_scope_exit(frame_allocator_arena(&world->frame_allocator));
 //
 //		model_node *model_nodes = model->nodes;
 //		if (animation_index < model->animation_count) {
 //			model_animation *animation = &model->animations[animation_index];
 //
-//			model_nodes = memory_arena_alloc<struct model_node>(&world->frame_memory_arena, model->node_count);
+//			model_nodes = frame_allocator_alloc<struct model_node>(&world->frame_allocator, model->node_count);
 //			memcpy(model_nodes, model->nodes, model->node_count * sizeof(struct model_node));
 //
 //			for (uint32 i = 0; i < animation->channel_count; i += 1) {
@@ -1472,7 +1763,7 @@ bool world_save_to_file(world* world, const char* file_name) {
 //		}
 //		for (uint32 i = 0; i < model->skin_count; i += 1) {
 //			model_skin *skin = &model->skins[i];
-//			mat4 *joint_mats = memory_arena_alloc<mat4>(&world->frame_memory_arena, skin->joint_count);
+//			mat4 *joint_mats = frame_allocator_alloc<mat4>(&world->frame_allocator, skin->joint_count);
 //			for (uint32 i = 0; i < skin->joint_count; i += 1) {
 //				joint_mats[i] = model_nodes[skin->joints[i].node_index].global_transform_mat * skin->joints[i].inverse_bind_mat;
 //			}
@@ -1492,7 +1783,7 @@ bool world_save_to_file(world* world, const char* file_name) {
 //				mesh_render_data->joint_mats_constant_buffer_offset = world_append_constant_buffer(world, &node->global_transform_mat, sizeof(mat4));
 //			}
 //			mesh_render_data->primitive_count = mesh_render_data->mesh->primitive_count;
-//			mesh_render_data->primitives = memory_arena_alloc<mesh_primitive_render_data>(&world->frame_memory_arena, mesh_render_data->primitive_count);
+//			mesh_render_data->primitives = frame_allocator_alloc<mesh_primitive_render_data>(&world->frame_allocator, mesh_render_data->primitive_count);
 //			for (uint32 i = 0; i < mesh_render_data->primitive_count; i += 1) {
 //				model_mesh_primitive *primitive = &mesh_render_data->mesh->primitives[i];
 //				mesh_primitive_render_data *primitive_render_data = &mesh_render_data->primitives[i];